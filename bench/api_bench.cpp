@@ -0,0 +1,293 @@
+// Round-trip latency and throughput of individual SDK calls.
+//
+// Every call in --calls runs at each level of --concurrency (callers
+// sharing one camera) for --seconds. Each caller issues the call back to
+// back in Block mode, so a level measures what that many controller
+// threads contending for one device would see. Results go to stdout or
+// --out as a table, CSV or JSON (--format).
+//
+// The camera is whatever obsbot::dev provides: the vendor libdev with a
+// live device, or the simulation when built with OBSBOT_SIM_DEV.
+
+#include <atomic>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <thread>
+#include <vector>
+
+#include "bench_device.hpp"
+#include "bench_util.hpp"
+
+#ifdef OBSBOT_SIM_DEV
+#include "sim_control.hpp"
+#endif
+
+namespace {
+
+struct ApiCall {
+    const char* name;
+    const char* sdk;
+    // `i` numbers the caller's iterations, for setters that vary the value
+    int32_t (*run)(Device& device, uint64_t i);
+};
+
+const ApiCall kCalls[] = {
+    {"zoom_set", "cameraSetZoomAbsoluteR",
+     [](Device& d, uint64_t i) { return d.cameraSetZoomAbsoluteR(1.0f + (i % 11) * 0.1f); }},
+    {"zoom_get", "cameraGetZoomAbsoluteR",
+     [](Device& d, uint64_t) {
+         float zoom;
+         return d.cameraGetZoomAbsoluteR(zoom);
+     }},
+    {"motor_angle", "aiSetGimbalMotorAngleR",
+     [](Device& d, uint64_t i) { return d.aiSetGimbalMotorAngleR(i % 2 ? 5.f : -5.f, i % 2 ? 10.f : -10.f); }},
+    {"gimbal_state", "aiGetGimbalStateR",
+     [](Device& d, uint64_t) {
+         Device::AiGimbalStateInfo info;
+         return d.aiGetGimbalStateR(&info);
+     }},
+    {"attitude", "gimbalGetAttitudeInfoR",
+     [](Device& d, uint64_t) {
+         float xyz[3];
+         return d.gimbalGetAttitudeInfoR(xyz);
+     }},
+    {"brightness_get", "cameraGetImageBrightnessR",
+     [](Device& d, uint64_t) {
+         int32_t brightness;
+         return d.cameraGetImageBrightnessR(brightness);
+     }},
+    {"brightness_set", "cameraSetImageBrightnessR",
+     [](Device& d, uint64_t i) { return d.cameraSetImageBrightnessR(static_cast<int32_t>(45 + i % 10)); }},
+    {"ai_status", "aiGetAiStatusR",
+     [](Device& d, uint64_t) {
+         Device::AiStatus status;
+         return d.aiGetAiStatusR(&status);
+     }},
+    {"preset_list", "aiGetGimbalPresetListR",
+     [](Device& d, uint64_t) {
+         Device::DevDataArray ids;
+         return d.aiGetGimbalPresetListR(&ids);
+     }},
+    {"camera_status", "cameraGetCameraStatusU",
+     [](Device& d, uint64_t) {
+         Device::CameraStatus status;
+         return d.cameraGetCameraStatusU(status);
+     }},
+};
+
+const char* kDefaultCalls = "zoom_set,motor_angle,gimbal_state,brightness_get";
+
+const ApiCall* findCall(const std::string& name) {
+    for (auto& call : kCalls) {
+        if (name == call.name) {
+            return &call;
+        }
+    }
+    return nullptr;
+}
+
+std::vector<std::string> split(const std::string& list) {
+    std::vector<std::string> items;
+    std::stringstream stream(list);
+    std::string item;
+    while (std::getline(stream, item, ',')) {
+        if (!item.empty()) {
+            items.push_back(item);
+        }
+    }
+    return items;
+}
+
+struct Result {
+    const ApiCall* call;
+    size_t callers;
+    uint64_t ok;
+    uint64_t failed;
+    double seconds;
+    double mean, p50, p99, p999, max;
+
+    double throughput() const { return seconds > 0 ? ok / seconds : 0.0; }
+};
+
+Result measure(Device& device, const ApiCall& call, size_t callers, double seconds, size_t warmup) {
+    for (size_t i = 0; i < warmup; ++i) {
+        call.run(device, i);
+    }
+
+    std::vector<bench::Samples> latency(callers);
+    std::vector<uint64_t> failed(callers, 0);
+    std::atomic<size_t> ready{0};
+    std::atomic<bool> go{false};
+    bench::Clock::time_point start, end;
+
+    std::vector<std::thread> threads;
+    for (size_t t = 0; t < callers; ++t) {
+        threads.emplace_back([&, t] {
+            latency[t].reserve(4096);
+            ++ready;
+            while (!go.load(std::memory_order_acquire)) {
+                std::this_thread::yield();
+            }
+            for (uint64_t i = 0; bench::Clock::now() < end; ++i) {
+                auto t0 = bench::Clock::now();
+                if (call.run(device, i) == RM_RET_OK) {
+                    latency[t].add(bench::toMicros(bench::Clock::now() - t0));
+                } else {
+                    ++failed[t];
+                }
+            }
+        });
+    }
+    while (ready.load() < callers) {
+        std::this_thread::yield();
+    }
+    start = bench::Clock::now();
+    end = start + std::chrono::duration_cast<bench::Clock::duration>(std::chrono::duration<double>(seconds));
+    go.store(true, std::memory_order_release);
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    auto elapsed = bench::Clock::now() - start;
+
+    bench::Samples all;
+    Result result{&call, callers, 0, 0, std::chrono::duration<double>(elapsed).count(), 0, 0, 0, 0, 0};
+    for (size_t t = 0; t < callers; ++t) {
+        all.merge(latency[t]);
+        result.failed += failed[t];
+    }
+    result.ok = all.count();
+    result.mean = all.mean();
+    result.p50 = all.percentile(50);
+    result.p99 = all.percentile(99);
+    result.p999 = all.percentile(99.9);
+    result.max = all.max();
+    return result;
+}
+
+void writeText(std::ostream& out, const std::vector<Result>& results) {
+    char line[256];
+    std::snprintf(line, sizeof(line), "%-15s %7s %8s %6s %10s %10s %10s %10s %10s\n", "call", "callers", "ok",
+                  "failed", "calls/s", "p50 us", "p99 us", "p99.9 us", "max us");
+    out << line;
+    for (auto& r : results) {
+        std::snprintf(line, sizeof(line), "%-15s %7zu %8llu %6llu %10.1f %10.1f %10.1f %10.1f %10.1f\n",
+                      r.call->name, r.callers, static_cast<unsigned long long>(r.ok),
+                      static_cast<unsigned long long>(r.failed), r.throughput(), r.p50, r.p99, r.p999, r.max);
+        out << line;
+    }
+}
+
+void writeCsv(std::ostream& out, const std::vector<Result>& results) {
+    out << "call,sdk,callers,ok,failed,seconds,calls_per_s,mean_us,p50_us,p99_us,p999_us,max_us\n";
+    char line[256];
+    for (auto& r : results) {
+        std::snprintf(line, sizeof(line), "%s,%s,%zu,%llu,%llu,%.3f,%.1f,%.1f,%.1f,%.1f,%.1f,%.1f\n", r.call->name,
+                      r.call->sdk, r.callers, static_cast<unsigned long long>(r.ok),
+                      static_cast<unsigned long long>(r.failed), r.seconds, r.throughput(), r.mean, r.p50, r.p99,
+                      r.p999, r.max);
+        out << line;
+    }
+}
+
+void writeJson(std::ostream& out, Device& device, const std::vector<Result>& results) {
+    out << "{\n";
+#ifdef OBSBOT_SIM_DEV
+    sim::Config config = sim::config();
+    out << "  \"backend\": \"sim\",\n";
+    out << "  \"sim\": {\"latency_us\": " << config.latency_us << ", \"jitter_us\": " << config.jitter_us
+        << ", \"service_us\": " << config.service_us << "},\n";
+#else
+    out << "  \"backend\": \"libdev\",\n";
+#endif
+    out << "  \"device\": {\"sn\": \"" << device.devSn() << "\", \"name\": \"" << device.devName()
+        << "\", \"version\": \"" << device.devVersion() << "\"},\n";
+    out << "  \"results\": [\n";
+    char line[512];
+    for (size_t i = 0; i < results.size(); ++i) {
+        auto& r = results[i];
+        std::snprintf(line, sizeof(line),
+                      "    {\"call\": \"%s\", \"sdk\": \"%s\", \"callers\": %zu, \"ok\": %llu, \"failed\": %llu, "
+                      "\"seconds\": %.3f, \"calls_per_s\": %.1f, \"mean_us\": %.1f, \"p50_us\": %.1f, "
+                      "\"p99_us\": %.1f, \"p999_us\": %.1f, \"max_us\": %.1f}%s\n",
+                      r.call->name, r.call->sdk, r.callers, static_cast<unsigned long long>(r.ok),
+                      static_cast<unsigned long long>(r.failed), r.seconds, r.throughput(), r.mean, r.p50, r.p99,
+                      r.p999, r.max, i + 1 < results.size() ? "," : "");
+        out << line;
+    }
+    out << "  ]\n}\n";
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    if (bench::hasFlag(argc, argv, "--help") || bench::hasFlag(argc, argv, "--list")) {
+        std::cout << "usage: obsbot_bench [--calls " << kDefaultCalls << "] [--concurrency 1,4,16]\n"
+                  << "                    [--seconds 2] [--warmup 20] [--format text|csv|json] [--out FILE]\n"
+                  << "calls:\n";
+        for (auto& call : kCalls) {
+            std::printf("  %-15s %s\n", call.name, call.sdk);
+        }
+        return 0;
+    }
+    std::vector<const ApiCall*> calls;
+    for (auto& name : split(bench::arg(argc, argv, "--calls", kDefaultCalls))) {
+        const ApiCall* call = findCall(name);
+        if (!call) {
+            std::cerr << "Unknown call " << name << " (see --list)" << std::endl;
+            return 1;
+        }
+        calls.push_back(call);
+    }
+    std::vector<size_t> levels;
+    for (auto& level : split(bench::arg(argc, argv, "--concurrency", "1,4,16"))) {
+        size_t callers = static_cast<size_t>(std::atoi(level.c_str()));
+        if (callers > 0) {
+            levels.push_back(callers);
+        }
+    }
+    double seconds = bench::argDouble(argc, argv, "--seconds", 2);
+    size_t warmup = static_cast<size_t>(bench::argDouble(argc, argv, "--warmup", 20));
+    std::string format = bench::arg(argc, argv, "--format", "text");
+    const char* out_path = bench::arg(argc, argv, "--out", nullptr);
+    if (format != "text" && format != "csv" && format != "json") {
+        std::cerr << "Unknown format " << format << std::endl;
+        return 1;
+    }
+
+    auto device = bench::waitForDevice(std::chrono::seconds(10));
+    if (!device) {
+        std::cerr << "No camera found" << std::endl;
+        return 1;
+    }
+    std::cerr << "device " << device->devSn() << " (" << device->devName() << " " << device->devVersion() << ")"
+              << std::endl;
+
+    std::vector<Result> results;
+    for (auto* call : calls) {
+        for (size_t callers : levels) {
+            results.push_back(measure(*device, *call, callers, seconds, warmup));
+            std::cerr << "  " << call->name << " x" << callers << ": " << results.back().ok << " ok" << std::endl;
+        }
+    }
+
+    std::ofstream file;
+    if (out_path) {
+        file.open(out_path);
+        if (!file) {
+            std::cerr << "Cannot write " << out_path << std::endl;
+            return 1;
+        }
+    }
+    std::ostream& out = out_path ? file : std::cout;
+    if (format == "csv") {
+        writeCsv(out, results);
+    } else if (format == "json") {
+        writeJson(out, *device, results);
+    } else {
+        writeText(out, results);
+    }
+
+    Devices::get().close();
+    return 0;
+}
@@ -0,0 +1,89 @@
+// Serial Block reads versus pipelined NonBlock reads of aiGetGimbalStateR.
+//
+// "serial" issues --reads Block-mode getters back to back. "pipelined" keeps
+// up to --window NonBlock requests in flight through AsyncDevice.
+
+#include <condition_variable>
+#include <iostream>
+#include <mutex>
+
+#include "async_device.hpp"
+#include "bench_device.hpp"
+#include "bench_util.hpp"
+
+namespace {
+
+void report(const char* name, size_t ok, size_t failed, bench::Clock::duration elapsed, bench::Samples& latency) {
+    double seconds = std::chrono::duration<double>(elapsed).count();
+    std::printf("%-10s ok=%-6zu failed=%-4zu total=%8.1fms rate=%9.1f/s p50=%8.1fus p99=%8.1fus\n", name, ok,
+                failed, seconds * 1000.0, seconds > 0 ? ok / seconds : 0.0, latency.percentile(50),
+                latency.percentile(99));
+}
+
+void runSerial(Device& device, size_t reads) {
+    bench::Samples latency;
+    latency.reserve(reads);
+    size_t ok = 0;
+    auto start = bench::Clock::now();
+    for (size_t i = 0; i < reads; ++i) {
+        Device::AiGimbalStateInfo info;
+        auto t0 = bench::Clock::now();
+        if (device.aiGetGimbalStateR(&info) == RM_RET_OK) {
+            ++ok;
+        }
+        latency.add(bench::toMicros(bench::Clock::now() - t0));
+    }
+    report("serial", ok, reads - ok, bench::Clock::now() - start, latency);
+}
+
+void runPipelined(const std::shared_ptr<Device>& device, size_t reads, size_t window) {
+    AsyncDevice async(device);
+    std::mutex mutex;
+    std::condition_variable cond;
+    bench::Samples latency;
+    latency.reserve(reads);
+    size_t issued = 0, completed = 0, ok = 0;
+
+    auto start = bench::Clock::now();
+    std::unique_lock<std::mutex> lock(mutex);
+    while (completed < reads) {
+        while (issued < reads && issued - completed < window) {
+            ++issued;
+            auto t0 = bench::Clock::now();
+            lock.unlock();
+            async.gimbalState([&, t0](const AsyncReply<Device::AiGimbalStateInfo>& reply) {
+                std::lock_guard<std::mutex> guard(mutex);
+                latency.add(bench::toMicros(bench::Clock::now() - t0));
+                ok += reply.ok() ? 1 : 0;
+                ++completed;
+                cond.notify_one();
+            });
+            lock.lock();
+        }
+        cond.wait(lock, [&] { return completed == reads || (issued < reads && issued - completed < window); });
+    }
+    report("pipelined", ok, reads - ok, bench::Clock::now() - start, latency);
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    if (bench::hasFlag(argc, argv, "--help")) {
+        std::cout << "usage: obsbot_async_bench [--reads 500] [--window 32]" << std::endl;
+        return 0;
+    }
+    size_t reads = static_cast<size_t>(bench::argDouble(argc, argv, "--reads", 500));
+    size_t window = static_cast<size_t>(bench::argDouble(argc, argv, "--window", 32));
+
+    auto device = bench::waitForDevice(std::chrono::seconds(10));
+    if (!device) {
+        std::cerr << "No camera found" << std::endl;
+        return 1;
+    }
+    std::printf("device %s, %zu reads, window %zu\n", device->devSn().c_str(), reads, window);
+
+    runSerial(*device, reads);
+    runPipelined(device, reads, window);
+    Devices::get().close();
+    return 0;
+}
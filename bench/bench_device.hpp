@@ -0,0 +1,44 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <dev/devs.hpp>
+
+// Device discovery for the benchmarks that talk to a camera (real or
+// simulated, depending on how the tree was built)
+
+namespace bench {
+
+// Wait until at least `count` devices are enumerated or the timeout expires.
+// Returns whatever was found.
+inline std::vector<std::shared_ptr<Device>> waitForDevices(size_t count, std::chrono::milliseconds timeout) {
+    std::mutex mutex;
+    std::condition_variable cond;
+    auto& devices = Devices::get();
+
+    devices.setDevChangedCallback([&](std::string, bool, void*) { cond.notify_all(); }, nullptr);
+
+    std::unique_lock<std::mutex> lock(mutex);
+    cond.wait_for(lock, timeout, [&] { return devices.getDevNum() >= count; });
+    lock.unlock();
+    devices.setDevChangedCallback(nullptr, nullptr);
+
+    std::vector<std::shared_ptr<Device>> result;
+    for (auto& device : devices.getDevList()) {
+        if (device) {
+            result.push_back(device);
+        }
+    }
+    return result;
+}
+
+inline std::shared_ptr<Device> waitForDevice(std::chrono::milliseconds timeout) {
+    auto devices = waitForDevices(1, timeout);
+    return devices.empty() ? nullptr : devices.front();
+}
+
+} // namespace bench
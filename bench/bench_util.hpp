@@ -0,0 +1,85 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+// Shared helpers for the obsbot benchmark programs
+
+namespace bench {
+
+using Clock = std::chrono::steady_clock;
+
+inline double toMicros(Clock::duration d) {
+    return std::chrono::duration<double, std::micro>(d).count();
+}
+
+// Latency sample set in microseconds
+class Samples {
+public:
+    void reserve(size_t n) { values_.reserve(n); }
+    void add(double us) { values_.push_back(us); }
+    size_t count() const { return values_.size(); }
+
+    // p in [0, 100]; sorts lazily
+    double percentile(double p) {
+        if (values_.empty()) {
+            return 0.0;
+        }
+        if (!sorted_) {
+            std::sort(values_.begin(), values_.end());
+            sorted_ = true;
+        }
+        size_t idx = static_cast<size_t>(p / 100.0 * (values_.size() - 1) + 0.5);
+        return values_[std::min(idx, values_.size() - 1)];
+    }
+
+    double max() { return percentile(100.0); }
+
+    double mean() const {
+        double sum = 0.0;
+        for (double v : values_) {
+            sum += v;
+        }
+        return values_.empty() ? 0.0 : sum / values_.size();
+    }
+
+    void merge(const Samples& other) {
+        values_.insert(values_.end(), other.values_.begin(), other.values_.end());
+        sorted_ = false;
+    }
+
+private:
+    std::vector<double> values_;
+    bool sorted_ = false;
+};
+
+// Minimal "--name value" argument lookup
+inline const char* arg(int argc, char** argv, const char* name, const char* fallback) {
+    for (int i = 1; i + 1 < argc; ++i) {
+        if (std::strcmp(argv[i], name) == 0) {
+            return argv[i + 1];
+        }
+    }
+    return fallback;
+}
+
+inline double argDouble(int argc, char** argv, const char* name, double fallback) {
+    const char* value = arg(argc, argv, name, nullptr);
+    return value ? std::atof(value) : fallback;
+}
+
+inline bool hasFlag(int argc, char** argv, const char* name) {
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], name) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+} // namespace bench
@@ -0,0 +1,71 @@
+// Startup cost of reading a camera's parameter ranges and video formats.
+//
+// "cold" queries every range over the device channel and saves the result
+// to --cache; "warm" opens the saved cache, as the next start would, and
+// looks the camera up by model code and firmware version. Each mode runs
+// --rounds times and reports the per-startup time.
+
+#include <cstdio>
+#include <iostream>
+#include <unistd.h>
+
+#include "bench_device.hpp"
+#include "bench_util.hpp"
+#include "capability_cache.hpp"
+
+int main(int argc, char** argv) {
+    if (bench::hasFlag(argc, argv, "--help")) {
+        std::cout << "usage: obsbot_caps_bench [--rounds 10] [--cache /tmp/obsbot_caps_bench.cache]" << std::endl;
+        return 0;
+    }
+    size_t rounds = static_cast<size_t>(bench::argDouble(argc, argv, "--rounds", 10));
+    std::string path = bench::arg(argc, argv, "--cache", "/tmp/obsbot_caps_bench.cache");
+
+    auto device = bench::waitForDevice(std::chrono::seconds(10));
+    if (!device) {
+        std::cerr << "No camera found" << std::endl;
+        return 1;
+    }
+    std::cout << device->devName() << " model=" << device->devModelCode() << " version=" << device->devVersion()
+              << std::endl;
+
+    bench::Samples cold, warm;
+    DeviceCapabilities caps;
+    for (size_t i = 0; i < rounds; ++i) {
+        ::unlink(path.c_str());
+        auto t0 = bench::Clock::now();
+        CapabilityCache cache;
+        bool cached = true;
+        if (!cache.open(path) || !cache.get(*device, caps, &cached) || cached || !cache.save()) {
+            std::cerr << "Cold start failed" << std::endl;
+            return 1;
+        }
+        cold.add(bench::toMicros(bench::Clock::now() - t0));
+    }
+    for (size_t i = 0; i < rounds; ++i) {
+        auto t0 = bench::Clock::now();
+        CapabilityCache cache;
+        bool cached = false;
+        if (!cache.open(path) || !cache.get(*device, caps, &cached) || !cached) {
+            std::cerr << "Warm start missed the cache" << std::endl;
+            return 1;
+        }
+        warm.add(bench::toMicros(bench::Clock::now() - t0));
+    }
+
+    for (size_t i = 0; i < DeviceCapabilities::RangeCount; ++i) {
+        auto which = static_cast<DeviceCapabilities::Range>(i);
+        const auto& range = caps.range(which);
+        if (range.valid_) {
+            std::printf("  %-13s %ld..%ld step %ld default %ld\n", DeviceCapabilities::rangeName(which), range.min_,
+                        range.max_, range.step_, range.default_);
+        } else {
+            std::printf("  %-13s unsupported\n", DeviceCapabilities::rangeName(which));
+        }
+    }
+    std::printf("  formats       %zu\n", caps.formats.size());
+    std::printf("cold  p50=%10.1fus max=%10.1fus\n", cold.percentile(50), cold.max());
+    std::printf("warm  p50=%10.1fus max=%10.1fus\n", warm.percentile(50), warm.max());
+    Devices::get().close();
+    return 0;
+}
@@ -0,0 +1,189 @@
+// Cost of checksumming ingested media.
+//
+// First the raw speed of each Checksum kind over a --buffer-mb buffer. Then
+// one simulated camera is ingested three times. "after" ingests without a
+// checksum and then reads every file back to hash it, the way a copy used
+// to be checked; the files are evicted from the page cache first, as
+// multi-GB clips would be by then. "crc32c" and "xxh64" hash while the files
+// stream in. Every file must pass MediaIngest::verify(), and one file is
+// then corrupted to see verify() catch it.
+
+#include <cstdlib>
+#include <fcntl.h>
+#include <iostream>
+#include <list>
+#include <unistd.h>
+#include <vector>
+
+#include "bench_util.hpp"
+#include "media_ingest.hpp"
+#include "status_pump.hpp"
+
+#ifdef OBSBOT_SIM_DEV
+#include "sim_control.hpp"
+#endif
+
+namespace {
+
+double hashSpeed(Checksum::Kind kind, const std::vector<uint8_t>& buffer, int rounds) {
+    Checksum checksum(kind);
+    auto t0 = bench::Clock::now();
+    for (int i = 0; i < rounds; ++i) {
+        checksum.update(buffer.data(), buffer.size());
+    }
+    double us = bench::toMicros(bench::Clock::now() - t0);
+    // Keep the result alive
+    if (checksum.value() == 1) {
+        std::printf(" ");
+    }
+    return buffer.size() * double(rounds) / (1024.0 * 1024.0 * 1024.0) / (us / 1e6);
+}
+
+void evict(const std::string& path) {
+    int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd >= 0) {
+        ::fdatasync(fd);
+        ::posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+        ::close(fd);
+    }
+}
+
+// Reads `path` and returns its checksum
+uint64_t hashFile(const std::string& path, Checksum::Kind kind) {
+    Checksum checksum(kind);
+    std::vector<uint8_t> buffer(1 << 20);
+    int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return 0;
+    }
+    ssize_t n;
+    while ((n = ::read(fd, buffer.data(), buffer.size())) > 0) {
+        checksum.update(buffer.data(), static_cast<size_t>(n));
+    }
+    ::close(fd);
+    return checksum.value();
+}
+
+struct Run {
+    double ingest_ms = 0;
+    double check_ms = 0; // separate pass after the ingest
+    uint64_t files = 0;
+    uint64_t bytes = 0;
+    size_t verified = 0;
+};
+
+} // namespace
+
+int main(int argc, char** argv) {
+    if (bench::hasFlag(argc, argv, "--help")) {
+        std::cout << "usage: obsbot_checksum_bench [--buffer-mb 64] [--files 8] [--file-mb 16]" << std::endl;
+        return 0;
+    }
+#ifndef OBSBOT_SIM_DEV
+    std::cerr << "obsbot_checksum_bench needs the simulated libdev (OBSBOT_SIM_DEV)" << std::endl;
+    return 1;
+#else
+    size_t buffer_mb = std::max<size_t>(1, static_cast<size_t>(bench::argDouble(argc, argv, "--buffer-mb", 64)));
+    size_t files = std::max<size_t>(1, static_cast<size_t>(bench::argDouble(argc, argv, "--files", 8)));
+    size_t file_mb = std::max<size_t>(1, static_cast<size_t>(bench::argDouble(argc, argv, "--file-mb", 16)));
+
+    std::vector<uint8_t> buffer(buffer_mb << 20);
+    uint32_t seed = 1;
+    for (auto& byte : buffer) {
+        seed = seed * 1664525u + 1013904223u;
+        byte = static_cast<uint8_t>(seed >> 24);
+    }
+    std::printf("crc32c (%s): %5.1f GB/s\n", Checksum::hardwareCrc32c() ? "hardware" : "tables",
+                hashSpeed(Checksum::Crc32c, buffer, 8));
+    std::printf("xxh64:           %5.1f GB/s\n", hashSpeed(Checksum::Xxh64, buffer, 8));
+
+    ::setenv("OBSBOT_SIM_MTP_FILES", std::to_string(files).c_str(), 1);
+    ::setenv("OBSBOT_SIM_MTP_FILE_KB", std::to_string(file_mb * 1024).c_str(), 1);
+    char temp[] = "/tmp/obsbot_checksum_XXXXXX";
+    if (!::mkdtemp(temp)) {
+        std::cerr << "Failed to create a temporary directory" << std::endl;
+        return 1;
+    }
+    std::string root = temp;
+
+    StatusPump pump;
+    FleetManager fleet(pump);
+    pump.start();
+    fleet.start();
+    if (!fleet.waitFor(1, std::chrono::seconds(10))) {
+        std::cerr << "No camera found" << std::endl;
+        return 1;
+    }
+    auto camera = fleet.cameras().front();
+    std::string sn = camera->sn();
+    std::vector<std::string> paths;
+    std::list<MtpFileInfo> infos;
+    camera->device()->mtpGetDirFileInfo("/DCIM/100MEDIA", infos);
+    for (auto& info : infos) {
+        paths.push_back("/DCIM/100MEDIA/" + info.file_name_);
+    }
+
+    auto ingestWith = [&](const char* name, Checksum::Kind kind) {
+        MediaIngest::Options options;
+        options.checksum = kind;
+        MediaIngest ingest(fleet, root + "/" + name, options);
+        Run run;
+        auto t0 = bench::Clock::now();
+        ingest.ingest(sn);
+        ingest.waitIdle(std::chrono::seconds(600));
+        run.ingest_ms = bench::toMicros(bench::Clock::now() - t0) / 1000;
+        run.files = ingest.files();
+        run.bytes = ingest.bytes();
+        if (kind == Checksum::None) {
+            for (auto& path : paths) {
+                evict(ingest.localPath(sn, path));
+            }
+            t0 = bench::Clock::now();
+            for (auto& path : paths) {
+                run.verified += hashFile(ingest.localPath(sn, path), Checksum::Crc32c) != 0;
+            }
+            run.check_ms = bench::toMicros(bench::Clock::now() - t0) / 1000;
+        } else {
+            for (auto& path : paths) {
+                run.verified += ingest.verify(sn, path);
+            }
+        }
+        std::printf("%-7s ingest %7.1f ms + check %6.1f ms = %7.1f ms  files=%llu (%.0f MB) checked=%zu\n", name,
+                    run.ingest_ms, run.check_ms, run.ingest_ms + run.check_ms,
+                    static_cast<unsigned long long>(run.files), run.bytes / (1024.0 * 1024.0), run.verified);
+        return run;
+    };
+
+    Run after = ingestWith("after", Checksum::None);
+    Run crc = ingestWith("crc32c", Checksum::Crc32c);
+    Run xxh = ingestWith("xxh64", Checksum::Xxh64);
+
+    // A flipped byte must be caught
+    MediaIngest check(fleet, root + "/crc32c");
+    std::string victim = check.localPath(sn, paths.front());
+    bool caught = false;
+    int fd = ::open(victim.c_str(), O_RDWR | O_CLOEXEC);
+    uint8_t byte = 0;
+    if (fd >= 0 && ::pread(fd, &byte, 1, 4096) == 1) {
+        byte ^= 0x01;
+        caught = ::pwrite(fd, &byte, 1, 4096) == 1 && !check.verify(sn, paths.front());
+    }
+    if (fd >= 0) {
+        ::close(fd);
+    }
+    std::printf("corrupted copy %s\n", caught ? "detected" : "NOT detected");
+
+    bool ok = caught && after.files == paths.size() && crc.verified == paths.size() && xxh.verified == paths.size();
+    if (!ok) {
+        std::printf("FAILED\n");
+    }
+    fleet.stop();
+    pump.stop();
+    Devices::get().close();
+    std::string cleanup = "rm -rf '" + root + "'";
+    if (std::system(cleanup.c_str()) != 0) {
+        std::cerr << "Failed to remove " << root << std::endl;
+    }
+    return ok ? 0 : 1;
+#endif
+}
@@ -0,0 +1,281 @@
+// Throughput and latency of the control socket.
+//
+// Runs a ControlServer on its own reactor thread; --clients client threads
+// then each pipeline --requests commands with up to --window of them in
+// flight, spread over every camera. --op selects the
+// command: "ping" is answered by the server itself and measures the socket
+// path alone; "setting" alternates the brightness so every write reaches the
+// camera; "attitude" reads the gimbal attitude; "speed" sends gimbal speeds
+// as a joystick would, which the server coalesces, and with --speed-hz also
+// paces to that many speeds per camera and second. Reports requests per
+// second, round-trip latency, how many responses overtook an earlier
+// request, how many speeds were superseded, and heap allocations per request
+// over the whole process.
+
+#include <atomic>
+#include <cstdlib>
+#include <iostream>
+#include <new>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+#include "bench_util.hpp"
+#include "control_server.hpp"
+#include "settings_snapshot.hpp"
+#include "status_pump.hpp"
+
+#ifdef OBSBOT_SIM_DEV
+#include "sim_control.hpp"
+#endif
+
+namespace {
+
+std::atomic<uint64_t> g_allocations{0};
+
+struct ClientResult {
+    bench::Samples latency;
+    uint64_t errors = 0;
+    uint64_t overtaken = 0;
+    uint64_t superseded = 0;
+    uint64_t preempted = 0;
+    bool ok = true;
+};
+
+int connectTo(const std::string& path) {
+    int fd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    sockaddr_un addr{};
+    addr.sun_family = AF_UNIX;
+    std::snprintf(addr.sun_path, sizeof(addr.sun_path), "%s", path.c_str());
+    if (fd >= 0 && ::connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0) {
+        ::close(fd);
+        fd = -1;
+    }
+    return fd;
+}
+
+bool sendAll(int fd, const uint8_t* data, size_t size) {
+    while (size > 0) {
+        ssize_t n = ::send(fd, data, size, MSG_NOSIGNAL);
+        if (n <= 0) {
+            return false;
+        }
+        data += n;
+        size -= static_cast<size_t>(n);
+    }
+    return true;
+}
+
+// One blocking request/response, for setup
+bool call(int fd, control::Op op, std::vector<uint8_t>& payload) {
+    uint8_t frame[control::kMaxRequestSize];
+    if (!sendAll(fd, frame, control::encodeRequest(frame, 0, op, 0))) {
+        return false;
+    }
+    uint8_t buffer[control::kMaxResponseSize];
+    size_t have = 0;
+    control::Response response;
+    long size;
+    while ((size = control::decodeResponse(buffer, have, response)) == 0) {
+        ssize_t n = ::recv(fd, buffer + have, sizeof(buffer) - have, 0);
+        if (n <= 0) {
+            return false;
+        }
+        have += static_cast<size_t>(n);
+    }
+    payload.assign(response.payload, response.payload + response.payload_size);
+    return size > 0 && response.result == RM_RET_OK;
+}
+
+std::vector<uint16_t> listCameras(int fd) {
+    std::vector<uint8_t> payload;
+    std::vector<uint16_t> cameras;
+    if (!call(fd, control::ListCameras, payload)) {
+        return cameras;
+    }
+    for (size_t pos = 0; pos + 3 <= payload.size() && payload[pos + 2] > 0;) {
+        cameras.push_back(control::load16(payload.data() + pos));
+        pos += 3 + payload[pos + 2];
+    }
+    return cameras;
+}
+
+void runClient(const std::string& path, control::Op op, size_t requests, size_t window, ClientResult& result) {
+    int fd = connectTo(path);
+    std::vector<uint16_t> cameras = fd >= 0 ? listCameras(fd) : std::vector<uint16_t>();
+    if (cameras.empty()) {
+        result.ok = false;
+        if (fd >= 0) {
+            ::close(fd);
+        }
+        return;
+    }
+
+    std::vector<bench::Clock::time_point> sent(window);
+    std::vector<uint8_t> out(window * control::kMaxRequestSize);
+    std::vector<uint8_t> in(64 * 1024);
+    size_t in_len = 0;
+    result.latency.reserve(requests);
+
+    uint32_t next = 0;
+    size_t in_flight = 0;
+    uint32_t newest = 0;
+    while (result.latency.count() < requests) {
+        size_t len = 0;
+        for (; in_flight < window && next < requests; ++next, ++in_flight) {
+            uint32_t args[3] = {};
+            size_t count = 0;
+            if (op == control::SettingSet) {
+                args[0] = SettingsSnapshot::Brightness;
+                args[1] = (next / cameras.size()) % 2 ? 40 : 60;
+                count = 3;
+            } else if (op == control::GimbalSpeed) {
+                args[0] = control::wordOf(0.f);
+                args[1] = control::wordOf(static_cast<float>(next % 60) - 30.f);
+                count = 2;
+            }
+            uint16_t camera = cameras[next % cameras.size()];
+            len += control::encodeRequest(out.data() + len, next, op, camera, args, count);
+            sent[next % window] = bench::Clock::now();
+        }
+        if (len > 0 && !sendAll(fd, out.data(), len)) {
+            result.ok = false;
+            break;
+        }
+
+        ssize_t n = ::recv(fd, in.data() + in_len, in.size() - in_len, 0);
+        if (n <= 0) {
+            result.ok = false;
+            break;
+        }
+        in_len += static_cast<size_t>(n);
+        size_t pos = 0;
+        control::Response response;
+        long size;
+        while ((size = control::decodeResponse(in.data() + pos, in_len - pos, response)) > 0) {
+            auto now = bench::Clock::now();
+            result.latency.add(bench::toMicros(now - sent[response.id % window]));
+            result.superseded += response.result == control::kResultSuperseded;
+            result.preempted += response.result == control::kResultPreempted;
+            result.errors += response.result != RM_RET_OK && response.result != control::kResultSuperseded &&
+                             response.result != control::kResultPreempted;
+            result.overtaken += response.id < newest;
+            newest = std::max(newest, response.id);
+            --in_flight;
+            pos += static_cast<size_t>(size);
+        }
+        if (size < 0) {
+            result.ok = false;
+            break;
+        }
+        std::memmove(in.data(), in.data() + pos, in_len - pos);
+        in_len -= pos;
+    }
+    ::close(fd);
+}
+
+} // namespace
+
+void* operator new(size_t size) {
+    g_allocations.fetch_add(1, std::memory_order_relaxed);
+    if (void* p = std::malloc(size ? size : 1)) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept {
+    std::free(p);
+}
+
+void operator delete(void* p, size_t) noexcept {
+    std::free(p);
+}
+
+int main(int argc, char** argv) {
+    if (bench::hasFlag(argc, argv, "--help")) {
+        std::cout << "usage: obsbot_control_bench [--op ping|setting|attitude|speed] [--cameras 2] [--clients 8] "
+                     "[--requests 20000] [--window 64] [--speed-hz 0] [--socket /tmp/obsbot_control_bench.sock]"
+                  << std::endl;
+        return 0;
+    }
+    std::string op_name = bench::arg(argc, argv, "--op", "ping");
+    size_t cameras = static_cast<size_t>(bench::argDouble(argc, argv, "--cameras", 2));
+    size_t clients = static_cast<size_t>(bench::argDouble(argc, argv, "--clients", 8));
+    size_t requests = static_cast<size_t>(bench::argDouble(argc, argv, "--requests", 20000));
+    size_t window = std::max<size_t>(1, static_cast<size_t>(bench::argDouble(argc, argv, "--window", 64)));
+    double speed_hz = bench::argDouble(argc, argv, "--speed-hz", 0);
+    std::string path = bench::arg(argc, argv, "--socket", "/tmp/obsbot_control_bench.sock");
+    control::Op op = op_name == "setting"    ? control::SettingSet
+                     : op_name == "attitude" ? control::GimbalAttitude
+                     : op_name == "speed"    ? control::GimbalSpeed
+                                             : control::Ping;
+
+    Reactor reactor;
+    StatusPump pump;
+    FleetManager fleet(pump);
+    ControlServer server(reactor, fleet, window);
+    server.setSpeedRate(speed_hz);
+    pump.start();
+    fleet.start();
+#ifdef OBSBOT_SIM_DEV
+    fleet.waitFor(1, std::chrono::seconds(10));
+    while (fleet.size() < cameras) {
+        sim::plug();
+        fleet.waitFor(fleet.size() + 1, std::chrono::seconds(1));
+    }
+#endif
+    if (!fleet.waitFor(cameras, std::chrono::seconds(10))) {
+        std::cerr << "No camera found" << std::endl;
+        return 1;
+    }
+    if (!reactor.valid() || !server.listen(path)) {
+        std::cerr << "Failed to listen on " << path << std::endl;
+        return 1;
+    }
+    std::thread loop([&] { reactor.run(); });
+
+    std::vector<ClientResult> results(clients);
+    std::vector<std::thread> threads;
+    uint64_t allocations = g_allocations.load();
+    auto t0 = bench::Clock::now();
+    for (size_t i = 0; i < clients; ++i) {
+        threads.emplace_back([&, i] { runClient(path, op, requests, window, results[i]); });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    double seconds = bench::toMicros(bench::Clock::now() - t0) / 1e6;
+    allocations = g_allocations.load() - allocations;
+
+    reactor.stop();
+    loop.join();
+    server.close();
+
+    bench::Samples latency;
+    ClientResult total;
+    for (auto& result : results) {
+        latency.merge(result.latency);
+        total.errors += result.errors;
+        total.overtaken += result.overtaken;
+        total.superseded += result.superseded;
+        total.preempted += result.preempted;
+        total.ok = total.ok && result.ok;
+    }
+    size_t done = latency.count();
+    std::printf("op=%s cameras=%zu clients=%zu window=%zu: %.0f req/s  p50=%.1fus p99=%.1fus max=%.1fus\n",
+                op_name.c_str(), fleet.size(), clients, window, done / seconds, latency.percentile(50),
+                latency.percentile(99), latency.max());
+    std::printf("  requests=%zu errors=%llu overtaken=%llu superseded=%llu preempted=%llu batches=%llu "
+                "allocations/request=%.3f %s\n",
+                done, static_cast<unsigned long long>(total.errors), static_cast<unsigned long long>(total.overtaken),
+                static_cast<unsigned long long>(total.superseded), static_cast<unsigned long long>(total.preempted),
+                static_cast<unsigned long long>(server.batches()),
+                done ? double(allocations) / done : 0.0, total.ok ? "" : "FAILED");
+    fleet.stop();
+    pump.stop();
+    Devices::get().close();
+    return total.ok ? 0 : 1;
+}
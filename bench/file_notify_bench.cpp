@@ -0,0 +1,228 @@
+// Time from taking a photo to having it on disk.
+//
+// One simulated Tail Air holds --clips files, which are ingested first so
+// that only new photos are left to fetch. Then --photos photos are taken one
+// at a time with cameraSetTakePhotosR, each waiting for the previous one to
+// be stored:
+//
+//   "event"   MediaIngest::onDeviceEvent() queues the announced file
+//   "poll"    no events; ingest() walks the storage every --poll-ms
+//   "backlog" events again, into an empty directory at USB speed, so every
+//             photo is announced while the card is still being copied
+//
+// The latency includes the camera's own time to take the photo. Also reports
+// the walks each mode needed and how many already stored files they listed.
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdlib>
+#include <iostream>
+#include <mutex>
+#include <set>
+#include <thread>
+
+#include "bench_util.hpp"
+#include "media_ingest.hpp"
+#include "status_pump.hpp"
+
+#ifdef OBSBOT_SIM_DEV
+#include "sim_control.hpp"
+#endif
+
+namespace {
+
+// Where the fleet's device events go; swapped between the modes
+struct EventTarget {
+    std::mutex mutex;
+    MediaIngest* ingest = nullptr;
+
+    void set(MediaIngest* target) {
+        std::lock_guard<std::mutex> lock(mutex);
+        ingest = target;
+    }
+
+    void forward(const std::string& sn, int32_t event_type, const void* result) {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (ingest) {
+            ingest->onDeviceEvent(sn, event_type, result);
+        }
+    }
+};
+
+// Photos stored, by number, as reported by the MediaIngest listener
+struct Photos {
+    std::mutex mutex;
+    std::condition_variable stored;
+    std::set<unsigned long> numbers;
+
+    void onStored(const std::string& path, bool ok) {
+        size_t at = path.rfind("/IMG_");
+        if (!ok || at == std::string::npos) {
+            return;
+        }
+        std::lock_guard<std::mutex> lock(mutex);
+        numbers.insert(std::strtoul(path.c_str() + at + 5, nullptr, 10));
+        stored.notify_all();
+    }
+
+    bool waitFor(unsigned long number, std::chrono::milliseconds timeout) {
+        std::unique_lock<std::mutex> lock(mutex);
+        return stored.wait_for(lock, timeout, [this, number] { return numbers.count(number) > 0; });
+    }
+};
+
+struct Mode {
+    bench::Samples latency;
+    size_t stored = 0;
+    uint64_t walks = 0;
+    uint64_t listed = 0; // files a walk found already stored
+};
+
+// Takes `photos` photos and times each until `ingest` reports it. The sim
+// numbers new photos on from the last file on the card, `next` is the first.
+Mode takePhotos(MediaIngest& ingest, Device& device, Photos& taken, unsigned long& next, size_t photos) {
+    Mode mode;
+    uint64_t walks = ingest.walks();
+    uint64_t skipped = ingest.skipped();
+    for (size_t i = 0; i < photos; ++i) {
+        auto t0 = bench::Clock::now();
+        if (device.cameraSetTakePhotosR(1, 0) != RM_RET_OK) {
+            break;
+        }
+        if (!taken.waitFor(next++, std::chrono::seconds(30))) {
+            break;
+        }
+        mode.latency.add(bench::toMicros(bench::Clock::now() - t0));
+        ++mode.stored;
+    }
+    mode.walks = ingest.walks() - walks;
+    mode.listed = ingest.skipped() - skipped;
+    return mode;
+}
+
+void print(const char* name, Mode& mode) {
+    std::printf("%-8s p50 %7.1f ms  p99 %7.1f ms  stored=%zu walks=%llu listed=%llu\n", name,
+                mode.latency.percentile(50) / 1000, mode.latency.percentile(99) / 1000, mode.stored,
+                static_cast<unsigned long long>(mode.walks), static_cast<unsigned long long>(mode.listed));
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    if (bench::hasFlag(argc, argv, "--help")) {
+        std::cout << "usage: obsbot_file_notify_bench [--clips 1000] [--clip-kb 1024] [--photos 10] [--poll-ms 1000]"
+                  << std::endl;
+        return 0;
+    }
+#ifndef OBSBOT_SIM_DEV
+    std::cerr << "obsbot_file_notify_bench needs the simulated libdev (OBSBOT_SIM_DEV)" << std::endl;
+    return 1;
+#else
+    size_t clips = std::max<size_t>(1, static_cast<size_t>(bench::argDouble(argc, argv, "--clips", 1000)));
+    size_t clip_kb = std::max<size_t>(1, static_cast<size_t>(bench::argDouble(argc, argv, "--clip-kb", 1024)));
+    size_t photos = std::max<size_t>(1, static_cast<size_t>(bench::argDouble(argc, argv, "--photos", 10)));
+    auto poll = std::chrono::milliseconds(
+        std::max<int64_t>(1, static_cast<int64_t>(bench::argDouble(argc, argv, "--poll-ms", 1000))));
+    ::setenv("OBSBOT_SIM_MTP_FILES", std::to_string(clips).c_str(), 1);
+    ::setenv("OBSBOT_SIM_MTP_FILE_KB", std::to_string(clip_kb).c_str(), 1);
+    ::setenv("OBSBOT_SIM_PRODUCT", "tailair", 1);
+
+    char temp[] = "/tmp/obsbot_notify_XXXXXX";
+    if (!::mkdtemp(temp)) {
+        std::cerr << "Failed to create a temporary directory" << std::endl;
+        return 1;
+    }
+    std::string root = temp;
+
+    StatusPump pump;
+    FleetManager fleet(pump);
+    EventTarget target;
+    fleet.setEventListener([&target](const std::string& sn, int32_t event_type, const void* result) {
+        target.forward(sn, event_type, result);
+    });
+    pump.start();
+    fleet.start();
+    if (!fleet.waitFor(1, std::chrono::seconds(10))) {
+        std::cerr << "No camera found" << std::endl;
+        return 1;
+    }
+    auto camera = fleet.cameras().front();
+    std::string sn = camera->sn();
+    Device& device = *camera->device();
+    Photos taken;
+    unsigned long next = clips + 1;
+    auto listen = [&taken](const std::string&, const std::string& path, bool ok) { taken.onStored(path, ok); };
+
+    // The card is already on disk
+    sim::Config config = sim::config();
+    uint32_t usb_mbps = config.mtp_mbps;
+    config.mtp_mbps = 2000;
+    sim::setConfig(config);
+    {
+        MediaIngest first(fleet, root + "/synced");
+        first.ingest(sn);
+        first.waitIdle(std::chrono::seconds(600));
+        std::printf("initial sync: %llu files\n", static_cast<unsigned long long>(first.files()));
+    }
+    config.mtp_mbps = usb_mbps;
+    sim::setConfig(config);
+
+    Mode event;
+    {
+        MediaIngest ingest(fleet, root + "/synced");
+        ingest.setListener(listen);
+        target.set(&ingest);
+        event = takePhotos(ingest, device, taken, next, photos);
+        target.set(nullptr);
+        ingest.stop();
+    }
+    print("event", event);
+
+    Mode polled;
+    {
+        MediaIngest ingest(fleet, root + "/synced");
+        ingest.setListener(listen);
+        std::atomic<bool> polling{true};
+        std::thread poller([&] {
+            while (polling.load()) {
+                ingest.ingest(sn);
+                std::this_thread::sleep_for(poll);
+            }
+        });
+        polled = takePhotos(ingest, device, taken, next, photos);
+        polling = false;
+        poller.join();
+        ingest.stop();
+    }
+    print("poll", polled);
+
+    Mode backlog;
+    {
+        MediaIngest ingest(fleet, root + "/backlog");
+        ingest.setListener(listen);
+        target.set(&ingest);
+        ingest.ingest(sn);
+        backlog = takePhotos(ingest, device, taken, next, photos);
+        target.set(nullptr);
+        uint64_t files = ingest.files();
+        ingest.stop();
+        std::printf("  backlog still being copied: %llu of %zu clips done\n", static_cast<unsigned long long>(files),
+                    clips);
+    }
+    print("backlog", backlog);
+
+    bool ok = event.stored == photos && polled.stored == photos && backlog.stored == photos && event.walks == 0;
+    if (!ok) {
+        std::printf("FAILED\n");
+    }
+
+    fleet.stop();
+    pump.stop();
+    Devices::get().close();
+    std::string cleanup = "rm -rf '" + root + "'";
+    if (std::system(cleanup.c_str()) != 0) {
+        std::cerr << "Failed to remove " << root << std::endl;
+    }
+    return ok ? 0 : 1;
+#endif
+}
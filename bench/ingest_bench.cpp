@@ -0,0 +1,273 @@
+// Media ingest from several cameras at once, against copying serially.
+//
+// Attaches --cameras simulated cameras and copies their storage three ways.
+// "serial" walks each camera and calls mtpCopyFileFromDir file by file, one
+// camera after the other. "ingest" runs MediaIngest on all of them while a
+// gimbal speed command goes to every camera each --interval ms; its latency
+// shows that the transfers leave the command scheduler alone. "resume"
+// starts another ingest and unplugs one camera halfway through, plugs it
+// back and waits for the rest. Every copy is compared with the serial one,
+// and a second walk of the ingested storage must find nothing to copy.
+
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "bench_util.hpp"
+#include "media_ingest.hpp"
+#include "status_pump.hpp"
+
+#ifdef OBSBOT_SIM_DEV
+#include "sim_control.hpp"
+#endif
+
+namespace {
+
+struct File {
+    std::string sn;
+    std::string path;
+    uint64_t size;
+};
+
+bool waitUntil(const std::function<bool()>& done, std::chrono::milliseconds timeout) {
+    auto deadline = bench::Clock::now() + timeout;
+    while (!done()) {
+        if (bench::Clock::now() >= deadline) {
+            return false;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    return true;
+}
+
+void listFiles(Device& device, const std::string& sn, std::vector<File>& out) {
+    std::vector<std::string> dirs{"/"};
+    while (!dirs.empty()) {
+        std::string dir = dirs.back();
+        dirs.pop_back();
+        std::list<MtpFileInfo> infos;
+        if (device.mtpGetDirFileInfo(dir, infos) != RM_RET_OK) {
+            continue;
+        }
+        for (auto& info : infos) {
+            std::string path = (dir == "/" ? dir : dir + "/") + info.file_name_;
+            if (info.file_type_ == MtpFileFolder) {
+                dirs.push_back(path);
+            } else {
+                out.push_back(File{sn, path, info.file_size_});
+            }
+        }
+    }
+}
+
+bool sameContents(const std::string& a, const std::string& b) {
+    std::ifstream fa(a, std::ios::binary);
+    std::ifstream fb(b, std::ios::binary);
+    std::vector<char> ba(1 << 16);
+    std::vector<char> bb(1 << 16);
+    while (fa && fb) {
+        fa.read(ba.data(), ba.size());
+        fb.read(bb.data(), bb.size());
+        if (fa.gcount() != fb.gcount() || std::memcmp(ba.data(), bb.data(), fa.gcount()) != 0) {
+            return false;
+        }
+    }
+    return fa.eof() && fb.eof();
+}
+
+// Files whose copy by `run` differs from the one by `reference`
+size_t compare(const MediaIngest& reference, const MediaIngest& run, const std::vector<File>& files) {
+    size_t wrong = 0;
+    for (auto& file : files) {
+        if (!sameContents(reference.localPath(file.sn, file.path), run.localPath(file.sn, file.path))) {
+            ++wrong;
+        }
+    }
+    return wrong;
+}
+
+std::string makeTempDir() {
+    char path[] = "/tmp/obsbot_ingest_XXXXXX";
+    return ::mkdtemp(path) ? path : std::string();
+}
+
+double mbPerSecond(uint64_t bytes, double us) {
+    return us > 0 ? bytes / (1024.0 * 1024.0) / (us / 1e6) : 0.0;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    if (bench::hasFlag(argc, argv, "--help")) {
+        std::cout << "usage: obsbot_ingest_bench [--cameras 4] [--interval 20]" << std::endl;
+        return 0;
+    }
+#ifndef OBSBOT_SIM_DEV
+    std::cerr << "obsbot_ingest_bench needs the simulated libdev (OBSBOT_SIM_DEV)" << std::endl;
+    return 1;
+#else
+    size_t cameras = std::max<size_t>(1, static_cast<size_t>(bench::argDouble(argc, argv, "--cameras", 4)));
+    int interval_ms = std::max(1, static_cast<int>(bench::argDouble(argc, argv, "--interval", 20)));
+    // A smaller storage than the default keeps the serial pass short
+    ::setenv("OBSBOT_SIM_MTP_FILES", "8", 0);
+    ::setenv("OBSBOT_SIM_MTP_FILE_KB", "2048", 0);
+
+    std::string root = makeTempDir();
+    if (root.empty()) {
+        std::cerr << "Failed to create a temporary directory" << std::endl;
+        return 1;
+    }
+
+    StatusPump pump;
+    FleetManager fleet(pump);
+    std::mutex mutex;
+    MediaIngest* current = nullptr;
+    fleet.setListener([&](const std::shared_ptr<CameraHandle>& camera, bool connected) {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (current) {
+            current->onDeviceChange(camera, connected);
+        }
+    });
+    pump.start();
+    fleet.start();
+    if (!fleet.waitFor(1, std::chrono::seconds(10))) {
+        std::cerr << "No camera found" << std::endl;
+        return 1;
+    }
+    ObsbotProductType product = fleet.cameras().front()->device()->productType();
+    while (fleet.size() < cameras) {
+        sim::plug(product);
+        waitUntil([&] { return fleet.size() >= cameras; }, std::chrono::milliseconds(100));
+    }
+
+    std::vector<File> files;
+    uint64_t total = 0;
+    for (auto& camera : fleet.cameras()) {
+        listFiles(*camera->device(), camera->sn(), files);
+    }
+    for (auto& file : files) {
+        total += file.size;
+    }
+    std::printf("%zu cameras, %zu files, %.1f MB\n", fleet.size(), files.size(), total / (1024.0 * 1024.0));
+
+    // Serial: one file at a time across the whole fleet
+    MediaIngest serial(fleet, root + "/serial");
+    auto t0 = bench::Clock::now();
+    size_t serial_failed = 0;
+    for (auto& file : files) {
+        auto camera = fleet.camera(file.sn);
+        std::string local = serial.localPath(file.sn, file.path);
+        std::string dir = local.substr(0, local.rfind('/'));
+        std::string mkdir = "mkdir -p '" + dir + "'";
+        if (!camera || std::system(mkdir.c_str()) != 0 ||
+            camera->device()->mtpCopyFileFromDir(file.path, local, nullptr) != RM_RET_OK) {
+            ++serial_failed;
+        }
+    }
+    double serial_us = bench::toMicros(bench::Clock::now() - t0);
+    std::printf("serial: %8.1f ms  %6.1f MB/s  failed=%zu\n", serial_us / 1000, mbPerSecond(total, serial_us),
+                serial_failed);
+
+    // All cameras at once, with gimbal commands going on
+    MediaIngest ingest(fleet, root + "/ingest");
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        current = &ingest;
+    }
+    bench::Samples command;
+    std::atomic<bool> done{false};
+    std::thread gimbal([&] {
+        auto next = bench::Clock::now();
+        while (!done.load()) {
+            for (auto& camera : fleet.cameras()) {
+                auto posted = bench::Clock::now();
+                auto finished = std::make_shared<std::atomic<bool>>(false);
+                camera->post(
+                    [finished](Device& device) {
+                        device.aiSetGimbalSpeedCtrlR(0.f, 5.f);
+                        finished->store(true);
+                    },
+                    CommandScheduler::Motion);
+                if (waitUntil([&] { return finished->load(); }, std::chrono::seconds(2))) {
+                    command.add(bench::toMicros(bench::Clock::now() - posted));
+                }
+            }
+            next += std::chrono::milliseconds(interval_ms);
+            std::this_thread::sleep_until(next);
+        }
+    });
+    t0 = bench::Clock::now();
+    for (auto& camera : fleet.cameras()) {
+        ingest.ingest(camera->sn());
+    }
+    bool idle = ingest.waitIdle(std::chrono::seconds(120));
+    double ingest_us = bench::toMicros(bench::Clock::now() - t0);
+    done.store(true);
+    gimbal.join();
+    std::printf("ingest: %8.1f ms  %6.1f MB/s  files=%llu failures=%llu%s\n", ingest_us / 1000,
+                mbPerSecond(ingest.bytes(), ingest_us), static_cast<unsigned long long>(ingest.files()),
+                static_cast<unsigned long long>(ingest.failures()), idle ? "" : " (timed out)");
+    std::printf("  gimbal command during ingest: p50=%.2fms p99=%.2fms max=%.2fms (%zu)\n",
+                command.percentile(50) / 1000, command.percentile(99) / 1000, command.max() / 1000,
+                command.count());
+
+    // Nothing left to copy the second time
+    for (auto& camera : fleet.cameras()) {
+        ingest.ingest(camera->sn());
+    }
+    ingest.waitIdle(std::chrono::seconds(10));
+    std::printf("  again: skipped=%llu copied=%llu\n", static_cast<unsigned long long>(ingest.skipped()),
+                static_cast<unsigned long long>(ingest.files() - files.size()));
+
+    // Unplug one camera halfway and plug it back
+    MediaIngest resume(fleet, root + "/resume");
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        current = &resume;
+    }
+    std::string victim = fleet.cameras().front()->sn();
+    t0 = bench::Clock::now();
+    for (auto& camera : fleet.cameras()) {
+        resume.ingest(camera->sn());
+    }
+    waitUntil([&] { return resume.files() >= files.size() / 2; }, std::chrono::seconds(60));
+    sim::unplug(victim);
+    waitUntil([&] { return !fleet.camera(victim); }, std::chrono::seconds(5));
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    sim::plug(product, victim);
+    waitUntil([&] { return resume.files() + resume.failures() >= files.size(); }, std::chrono::seconds(120));
+    idle = resume.waitIdle(std::chrono::seconds(10));
+    double resume_us = bench::toMicros(bench::Clock::now() - t0);
+    std::printf("resume: %8.1f ms  files=%llu retries=%llu failures=%llu%s\n", resume_us / 1000,
+                static_cast<unsigned long long>(resume.files()), static_cast<unsigned long long>(resume.retries()),
+                static_cast<unsigned long long>(resume.failures()), idle ? "" : " (timed out)");
+
+    size_t wrong = compare(serial, ingest, files) + compare(serial, resume, files);
+    bool ok = serial_failed == 0 && wrong == 0 && ingest.files() == files.size() && ingest.skipped() == files.size() &&
+              resume.files() == files.size() && resume.failures() == 0;
+    std::printf("  differing copies=%zu %s\n", wrong, ok ? "" : "FAILED");
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        current = nullptr;
+    }
+    resume.stop();
+    ingest.stop();
+    fleet.stop();
+    pump.stop();
+    Devices::get().close();
+    std::string cleanup = "rm -rf '" + root + "'";
+    if (std::system(cleanup.c_str()) != 0) {
+        std::cerr << "Failed to remove " << root << std::endl;
+    }
+    return ok ? 0 : 1;
+#endif
+}
@@ -0,0 +1,107 @@
+// Cost of an SDK log call on the calling thread.
+//
+// --threads callers each log --messages DEBUG lines through the handler
+// installed with dev_set_log_handler, the way libdev calls it. "sync"
+// formats and writes to --out on the caller, as a console handler does;
+// "async" goes through SdkLogSink. Reported latency is the time the
+// caller spends inside the handler.
+
+#include <cstdarg>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+#include "bench_util.hpp"
+#include "log_sink.hpp"
+
+namespace {
+
+FILE* g_sync_out = nullptr;
+
+void syncHandler(int32_t lvl, const char* msg, va_list args, void*) {
+    std::fprintf(g_sync_out, "%d ", lvl);
+    std::vfprintf(g_sync_out, msg, args);
+    std::fputc('\n', g_sync_out);
+    std::fflush(g_sync_out);
+}
+
+// Calls the installed handler exactly as libdev's dlog() does
+void logThrough(int32_t level, const char* format, ...) __attribute__((__format__(__printf__, 2, 3)));
+void logThrough(int32_t level, const char* format, ...) {
+    dlog_handler_t handler;
+    void* param;
+    dev_get_log_handler(&handler, &param);
+    va_list args;
+    va_start(args, format);
+    handler(level, format, args, param);
+    va_end(args);
+}
+
+void run(const char* name, size_t threads, size_t messages) {
+    std::vector<bench::Samples> latency(threads);
+    std::vector<std::thread> workers;
+    auto start = bench::Clock::now();
+    for (size_t t = 0; t < threads; ++t) {
+        workers.emplace_back([&, t] {
+            latency[t].reserve(messages);
+            for (size_t i = 0; i < messages; ++i) {
+                auto t0 = bench::Clock::now();
+                logThrough(DEV_DEBUG, "uvc ctrl %s: sel=0x%02x len=%zu ret=%d (%.2f ms)", "SIM00000000001",
+                           static_cast<unsigned>(i & 0xff), i % 64, 0, i * 0.01);
+                latency[t].add(bench::toMicros(bench::Clock::now() - t0));
+            }
+        });
+    }
+    for (auto& worker : workers) {
+        worker.join();
+    }
+    double seconds = std::chrono::duration<double>(bench::Clock::now() - start).count();
+    bench::Samples all;
+    for (auto& samples : latency) {
+        all.merge(samples);
+    }
+    std::printf("%-6s calls=%-8zu rate=%10.0f/s p50=%7.2fus p99=%7.2fus p99.9=%8.2fus max=%9.2fus\n", name,
+                all.count(), all.count() / seconds, all.percentile(50), all.percentile(99), all.percentile(99.9),
+                all.max());
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    if (bench::hasFlag(argc, argv, "--help")) {
+        std::cout << "usage: obsbot_log_bench [--threads 4] [--messages 20000] [--out /tmp/obsbot_log_bench.log]"
+                  << std::endl;
+        return 0;
+    }
+    size_t threads = static_cast<size_t>(bench::argDouble(argc, argv, "--threads", 4));
+    size_t messages = static_cast<size_t>(bench::argDouble(argc, argv, "--messages", 20000));
+    std::string path = bench::arg(argc, argv, "--out", "/tmp/obsbot_log_bench.log");
+
+    dlog_handler_t original;
+    void* original_param;
+    dev_get_log_handler(&original, &original_param);
+
+    g_sync_out = std::fopen(path.c_str(), "w");
+    if (!g_sync_out) {
+        std::cerr << "Cannot write " << path << std::endl;
+        return 1;
+    }
+    dev_set_log_handler(syncHandler, nullptr);
+    run("sync", threads, messages);
+    dev_set_log_handler(original, original_param);
+    std::fclose(g_sync_out);
+
+    SdkLogSink sink;
+    sink.setLevel(DEV_DEBUG);
+    sink.setRateLimit(DEV_DEBUG, 0);
+    if (!sink.start(path)) {
+        std::cerr << "Cannot start log sink on " << path << std::endl;
+        return 1;
+    }
+    run("async", threads, messages);
+    sink.stop();
+    std::printf("async  written=%llu dropped_full=%llu dropped_rate=%llu\n",
+                static_cast<unsigned long long>(sink.written()), static_cast<unsigned long long>(sink.droppedFull()),
+                static_cast<unsigned long long>(sink.droppedRate()));
+    return 0;
+}
@@ -0,0 +1,134 @@
+// Repeat syncs of a camera with a large card.
+//
+// One simulated camera holds --clips files. "first" ingests all of them
+// into an empty directory. "repeat" starts a new MediaIngest on the same
+// directory, as after a restart, so the MediaIndex is read back from disk,
+// and syncs again; nothing may be copied. "no index" does the same without
+// the index file, which falls back to checking every file on disk and
+// rebuilds the index. Also reports the cost of opening the index and of one
+// lookup.
+
+#include <cstdlib>
+#include <iostream>
+#include <list>
+#include <unistd.h>
+
+#include "bench_util.hpp"
+#include "media_ingest.hpp"
+#include "status_pump.hpp"
+
+#ifdef OBSBOT_SIM_DEV
+#include "sim_control.hpp"
+#endif
+
+namespace {
+
+struct Pass {
+    double ms = 0;
+    uint64_t copied = 0;
+    uint64_t skipped = 0;
+    uint64_t bytes = 0;
+};
+
+Pass sync(FleetManager& fleet, const std::string& sn, const std::string& destination) {
+    MediaIngest ingest(fleet, destination);
+    auto t0 = bench::Clock::now();
+    ingest.ingest(sn);
+    ingest.waitIdle(std::chrono::seconds(600));
+    Pass pass;
+    pass.ms = bench::toMicros(bench::Clock::now() - t0) / 1000;
+    pass.copied = ingest.files();
+    pass.skipped = ingest.skipped();
+    pass.bytes = ingest.bytes();
+    return pass;
+}
+
+void print(const char* name, const Pass& pass) {
+    std::printf("%-9s %9.1f ms  copied=%llu (%.1f MB) skipped=%llu\n", name, pass.ms,
+                static_cast<unsigned long long>(pass.copied), pass.bytes / (1024.0 * 1024.0),
+                static_cast<unsigned long long>(pass.skipped));
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    if (bench::hasFlag(argc, argv, "--help")) {
+        std::cout << "usage: obsbot_media_index_bench [--clips 2000] [--clip-kb 1024] [--mbps 2000]" << std::endl;
+        return 0;
+    }
+#ifndef OBSBOT_SIM_DEV
+    std::cerr << "obsbot_media_index_bench needs the simulated libdev (OBSBOT_SIM_DEV)" << std::endl;
+    return 1;
+#else
+    size_t clips = std::max<size_t>(1, static_cast<size_t>(bench::argDouble(argc, argv, "--clips", 2000)));
+    size_t clip_kb = std::max<size_t>(1, static_cast<size_t>(bench::argDouble(argc, argv, "--clip-kb", 1024)));
+    // Faster than USB, so the first pass does not dominate the run
+    uint32_t mbps = static_cast<uint32_t>(bench::argDouble(argc, argv, "--mbps", 2000));
+    ::setenv("OBSBOT_SIM_MTP_FILES", std::to_string(clips).c_str(), 1);
+    ::setenv("OBSBOT_SIM_MTP_FILE_KB", std::to_string(clip_kb).c_str(), 1);
+
+    char temp[] = "/tmp/obsbot_index_XXXXXX";
+    if (!::mkdtemp(temp)) {
+        std::cerr << "Failed to create a temporary directory" << std::endl;
+        return 1;
+    }
+    std::string root = temp;
+
+    StatusPump pump;
+    FleetManager fleet(pump);
+    pump.start();
+    fleet.start();
+    if (!fleet.waitFor(1, std::chrono::seconds(10))) {
+        std::cerr << "No camera found" << std::endl;
+        return 1;
+    }
+    sim::Config config = sim::config();
+    config.mtp_mbps = mbps;
+    sim::setConfig(config);
+    std::string sn = fleet.cameras().front()->sn();
+
+    Pass first = sync(fleet, sn, root);
+    print("first", first);
+    Pass repeat = sync(fleet, sn, root);
+    print("repeat", repeat);
+    std::string index_path = MediaIngest(fleet, root).indexPath(sn);
+    ::unlink(index_path.c_str());
+    Pass unindexed = sync(fleet, sn, root);
+    print("no index", unindexed);
+    std::printf("  repeat avoided %.1f MB, %.1f s at the default 40 MB/s\n", first.bytes / (1024.0 * 1024.0),
+                first.bytes / (40.0 * 1024 * 1024));
+
+    // The index on its own
+    auto t0 = bench::Clock::now();
+    MediaIndex index;
+    index.open(index_path);
+    double open_us = bench::toMicros(bench::Clock::now() - t0);
+    std::list<MtpFileInfo> infos;
+    fleet.cameras().front()->device()->mtpGetDirFileInfo("/DCIM/100MEDIA", infos);
+    size_t current = 0;
+    t0 = bench::Clock::now();
+    for (int round = 0; round < 100; ++round) {
+        for (auto& info : infos) {
+            std::string path = "/DCIM/100MEDIA/" + info.file_name_;
+            current += index.check(path, info.file_size_, info.date_modify_) == MediaIndex::Current;
+        }
+    }
+    double check_ns = bench::toMicros(bench::Clock::now() - t0) * 1000 / std::max<size_t>(1, infos.size() * 100);
+    std::printf("index: %zu entries, open %.0f us, check %.0f ns\n", index.size(), open_us, check_ns);
+
+    bool ok = first.copied == clips && repeat.copied == 0 && repeat.skipped == clips && unindexed.copied == 0 &&
+              current == infos.size() * 100;
+    if (!ok) {
+        std::printf("FAILED\n");
+    }
+
+    fleet.stop();
+    pump.stop();
+    Devices::get().close();
+    std::string cleanup = "rm -rf '" + root + "'";
+    if (std::system(cleanup.c_str()) != 0) {
+        std::cerr << "Failed to remove " << root << std::endl;
+    }
+    return ok ? 0 : 1;
+#endif
+}
@@ -0,0 +1,199 @@
+// Smoothness of a pan/tilt move under command jitter.
+//
+// Moves the gimbal from the home position to --pan/--pitch, once as a raw
+// aiSetGimbalMotorAngleR jump and once through PtzMover over --seconds,
+// sampling aiGetGimbalStateR every --sample-ms. For each --jitter-us level
+// (simulated builds only) it reports time to within 0.5 degrees of the
+// target, peak speed and acceleration seen in the reported velocities, and
+// "stalls": samples in the middle of the move where the gimbal nearly
+// stopped.
+
+#include <atomic>
+#include <cmath>
+#include <iostream>
+#include <mutex>
+#include <sstream>
+#include <thread>
+#include <vector>
+
+#include "bench_util.hpp"
+#include "ptz_trajectory.hpp"
+#include "status_pump.hpp"
+
+#ifdef OBSBOT_SIM_DEV
+#include "sim_control.hpp"
+#endif
+
+namespace {
+
+struct Sample {
+    double t;
+    float pan, pitch;
+    float pan_v, pitch_v;
+};
+
+class Sampler {
+public:
+    Sampler(Device& device, double period_ms) : device_(device), period_ms_(period_ms) {}
+
+    void start() {
+        running_ = true;
+        start_ = bench::Clock::now();
+        thread_ = std::thread([this] {
+            auto next = start_;
+            while (running_) {
+                Device::AiGimbalStateInfo state;
+                if (device_.aiGetGimbalStateR(&state) == RM_RET_OK) {
+                    double t = std::chrono::duration<double>(bench::Clock::now() - start_).count();
+                    samples_.push_back({t, state.yaw_euler, state.pitch_euler, state.yaw_v, state.pitch_v});
+                }
+                next += std::chrono::duration_cast<bench::Clock::duration>(
+                    std::chrono::duration<double, std::milli>(period_ms_));
+                std::this_thread::sleep_until(next);
+            }
+        });
+    }
+
+    std::vector<Sample> stop() {
+        running_ = false;
+        thread_.join();
+        return std::move(samples_);
+    }
+
+private:
+    Device& device_;
+    double period_ms_;
+    std::atomic<bool> running_{false};
+    bench::Clock::time_point start_;
+    std::thread thread_;
+    std::vector<Sample> samples_;
+};
+
+void report(const char* mode, uint32_t jitter_us, const std::vector<Sample>& samples, float pan, float pitch,
+            const PtzMover::Stats* stats) {
+    double arrived = -1.0, peak_speed = 0.0, peak_accel = 0.0;
+    for (size_t i = 0; i < samples.size(); ++i) {
+        const Sample& s = samples[i];
+        double speed = std::hypot(s.pan_v, s.pitch_v);
+        peak_speed = std::max(peak_speed, speed);
+        if (i > 0 && s.t > samples[i - 1].t) {
+            double dv = std::hypot(s.pan_v - samples[i - 1].pan_v, s.pitch_v - samples[i - 1].pitch_v);
+            peak_accel = std::max(peak_accel, dv / (s.t - samples[i - 1].t));
+        }
+        bool there = std::fabs(s.pan - pan) < 0.5f && std::fabs(s.pitch - pitch) < 0.5f;
+        if (there && arrived < 0.0) {
+            arrived = s.t;
+        } else if (!there) {
+            arrived = -1.0;
+        }
+    }
+    // Stalls: nearly stopped between 10% and 90% of the way
+    size_t stalls = 0;
+    double total = std::hypot(pan, pitch);
+    for (auto& s : samples) {
+        double done = total > 0 ? std::hypot(s.pan, s.pitch) / total : 1.0;
+        if (done > 0.1 && done < 0.9 && std::hypot(s.pan_v, s.pitch_v) < 0.05 * peak_speed) {
+            ++stalls;
+        }
+    }
+    const Sample* last = samples.empty() ? nullptr : &samples.back();
+    double error = last ? std::hypot(last->pan - pan, last->pitch - pitch) : NAN;
+    std::printf("%-7s jitter=%6uus arrive=%6.2fs err=%5.2fdeg peak_v=%6.1fdeg/s peak_a=%8.1fdeg/s2 stalls=%-3zu",
+                mode, jitter_us, arrived, error, peak_speed, peak_accel, stalls);
+    if (stats) {
+        std::printf(" ticks=%llu late=%llu max_late=%.1fms",
+                    static_cast<unsigned long long>(stats->ticks), static_cast<unsigned long long>(stats->late_ticks),
+                    stats->max_lateness_ms);
+    }
+    std::printf("\n");
+}
+
+bool home(Device& device) {
+    if (device.aiSetGimbalMotorAngleR(0.f, 0.f) != RM_RET_OK) {
+        return false;
+    }
+    auto deadline = bench::Clock::now() + std::chrono::seconds(10);
+    while (bench::Clock::now() < deadline) {
+        Device::AiGimbalStateInfo state;
+        if (device.aiGetGimbalStateR(&state) == RM_RET_OK && std::fabs(state.yaw_euler) < 0.1f &&
+            std::fabs(state.pitch_euler) < 0.1f) {
+            return true;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    }
+    return false;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    if (bench::hasFlag(argc, argv, "--help")) {
+        std::cout << "usage: obsbot_ptz_bench [--pan 90] [--pitch 20] [--seconds 3] [--sample-ms 10]\n"
+                  << "                        [--jitter-us 0,10000,30000]" << std::endl;
+        return 0;
+    }
+    float pan = static_cast<float>(bench::argDouble(argc, argv, "--pan", 90));
+    float pitch = static_cast<float>(bench::argDouble(argc, argv, "--pitch", 20));
+    double seconds = bench::argDouble(argc, argv, "--seconds", 3);
+    double sample_ms = bench::argDouble(argc, argv, "--sample-ms", 10);
+    std::vector<uint32_t> jitters;
+    std::stringstream list(bench::arg(argc, argv, "--jitter-us", "0,10000,30000"));
+    for (std::string item; std::getline(list, item, ',');) {
+        jitters.push_back(static_cast<uint32_t>(std::atoi(item.c_str())));
+    }
+#ifndef OBSBOT_SIM_DEV
+    jitters.assign(1, 0); // a live camera has whatever jitter it has
+#endif
+
+    StatusPump pump;
+    FleetManager fleet(pump);
+    pump.start();
+    fleet.start();
+    if (!fleet.waitFor(1, std::chrono::seconds(10))) {
+        std::cerr << "No camera found" << std::endl;
+        return 1;
+    }
+    auto camera = fleet.cameras().front();
+    auto device = camera->device();
+
+    for (uint32_t jitter : jitters) {
+#ifdef OBSBOT_SIM_DEV
+        sim::Config config = sim::config();
+        config.jitter_us = jitter;
+        sim::setConfig(config);
+#endif
+        for (int mode = 0; mode < 2; ++mode) {
+            if (!home(*device)) {
+                std::cerr << "Gimbal did not reach home" << std::endl;
+                return 1;
+            }
+            Sampler sampler(*device, sample_ms);
+            sampler.start();
+            auto deadline = bench::Clock::now() +
+                            std::chrono::duration_cast<bench::Clock::duration>(std::chrono::duration<double>(seconds));
+            if (mode == 0) {
+                device->aiSetGimbalMotorAngleR(pitch, pan);
+                std::this_thread::sleep_until(deadline + std::chrono::seconds(1));
+                report("jump", jitter, sampler.stop(), pan, pitch, nullptr);
+            } else {
+                PtzMover mover(camera);
+                PtzPose target;
+                target.pan = pan;
+                target.pitch = pitch;
+                target.zoom = 0.f;
+                if (!mover.moveTo(target, seconds)) {
+                    std::cerr << "moveTo failed" << std::endl;
+                    return 1;
+                }
+                mover.wait(std::chrono::seconds(30));
+                std::this_thread::sleep_for(std::chrono::seconds(1));
+                auto stats = mover.stats();
+                report("s-curve", jitter, sampler.stop(), pan, pitch, &stats);
+            }
+        }
+    }
+    fleet.stop();
+    pump.stop();
+    Devices::get().close();
+    return 0;
+}
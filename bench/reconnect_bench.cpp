@@ -0,0 +1,169 @@
+// Time from a camera coming back to it being fully restored.
+//
+// Gives one camera an AI mode, a zoom, an action on a preset and some image
+// settings through ReconnectManager, on top of the baseline it captures.
+// Then it unplugs and replugs the camera --cycles times. Each cycle reports
+// when AI mode and zoom were back ("motion") and when the last setting was
+// written ("restored"), both measured from sim::plug(). Afterwards the
+// camera is read back to check that the state really is the desired one.
+// --depth 1 writes one setting at a time, for comparison with the
+// pipelined default.
+
+#include <condition_variable>
+#include <cstring>
+#include <iostream>
+#include <mutex>
+#include <thread>
+
+#include "bench_util.hpp"
+#include "reconnect_manager.hpp"
+#include "status_pump.hpp"
+
+#ifdef OBSBOT_SIM_DEV
+#include "sim_control.hpp"
+#endif
+
+namespace {
+
+struct Restored {
+    std::mutex mutex;
+    std::condition_variable cond;
+    uint64_t count = 0;
+    ReconnectManager::Report report;
+};
+
+bool waitUntil(const std::function<bool()>& done, std::chrono::milliseconds timeout) {
+    auto deadline = bench::Clock::now() + timeout;
+    while (!done()) {
+        if (bench::Clock::now() >= deadline) {
+            return false;
+        }
+        std::this_thread::sleep_for(std::chrono::microseconds(200));
+    }
+    return true;
+}
+
+// Differences between the camera and its desired state
+size_t verify(Device& device, const DesiredState& state) {
+    size_t wrong = 0;
+    float zoom = 0.f;
+    if (state.has_zoom && (device.cameraGetZoomAbsoluteR(zoom) != RM_RET_OK || std::abs(zoom - state.zoom) > 0.01f)) {
+        ++wrong;
+    }
+    for (auto& entry : state.preset_actions) {
+        Device::PresetsAction action;
+        if (device.aiGetPresetsActionR(action, entry.first) != RM_RET_OK ||
+            std::memcmp(&action, &entry.second, sizeof(action)) != 0) {
+            ++wrong;
+        }
+    }
+    for (size_t i = 0; i < SettingsSnapshot::SettingCount; ++i) {
+        auto which = static_cast<SettingsSnapshot::Setting>(i);
+        SettingsSnapshot::Value value;
+        if (state.settings.has(which) &&
+            (SettingsSnapshotter::read(device, which, value) != RM_RET_OK || value != state.settings.get(which))) {
+            ++wrong;
+        }
+    }
+    return wrong;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    if (bench::hasFlag(argc, argv, "--help")) {
+        std::cout << "usage: obsbot_reconnect_bench [--cycles 20] [--depth 4]" << std::endl;
+        return 0;
+    }
+#ifndef OBSBOT_SIM_DEV
+    std::cerr << "obsbot_reconnect_bench needs the simulated libdev (OBSBOT_SIM_DEV)" << std::endl;
+    return 1;
+#else
+    size_t cycles = static_cast<size_t>(bench::argDouble(argc, argv, "--cycles", 20));
+    size_t depth = std::max<size_t>(1, static_cast<size_t>(bench::argDouble(argc, argv, "--depth", 4)));
+
+    StatusPump pump;
+    FleetManager fleet(pump);
+    ReconnectManager reconnect(fleet, depth);
+    Restored restored;
+    reconnect.setListener([&restored](const std::string&, const ReconnectManager::Report& report) {
+        std::lock_guard<std::mutex> lock(restored.mutex);
+        restored.report = report;
+        ++restored.count;
+        restored.cond.notify_all();
+    });
+    fleet.setListener([&reconnect](const std::shared_ptr<CameraHandle>& camera, bool connected) {
+        reconnect.onDeviceChange(camera, connected);
+    });
+    pump.start();
+    fleet.start();
+    if (!fleet.waitFor(1, std::chrono::seconds(10)) ||
+        !waitUntil([&] { return reconnect.captures() > 0; }, std::chrono::seconds(10))) {
+        std::cerr << "No camera found" << std::endl;
+        return 1;
+    }
+    auto camera = fleet.cameras().front();
+    std::string sn = camera->sn();
+    ObsbotProductType product = camera->device()->productType();
+
+    Device::PresetPosInfo preset{};
+    preset.id = 1;
+    preset.zoom = 1.2f;
+    camera->presets().add(preset);
+    Device::PresetsAction action;
+    action.ai_track_type = 1;
+    action.auto_focus = 1;
+    reconnect.setAiMode(sn, Device::AiWorkModeHuman);
+    reconnect.setZoom(sn, 1.6f);
+    reconnect.setPresetAction(sn, preset.id, action);
+    reconnect.setSetting(sn, SettingsSnapshot::Brightness, {70, 0});
+    reconnect.setSetting(sn, SettingsSnapshot::Contrast, {35, 0});
+    reconnect.setSetting(sn, SettingsSnapshot::Saturation, {65, 0});
+    reconnect.setSetting(sn, SettingsSnapshot::Sharpness, {45, 0});
+    waitUntil([&] { return camera->pending() == 0; }, std::chrono::seconds(5));
+    DesiredState state;
+    reconnect.desired(sn, state);
+
+    bench::Samples motion;
+    bench::Samples total;
+    size_t failed = 0;
+    size_t wrong = 0;
+    for (size_t i = 0; i < cycles; ++i) {
+        sim::unplug(sn);
+        waitUntil([&] { return fleet.size() == 0; }, std::chrono::seconds(5));
+        uint64_t before;
+        {
+            std::lock_guard<std::mutex> lock(restored.mutex);
+            before = restored.count;
+        }
+        auto t0 = bench::Clock::now();
+        sim::plug(product, sn);
+        std::unique_lock<std::mutex> lock(restored.mutex);
+        if (!restored.cond.wait_for(lock, std::chrono::seconds(10), [&] { return restored.count > before; })) {
+            std::cerr << "Camera was not restored" << std::endl;
+            return 1;
+        }
+        // The restore's own clock starts at the hot-plug callback; add the
+        // enumeration before it
+        double done_us = bench::toMicros(bench::Clock::now() - t0);
+        double lag_us = done_us - restored.report.total.count();
+        motion.add(lag_us + restored.report.motion.count());
+        total.add(done_us);
+        failed += restored.report.failed;
+        lock.unlock();
+
+        if (auto again = fleet.camera(sn)) {
+            wrong += verify(*again->device(), state);
+        }
+    }
+
+    std::printf("depth=%zu cycles=%zu writes=%zu: motion p50=%.1fms max=%.1fms  restored p50=%.1fms max=%.1fms\n",
+                depth, cycles, restored.report.written, motion.percentile(50) / 1000, motion.max() / 1000,
+                total.percentile(50) / 1000, total.max() / 1000);
+    std::printf("  failed writes=%zu wrong after restore=%zu %s\n", failed, wrong, wrong ? "FAILED" : "");
+    fleet.stop();
+    pump.stop();
+    Devices::get().close();
+    return wrong == 0 ? 0 : 1;
+#endif
+}
@@ -0,0 +1,139 @@
+// Status-processing throughput from a recorded journal.
+//
+// Replays --journal through StatusReplay into a StatusPump whose sink runs
+// the per-camera delta tracker, i.e. the controller's status path without
+// cameras. --speed 1 is real time, N is N times faster, 0 (default) is as
+// fast as possible. --generate writes a synthetic journal of that many
+// pushes from --cameras devices first, so the bench also runs on machines
+// that never saw a camera.
+
+#include <atomic>
+#include <cinttypes>
+#include <cstring>
+#include <iostream>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "bench_util.hpp"
+#include "status_delta.hpp"
+#include "status_journal.hpp"
+#include "status_pump.hpp"
+#include "status_replay.hpp"
+
+namespace {
+
+// Pushes at the SDK refresh period, every camera slowly changing a few fields
+bool generate(const std::string& directory, uint64_t pushes, size_t cameras) {
+    StatusJournal journal;
+    if (!journal.open(directory)) {
+        return false;
+    }
+    const uint64_t period_ns = UVC_DEV_CAM_STATUS_REFRESH_PERIOD * 1000000ull;
+    std::vector<uint64_t> hashes;
+    for (size_t i = 0; i < cameras; ++i) {
+        hashes.push_back(snHash("SIM" + std::to_string(i)));
+    }
+    Device::CameraStatus status;
+    for (uint64_t i = 0; i < pushes; ++i) {
+        uint64_t tick = i / cameras;
+        std::memset(&status, 0, sizeof(status));
+        status.tail_air.battery.capacity = 100 - (tick / 600) % 100;
+        status.tail_air.battery.charging = (tick / 3000) % 2;
+        status.tail_air.ai_type = (tick / 50) % 4;
+        status.tail_air.digi_zoom_ratio = 100 + (tick / 10) % 300;
+        status.tail_air.media_running.record_status = (tick / 200) % 2;
+        status.tail_air.usb_status = 1;
+        journal.append(hashes[i % cameras], 1000000000ull + tick * period_ns + i % cameras, status);
+    }
+    journal.close();
+    return journal.dropped() == 0;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    const char* directory = bench::arg(argc, argv, "--journal", nullptr);
+    if (!directory || bench::hasFlag(argc, argv, "--help")) {
+        std::cout << "usage: obsbot_replay_bench --journal DIR [--speed 0] [--generate N --cameras 4]" << std::endl;
+        return directory ? 0 : 1;
+    }
+    double speed = bench::argDouble(argc, argv, "--speed", StatusReplay::kAsFastAsPossible);
+    uint64_t pushes = static_cast<uint64_t>(bench::argDouble(argc, argv, "--generate", 0));
+    size_t cameras = static_cast<size_t>(std::max(1.0, bench::argDouble(argc, argv, "--cameras", 4)));
+
+    if (pushes > 0 && !generate(directory, pushes, cameras)) {
+        std::cerr << "Failed to write journal to " << directory << std::endl;
+        return 1;
+    }
+
+    StatusReplay replay;
+    if (!replay.open(directory)) {
+        std::cerr << "No journal records in " << directory << std::endl;
+        return 1;
+    }
+    std::printf("journal %s: %" PRIu64 " records, %zu devices, %.1fs recorded\n", directory, replay.recordCount(),
+                replay.devices().size(), replay.recordedSpanNs() / 1e9);
+
+    std::atomic<uint64_t> processed{0};
+    uint64_t changes_seen = 0;
+    std::unordered_map<uint64_t, StatusDeltaTracker> trackers;
+    std::vector<StatusChange> changes;
+
+    StatusPump pump;
+    pump.addSink([&](const StatusSource& source, const StatusSample& sample) {
+        auto it = trackers.find(source.snHash());
+        if (it == trackers.end()) {
+            it = trackers.emplace(source.snHash(), StatusDeltaTracker(StatusLayout::TailAir)).first;
+        }
+        it->second.update(sample.status, changes);
+        changes_seen += changes.size();
+        processed.fetch_add(1, std::memory_order_release);
+    });
+    if (!pump.start()) {
+        std::cerr << "Failed to start status pump" << std::endl;
+        return 1;
+    }
+
+    std::vector<StatusSource*> sources;
+    replay.setDevChangedCallback(
+        [&](std::string sn, bool connected, void*) {
+            if (connected) {
+                StatusSource* source = pump.addSource(sn);
+                sources.push_back(source);
+                replay.setDevStatusCallbackFunc(sn, StatusPump::onDeviceStatus, source);
+            }
+        },
+        nullptr);
+
+    auto start = bench::Clock::now();
+    uint64_t delivered = replay.run(speed);
+    auto replayed = bench::Clock::now() - start;
+
+    auto dropped = [&] {
+        uint64_t total = 0;
+        for (auto* source : sources) {
+            total += source->dropped();
+        }
+        return total;
+    };
+    while (processed.load(std::memory_order_acquire) + dropped() < delivered) {
+        std::this_thread::yield();
+    }
+    auto drained = bench::Clock::now() - start;
+    pump.stop();
+
+    double replay_s = std::chrono::duration<double>(replayed).count();
+    double drain_s = std::chrono::duration<double>(drained).count();
+    if (speed > 0) {
+        std::printf("speed %gx: ", speed);
+    } else {
+        std::printf("speed max: ");
+    }
+    std::printf("delivered=%" PRIu64 " processed=%" PRIu64 " dropped=%" PRIu64 " changes=%" PRIu64 "\n", delivered,
+                processed.load(), dropped(), changes_seen);
+    std::printf("replay %.1fms (%.0f pushes/s), processed %.0f pushes/s\n", replay_s * 1000.0,
+                replay_s > 0 ? delivered / replay_s : 0.0, drain_s > 0 ? processed.load() / drain_s : 0.0);
+    return 0;
+}
@@ -0,0 +1,141 @@
+// Worst-case latency of a gimbal stop behind a flood of other commands.
+//
+// One camera gets a steady backlog of --backlog brightness writes and
+// videoFormatInfo reads (bulk), and a gimbal speed command every 33 ms, the
+// rate of a joystick. Every --interval ms an aiSetGimbalStop is posted.
+// Latency runs from the post to the stop's return. "fifo" queues everything
+// in one class without pacing, which is how the per-camera strand used to
+// behave. "priority" uses the CommandScheduler classes and default pacing.
+// Reports the stop latency and how many commands of each class ran.
+
+#include <atomic>
+#include <iostream>
+#include <mutex>
+#include <thread>
+
+#include "bench_util.hpp"
+#include "fleet_manager.hpp"
+#include "status_pump.hpp"
+
+namespace {
+
+struct Run {
+    bench::Samples stop;
+    uint64_t executed[CommandScheduler::PriorityCount] = {};
+    double seconds = 0;
+};
+
+Run runMode(CameraHandle& camera, bool fifo, size_t backlog, size_t stops, int interval_ms) {
+    using Scheduler = CommandScheduler;
+    Scheduler& scheduler = camera.scheduler();
+    for (int i = Scheduler::Motion; i < Scheduler::PriorityCount; ++i) {
+        auto priority = static_cast<Scheduler::Priority>(i);
+        scheduler.setPacing(priority, fifo ? Scheduler::Pacing{0.0, 1.0} : Scheduler::defaultPacing(priority));
+    }
+    auto classOf = [fifo](Scheduler::Priority priority) { return fifo ? Scheduler::Motion : priority; };
+    uint64_t before[Scheduler::PriorityCount];
+    for (int i = 0; i < Scheduler::PriorityCount; ++i) {
+        before[i] = scheduler.executed(static_cast<Scheduler::Priority>(i));
+    }
+
+    Run run;
+    std::mutex mutex;
+    std::atomic<bool> done{false};
+    std::thread flood([&] {
+        int32_t brightness = 40;
+        size_t posted = 0;
+        auto next_motion = bench::Clock::now();
+        while (!done.load()) {
+            while (camera.pending() < backlog) {
+                if (posted++ % 4 == 3) {
+                    camera.post([](Device& device) { device.videoFormatInfo(); }, classOf(Scheduler::Bulk));
+                } else {
+                    brightness = brightness == 40 ? 60 : 40;
+                    camera.post([brightness](Device& device) { device.cameraSetImageBrightnessR(brightness); },
+                                classOf(Scheduler::Settings));
+                }
+            }
+            if (bench::Clock::now() >= next_motion) {
+                camera.post([](Device& device) { device.aiSetGimbalSpeedCtrlR(5.f, 10.f); },
+                            classOf(Scheduler::Motion));
+                next_motion += std::chrono::milliseconds(33);
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+    });
+
+    // Let the backlog build up first
+    std::this_thread::sleep_for(std::chrono::milliseconds(interval_ms));
+    auto t0 = bench::Clock::now();
+    std::atomic<size_t> finished{0};
+    for (size_t i = 0; i < stops; ++i) {
+        auto posted = bench::Clock::now();
+        camera.post(
+            [&run, &mutex, &finished, posted](Device& device) {
+                device.aiSetGimbalStop();
+                std::lock_guard<std::mutex> lock(mutex);
+                run.stop.add(bench::toMicros(bench::Clock::now() - posted));
+                ++finished;
+            },
+            classOf(Scheduler::Stop));
+        std::this_thread::sleep_for(std::chrono::milliseconds(interval_ms));
+    }
+    while (finished.load() < stops) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    run.seconds = bench::toMicros(bench::Clock::now() - t0) / 1e6;
+    done.store(true);
+    flood.join();
+    while (camera.pending() > 0) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    for (int i = 0; i < Scheduler::PriorityCount; ++i) {
+        run.executed[i] = scheduler.executed(static_cast<Scheduler::Priority>(i)) - before[i];
+    }
+    return run;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    if (bench::hasFlag(argc, argv, "--help")) {
+        std::cout << "usage: obsbot_scheduler_bench [--mode fifo|priority|both] [--backlog 64] [--stops 40] "
+                     "[--interval 50]"
+                  << std::endl;
+        return 0;
+    }
+    std::string mode = bench::arg(argc, argv, "--mode", "both");
+    size_t backlog = static_cast<size_t>(bench::argDouble(argc, argv, "--backlog", 64));
+    size_t stops = static_cast<size_t>(bench::argDouble(argc, argv, "--stops", 40));
+    int interval_ms = static_cast<int>(bench::argDouble(argc, argv, "--interval", 50));
+
+    StatusPump pump;
+    FleetManager fleet(pump);
+    pump.start();
+    fleet.start();
+    if (!fleet.waitFor(1, std::chrono::seconds(10))) {
+        std::cerr << "No camera found" << std::endl;
+        return 1;
+    }
+    auto camera = fleet.cameras().front();
+
+    for (const char* name : {"fifo", "priority"}) {
+        if (mode != "both" && mode != name) {
+            continue;
+        }
+        Run run = runMode(*camera, std::string(name) == "fifo", backlog, stops, interval_ms);
+        std::printf("%-8s stop p50=%.1fms p99=%.1fms max=%.1fms\n", name, run.stop.percentile(50) / 1000,
+                    run.stop.percentile(99) / 1000, run.stop.max() / 1000);
+        std::printf("         executed over %.1fs: stop=%llu motion=%llu settings=%llu bulk=%llu throttled=%llu\n",
+                    run.seconds, static_cast<unsigned long long>(run.executed[CommandScheduler::Stop]),
+                    static_cast<unsigned long long>(run.executed[CommandScheduler::Motion]),
+                    static_cast<unsigned long long>(run.executed[CommandScheduler::Settings]),
+                    static_cast<unsigned long long>(run.executed[CommandScheduler::Bulk]),
+                    static_cast<unsigned long long>(camera->scheduler().throttled()));
+    }
+
+    fleet.stop();
+    pump.stop();
+    Devices::get().close();
+    return 0;
+}
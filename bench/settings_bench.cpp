@@ -0,0 +1,131 @@
+// Capture and restore of the full image/exposure/white-balance/focus/audio
+// state of every camera.
+//
+// For each --depth (SDK calls in flight per camera; 1 is the plain serial
+// loop) every camera is captured on its own thread, --changes settings are
+// then altered behind the snapshotter's back, and the snapshot is restored.
+// Reports the slowest camera's capture and restore time, the setters the
+// restore issued and the encoded snapshot size.
+
+#include <iostream>
+#include <sstream>
+#include <thread>
+#include <vector>
+
+#include "bench_device.hpp"
+#include "bench_util.hpp"
+#include "settings_snapshot.hpp"
+
+#ifdef OBSBOT_SIM_DEV
+#include "sim_control.hpp"
+#endif
+
+namespace {
+
+struct Result {
+    double capture_ms = 0.0;
+    double restore_ms = 0.0;
+    SettingsSnapshotter::RestoreReport report;
+    size_t settings = 0;
+    size_t encoded = 0;
+    bool ok = true;
+};
+
+// Moves the first `changes` settings the camera reported away from their value
+void perturb(Device& device, const SettingsSnapshot& snapshot, size_t changes) {
+    for (size_t i = 0; i < SettingsSnapshot::SettingCount && changes > 0; ++i) {
+        auto which = static_cast<SettingsSnapshot::Setting>(i);
+        if (!snapshot.has(which) || SettingsSnapshot::stage(which) == 0) {
+            continue;
+        }
+        SettingsSnapshot::Value value = snapshot.get(which);
+        value.a = value.a > 0 ? value.a - 1 : value.a + 1;
+        if (SettingsSnapshotter::write(device, which, value) == RM_RET_OK) {
+            --changes;
+        }
+    }
+}
+
+Result runCamera(SettingsSnapshotter& snapshotter, Device& device, size_t changes) {
+    Result result;
+    SettingsSnapshot snapshot;
+
+    auto t0 = bench::Clock::now();
+    result.ok = snapshotter.capture(device, snapshot);
+    result.capture_ms = bench::toMicros(bench::Clock::now() - t0) / 1000.0;
+    result.settings = snapshot.size();
+    auto encoded = snapshot.encode();
+    result.encoded = encoded.size();
+
+    // Restore from the encoded form, as a saved snapshot would be
+    SettingsSnapshot saved;
+    result.ok = result.ok && saved.decode(encoded.data(), encoded.size());
+    perturb(device, snapshot, changes);
+
+    t0 = bench::Clock::now();
+    result.ok = snapshotter.restore(device, saved, &result.report) && result.ok;
+    result.restore_ms = bench::toMicros(bench::Clock::now() - t0) / 1000.0;
+
+    SettingsSnapshot after;
+    snapshotter.capture(device, after);
+    result.ok = result.ok && after.present == snapshot.present && after.values == snapshot.values;
+    return result;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    if (bench::hasFlag(argc, argv, "--help")) {
+        std::cout << "usage: obsbot_settings_bench [--cameras 4] [--depth 1,4,8] [--changes 3]" << std::endl;
+        return 0;
+    }
+    size_t cameras = static_cast<size_t>(bench::argDouble(argc, argv, "--cameras", 4));
+    size_t changes = static_cast<size_t>(bench::argDouble(argc, argv, "--changes", 3));
+    std::vector<size_t> depths;
+    std::stringstream list(bench::arg(argc, argv, "--depth", "1,4,8"));
+    for (std::string item; std::getline(list, item, ',');) {
+        depths.push_back(static_cast<size_t>(std::max(1, std::atoi(item.c_str()))));
+    }
+
+#ifdef OBSBOT_SIM_DEV
+    bench::waitForDevice(std::chrono::seconds(10));
+    while (Devices::get().getDevNum() < cameras) {
+        sim::plug();
+    }
+#endif
+    auto devices = bench::waitForDevices(cameras, std::chrono::seconds(10));
+    if (devices.empty()) {
+        std::cerr << "No camera found" << std::endl;
+        return 1;
+    }
+    devices.resize(std::min(devices.size(), cameras));
+
+    for (size_t depth : depths) {
+        SettingsSnapshotter snapshotter(depth);
+        std::vector<Result> results(devices.size());
+        std::vector<std::thread> threads;
+        for (size_t i = 0; i < devices.size(); ++i) {
+            threads.emplace_back([&, i] { results[i] = runCamera(snapshotter, *devices[i], changes); });
+        }
+        for (auto& thread : threads) {
+            thread.join();
+        }
+
+        Result worst;
+        for (auto& result : results) {
+            worst.capture_ms = std::max(worst.capture_ms, result.capture_ms);
+            worst.restore_ms = std::max(worst.restore_ms, result.restore_ms);
+            worst.report.written = std::max(worst.report.written, result.report.written);
+            worst.report.failed += result.report.failed;
+            worst.settings = std::max(worst.settings, result.settings);
+            worst.encoded = std::max(worst.encoded, result.encoded);
+            worst.ok = worst.ok && result.ok;
+        }
+        std::printf("depth=%-3zu cameras=%zu settings=%zu bytes=%zu capture=%7.1fms restore=%7.1fms "
+                    "written=%zu failed=%zu %s\n",
+                    depth, devices.size(), worst.settings, worst.encoded, worst.capture_ms, worst.restore_ms,
+                    worst.report.written, worst.report.failed, worst.ok ? "verified" : "MISMATCH");
+    }
+    Devices::get().close();
+    return 0;
+}
@@ -0,0 +1,127 @@
+// Reader and writer cost of the shared status board.
+//
+// One writer thread publishes --updates status pushes, round robin over
+// --cameras slots, as fast as it can. Meanwhile --readers threads, each with
+// its own StatusBoardReader mapping as another process would have, read
+// every slot in a loop. Every status the writer publishes is filled with a
+// single byte value, so a reader that ever sees two different bytes in one
+// record got a torn read. Reports updates per second, reads per second,
+// read latency, how often a read gave up because the writer kept the slot
+// busy, and torn reads (which must be zero).
+
+#include <atomic>
+#include <cstring>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+#include "bench_util.hpp"
+#include "status_board.hpp"
+
+namespace {
+
+struct ReaderResult {
+    bench::Samples latency;
+    uint64_t reads = 0;
+    uint64_t busy = 0;
+    uint64_t torn = 0;
+    bool ok = true;
+};
+
+bool uniform(const Device::CameraStatus& status) {
+    const auto* bytes = reinterpret_cast<const uint8_t*>(&status);
+    for (size_t i = 1; i < sizeof(status); ++i) {
+        if (bytes[i] != bytes[0]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void runReader(const std::string& name, const std::atomic<bool>& done, ReaderResult& result) {
+    StatusBoardReader reader;
+    if (!reader.open(name)) {
+        result.ok = false;
+        return;
+    }
+    StatusBoardRecord record;
+    while (!done.load(std::memory_order_relaxed)) {
+        for (size_t i = 0; i < reader.capacity(); ++i) {
+            // Sample the latency of one read in 64 to keep the clock out of
+            // the measured loop
+            bool timed = (result.reads & 63) == 0;
+            auto t0 = timed ? bench::Clock::now() : bench::Clock::time_point();
+            bool ok = reader.read(i, record);
+            if (timed) {
+                result.latency.add(bench::toMicros(bench::Clock::now() - t0));
+            }
+            ++result.reads;
+            if (!ok) {
+                result.busy += reader.sequence(i) != 0;
+                continue;
+            }
+            result.torn += !uniform(record.status);
+        }
+    }
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    if (bench::hasFlag(argc, argv, "--help")) {
+        std::cout << "usage: obsbot_shm_bench [--cameras 4] [--readers 4] [--updates 2000000] "
+                     "[--name /obsbot_shm_bench]"
+                  << std::endl;
+        return 0;
+    }
+    size_t cameras = std::max<size_t>(1, static_cast<size_t>(bench::argDouble(argc, argv, "--cameras", 4)));
+    size_t readers = static_cast<size_t>(bench::argDouble(argc, argv, "--readers", 4));
+    size_t updates = static_cast<size_t>(bench::argDouble(argc, argv, "--updates", 2000000));
+    std::string name = bench::arg(argc, argv, "--name", "/obsbot_shm_bench");
+
+    StatusBoard board;
+    if (!board.open(name, cameras)) {
+        std::cerr << "Failed to open status board " << name << std::endl;
+        return 1;
+    }
+    std::vector<std::string> serials;
+    for (size_t i = 0; i < cameras; ++i) {
+        serials.push_back("BENCH" + std::to_string(i));
+    }
+
+    std::atomic<bool> done{false};
+    std::vector<ReaderResult> results(readers);
+    std::vector<std::thread> threads;
+    for (size_t i = 0; i < readers; ++i) {
+        threads.emplace_back([&, i] { runReader(name, done, results[i]); });
+    }
+
+    Device::CameraStatus status;
+    auto t0 = bench::Clock::now();
+    for (size_t i = 0; i < updates; ++i) {
+        std::memset(&status, static_cast<int>(i & 0xff), sizeof(status));
+        board.publishStatus(serials[i % cameras], ObsbotProdTailAir, i, status);
+    }
+    double seconds = bench::toMicros(bench::Clock::now() - t0) / 1e6;
+    done.store(true);
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    bench::Samples latency;
+    ReaderResult total;
+    for (auto& result : results) {
+        latency.merge(result.latency);
+        total.reads += result.reads;
+        total.busy += result.busy;
+        total.torn += result.torn;
+        total.ok = total.ok && result.ok;
+    }
+    std::printf("cameras=%zu readers=%zu: %.0f updates/s  %.0f reads/s\n", cameras, readers,
+                board.updates() / seconds, total.reads / seconds);
+    std::printf("  read p50=%.3fus p99=%.3fus max=%.1fus  busy=%llu torn=%llu %s\n", latency.percentile(50),
+                latency.percentile(99), latency.max(), static_cast<unsigned long long>(total.busy),
+                static_cast<unsigned long long>(total.torn), total.ok ? "" : "FAILED");
+    board.close();
+    return total.ok && total.torn == 0 ? 0 : 1;
+}
@@ -0,0 +1,162 @@
+// Time from process start to the first command a camera has acknowledged.
+//
+// Every startup runs in a fresh child process, so the SDK enumerates the
+// camera from scratch each time:
+//   poll  the old main(): check getDevNum() once a second, then ask the
+//         camera for its formats before commanding it
+//   cold  readiness from the hot-plug callback (FleetManager::waitFor), an
+//         empty --registry, so the formats are still queried first
+//   warm  readiness from the hot-plug callback and the camera found in the
+//         registry written by the cold runs; the formats are refreshed after
+//         the first command
+// Reports when the camera was seen ("ready") and when the command completed.
+
+#include <future>
+#include <iostream>
+#include <sys/wait.h>
+#include <thread>
+#include <unistd.h>
+
+#include "bench_util.hpp"
+#include "device_registry.hpp"
+#include "fleet_manager.hpp"
+#include "status_pump.hpp"
+
+namespace {
+
+enum class Mode { Poll, Cold, Warm };
+
+struct Startup {
+    double ready_us = -1.0;
+    double first_us = -1.0;
+};
+
+// Runs in the child; the SDK is first touched here
+Startup startOnce(Mode mode, const std::string& registry_path) {
+    Startup result;
+    auto t0 = bench::Clock::now();
+    DeviceRegistry registry;
+    if (!registry.open(registry_path)) {
+        return result;
+    }
+
+    if (mode == Mode::Poll) {
+        auto& devices = Devices::get();
+        for (int retry = 0; retry < 10 && devices.getDevNum() == 0; ++retry) {
+            std::this_thread::sleep_for(std::chrono::seconds(1));
+        }
+        auto list = devices.getDevList();
+        if (list.empty() || !list.front()) {
+            return result;
+        }
+        result.ready_us = bench::toMicros(bench::Clock::now() - t0);
+        Device& device = *list.front();
+        DeviceRecord record = DeviceRecord::identify(device);
+        record.formats = device.videoFormatInfo();
+        if (device.cameraSetDevRunStatusR(Device::DevStatusRun) == RM_RET_OK) {
+            result.first_us = bench::toMicros(bench::Clock::now() - t0);
+        }
+        Devices::get().close();
+        return result;
+    }
+
+    StatusPump pump;
+    FleetManager fleet(pump);
+    pump.start();
+    fleet.start();
+    if (!fleet.waitFor(1, std::chrono::seconds(10))) {
+        return result;
+    }
+    result.ready_us = bench::toMicros(bench::Clock::now() - t0);
+
+    auto camera = fleet.cameras().front();
+    std::promise<bool> done;
+    camera->post([&](Device& device) {
+        DeviceRecord record;
+        bool known = registry.recognize(device, record);
+        if (!known) {
+            record = DeviceRecord::identify(device);
+            record.formats = device.videoFormatInfo();
+        }
+        bool ok = device.cameraSetDevRunStatusR(Device::DevStatusRun) == RM_RET_OK;
+        done.set_value(ok);
+        if (known) {
+            record.formats = device.videoFormatInfo();
+        }
+        registry.remember(record);
+        registry.save();
+    });
+    if (done.get_future().get()) {
+        result.first_us = bench::toMicros(bench::Clock::now() - t0);
+    }
+    // Let the background refresh and save finish
+    while (camera->pending() > 0) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    fleet.stop();
+    pump.stop();
+    Devices::get().close();
+    return result;
+}
+
+bool runChild(Mode mode, const std::string& registry_path, Startup& out) {
+    int fds[2];
+    if (::pipe(fds) != 0) {
+        return false;
+    }
+    pid_t pid = ::fork();
+    if (pid < 0) {
+        ::close(fds[0]);
+        ::close(fds[1]);
+        return false;
+    }
+    if (pid == 0) {
+        ::close(fds[0]);
+        Startup result = startOnce(mode, registry_path);
+        ssize_t written = ::write(fds[1], &result, sizeof(result));
+        ::_exit(written == sizeof(result) ? 0 : 1);
+    }
+    ::close(fds[1]);
+    ssize_t n = ::read(fds[0], &out, sizeof(out));
+    ::close(fds[0]);
+    int status = 0;
+    ::waitpid(pid, &status, 0);
+    return n == sizeof(out) && WIFEXITED(status) && WEXITSTATUS(status) == 0 && out.first_us >= 0.0;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    if (bench::hasFlag(argc, argv, "--help")) {
+        std::cout << "usage: obsbot_startup_bench [--rounds 5] [--registry /tmp/obsbot_startup_bench.devices]"
+                  << std::endl;
+        return 0;
+    }
+    size_t rounds = static_cast<size_t>(bench::argDouble(argc, argv, "--rounds", 5));
+    std::string path = bench::arg(argc, argv, "--registry", "/tmp/obsbot_startup_bench.devices");
+
+    // Nothing here may start a thread or touch the SDK before the forks
+    const struct {
+        const char* name;
+        Mode mode;
+    } kModes[] = {{"poll", Mode::Poll}, {"cold", Mode::Cold}, {"warm", Mode::Warm}};
+    for (auto& entry : kModes) {
+        bench::Samples ready, first;
+        for (size_t i = 0; i < rounds; ++i) {
+            if (entry.mode != Mode::Warm) {
+                ::unlink(path.c_str());
+            }
+            Startup startup;
+            if (!runChild(entry.mode, path, startup)) {
+                std::cerr << entry.name << " startup failed" << std::endl;
+                return 1;
+            }
+            ready.add(startup.ready_us);
+            first.add(startup.first_us);
+        }
+        std::printf("%-5s ready p50=%9.1fms  first command p50=%9.1fms max=%9.1fms\n", entry.name,
+                    ready.percentile(50) / 1000.0, first.percentile(50) / 1000.0, first.max() / 1000.0);
+    }
+    ::unlink(path.c_str());
+    return 0;
+}
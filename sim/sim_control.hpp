@@ -0,0 +1,54 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <dev/dev.hpp>
+
+// Control surface of the in-tree libdev stand-in (OBSBOT_SIM_DEV builds).
+//
+// The simulated Devices enumerates OBSBOT_SIM_DEVICES cameras shortly after
+// Devices::get() is first called. Every command pays a serialized service
+// time on the device's control channel plus a round trip of latency and
+// uniform jitter, so pipelining and contention behave like a USB camera.
+//
+// Defaults come from the environment when the library is first used:
+//   OBSBOT_SIM_DEVICES      cameras enumerated at startup (1)
+//   OBSBOT_SIM_PRODUCT      tailair, tail2, tiny2, tiny4k, meet2, meet4k (tailair)
+//   OBSBOT_SIM_LATENCY_US   round trip per command (2000)
+//   OBSBOT_SIM_JITTER_US    uniform extra round trip, 0..jitter (500)
+//   OBSBOT_SIM_SERVICE_US   time a command occupies the channel (300)
+//   OBSBOT_SIM_STATUS_MS    status push period (UVC_DEV_CAM_STATUS_REFRESH_PERIOD)
+//   OBSBOT_SIM_MTP_MBPS     MTP transfer rate in MB/s (40)
+//   OBSBOT_SIM_MTP_ROOT     serve this host directory as the camera storage
+//   OBSBOT_SIM_MTP_FILES    otherwise, number of generated media files (20)
+//   OBSBOT_SIM_MTP_FILE_KB  size of each generated file (4096)
+//
+// On the Tail models cameraSetTakePhotosR adds photos to the storage and
+// announces each one through the DevEventNotifyCallback as
+// kEvtInfoNewMediaFile, with a CameraFileNotify path relative to /DCIM.
+
+namespace sim {
+
+struct Config {
+    uint32_t latency_us;
+    uint32_t jitter_us;
+    uint32_t service_us;
+    uint32_t status_ms;
+    uint32_t mtp_mbps;
+};
+
+Config config();
+
+// Applies to commands issued after the call, on every device
+void setConfig(const Config& config);
+
+// Attaches a new camera and reports it through the devChangedCallback.
+// Returns its SN; an empty `sn` picks the next free one.
+std::string plug(ObsbotProductType product = ObsbotProdTailAir, const std::string& sn = std::string());
+
+// Detaches a camera. Commands in flight on it fail; returns false when no
+// such camera is attached. Its presets come back when the same SN is
+// plugged again, everything else starts from the defaults.
+bool unplug(const std::string& sn);
+
+} // namespace sim
@@ -0,0 +1,1099 @@
+// Simulated Device: identity, status pushes, gimbal, zoom, image, exposure,
+// white balance, focus, audio, AI and presets
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+
+#include "sim_private.hpp"
+
+namespace {
+
+constexpr float kPitchLimit = 90.f;
+constexpr float kYawLimit = 150.f;
+constexpr float kPresetSpeed = 90.f; // deg/s for positional moves
+
+// Speed arguments outside these ranges are ignored by the firmware
+bool validSpeed(double pitch, double pan) {
+    return std::fabs(pitch) <= 90.0 && std::fabs(pan) <= 180.0;
+}
+
+struct ProductInfo {
+    const char* name;
+    const char* model_code;
+    const char* version;
+};
+
+ProductInfo productInfo(ObsbotProductType product) {
+    switch (product) {
+    case ObsbotProdTailAir:
+        return {"OBSBOT Tail Air", "TAIL-AIR", "1.3.1.7"};
+    case ObsbotProdTail2:
+        return {"OBSBOT Tail 2", "TAIL-2", "1.0.4.2"};
+    case ObsbotProdTiny2:
+        return {"OBSBOT Tiny 2", "TINY-2", "2.0.2.6"};
+    case ObsbotProdTiny4k:
+        return {"OBSBOT Tiny 4K", "TINY-4K", "1.5.0.3"};
+    case ObsbotProdMeet2:
+        return {"OBSBOT Meet 2", "MEET-2", "1.1.0.9"};
+    case ObsbotProdMeet4k:
+        return {"OBSBOT Meet 4K", "MEET-4K", "1.4.2.0"};
+    default:
+        return {"OBSBOT Camera", "GENERIC", "1.0.0.0"};
+    }
+}
+
+bool isTail(ObsbotProductType product) {
+    return product == ObsbotProdTailAir || product == ObsbotProdTail2;
+}
+
+} // namespace
+
+DevicePrivate::DevicePrivate(Device* q, DeviceId* id)
+    : q_ptr(q), sn(id->sn), product(id->product), plugged_at(sim::Clock::now()), channel_free(plugged_at),
+      rng(std::hash<std::string>()(id->sn)), run_status(Device::DevStatusRun), ai_mode(Device::AiWorkModeNone),
+      ai_sub_mode(0), zoom(1.f), gimbal_pos{0.f, 0.f, 0.f}, gimbal_vel{0.f, 0.f, 0.f}, gimbal_goal{0.f, 0.f},
+      gimbal_seeking(false), gimbal_until(sim::Clock::time_point::max()), gimbal_updated(plugged_at),
+      status_param(nullptr), status_enabled(false), event_param(nullptr), mtp_dir("/") {
+    ProductInfo info = productInfo(product);
+    name = info.name;
+    model_code = info.model_code;
+    version = info.version;
+    for (size_t i = 0; i < uuid.size(); ++i) {
+        uuid[i] = static_cast<uint8_t>(i < sn.size() ? sn[i] : 0);
+    }
+    std::fill(std::begin(image), std::end(image), 50);
+    std::fill(std::begin(control), std::end(control), 0);
+    control[EvBias] = Device::DevAEEvBias_0;
+    control[Iso] = 400;
+    control[WbParam] = 5000;
+    control[FocusPos] = 50;
+    control[AudioVolume] = 50;
+    control[AudioAgc] = 1;
+    std::memset(&status, 0, sizeof(status));
+    std::memset(&boot_pos, 0, sizeof(boot_pos));
+    boot_pos.zoom = 1.f;
+    buildStorage();
+    refreshStatus();
+}
+
+sim::Clock::time_point DevicePrivate::reserve() {
+    auto& settings = sim::settings();
+    auto service = std::chrono::microseconds(settings.service_us.load(std::memory_order_relaxed));
+    uint32_t jitter_us = settings.jitter_us.load(std::memory_order_relaxed);
+    std::lock_guard<std::mutex> lock(channel_mutex);
+    auto start = std::max(sim::Clock::now(), channel_free);
+    channel_free = start + service;
+    uint32_t jitter = jitter_us ? std::uniform_int_distribution<uint32_t>(0, jitter_us)(rng) : 0;
+    return channel_free +
+           std::chrono::microseconds(settings.latency_us.load(std::memory_order_relaxed) + jitter);
+}
+
+int32_t DevicePrivate::transact(const char* command) {
+    if (!connected.load()) {
+        return RM_RET_ERR;
+    }
+    sim::log(DEV_DEBUG, "%s: %s", sn.c_str(), command);
+    std::this_thread::sleep_until(reserve());
+    return connected.load() ? RM_RET_OK : RM_RET_ERR;
+}
+
+void DevicePrivate::advanceGimbal(sim::Clock::time_point now) {
+    auto end = std::min(now, gimbal_until);
+    if (end > gimbal_updated) {
+        float dt = std::chrono::duration<float>(end - gimbal_updated).count();
+        bool arrived = true;
+        for (int axis = 0; axis < 2; ++axis) {
+            float& pos = gimbal_pos[axis];
+            if (gimbal_seeking) {
+                float delta = gimbal_goal[axis] - pos;
+                float step = std::fabs(gimbal_vel[axis]) * dt;
+                pos = std::fabs(delta) <= step ? gimbal_goal[axis] : pos + std::copysign(step, delta);
+                arrived = arrived && pos == gimbal_goal[axis];
+            } else {
+                pos += gimbal_vel[axis] * dt;
+            }
+            float limit = axis == 0 ? kPitchLimit : kYawLimit;
+            if (std::fabs(pos) >= limit) {
+                pos = std::copysign(limit, pos);
+                gimbal_vel[axis] = 0.f;
+            }
+        }
+        if (gimbal_seeking && arrived) {
+            gimbal_seeking = false;
+            gimbal_vel[0] = gimbal_vel[1] = 0.f;
+        }
+    }
+    if (now >= gimbal_until) {
+        gimbal_vel[0] = gimbal_vel[1] = 0.f;
+        gimbal_until = sim::Clock::time_point::max();
+    }
+    gimbal_updated = now;
+}
+
+void DevicePrivate::moveTo(float pitch, float yaw, float speed) {
+    advanceGimbal(sim::Clock::now());
+    gimbal_goal[0] = std::max(-kPitchLimit, std::min(kPitchLimit, pitch));
+    gimbal_goal[1] = std::max(-kYawLimit, std::min(kYawLimit, yaw));
+    gimbal_vel[0] = gimbal_vel[1] = speed;
+    gimbal_seeking = true;
+    gimbal_until = sim::Clock::time_point::max();
+}
+
+void DevicePrivate::refreshStatus() {
+    auto uptime = std::chrono::duration_cast<std::chrono::seconds>(sim::Clock::now() - plugged_at).count();
+    int32_t zoom_pct = static_cast<int32_t>(std::lround((zoom - 1.f) / 3.f * 100.f));
+    if (isTail(product)) {
+        auto& tail = status.tail_air;
+        tail.battery.capacity = static_cast<uint8_t>(std::max<int64_t>(5, 100 - uptime / 60));
+        tail.ai_type = static_cast<uint8_t>(ai_mode);
+        tail.digi_zoom_ratio = static_cast<uint16_t>(std::lround(zoom * 100.f));
+        tail.usb_status = 1;
+        tail.online_status.ai_online = 1;
+        tail.online_status.gim_online = 1;
+        tail.brightness = static_cast<uint8_t>(image[Brightness]);
+        tail.contrast = static_cast<uint8_t>(image[Contrast]);
+        tail.hue = static_cast<uint8_t>(image[Hue]);
+        tail.saturation = static_cast<uint8_t>(image[Saturation]);
+        tail.sharpness = static_cast<uint8_t>(image[Sharpness]);
+        tail.media_flags.anti_flick = static_cast<uint16_t>(control[AntiFlicker] & 3);
+    } else if (product == ObsbotProdMeet || product == ObsbotProdMeet4k) {
+        status.meet.zoom_ratio = static_cast<uint16_t>(zoom_pct);
+        status.meet.anti_flicker = static_cast<uint8_t>(control[AntiFlicker]);
+        status.meet.dev_status = static_cast<uint8_t>(run_status);
+    } else {
+        status.tiny.zoom_ratio = static_cast<uint16_t>(zoom_pct);
+        status.tiny.anti_flicker = static_cast<uint8_t>(control[AntiFlicker]);
+        status.tiny.dev_status = static_cast<uint8_t>(run_status);
+        status.tiny.ai_mode = static_cast<uint8_t>(ai_mode);
+        status.tiny.ai_sub_mode = static_cast<uint8_t>(ai_sub_mode);
+    }
+}
+
+void DevicePrivate::pushStatus() {
+    Device::CameraStatus snapshot;
+    {
+        std::lock_guard<std::mutex> lock(state_mutex);
+        refreshStatus();
+        // preset_update is set in exactly one push per batch of changes,
+        // and libdev latches it until the application clears it
+        if (isTail(product)) {
+            status.tail_air.misc_status.preset_update = preset_pending ? 1 : 0;
+            if (preset_pending) {
+                pos_changed = true;
+            }
+            preset_pending = false;
+        }
+        snapshot = status;
+    }
+    Device::DevStatusCallback callback;
+    void* param;
+    {
+        std::lock_guard<std::mutex> lock(callback_mutex);
+        if (!status_enabled || !status_callback) {
+            return;
+        }
+        callback = status_callback;
+        param = status_param;
+    }
+    callback(param, &snapshot);
+}
+
+void DevicePrivate::scheduleStatus() {
+    auto period = std::chrono::milliseconds(std::max<uint32_t>(1, sim::settings().status_ms.load()));
+    auto device = self;
+    sim::scheduler().at(sim::Clock::now() + period, [device] {
+        auto alive = device.lock();
+        if (!alive) {
+            return;
+        }
+        DevicePrivate* d = of(*alive);
+        if (!d->connected.load()) {
+            return;
+        }
+        d->pushStatus();
+        d->scheduleStatus();
+    });
+}
+
+Device::Device(DeviceId* id)
+    : d_ptr(new DevicePrivate(this, id)) {
+}
+
+Device::~Device() {
+    delete d_ptr;
+}
+
+const std::string& Device::videoDevPath() const {
+    static const std::string path = "/dev/video-sim";
+    return path;
+}
+
+const std::string& Device::audioDevPath() const {
+    static const std::string path;
+    return path;
+}
+
+std::vector<Device::VideoFormatInfo> Device::videoFormatInfo() {
+    R_D(Device);
+    d->transact("videoFormatInfo");
+    std::vector<VideoFormatInfo> formats;
+    const int32_t sizes[][2] = {{3840, 2160}, {1920, 1080}, {1280, 720}, {640, 360}};
+    for (auto& size : sizes) {
+        if (size[0] > 1920 && d->product == ObsbotProdTailAir) {
+            continue;
+        }
+        formats.emplace_back(size[0], size[1], 1, size[0] > 1920 ? 30 : 60, RmVideoFormat::MJPEG);
+        formats.emplace_back(size[0], size[1], 1, 30, RmVideoFormat::YUY2);
+    }
+    return formats;
+}
+
+const std::string& Device::devName() {
+    return d_func()->name;
+}
+
+const std::string& Device::devModelCode() {
+    return d_func()->model_code;
+}
+
+std::string Device::devVersion() {
+    return d_func()->version;
+}
+
+std::string Device::devSn() {
+    return d_func()->sn;
+}
+
+Device::DevMode Device::devMode() {
+    return DevModeUvc;
+}
+
+Device::DevUuid Device::uuid() {
+    return d_func()->uuid;
+}
+
+bool Device::isInited() {
+    return d_func()->connected.load();
+}
+
+Device::DevInfo Device::devInfo() {
+    R_D(Device);
+    DevInfo info;
+    info.product_ = d->name;
+    info.version_ = d->version;
+    info.sn_ = d->sn;
+    info.sys_type_ = DevMainSys;
+    return info;
+}
+
+Device::DevLiveStreamStatus Device::devLiveStreamStatus() {
+    return DevLiveStreamStatusNotStart;
+}
+
+Device::DevRecordStatus Device::devRecordStatus() {
+    R_D(Device);
+    std::lock_guard<std::mutex> lock(d->state_mutex);
+    if (isTail(d->product) && d->status.tail_air.media_running.record_status) {
+        return DevRecordStatusRunning;
+    }
+    return DevRecordStatusIdle;
+}
+
+bool Device::getDevPosChangedFlag() {
+    return d_func()->pos_changed.load();
+}
+
+void Device::setDevPosChangedFlag(bool flag) {
+    d_func()->pos_changed = flag;
+}
+
+Device::CameraStatus Device::cameraStatus() {
+    R_D(Device);
+    std::lock_guard<std::mutex> lock(d->state_mutex);
+    d->refreshStatus();
+    return d->status;
+}
+
+int32_t Device::cameraGetCameraStatusU(CameraStatus& camera_status) {
+    R_D(Device);
+    int32_t ret = d->transact("cameraGetCameraStatusU");
+    if (ret == RM_RET_OK) {
+        camera_status = cameraStatus();
+    }
+    return ret;
+}
+
+ObsbotProductType Device::productType() {
+    return d_func()->product;
+}
+
+void Device::setDevStatusCallbackFunc(DevStatusCallback callback, void* param) {
+    R_D(Device);
+    std::lock_guard<std::mutex> lock(d->callback_mutex);
+    d->status_callback = std::move(callback);
+    d->status_param = param;
+}
+
+void Device::enableDevStatusCallback(bool enabled) {
+    R_D(Device);
+    std::lock_guard<std::mutex> lock(d->callback_mutex);
+    d->status_enabled = enabled;
+}
+
+void Device::setDevEventNotifyCallbackFunc(DevEventNotifyCallback callback, void* param) {
+    R_D(Device);
+    std::lock_guard<std::mutex> lock(d->callback_mutex);
+    d->event_callback = std::move(callback);
+    d->event_param = param;
+}
+
+int32_t Device::cameraSetDevRunStatusR(DevStatus type) {
+    R_D(Device);
+    int32_t ret = d->transact("cameraSetDevRunStatusR");
+    if (ret == RM_RET_OK) {
+        std::lock_guard<std::mutex> lock(d->state_mutex);
+        d->run_status = type;
+    }
+    return ret;
+}
+
+int32_t Device::cameraSetAiModeU(AiWorkModeType mode, int32_t sub_mode_or_from) {
+    R_D(Device);
+    int32_t ret = d->transact("cameraSetAiModeU");
+    if (ret == RM_RET_OK) {
+        std::lock_guard<std::mutex> lock(d->state_mutex);
+        d->ai_mode = mode;
+        d->ai_sub_mode = sub_mode_or_from;
+    }
+    return ret;
+}
+
+int32_t Device::aiSetEnabledR(bool enabled) {
+    R_D(Device);
+    int32_t ret = d->transact("aiSetEnabledR");
+    if (ret == RM_RET_OK && !enabled) {
+        std::lock_guard<std::mutex> lock(d->state_mutex);
+        d->ai_mode = AiWorkModeNone;
+    }
+    return ret;
+}
+
+int32_t Device::aiGetAiStatusR(AiStatus* ai_status, RxDataCallback callback, void* param, GetMethod method) {
+    R_D(Device);
+    return d->get<AiStatus>("aiGetAiStatusR", ai_status, callback, param, method, [d](AiStatus& out) {
+        std::lock_guard<std::mutex> lock(d->state_mutex);
+        std::memset(&out, 0, sizeof(out));
+        out.presets_num = static_cast<uint8_t>(d->presets.size());
+        out.ai_main_mode = d->ai_mode == AiWorkModeGroup   ? AiMainModeTypeGroup
+                           : d->ai_mode == AiWorkModeHuman ? AiMainModeTypeTrack
+                           : d->ai_mode == AiWorkModeHand  ? AiMainModeTypeGestureTrack
+                           : d->ai_mode == AiWorkModeDesk  ? AiMainModeTypeDesk
+                           : d->ai_mode == AiWorkModeWhiteBoard ? AiMainModeTypeWhiteBoard
+                                                                : AiMainModeTypeNormal;
+        out.speed_mode = AiTrackSpeedStandard;
+    });
+}
+
+// Gimbal
+
+int32_t Device::aiSetGimbalSpeedCtrlR(double pitch, double pan, double roll) {
+    (void)roll;
+    R_D(Device);
+    int32_t ret = d->transact("aiSetGimbalSpeedCtrlR");
+    if (ret == RM_RET_OK && validSpeed(pitch, pan)) {
+        std::lock_guard<std::mutex> lock(d->state_mutex);
+        d->advanceGimbal(sim::Clock::now());
+        d->gimbal_seeking = false;
+        d->gimbal_vel[0] = static_cast<float>(pitch);
+        d->gimbal_vel[1] = static_cast<float>(pan);
+        d->gimbal_until = sim::Clock::time_point::max();
+    }
+    return ret;
+}
+
+int32_t Device::gimbalSpeedCtrlR(double pitch, double pan, double roll) {
+    return aiSetGimbalSpeedCtrlR(pitch, pan, roll);
+}
+
+int32_t Device::aiSetGimbalSpeedTimeR(float s_pitch, float s_pan, float t_pitch, float t_pan, float s_roll,
+                                      float t_roll) {
+    (void)s_roll;
+    (void)t_roll;
+    R_D(Device);
+    int32_t ret = d->transact("aiSetGimbalSpeedTimeR");
+    if (ret == RM_RET_OK && validSpeed(s_pitch, s_pan)) {
+        std::lock_guard<std::mutex> lock(d->state_mutex);
+        auto now = sim::Clock::now();
+        d->advanceGimbal(now);
+        d->gimbal_seeking = false;
+        // One deadline for both axes; the shorter time wins
+        float seconds = std::max(0.f, std::min(t_pitch, t_pan));
+        d->gimbal_vel[0] = s_pitch;
+        d->gimbal_vel[1] = s_pan;
+        d->gimbal_until = now + std::chrono::duration_cast<sim::Clock::duration>(
+                                    std::chrono::duration<float>(seconds));
+    }
+    return ret;
+}
+
+int32_t Device::aiSetGimbalSpeedEulerR(float s_pitch, float s_pan, float e_pitch, float e_pan, float s_roll,
+                                       float e_roll) {
+    (void)s_roll;
+    (void)e_roll;
+    R_D(Device);
+    int32_t ret = d->transact("aiSetGimbalSpeedEulerR");
+    if (ret == RM_RET_OK && validSpeed(s_pitch, s_pan)) {
+        std::lock_guard<std::mutex> lock(d->state_mutex);
+        d->moveTo(e_pitch, e_pan, 0.f);
+        d->gimbal_vel[0] = std::fabs(s_pitch);
+        d->gimbal_vel[1] = std::fabs(s_pan);
+    }
+    return ret;
+}
+
+int32_t Device::aiSetGimbalStop() {
+    R_D(Device);
+    int32_t ret = d->transact("aiSetGimbalStop");
+    if (ret == RM_RET_OK) {
+        std::lock_guard<std::mutex> lock(d->state_mutex);
+        d->advanceGimbal(sim::Clock::now());
+        d->gimbal_seeking = false;
+        d->gimbal_vel[0] = d->gimbal_vel[1] = 0.f;
+    }
+    return ret;
+}
+
+int32_t Device::aiSetGimbalMotorAngleR(float pitch, float yaw, float roll) {
+    (void)roll;
+    R_D(Device);
+    int32_t ret = d->transact("aiSetGimbalMotorAngleR");
+    if (ret == RM_RET_OK) {
+        std::lock_guard<std::mutex> lock(d->state_mutex);
+        d->moveTo(pitch, yaw, kPresetSpeed);
+    }
+    return ret;
+}
+
+int32_t Device::aiSetGimbalEulerAngleR(float pitch, float yaw, float roll) {
+    return aiSetGimbalMotorAngleR(pitch, yaw, roll);
+}
+
+int32_t Device::gimbalRstPosR() {
+    return aiSetGimbalMotorAngleR(0.f, 0.f);
+}
+
+int32_t Device::aiGetGimbalStateR(AiGimbalStateInfo* gim_info, RxDataCallback callback, void* param,
+                                  GetMethod method) {
+    R_D(Device);
+    return d->get<AiGimbalStateInfo>("aiGetGimbalStateR", gim_info, callback, param, method,
+                                     [d](AiGimbalStateInfo& out) {
+        std::lock_guard<std::mutex> lock(d->state_mutex);
+        d->advanceGimbal(sim::Clock::now());
+        out.pitch_euler = out.pitch_motor = d->gimbal_pos[0];
+        out.yaw_euler = out.yaw_motor = d->gimbal_pos[1];
+        out.roll_euler = out.roll_motor = d->gimbal_pos[2];
+        float sign_pitch = d->gimbal_seeking && d->gimbal_goal[0] < d->gimbal_pos[0] ? -1.f : 1.f;
+        float sign_yaw = d->gimbal_seeking && d->gimbal_goal[1] < d->gimbal_pos[1] ? -1.f : 1.f;
+        out.pitch_v = sign_pitch * d->gimbal_vel[0];
+        out.yaw_v = sign_yaw * d->gimbal_vel[1];
+        out.roll_v = 0.f;
+    });
+}
+
+int32_t Device::gimbalGetAttitudeInfoR(float xyz[3], RxDataCallback callback, void* param, GetMethod method) {
+    using Attitude = std::array<float, 3>;
+    R_D(Device);
+    return d->get<Attitude>("gimbalGetAttitudeInfoR", reinterpret_cast<Attitude*>(xyz), callback, param, method,
+                            [d](Attitude& out) {
+        std::lock_guard<std::mutex> lock(d->state_mutex);
+        d->advanceGimbal(sim::Clock::now());
+        out = {d->gimbal_pos[2], d->gimbal_pos[0], d->gimbal_pos[1]};
+    });
+}
+
+int32_t Device::aiSetGimbalBootPosR(const PresetPosInfo& preset_info, bool presets_flag) {
+    (void)presets_flag;
+    R_D(Device);
+    int32_t ret = d->transact("aiSetGimbalBootPosR");
+    if (ret == RM_RET_OK) {
+        std::lock_guard<std::mutex> lock(d->state_mutex);
+        d->boot_pos = preset_info;
+    }
+    return ret;
+}
+
+int32_t Device::aiGetGimbalBootPosR(PresetPosInfo* preset_info, RxDataCallback callback, void* param,
+                                    GetMethod method) {
+    R_D(Device);
+    return d->get<PresetPosInfo>("aiGetGimbalBootPosR", preset_info, callback, param, method,
+                                 [d](PresetPosInfo& out) {
+        std::lock_guard<std::mutex> lock(d->state_mutex);
+        out = d->boot_pos;
+    });
+}
+
+int32_t Device::aiTrgGimbalBootPosR(bool reset_mode) {
+    (void)reset_mode;
+    R_D(Device);
+    int32_t ret = d->transact("aiTrgGimbalBootPosR");
+    if (ret == RM_RET_OK) {
+        std::lock_guard<std::mutex> lock(d->state_mutex);
+        d->moveTo(d->boot_pos.pitch, d->boot_pos.yaw, kPresetSpeed);
+        d->zoom = std::max(1.f, d->boot_pos.zoom);
+    }
+    return ret;
+}
+
+int32_t Device::cameraGetFaceFocusR(int32_t* face_focus, RxDataCallback callback, void* param, GetMethod method) {
+    R_D(Device);
+    return d->get<int32_t>("cameraGetFaceFocusR", face_focus, callback, param, method, [](int32_t& out) {
+        out = 0;
+    });
+}
+
+int32_t Device::aiGetHandTrackStateR(AiHandTrackStateInfo* state_info, int32_t id, RxDataCallback callback,
+                                     void* param, GetMethod method) {
+    R_D(Device);
+    return d->get<AiHandTrackStateInfo>("aiGetHandTrackStateR", state_info, callback, param, method,
+                                        [id](AiHandTrackStateInfo& out) {
+        out.yaw_min = -kYawLimit;
+        out.yaw_max = kYawLimit;
+        out.pitch_min = -kPitchLimit;
+        out.pitch_max = kPitchLimit;
+        out.view_id = id;
+        out.hand_type = AiHandTrackRight;
+    });
+}
+
+// Zoom
+
+int32_t Device::cameraGetRangeZoomAbsoluteR(UvcParamRange& range) {
+    R_D(Device);
+    int32_t ret = d->transact("cameraGetRangeZoomAbsoluteR");
+    if (ret == RM_RET_OK) {
+        range.min_ = 0;
+        range.max_ = 100;
+        range.step_ = 1;
+        range.default_ = 0;
+        range.caps_flags_ = 0;
+        range.valid_ = true;
+    }
+    return ret;
+}
+
+int32_t Device::cameraSetZoomAbsoluteR(float zoom) {
+    R_D(Device);
+    int32_t ret = d->transact("cameraSetZoomAbsoluteR");
+    if (ret == RM_RET_OK && zoom >= 1.f && zoom <= 2.f) {
+        std::lock_guard<std::mutex> lock(d->state_mutex);
+        d->zoom = zoom;
+    }
+    return ret;
+}
+
+int32_t Device::cameraGetZoomAbsoluteR(float& zoom) {
+    R_D(Device);
+    int32_t ret = d->transact("cameraGetZoomAbsoluteR");
+    if (ret == RM_RET_OK) {
+        std::lock_guard<std::mutex> lock(d->state_mutex);
+        zoom = d->zoom;
+    }
+    return ret;
+}
+
+int32_t Device::aiSetCameraZoomRatioR(float ratio, int speed) {
+    (void)speed;
+    R_D(Device);
+    int32_t ret = d->transact("aiSetCameraZoomRatioR");
+    if (ret == RM_RET_OK && ratio >= 1.f && ratio <= 4.f) {
+        std::lock_guard<std::mutex> lock(d->state_mutex);
+        d->zoom = ratio;
+    }
+    return ret;
+}
+
+int32_t Device::cameraSetZoomWithSpeedAbsoluteR(uint32_t zoom_ratio, uint32_t zoom_speed) {
+    (void)zoom_speed;
+    R_D(Device);
+    int32_t ret = d->transact("cameraSetZoomWithSpeedAbsoluteR");
+    if (ret == RM_RET_OK && zoom_ratio >= 100 && zoom_ratio <= 400) {
+        std::lock_guard<std::mutex> lock(d->state_mutex);
+        d->zoom = zoom_ratio / 100.f;
+    }
+    return ret;
+}
+
+int32_t Device::cameraSetZoomStopR() {
+    return d_func()->transact("cameraSetZoomStopR");
+}
+
+// Image
+
+int32_t DevicePrivate::setImage(const char* command, ImageParam which, int32_t value) {
+    int32_t ret = transact(command);
+    if (ret == RM_RET_OK) {
+        if (value < 0 || value > 100) {
+            return RM_RET_ERR;
+        }
+        std::lock_guard<std::mutex> lock(state_mutex);
+        image[which] = value;
+    }
+    return ret;
+}
+
+int32_t DevicePrivate::getImage(const char* command, ImageParam which, int32_t& value) {
+    int32_t ret = transact(command);
+    if (ret == RM_RET_OK) {
+        std::lock_guard<std::mutex> lock(state_mutex);
+        value = image[which];
+    }
+    return ret;
+}
+
+namespace {
+
+int32_t imageRange(DevicePrivate* d, const char* command, Device::UvcParamRange& range) {
+    int32_t ret = d->transact(command);
+    if (ret == RM_RET_OK) {
+        range.min_ = 0;
+        range.max_ = 100;
+        range.step_ = 1;
+        range.default_ = 50;
+        range.caps_flags_ = 0;
+        range.valid_ = true;
+    }
+    return ret;
+}
+
+} // namespace
+
+int32_t Device::cameraSetImageBrightnessR(int32_t brightness) {
+    return d_func()->setImage("cameraSetImageBrightnessR", DevicePrivate::Brightness, brightness);
+}
+
+int32_t Device::cameraGetImageBrightnessR(int32_t& brightness) {
+    return d_func()->getImage("cameraGetImageBrightnessR", DevicePrivate::Brightness, brightness);
+}
+
+int32_t Device::cameraGetRangeImageBrightnessR(UvcParamRange& range) {
+    return imageRange(d_func(), "cameraGetRangeImageBrightnessR", range);
+}
+
+int32_t Device::cameraSetImageContrastR(int32_t contrast) {
+    return d_func()->setImage("cameraSetImageContrastR", DevicePrivate::Contrast, contrast);
+}
+
+int32_t Device::cameraGetImageContrastR(int32_t& contrast) {
+    return d_func()->getImage("cameraGetImageContrastR", DevicePrivate::Contrast, contrast);
+}
+
+int32_t Device::cameraGetRangeImageContrastR(UvcParamRange& range) {
+    return imageRange(d_func(), "cameraGetRangeImageContrastR", range);
+}
+
+int32_t Device::cameraSetImageHueR(int32_t hue) {
+    return d_func()->setImage("cameraSetImageHueR", DevicePrivate::Hue, hue);
+}
+
+int32_t Device::cameraGetImageHueR(int32_t& hue) {
+    return d_func()->getImage("cameraGetImageHueR", DevicePrivate::Hue, hue);
+}
+
+int32_t Device::cameraGetRangeImageHueR(UvcParamRange& range) {
+    return imageRange(d_func(), "cameraGetRangeImageHueR", range);
+}
+
+int32_t Device::cameraSetImageSaturationR(int32_t saturation) {
+    return d_func()->setImage("cameraSetImageSaturationR", DevicePrivate::Saturation, saturation);
+}
+
+int32_t Device::cameraGetImageSaturationR(int32_t& saturation) {
+    return d_func()->getImage("cameraGetImageSaturationR", DevicePrivate::Saturation, saturation);
+}
+
+int32_t Device::cameraGetRangeImageSaturationR(UvcParamRange& range) {
+    return imageRange(d_func(), "cameraGetRangeImageSaturationR", range);
+}
+
+int32_t Device::cameraSetImageSharpR(int32_t sharp) {
+    return d_func()->setImage("cameraSetImageSharpR", DevicePrivate::Sharpness, sharp);
+}
+
+int32_t Device::cameraGetImageSharpR(int32_t& sharp) {
+    return d_func()->getImage("cameraGetImageSharpR", DevicePrivate::Sharpness, sharp);
+}
+
+int32_t Device::cameraGetRangeImageSharpR(UvcParamRange& range) {
+    return imageRange(d_func(), "cameraGetRangeImageSharpR", range);
+}
+
+// Exposure, white balance, focus and audio
+
+int32_t DevicePrivate::setControl(const char* command, bool tail_only,
+                                  std::initializer_list<std::pair<Control, int32_t>> values) {
+    int32_t ret = transact(command);
+    if (ret != RM_RET_OK) {
+        return ret;
+    }
+    if (tail_only && !isTail(product)) {
+        return Device::CommErrorMode;
+    }
+    std::lock_guard<std::mutex> lock(state_mutex);
+    for (auto& value : values) {
+        control[value.first] = value.second;
+    }
+    return RM_RET_OK;
+}
+
+int32_t DevicePrivate::getControl(const char* command, bool tail_only,
+                                  std::initializer_list<std::pair<Control, int32_t*>> values) {
+    int32_t ret = transact(command);
+    if (ret != RM_RET_OK) {
+        return ret;
+    }
+    if (tail_only && !isTail(product)) {
+        return Device::CommErrorMode;
+    }
+    std::lock_guard<std::mutex> lock(state_mutex);
+    for (auto& value : values) {
+        *value.second = control[value.first];
+    }
+    return RM_RET_OK;
+}
+
+int32_t Device::cameraSetExposureModeR(int32_t exposure_mode) {
+    return d_func()->setControl("cameraSetExposureModeR", true, {{DevicePrivate::ExposureMode, exposure_mode}});
+}
+
+int32_t Device::cameraGetExposureModeR(int32_t& exposure_mode) {
+    return d_func()->getControl("cameraGetExposureModeR", true, {{DevicePrivate::ExposureMode, &exposure_mode}});
+}
+
+int32_t Device::cameraSetAELockR(bool enabled) {
+    return d_func()->setControl("cameraSetAELockR", true, {{DevicePrivate::AeLock, enabled ? 1 : 0}});
+}
+
+int32_t Device::cameraGetAELockR(bool& enabled) {
+    int32_t value = 0;
+    int32_t ret = d_func()->getControl("cameraGetAELockR", true, {{DevicePrivate::AeLock, &value}});
+    enabled = value != 0;
+    return ret;
+}
+
+int32_t Device::cameraSetPAEEvBiasR(int32_t ev_bias) {
+    return d_func()->setControl("cameraSetPAEEvBiasR", true, {{DevicePrivate::EvBias, ev_bias}});
+}
+
+int32_t Device::cameraGetPAEEvBiasR(int32_t& ev_bias) {
+    return d_func()->getControl("cameraGetPAEEvBiasR", true, {{DevicePrivate::EvBias, &ev_bias}});
+}
+
+int32_t Device::cameraSetMAEIsoR(int32_t iso) {
+    return d_func()->setControl("cameraSetMAEIsoR", true, {{DevicePrivate::Iso, iso}});
+}
+
+int32_t Device::cameraGetMAEIsoR(int32_t& iso) {
+    return d_func()->getControl("cameraGetMAEIsoR", true, {{DevicePrivate::Iso, &iso}});
+}
+
+int32_t Device::cameraSetMAEShutterR(int32_t shutter_time) {
+    return d_func()->setControl("cameraSetMAEShutterR", true, {{DevicePrivate::Shutter, shutter_time}});
+}
+
+int32_t Device::cameraGetMAEShutterR(int32_t& shutter_time) {
+    return d_func()->getControl("cameraGetMAEShutterR", true, {{DevicePrivate::Shutter, &shutter_time}});
+}
+
+int32_t Device::cameraSetAntiFlickR(int32_t freq) {
+    return d_func()->setControl("cameraSetAntiFlickR", false, {{DevicePrivate::AntiFlicker, freq}});
+}
+
+int32_t Device::cameraGetAntiFlickR(int32_t& freq) {
+    return d_func()->getControl("cameraGetAntiFlickR", false, {{DevicePrivate::AntiFlicker, &freq}});
+}
+
+int32_t Device::cameraSetWhiteBalanceR(DevWhiteBalanceType wb_type, int32_t param) {
+    return d_func()->setControl("cameraSetWhiteBalanceR", false,
+                                {{DevicePrivate::WbType, wb_type}, {DevicePrivate::WbParam, param}});
+}
+
+int32_t Device::cameraGetWhiteBalanceR(DevWhiteBalanceType& wb_type, int32_t& param) {
+    int32_t type = 0;
+    int32_t ret = d_func()->getControl("cameraGetWhiteBalanceR", false,
+                                       {{DevicePrivate::WbType, &type}, {DevicePrivate::WbParam, &param}});
+    wb_type = static_cast<DevWhiteBalanceType>(type);
+    return ret;
+}
+
+int32_t Device::cameraSetAutoFocusModeR(DevAutoFocusType focus_type) {
+    return d_func()->setControl("cameraSetAutoFocusModeR", true, {{DevicePrivate::FocusMode, focus_type}});
+}
+
+int32_t Device::cameraGetAutoFocusModeR(DevAutoFocusType& focus_type) {
+    int32_t type = 0;
+    int32_t ret = d_func()->getControl("cameraGetAutoFocusModeR", true, {{DevicePrivate::FocusMode, &type}});
+    focus_type = static_cast<DevAutoFocusType>(type);
+    return ret;
+}
+
+int32_t Device::cameraSetFocusPosR(int32_t focus_pos) {
+    return d_func()->setControl("cameraSetFocusPosR", true, {{DevicePrivate::FocusPos, focus_pos}});
+}
+
+int32_t Device::cameraGetFocusPosR(int32_t& focus_pos) {
+    return d_func()->getControl("cameraGetFocusPosR", true, {{DevicePrivate::FocusPos, &focus_pos}});
+}
+
+int32_t Device::cameraSetAudioVolumeR(int16_t volume) {
+    return d_func()->setControl("cameraSetAudioVolumeR", true, {{DevicePrivate::AudioVolume, volume}});
+}
+
+int32_t Device::cameraGetAudioVolumeR(int16_t& volume) {
+    int32_t value = 0;
+    int32_t ret = d_func()->getControl("cameraGetAudioVolumeR", true, {{DevicePrivate::AudioVolume, &value}});
+    volume = static_cast<int16_t>(value);
+    return ret;
+}
+
+int32_t Device::cameraSetAudioAGCR(bool enabled) {
+    return d_func()->setControl("cameraSetAudioAGCR", false, {{DevicePrivate::AudioAgc, enabled ? 1 : 0}});
+}
+
+int32_t Device::cameraGetAudioAGCR(bool& enabled) {
+    int32_t value = 0;
+    int32_t ret = d_func()->getControl("cameraGetAudioAGCR", false, {{DevicePrivate::AudioAgc, &value}});
+    enabled = value != 0;
+    return ret;
+}
+
+int32_t Device::cameraSetAudioNoiseReduceR(bool enabled, int32_t level) {
+    return d_func()->setControl("cameraSetAudioNoiseReduceR", true,
+                                {{DevicePrivate::AudioNr, enabled ? 1 : 0}, {DevicePrivate::AudioNrLevel, level}});
+}
+
+int32_t Device::cameraGetAudioNoiseReduceR(bool& enabled, int32_t& level) {
+    int32_t value = 0;
+    int32_t ret = d_func()->getControl("cameraGetAudioNoiseReduceR", true,
+                                       {{DevicePrivate::AudioNr, &value}, {DevicePrivate::AudioNrLevel, &level}});
+    enabled = value != 0;
+    return ret;
+}
+
+namespace {
+
+int32_t fixedRange(DevicePrivate* d, const char* command, bool supported, long min, long max, long step,
+                   long def, Device::UvcParamRange& range) {
+    int32_t ret = d->transact(command);
+    if (ret != RM_RET_OK) {
+        return ret;
+    }
+    if (!supported) {
+        return Device::CommErrorMode;
+    }
+    range.min_ = min;
+    range.max_ = max;
+    range.step_ = step;
+    range.default_ = def;
+    range.caps_flags_ = 0;
+    range.valid_ = true;
+    return RM_RET_OK;
+}
+
+} // namespace
+
+int32_t Device::cameraGetRangeWhiteBalanceR(UvcParamRange& range) {
+    return fixedRange(d_func(), "cameraGetRangeWhiteBalanceR", true, 2000, 10000, 100, 5000, range);
+}
+
+int32_t Device::cameraGetRangePAEEvBiasR(UvcParamRange& range) {
+    R_D(Device);
+    return fixedRange(d, "cameraGetRangePAEEvBiasR", isTail(d->product), DevAEEvBias_NEG_3_0, DevAEEvBias_3_0, 1,
+                      DevAEEvBias_0, range);
+}
+
+int32_t Device::cameraGetRangeMAEIsoR(UvcParamRange& range) {
+    R_D(Device);
+    return fixedRange(d, "cameraGetRangeMAEIsoR", isTail(d->product), 100, 6400, 100, 400, range);
+}
+
+int32_t Device::cameraGetRangeAntiFlickR(UvcParamRange& range) {
+    return fixedRange(d_func(), "cameraGetRangeAntiFlickR", true, 0, 3, 1, 0, range);
+}
+
+int32_t Device::cameraGetRangeExposureAbsolute(UvcParamRange& range) {
+    return fixedRange(d_func(), "cameraGetRangeExposureAbsolute", true, DevShutterTime_Auto,
+                      DevShutterTime_1_2, 1, DevShutterTime_Auto, range);
+}
+
+int32_t Device::cameraGetRangeFocusAbsolute(UvcParamRange& range) {
+    return fixedRange(d_func(), "cameraGetRangeFocusAbsolute", true, 0, 100, 1, 50, range);
+}
+
+// Presets
+
+namespace {
+
+void notePresetChange(DevicePrivate* d) {
+    if (isTail(d->product)) {
+        d->preset_pending = true;
+    }
+}
+
+} // namespace
+
+int32_t Device::aiGetGimbalPresetListR(DevDataArray* ids, RxDataCallback callback, void* param, GetMethod method) {
+    R_D(Device);
+    return d->get<DevDataArray>("aiGetGimbalPresetListR", ids, callback, param, method, [d](DevDataArray& out) {
+        std::lock_guard<std::mutex> lock(d->state_mutex);
+        std::memset(&out, 0, sizeof(out));
+        for (auto& entry : d->presets) {
+            if (out.len < 16) {
+                out.data_int32[out.len++] = entry.first;
+            }
+        }
+    });
+}
+
+int32_t Device::aiGetGimbalPresetInfoWithIdR(PresetPosInfo* preset_info, int32_t id, RxDataCallback callback,
+                                             void* param, GetMethod method) {
+    R_D(Device);
+    return d->get<PresetPosInfo>("aiGetGimbalPresetInfoWithIdR", preset_info, callback, param, method,
+                                 [d, id](PresetPosInfo& out) {
+        std::lock_guard<std::mutex> lock(d->state_mutex);
+        auto it = d->presets.find(id);
+        if (it != d->presets.end()) {
+            out = it->second.info;
+        } else {
+            std::memset(&out, 0, sizeof(out));
+            out.id = -1;
+        }
+    });
+}
+
+int32_t Device::aiGetGimbalPresetNameWithIdR(DevDataArray* name, int32_t id, RxDataCallback callback, void* param,
+                                             GetMethod method) {
+    R_D(Device);
+    return d->get<DevDataArray>("aiGetGimbalPresetNameWithIdR", name, callback, param, method,
+                                [d, id](DevDataArray& out) {
+        std::lock_guard<std::mutex> lock(d->state_mutex);
+        std::memset(&out, 0, sizeof(out));
+        auto it = d->presets.find(id);
+        if (it != d->presets.end()) {
+            out.len = std::min<int32_t>(it->second.info.name_len, sizeof(out.data_int8));
+            std::memcpy(out.data_int8, it->second.info.name, out.len);
+        }
+    });
+}
+
+int32_t Device::aiSetGimbalPresetNameWithIdR(const std::string& name, int32_t id) {
+    R_D(Device);
+    int32_t ret = d->transact("aiSetGimbalPresetNameWithIdR");
+    if (ret != RM_RET_OK) {
+        return ret;
+    }
+    std::lock_guard<std::mutex> lock(d->state_mutex);
+    auto it = d->presets.find(id);
+    if (it == d->presets.end()) {
+        return RM_RET_ERR;
+    }
+    auto& info = it->second.info;
+    info.name_len = static_cast<int32_t>(std::min(name.size(), sizeof(info.name)));
+    std::memset(info.name, 0, sizeof(info.name));
+    std::memcpy(info.name, name.data(), info.name_len);
+    notePresetChange(d);
+    return RM_RET_OK;
+}
+
+int32_t Device::aiAddGimbalPresetR(PresetPosInfo* preset_info) {
+    R_D(Device);
+    if (!preset_info) {
+        return RM_RET_ERR;
+    }
+    int32_t ret = d->transact("aiAddGimbalPresetR");
+    if (ret == RM_RET_OK) {
+        std::lock_guard<std::mutex> lock(d->state_mutex);
+        d->presets[preset_info->id].info = *preset_info;
+        notePresetChange(d);
+    }
+    return ret;
+}
+
+int32_t Device::aiDelGimbalPresetR(int32_t id) {
+    R_D(Device);
+    int32_t ret = d->transact("aiDelGimbalPresetR");
+    if (ret == RM_RET_OK) {
+        std::lock_guard<std::mutex> lock(d->state_mutex);
+        if (d->presets.erase(id) == 0) {
+            return RM_RET_ERR;
+        }
+        notePresetChange(d);
+    }
+    return ret;
+}
+
+int32_t Device::aiUpdGimbalPresetR(PresetPosInfo* preset_info, bool presets_flag) {
+    (void)presets_flag;
+    R_D(Device);
+    if (!preset_info) {
+        return RM_RET_ERR;
+    }
+    int32_t ret = d->transact("aiUpdGimbalPresetR");
+    if (ret == RM_RET_OK) {
+        std::lock_guard<std::mutex> lock(d->state_mutex);
+        auto it = d->presets.find(preset_info->id);
+        if (it != d->presets.end()) {
+            it->second.info = *preset_info;
+            notePresetChange(d);
+        }
+    }
+    return ret;
+}
+
+int32_t Device::aiTrgGimbalPresetR(int pos_id) {
+    R_D(Device);
+    int32_t ret = d->transact("aiTrgGimbalPresetR");
+    if (ret != RM_RET_OK) {
+        return ret;
+    }
+    std::lock_guard<std::mutex> lock(d->state_mutex);
+    auto it = d->presets.find(pos_id);
+    if (it == d->presets.end()) {
+        return RM_RET_ERR;
+    }
+    d->moveTo(it->second.info.pitch, it->second.info.yaw, kPresetSpeed);
+    if (it->second.info.zoom >= 1.f) {
+        d->zoom = it->second.info.zoom;
+    }
+    return RM_RET_OK;
+}
+
+int32_t Device::aiSetPresetsActionR(const PresetsAction& presets_action, int pos_id) {
+    R_D(Device);
+    int32_t ret = d->transact("aiSetPresetsActionR");
+    if (ret != RM_RET_OK) {
+        return ret;
+    }
+    std::lock_guard<std::mutex> lock(d->state_mutex);
+    auto it = d->presets.find(pos_id);
+    if (it == d->presets.end()) {
+        return RM_RET_ERR;
+    }
+    it->second.action = presets_action;
+    return RM_RET_OK;
+}
+
+int32_t Device::aiGetPresetsActionR(PresetsAction& presets_action, int pos_id) {
+    R_D(Device);
+    int32_t ret = d->transact("aiGetPresetsActionR");
+    if (ret != RM_RET_OK) {
+        return ret;
+    }
+    std::lock_guard<std::mutex> lock(d->state_mutex);
+    auto it = d->presets.find(pos_id);
+    if (it == d->presets.end()) {
+        return RM_RET_ERR;
+    }
+    presets_action = it->second.action;
+    return RM_RET_OK;
+}
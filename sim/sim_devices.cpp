@@ -0,0 +1,376 @@
+// Simulated Devices: enumeration, hot-plug, the SDK thread and logging
+
+#include <cstdarg>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include "sim_private.hpp"
+
+namespace {
+
+uint32_t envU32(const char* name, uint32_t fallback) {
+    const char* value = std::getenv(name);
+    return value && *value ? static_cast<uint32_t>(std::strtoul(value, nullptr, 10)) : fallback;
+}
+
+ObsbotProductType envProduct(const char* name, ObsbotProductType fallback) {
+    const char* value = std::getenv(name);
+    if (!value) {
+        return fallback;
+    }
+    static const struct {
+        const char* name;
+        ObsbotProductType product;
+    } kProducts[] = {
+        {"tailair", ObsbotProdTailAir}, {"tail2", ObsbotProdTail2},   {"tiny2", ObsbotProdTiny2},
+        {"tiny4k", ObsbotProdTiny4k},   {"meet2", ObsbotProdMeet2},   {"meet4k", ObsbotProdMeet4k},
+    };
+    for (auto& entry : kProducts) {
+        if (std::strcmp(entry.name, value) == 0) {
+            return entry.product;
+        }
+    }
+    return fallback;
+}
+
+void defaultLogHandler(int32_t lvl, const char* msg, va_list args, void*) {
+    if (lvl > DEV_INFO) {
+        return;
+    }
+    std::fprintf(stderr, "[libdev-sim] ");
+    std::vfprintf(stderr, msg, args);
+    std::fputc('\n', stderr);
+}
+
+std::atomic<dlog_handler_t> g_log_handler{defaultLogHandler};
+std::atomic<void*> g_log_param{nullptr};
+
+} // namespace
+
+namespace sim {
+
+Settings& settings() {
+    static Settings* instance = [] {
+        auto* s = new Settings();
+        s->latency_us = envU32("OBSBOT_SIM_LATENCY_US", 2000);
+        s->jitter_us = envU32("OBSBOT_SIM_JITTER_US", 500);
+        s->service_us = envU32("OBSBOT_SIM_SERVICE_US", 300);
+        s->status_ms = envU32("OBSBOT_SIM_STATUS_MS", UVC_DEV_CAM_STATUS_REFRESH_PERIOD);
+        s->mtp_mbps = envU32("OBSBOT_SIM_MTP_MBPS", 40);
+        s->initial_devices = envU32("OBSBOT_SIM_DEVICES", 1);
+        s->initial_product = envProduct("OBSBOT_SIM_PRODUCT", ObsbotProdTailAir);
+        const char* root = std::getenv("OBSBOT_SIM_MTP_ROOT");
+        s->mtp_root = root ? root : "";
+        s->mtp_files = envU32("OBSBOT_SIM_MTP_FILES", 20);
+        s->mtp_file_kb = envU32("OBSBOT_SIM_MTP_FILE_KB", 4096);
+        return s;
+    }();
+    return *instance;
+}
+
+Scheduler& scheduler() {
+    static Scheduler instance;
+    return instance;
+}
+
+void log(int32_t level, const char* format, ...) {
+    va_list args;
+    va_start(args, format);
+    dlogva(level, format, args);
+    va_end(args);
+}
+
+Scheduler::Scheduler()
+    : next_order_(0), stopping_(false), thread_(&Scheduler::run, this) {
+}
+
+Scheduler::~Scheduler() {
+    stop();
+}
+
+void Scheduler::at(Clock::time_point when, Task task) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (stopping_) {
+            return;
+        }
+        queue_.push(Entry{when, next_order_++, std::move(task)});
+    }
+    cond_.notify_one();
+}
+
+void Scheduler::stop() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    cond_.notify_one();
+    if (thread_.joinable() && thread_.get_id() != std::this_thread::get_id()) {
+        thread_.join();
+    }
+}
+
+void Scheduler::run() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (!stopping_) {
+        if (queue_.empty()) {
+            cond_.wait(lock);
+            continue;
+        }
+        auto when = queue_.top().when;
+        if (Clock::now() < when) {
+            cond_.wait_until(lock, when);
+            continue;
+        }
+        Task task = std::move(const_cast<Entry&>(queue_.top()).task);
+        queue_.pop();
+        lock.unlock();
+        task();
+        lock.lock();
+    }
+}
+
+Config config() {
+    auto& s = settings();
+    return Config{s.latency_us.load(), s.jitter_us.load(), s.service_us.load(), s.status_ms.load(),
+                  s.mtp_mbps.load()};
+}
+
+void setConfig(const Config& config) {
+    auto& s = settings();
+    s.latency_us = config.latency_us;
+    s.jitter_us = config.jitter_us;
+    s.service_us = config.service_us;
+    s.status_ms = config.status_ms;
+    s.mtp_mbps = config.mtp_mbps;
+}
+
+std::string plug(ObsbotProductType product, const std::string& sn) {
+    auto device = DevicesPrivate::of(Devices::get())->attach(product, sn);
+    return device ? device->devSn() : std::string();
+}
+
+bool unplug(const std::string& sn) {
+    return DevicesPrivate::of(Devices::get())->detach(sn);
+}
+
+} // namespace sim
+
+std::shared_ptr<Device> DevicesPrivate::attach(ObsbotProductType product, const std::string& sn) {
+    DeviceId id;
+    id.product = product;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (closed) {
+            return nullptr;
+        }
+        if (sn.empty()) {
+            char generated[16];
+            std::snprintf(generated, sizeof(generated), "SIM%011u", next_sn++);
+            id.sn = generated;
+        } else {
+            id.sn = sn;
+        }
+        for (auto& device : devices) {
+            if (device->devSn() == id.sn) {
+                return nullptr;
+            }
+        }
+    }
+
+    auto device = std::make_shared<Device>(&id);
+    DevicePrivate* d = DevicePrivate::of(*device);
+    d->self = device;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto kept = flash.find(id.sn);
+        if (kept != flash.end()) {
+            d->presets = std::move(kept->second);
+            flash.erase(kept);
+        }
+        devices.push_back(device);
+    }
+    sim::log(DEV_INFO, "%s attached (%s)", id.sn.c_str(), d->name.c_str());
+    d->scheduleStatus();
+    notify(id.sn, true);
+    return device;
+}
+
+bool DevicesPrivate::detach(const std::string& sn) {
+    std::shared_ptr<Device> device;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        for (auto it = devices.begin(); it != devices.end(); ++it) {
+            if ((*it)->devSn() == sn) {
+                device = *it;
+                devices.erase(it);
+                break;
+            }
+        }
+    }
+    if (!device) {
+        return false;
+    }
+    DevicePrivate* d = DevicePrivate::of(*device);
+    d->connected.store(false);
+    std::map<int32_t, DevicePrivate::Preset> presets;
+    {
+        std::lock_guard<std::mutex> lock(d->state_mutex);
+        presets = d->presets;
+    }
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        flash[sn] = std::move(presets);
+    }
+    sim::log(DEV_INFO, "%s detached", sn.c_str());
+    notify(sn, false);
+    return true;
+}
+
+void DevicesPrivate::notify(const std::string& sn, bool connected) {
+    sim::scheduler().post([this, sn, connected] {
+        Devices::devChangedCallback callback;
+        void* param;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (closed || !changed) {
+                return;
+            }
+            callback = changed;
+            param = changed_param;
+        }
+        callback(sn, connected, param);
+    });
+}
+
+Devices::Devices()
+    : d_ptr(new DevicesPrivate()) {
+    uint32_t count = sim::settings().initial_devices;
+    ObsbotProductType product = sim::settings().initial_product;
+    // Enumeration takes a moment on real hardware too
+    sim::scheduler().at(sim::Clock::now() + std::chrono::milliseconds(200), [this, count, product] {
+        for (uint32_t i = 0; i < count; ++i) {
+            d_ptr->attach(product, std::string());
+        }
+    });
+}
+
+Devices::~Devices() {
+    close();
+    delete d_ptr;
+}
+
+Devices& Devices::get() {
+    // The scheduler must outlive the Devices singleton
+    sim::scheduler();
+    static Devices devices;
+    return devices;
+}
+
+void Devices::close() {
+    std::list<std::shared_ptr<Device>> devices;
+    {
+        std::lock_guard<std::mutex> lock(d_ptr->mutex);
+        d_ptr->closed = true;
+        d_ptr->changed = nullptr;
+        devices.swap(d_ptr->devices);
+    }
+    for (auto& device : devices) {
+        DevicePrivate::of(*device)->connected.store(false);
+    }
+    sim::scheduler().stop();
+}
+
+void Devices::setDevChangedCallback(devChangedCallback callback, void* param) {
+    std::lock_guard<std::mutex> lock(d_ptr->mutex);
+    d_ptr->changed = std::move(callback);
+    d_ptr->changed_param = param;
+}
+
+void Devices::setNetDevHeartbeatInterval(int interval) {
+    (void)interval;
+}
+
+size_t Devices::getDevNum() {
+    std::lock_guard<std::mutex> lock(d_ptr->mutex);
+    return d_ptr->devices.size();
+}
+
+bool Devices::containDev(Device::DevUuid& uuid) {
+    return getDevByUuid(uuid) != nullptr;
+}
+
+std::shared_ptr<Device> Devices::getDevByName(const std::string& dev_name) {
+    std::lock_guard<std::mutex> lock(d_ptr->mutex);
+    for (auto& device : d_ptr->devices) {
+        if (device->devName() == dev_name) {
+            return device;
+        }
+    }
+    return nullptr;
+}
+
+std::shared_ptr<Device> Devices::getDevByUuid(Device::DevUuid& uuid) {
+    std::lock_guard<std::mutex> lock(d_ptr->mutex);
+    for (auto& device : d_ptr->devices) {
+        if (device->uuid() == uuid) {
+            return device;
+        }
+    }
+    return nullptr;
+}
+
+std::shared_ptr<Device> Devices::getDevBySn(const std::string& dev_sn) {
+    std::lock_guard<std::mutex> lock(d_ptr->mutex);
+    for (auto& device : d_ptr->devices) {
+        if (device->devSn() == dev_sn) {
+            return device;
+        }
+    }
+    return nullptr;
+}
+
+std::list<std::shared_ptr<Device>> Devices::getDevList() {
+    std::lock_guard<std::mutex> lock(d_ptr->mutex);
+    return d_ptr->devices;
+}
+
+void Devices::setTailAirWhiteList(std::list<std::string> white_list) {
+    (void)white_list;
+}
+
+int32_t Devices::startNetworkScanImmediately() {
+    return RM_RET_OK;
+}
+
+void Devices::setEnableMdnsScan(bool enabled) {
+    (void)enabled;
+}
+
+void Devices::setUgSn(const std::string& sn) {
+    (void)sn;
+}
+
+// Logging
+
+void dev_get_log_handler(dlog_handler_t* handler, void** param) {
+    *handler = g_log_handler.load();
+    *param = g_log_param.load();
+}
+
+void dev_set_log_handler(dlog_handler_t handler, void* param) {
+    g_log_param.store(param);
+    g_log_handler.store(handler ? handler : defaultLogHandler);
+}
+
+void dlogva(int32_t log_level, const char* format, va_list args) {
+    g_log_handler.load()(log_level, format, args, g_log_param.load());
+}
+
+void dlog(int32_t log_level, const char* format, ...) {
+    va_list args;
+    va_start(args, format);
+    dlogva(log_level, format, args);
+    va_end(args);
+}
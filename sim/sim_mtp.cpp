@@ -0,0 +1,346 @@
+// Simulated MTP storage: generated media files, or a host directory when
+// OBSBOT_SIM_MTP_ROOT is set, transferred at OBSBOT_SIM_MTP_MBPS
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <dirent.h>
+#include <sys/stat.h>
+
+#include "sim_private.hpp"
+
+namespace {
+
+constexpr size_t kChunkBytes = 256 * 1024;
+// From cameraSetTakePhotosR to the photo on the card, and between the
+// photos of a burst
+constexpr auto kPhotoLatency = std::chrono::milliseconds(200);
+constexpr auto kBurstInterval = std::chrono::milliseconds(100);
+
+std::string normalize(const std::string& current, const std::string& dir) {
+    std::string path = !dir.empty() && dir[0] == '/' ? dir : current + "/" + dir;
+    std::string out;
+    size_t pos = 0;
+    while (pos < path.size()) {
+        size_t next = path.find('/', pos);
+        if (next == std::string::npos) {
+            next = path.size();
+        }
+        std::string part = path.substr(pos, next - pos);
+        if (part == "..") {
+            size_t cut = out.rfind('/');
+            out.erase(cut == std::string::npos ? 0 : cut);
+        } else if (!part.empty() && part != ".") {
+            out += "/" + part;
+        }
+        pos = next + 1;
+    }
+    return out.empty() ? "/" : out;
+}
+
+MtpFileType fileType(const std::string& name) {
+    size_t dot = name.rfind('.');
+    std::string ext = dot == std::string::npos ? std::string() : name.substr(dot + 1);
+    std::transform(ext.begin(), ext.end(), ext.begin(), ::toupper);
+    if (ext == "MP4" || ext == "MOV") {
+        return MtpFileVideo;
+    }
+    if (ext == "JPG" || ext == "DNG") {
+        return MtpFileImage;
+    }
+    if (ext == "WAV" || ext == "AAC") {
+        return MtpFileAudio;
+    }
+    return MtpFileGeneralFile;
+}
+
+uint32_t objectId(const std::string& path) {
+    uint32_t hash = 2166136261u;
+    for (unsigned char c : path) {
+        hash = (hash ^ c) * 16777619u;
+    }
+    return hash;
+}
+
+std::string mtpDate(time_t t) {
+    char buf[20];
+    struct tm tm;
+    gmtime_r(&t, &tm);
+    std::strftime(buf, sizeof(buf), "%Y%m%dT%H%M%S", &tm);
+    return buf;
+}
+
+void scanHost(const std::string& host, const std::string& path, std::map<std::string, sim::MediaFile>& storage) {
+    DIR* dir = ::opendir(host.c_str());
+    if (!dir) {
+        return;
+    }
+    while (dirent* entry = ::readdir(dir)) {
+        std::string name = entry->d_name;
+        if (name == "." || name == "..") {
+            continue;
+        }
+        std::string child = host + "/" + name;
+        struct stat st;
+        if (::stat(child.c_str(), &st) != 0) {
+            continue;
+        }
+        if (S_ISDIR(st.st_mode)) {
+            scanHost(child, path + "/" + name, storage);
+        } else if (S_ISREG(st.st_mode)) {
+            storage[path + "/" + name] = sim::MediaFile{static_cast<uint64_t>(st.st_size), mtpDate(st.st_mtime), child};
+        }
+    }
+    ::closedir(dir);
+}
+
+// Deterministic content of a generated file: a splitmix64 stream keyed by
+// the path, one word per 8 bytes of offset
+void generate(const std::string& path, uint64_t offset, uint8_t* out, size_t size) {
+    uint64_t seed = objectId(path);
+    uint64_t block = UINT64_MAX, word = 0;
+    for (size_t i = 0; i < size; ++i) {
+        uint64_t pos = offset + i;
+        if (pos / 8 != block) {
+            block = pos / 8;
+            uint64_t x = seed + block * 0x9E3779B97F4A7C15ull;
+            x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ull;
+            x = (x ^ (x >> 27)) * 0x94D049BB133111EBull;
+            word = x ^ (x >> 31);
+        }
+        out[i] = static_cast<uint8_t>(word >> ((pos % 8) * 8));
+    }
+}
+
+} // namespace
+
+void DevicePrivate::buildStorage() {
+    auto& settings = sim::settings();
+    if (!settings.mtp_root.empty()) {
+        scanHost(settings.mtp_root, "", storage);
+        return;
+    }
+    time_t base = 1760000000; // fixed, so listings are stable across runs
+    for (uint32_t i = 1; i <= settings.mtp_files; ++i) {
+        bool image = i % 4 == 0;
+        char name[64];
+        std::snprintf(name, sizeof(name), "/DCIM/100MEDIA/%s_%04u.%s", image ? "IMG" : "VID", i, image ? "JPG" : "MP4");
+        uint64_t size = uint64_t(settings.mtp_file_kb) * 1024 / (image ? 8 : 1);
+        storage[name] = sim::MediaFile{size, mtpDate(base + i * 60), std::string()};
+    }
+}
+
+void DevicePrivate::takePhoto() {
+    std::string path;
+    {
+        std::lock_guard<std::mutex> lock(storage_mutex);
+        do {
+            char name[64];
+            std::snprintf(name, sizeof(name), "/DCIM/100MEDIA/IMG_%04u.JPG", sim::settings().mtp_files + ++photos_taken);
+            path = name;
+        } while (storage.count(path));
+        uint64_t size = uint64_t(sim::settings().mtp_file_kb) * 1024 / 8;
+        storage[path] = sim::MediaFile{size, mtpDate(std::time(nullptr)), std::string()};
+    }
+    sim::log(DEV_DEBUG, "%s: new photo %s", sn.c_str(), path.c_str());
+
+    Device::DevEventNotifyCallback callback;
+    void* param;
+    {
+        std::lock_guard<std::mutex> lock(callback_mutex);
+        if (!event_callback) {
+            return;
+        }
+        callback = event_callback;
+        param = event_param;
+    }
+    Device::CameraFileNotify notify;
+    notify.storage_midia_type = 0; // sd card
+    notify.storage_index = 0;
+    notify.file_type = 2; // photo
+    notify.is_dcf_file = true;
+    notify.is_image = true;
+    notify.file_path = path.substr(std::strlen("/DCIM/"));
+    callback(param, Device::kEvtInfoNewMediaFile, &notify);
+}
+
+void DevicePrivate::schedulePhotos(uint32_t series, uint32_t remaining, sim::Clock::duration delay) {
+    auto device = self;
+    sim::scheduler().at(sim::Clock::now() + delay, [device, series, remaining] {
+        auto alive = device.lock();
+        if (!alive) {
+            return;
+        }
+        DevicePrivate* d = of(*alive);
+        if (!d->connected.load() || d->photo_series.load() != series) {
+            return;
+        }
+        d->takePhoto();
+        if (remaining == kPhotosUntilStopped) {
+            d->schedulePhotos(series, remaining, kBurstInterval);
+        } else if (remaining > 1) {
+            d->schedulePhotos(series, remaining - 1, kBurstInterval);
+        }
+    });
+}
+
+int32_t Device::cameraSetTakePhotosR(uint32_t operation, uint32_t param) {
+    R_D(Device);
+    int32_t ret = d->transact("cameraSetTakePhotosR");
+    if (ret != RM_RET_OK) {
+        return ret;
+    }
+    if (d->product != ObsbotProdTailAir && d->product != ObsbotProdTail2) {
+        return CommErrorMode;
+    }
+    if (operation > 2) {
+        return RM_RET_ERR;
+    }
+    // A start or a stop ends the series before it
+    uint32_t series = ++d->photo_series;
+    if (operation == 1) {
+        d->schedulePhotos(series, 1, kPhotoLatency);
+    } else if (operation == 2 && param > 0) {
+        d->schedulePhotos(series, param > 0xFFFF ? DevicePrivate::kPhotosUntilStopped : param, kPhotoLatency);
+    }
+    return RM_RET_OK;
+}
+
+bool Device::devTransferringFileByMtp() {
+    return d_func()->mtp_busy.load();
+}
+
+int32_t Device::mtpSetCurrentDir(const std::string& dir) {
+    R_D(Device);
+    std::lock_guard<std::mutex> lock(d->storage_mutex);
+    d->mtp_dir = normalize(d->mtp_dir, dir);
+    return RM_RET_OK;
+}
+
+int32_t Device::mtpGetCurrentDir(std::string& current_dir) {
+    R_D(Device);
+    std::lock_guard<std::mutex> lock(d->storage_mutex);
+    current_dir = d->mtp_dir;
+    return RM_RET_OK;
+}
+
+int32_t Device::mtpGetDirFileInfo(const std::string& dir, std::list<MtpFileInfo>& file_infos) {
+    R_D(Device);
+    int32_t ret = d->transact("mtpGetDirFileInfo");
+    if (ret != RM_RET_OK) {
+        return ret;
+    }
+    std::lock_guard<std::mutex> lock(d->storage_mutex);
+    std::string base = normalize(d->mtp_dir, dir);
+    std::string prefix = base == "/" ? "/" : base + "/";
+    bool exists = base == "/";
+    std::string last_folder;
+    for (auto it = d->storage.lower_bound(prefix); it != d->storage.end(); ++it) {
+        const std::string& path = it->first;
+        if (path.compare(0, prefix.size(), prefix) != 0) {
+            break;
+        }
+        exists = true;
+        std::string rest = path.substr(prefix.size());
+        size_t slash = rest.find('/');
+        MtpFileInfo info;
+        if (slash != std::string::npos) {
+            std::string folder = rest.substr(0, slash);
+            if (folder == last_folder) {
+                continue;
+            }
+            last_folder = folder;
+            info.obj_id_ = objectId(prefix + folder);
+            info.file_name_ = folder;
+            info.file_type_ = MtpFileFolder;
+            info.file_size_ = 0;
+            info.date_create_ = info.date_modify_ = it->second.date;
+        } else {
+            info.obj_id_ = objectId(path);
+            info.file_name_ = rest;
+            info.file_type_ = fileType(rest);
+            info.file_size_ = it->second.size;
+            info.date_create_ = info.date_modify_ = it->second.date;
+        }
+        file_infos.push_back(std::move(info));
+    }
+    return exists ? RM_RET_OK : RM_RET_ERR;
+}
+
+int32_t Device::mtpCopyFileFromDir(const std::string& src_file, const std::string& dst_file,
+                                   const FileTransCallback& cb) {
+    R_D(Device);
+    if (!d->connected.load()) {
+        return RM_RET_ERR;
+    }
+    std::string path;
+    sim::MediaFile file;
+    {
+        std::lock_guard<std::mutex> lock(d->storage_mutex);
+        path = normalize(d->mtp_dir, src_file);
+        auto it = d->storage.find(path);
+        if (it == d->storage.end()) {
+            return RM_RET_ERR;
+        }
+        file = it->second;
+    }
+
+    std::lock_guard<std::mutex> transfer(d->mtp_mutex);
+    d->mtp_cancel.store(false);
+    d->mtp_busy.store(true);
+    sim::log(DEV_DEBUG, "%s: mtp copy %s", d->sn.c_str(), path.c_str());
+
+    FILE* out = std::fopen(dst_file.c_str(), "wb");
+    FILE* in = file.host_path.empty() ? nullptr : std::fopen(file.host_path.c_str(), "rb");
+    bool ok = out && (file.host_path.empty() || in);
+    std::vector<uint8_t> chunk(kChunkBytes);
+    uint64_t done = 0;
+    int32_t reported = -1;
+    auto next_chunk = sim::Clock::now();
+    while (ok && done < file.size) {
+        if (d->mtp_cancel.load() || !d->connected.load()) {
+            ok = false;
+            break;
+        }
+        size_t n = static_cast<size_t>(std::min<uint64_t>(kChunkBytes, file.size - done));
+        if (in) {
+            ok = std::fread(chunk.data(), 1, n, in) == n;
+        } else {
+            generate(path, done, chunk.data(), n);
+        }
+        double mbps = std::max<uint32_t>(1, sim::settings().mtp_mbps.load());
+        next_chunk += std::chrono::duration_cast<sim::Clock::duration>(
+            std::chrono::duration<double>(n / (mbps * 1024 * 1024)));
+        std::this_thread::sleep_until(next_chunk);
+        ok = ok && std::fwrite(chunk.data(), 1, n, out) == n;
+        done += n;
+        int32_t progress = static_cast<int32_t>(done * 100 / std::max<uint64_t>(1, file.size));
+        if (ok && cb && progress != reported) {
+            reported = progress;
+            cb(src_file, progress);
+        }
+    }
+    if (ok && cb && reported != 100) {
+        cb(src_file, 100);
+    }
+    if (in) {
+        std::fclose(in);
+    }
+    if (out) {
+        std::fclose(out);
+    }
+    if (!ok) {
+        std::remove(dst_file.c_str());
+    }
+    d->mtp_busy.store(false);
+    return ok ? RM_RET_OK : RM_RET_ERR;
+}
+
+int32_t Device::mtpCancelTransaction() {
+    R_D(Device);
+    if (d->mtp_busy.load()) {
+        d->mtp_cancel.store(true);
+    }
+    return RM_RET_OK;
+}
@@ -0,0 +1,261 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <cstdint>
+#include <functional>
+#include <initializer_list>
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <random>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+#include <dev/devs.hpp>
+
+#include "sim_control.hpp"
+
+// Internals shared by the sim translation units. Nothing here is visible to
+// code built against the real libdev.
+
+namespace sim {
+
+using Clock = std::chrono::steady_clock;
+
+// Single "SDK thread": runs timed work such as NonBlock completions, status
+// pushes and hot-plug notifications, in deadline order
+class Scheduler {
+public:
+    using Task = std::function<void()>;
+
+    Scheduler();
+    ~Scheduler();
+
+    void at(Clock::time_point when, Task task);
+    void post(Task task) { at(Clock::now(), std::move(task)); }
+    void stop();
+
+private:
+    struct Entry {
+        Clock::time_point when;
+        uint64_t order;
+        Task task;
+        bool operator>(const Entry& other) const {
+            return when != other.when ? when > other.when : order > other.order;
+        }
+    };
+
+    void run();
+
+    std::mutex mutex_;
+    std::condition_variable cond_;
+    std::priority_queue<Entry, std::vector<Entry>, std::greater<Entry>> queue_;
+    uint64_t next_order_;
+    bool stopping_;
+    std::thread thread_;
+};
+
+// Process-wide settings, read on every command
+struct Settings {
+    std::atomic<uint32_t> latency_us;
+    std::atomic<uint32_t> jitter_us;
+    std::atomic<uint32_t> service_us;
+    std::atomic<uint32_t> status_ms;
+    std::atomic<uint32_t> mtp_mbps;
+    uint32_t initial_devices;
+    ObsbotProductType initial_product;
+    std::string mtp_root;
+    uint32_t mtp_files;
+    uint32_t mtp_file_kb;
+};
+
+Settings& settings();
+Scheduler& scheduler();
+
+// Debug log through the handler installed with dev_set_log_handler
+void log(int32_t level, const char* format, ...) __attribute__((__format__(__printf__, 2, 3)));
+
+// One file on the simulated camera storage
+struct MediaFile {
+    uint64_t size;
+    std::string date; // "YYYYMMDDThhmmss", as MTP reports it
+    std::string host_path; // empty for generated content
+};
+
+} // namespace sim
+
+// Identity handed to Device's constructor
+class DeviceId {
+public:
+    std::string sn;
+    ObsbotProductType product;
+};
+
+class DevicePrivate {
+public:
+    enum ImageParam { Brightness, Contrast, Hue, Saturation, Sharpness, ImageParamCount };
+    // Exposure, white balance, focus and audio controls
+    enum Control {
+        ExposureMode, AeLock, EvBias, Iso, Shutter, AntiFlicker, WbType, WbParam, FocusMode, FocusPos,
+        AudioVolume, AudioAgc, AudioNr, AudioNrLevel, ControlCount
+    };
+
+    DevicePrivate(Device* q, DeviceId* id);
+
+    static DevicePrivate* of(Device& device) { return device.d_func(); }
+
+    // Reserves the control channel and returns when the reply arrives
+    sim::Clock::time_point reserve();
+
+    // Synchronous command: waits for the reply. Returns RM_RET_ERR when the
+    // device is unplugged before or during the exchange.
+    int32_t transact(const char* command);
+
+    // Getter honouring GetMethod. `fill` runs at reply time and copies the
+    // answer into `out` (Block) or into the callback payload (NonBlock).
+    template <typename T>
+    int32_t get(const char* command, T* out, const Device::RxDataCallback& callback, void* param,
+                Device::GetMethod method, std::function<void(T&)> fill);
+
+    // Advances the gimbal model to `now`; call with state_mutex held
+    void advanceGimbal(sim::Clock::time_point now);
+    void moveTo(float pitch, float yaw, float speed);
+    void refreshStatus();
+    void pushStatus();
+    void scheduleStatus();
+
+    void buildStorage();
+    // Adds a photo to the storage and announces it with kEvtInfoNewMediaFile
+    void takePhoto();
+    // Takes `remaining` photos, the first after `delay`, while `series` is
+    // the current photo series; kPhotosUntilStopped never runs out
+    void schedulePhotos(uint32_t series, uint32_t remaining, sim::Clock::duration delay);
+    static constexpr uint32_t kPhotosUntilStopped = 0xFFFFFFFFu;
+
+    int32_t setImage(const char* command, ImageParam which, int32_t value);
+    int32_t getImage(const char* command, ImageParam which, int32_t& value);
+    // `tail_only` controls answer CommErrorMode on other models
+    int32_t setControl(const char* command, bool tail_only, std::initializer_list<std::pair<Control, int32_t>> values);
+    int32_t getControl(const char* command, bool tail_only, std::initializer_list<std::pair<Control, int32_t*>> values);
+
+    Device* q_ptr;
+    std::weak_ptr<Device> self;
+
+    // Identity
+    std::string sn;
+    std::string name;
+    std::string model_code;
+    std::string version;
+    ObsbotProductType product;
+    Device::DevUuid uuid;
+    std::atomic<bool> connected{true};
+    sim::Clock::time_point plugged_at;
+
+    // Control channel model
+    std::mutex channel_mutex;
+    sim::Clock::time_point channel_free;
+    std::mt19937 rng;
+
+    // Device state
+    std::mutex state_mutex;
+    Device::CameraStatus status;
+    Device::DevStatus run_status;
+    Device::AiWorkModeType ai_mode;
+    int32_t ai_sub_mode;
+    float zoom;           // 1.0 ~ 4.0
+    int32_t image[ImageParamCount]; // 0 ~ 100
+    int32_t control[ControlCount];
+    float gimbal_pos[3];  // pitch, yaw, roll in degrees
+    float gimbal_vel[3];  // degrees per second
+    float gimbal_goal[2]; // pitch, yaw target of a positional move
+    bool gimbal_seeking;
+    sim::Clock::time_point gimbal_until; // end of a timed speed command
+    sim::Clock::time_point gimbal_updated;
+    Device::PresetPosInfo boot_pos;
+    struct Preset {
+        Device::PresetPosInfo info;
+        Device::PresetsAction action;
+    };
+    std::map<int32_t, Preset> presets;
+    bool preset_pending = false;           // change not reported in a push yet
+    std::atomic<bool> pos_changed{false}; // libdev's latch of preset_update
+
+    // Callbacks
+    std::mutex callback_mutex;
+    Device::DevStatusCallback status_callback;
+    void* status_param;
+    bool status_enabled;
+    Device::DevEventNotifyCallback event_callback;
+    void* event_param;
+
+    // MTP
+    std::mutex mtp_mutex; // one transfer at a time
+    std::mutex storage_mutex;
+    std::map<std::string, sim::MediaFile> storage; // absolute path -> file
+    std::string mtp_dir;
+    std::atomic<bool> mtp_busy{false};
+    std::atomic<bool> mtp_cancel{false};
+    std::atomic<uint32_t> photo_series{0}; // bumped by every start and stop
+    uint32_t photos_taken = 0;             // under storage_mutex
+};
+
+class DevicesPrivate {
+public:
+    static DevicesPrivate* of(Devices& devices) { return devices.d_func(); }
+
+    std::shared_ptr<Device> attach(ObsbotProductType product, const std::string& sn);
+    bool detach(const std::string& sn);
+    void notify(const std::string& sn, bool connected);
+
+    std::mutex mutex;
+    std::list<std::shared_ptr<Device>> devices;
+    // Presets of unplugged cameras by SN; they live in the camera's flash
+    std::map<std::string, std::map<int32_t, DevicePrivate::Preset>> flash;
+    Devices::devChangedCallback changed;
+    void* changed_param = nullptr;
+    uint32_t next_sn = 1;
+    bool closed = false;
+};
+
+template <typename T>
+int32_t DevicePrivate::get(const char* command, T* out, const Device::RxDataCallback& callback, void* param,
+                           Device::GetMethod method, std::function<void(T&)> fill) {
+    if (!connected.load()) {
+        return RM_RET_ERR;
+    }
+    if (method == Device::Block) {
+        int32_t ret = transact(command);
+        if (ret == RM_RET_OK && out) {
+            fill(*out);
+        }
+        return ret;
+    }
+
+    sim::log(DEV_DEBUG, "%s: %s (async)", sn.c_str(), command);
+    auto reply_at = reserve();
+    auto device = self;
+    sim::scheduler().at(reply_at, [device, callback, param, fill] {
+        auto alive = device.lock();
+        // Payload: length byte, or a negative error, then the raw reply
+        uint8_t payload[1 + sizeof(T)] = {};
+        if (!alive || !of(*alive)->connected.load()) {
+            payload[0] = static_cast<uint8_t>(static_cast<int8_t>(Device::CommErrorOther));
+        } else {
+            T value{};
+            fill(value);
+            static_assert(sizeof(T) < 128, "reply does not fit the length byte");
+            payload[0] = static_cast<uint8_t>(sizeof(T));
+            std::memcpy(payload + 1, &value, sizeof(T));
+        }
+        if (callback) {
+            callback(param, payload);
+        }
+    });
+    return RM_RET_OK;
+}
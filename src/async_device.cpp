@@ -0,0 +1,202 @@
+#include "async_device.hpp"
+
+#include <vector>
+
+AsyncDevice::AsyncDevice(std::shared_ptr<Device> device, std::chrono::milliseconds timeout)
+    : device_(std::move(device)), timeout_(timeout), state_(std::make_shared<State>()) {
+    reaper_ = std::thread(&AsyncDevice::reap, this);
+}
+
+AsyncDevice::~AsyncDevice() {
+    {
+        std::lock_guard<std::mutex> lock(state_->mutex);
+        state_->stopping = true;
+    }
+    state_->cond.notify_all();
+    reaper_.join();
+
+    // Resolve whatever is still outstanding so no future waits forever
+    std::vector<std::shared_ptr<Pending>> pending;
+    {
+        std::lock_guard<std::mutex> lock(state_->mutex);
+        for (auto& entry : state_->deadlines) {
+            pending.push_back(entry.second);
+        }
+    }
+    for (auto& p : pending) {
+        finish(*state_, p, Device::CommErrorOther, nullptr);
+    }
+}
+
+size_t AsyncDevice::inFlight() const {
+    std::lock_guard<std::mutex> lock(state_->mutex);
+    return state_->in_flight;
+}
+
+void AsyncDevice::submit(Issue issue, Complete complete) {
+    auto pending = std::make_shared<Pending>();
+    pending->complete = std::move(complete);
+
+    bool wake;
+    {
+        std::lock_guard<std::mutex> lock(state_->mutex);
+        auto deadline = std::chrono::steady_clock::now() + timeout_;
+        pending->deadline = state_->deadlines.emplace(deadline, pending);
+        wake = pending->deadline == state_->deadlines.begin();
+        ++state_->in_flight;
+    }
+    if (wake) {
+        state_->cond.notify_one();
+    }
+
+    std::shared_ptr<State> state = state_;
+    int32_t ret = issue([state, pending](void*, const void* rcvd_data) {
+        finish(*state, pending, RM_RET_OK, rcvd_data);
+    });
+    if (ret != RM_RET_OK) {
+        finish(*state_, pending, ret, nullptr);
+    }
+}
+
+void AsyncDevice::finish(State& state, const std::shared_ptr<Pending>& pending, int32_t result,
+                         const void* rcvd_data) {
+    if (pending->done.exchange(true, std::memory_order_acq_rel)) {
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(state.mutex);
+        state.deadlines.erase(pending->deadline);
+        --state.in_flight;
+    }
+    pending->complete(result, rcvd_data);
+}
+
+void AsyncDevice::reap() {
+    std::unique_lock<std::mutex> lock(state_->mutex);
+    while (!state_->stopping) {
+        if (state_->deadlines.empty()) {
+            state_->cond.wait(lock);
+            continue;
+        }
+        auto first = state_->deadlines.begin();
+        if (first->first > std::chrono::steady_clock::now()) {
+            state_->cond.wait_until(lock, first->first);
+            continue;
+        }
+        std::shared_ptr<Pending> expired = first->second;
+        lock.unlock();
+        finish(*state_, expired, Device::CommErrorTimeout, nullptr);
+        lock.lock();
+    }
+}
+
+// -----------------------------------------------------------------------------
+// Callback flavour
+
+void AsyncDevice::aiStatus(Callback<Device::AiStatus> callback) {
+    std::shared_ptr<Device> dev = device_;
+    request<Device::AiStatus>([dev](Device::RxDataCallback cb) {
+        return dev->aiGetAiStatusR(nullptr, cb, nullptr, Device::NonBlock);
+    }, std::move(callback));
+}
+
+void AsyncDevice::gimbalState(Callback<Device::AiGimbalStateInfo> callback) {
+    std::shared_ptr<Device> dev = device_;
+    request<Device::AiGimbalStateInfo>([dev](Device::RxDataCallback cb) {
+        return dev->aiGetGimbalStateR(nullptr, cb, nullptr, Device::NonBlock);
+    }, std::move(callback));
+}
+
+void AsyncDevice::gimbalAttitude(Callback<GimbalAttitude> callback) {
+    std::shared_ptr<Device> dev = device_;
+    request<GimbalAttitude>([dev](Device::RxDataCallback cb) {
+        return dev->gimbalGetAttitudeInfoR(nullptr, cb, nullptr, Device::NonBlock);
+    }, std::move(callback));
+}
+
+void AsyncDevice::gimbalBootPos(Callback<Device::PresetPosInfo> callback) {
+    std::shared_ptr<Device> dev = device_;
+    request<Device::PresetPosInfo>([dev](Device::RxDataCallback cb) {
+        return dev->aiGetGimbalBootPosR(nullptr, cb, nullptr, Device::NonBlock);
+    }, std::move(callback));
+}
+
+void AsyncDevice::faceFocus(Callback<int32_t> callback) {
+    std::shared_ptr<Device> dev = device_;
+    request<int32_t>([dev](Device::RxDataCallback cb) {
+        return dev->cameraGetFaceFocusR(nullptr, cb, nullptr, Device::NonBlock);
+    }, std::move(callback));
+}
+
+void AsyncDevice::handTrackState(int32_t id, Callback<Device::AiHandTrackStateInfo> callback) {
+    std::shared_ptr<Device> dev = device_;
+    request<Device::AiHandTrackStateInfo>([dev, id](Device::RxDataCallback cb) {
+        return dev->aiGetHandTrackStateR(nullptr, id, cb, nullptr, Device::NonBlock);
+    }, std::move(callback));
+}
+
+void AsyncDevice::gimbalPresetList(Callback<Device::DevDataArray> callback) {
+    std::shared_ptr<Device> dev = device_;
+    request<Device::DevDataArray>([dev](Device::RxDataCallback cb) {
+        return dev->aiGetGimbalPresetListR(nullptr, cb, nullptr, Device::NonBlock);
+    }, std::move(callback));
+}
+
+void AsyncDevice::gimbalPresetInfo(int32_t id, Callback<Device::PresetPosInfo> callback) {
+    std::shared_ptr<Device> dev = device_;
+    request<Device::PresetPosInfo>([dev, id](Device::RxDataCallback cb) {
+        return dev->aiGetGimbalPresetInfoWithIdR(nullptr, id, cb, nullptr, Device::NonBlock);
+    }, std::move(callback));
+}
+
+void AsyncDevice::gimbalPresetName(int32_t id, Callback<Device::DevDataArray> callback) {
+    std::shared_ptr<Device> dev = device_;
+    request<Device::DevDataArray>([dev, id](Device::RxDataCallback cb) {
+        return dev->aiGetGimbalPresetNameWithIdR(nullptr, id, cb, nullptr, Device::NonBlock);
+    }, std::move(callback));
+}
+
+// -----------------------------------------------------------------------------
+// Future flavour
+
+std::future<AsyncReply<Device::AiStatus>> AsyncDevice::aiStatus() {
+    return promised<Device::AiStatus>([this](Callback<Device::AiStatus> cb) { aiStatus(std::move(cb)); });
+}
+
+std::future<AsyncReply<Device::AiGimbalStateInfo>> AsyncDevice::gimbalState() {
+    return promised<Device::AiGimbalStateInfo>(
+        [this](Callback<Device::AiGimbalStateInfo> cb) { gimbalState(std::move(cb)); });
+}
+
+std::future<AsyncReply<AsyncDevice::GimbalAttitude>> AsyncDevice::gimbalAttitude() {
+    return promised<GimbalAttitude>([this](Callback<GimbalAttitude> cb) { gimbalAttitude(std::move(cb)); });
+}
+
+std::future<AsyncReply<Device::PresetPosInfo>> AsyncDevice::gimbalBootPos() {
+    return promised<Device::PresetPosInfo>(
+        [this](Callback<Device::PresetPosInfo> cb) { gimbalBootPos(std::move(cb)); });
+}
+
+std::future<AsyncReply<int32_t>> AsyncDevice::faceFocus() {
+    return promised<int32_t>([this](Callback<int32_t> cb) { faceFocus(std::move(cb)); });
+}
+
+std::future<AsyncReply<Device::AiHandTrackStateInfo>> AsyncDevice::handTrackState(int32_t id) {
+    return promised<Device::AiHandTrackStateInfo>(
+        [this, id](Callback<Device::AiHandTrackStateInfo> cb) { handTrackState(id, std::move(cb)); });
+}
+
+std::future<AsyncReply<Device::DevDataArray>> AsyncDevice::gimbalPresetList() {
+    return promised<Device::DevDataArray>(
+        [this](Callback<Device::DevDataArray> cb) { gimbalPresetList(std::move(cb)); });
+}
+
+std::future<AsyncReply<Device::PresetPosInfo>> AsyncDevice::gimbalPresetInfo(int32_t id) {
+    return promised<Device::PresetPosInfo>(
+        [this, id](Callback<Device::PresetPosInfo> cb) { gimbalPresetInfo(id, std::move(cb)); });
+}
+
+std::future<AsyncReply<Device::DevDataArray>> AsyncDevice::gimbalPresetName(int32_t id) {
+    return promised<Device::DevDataArray>(
+        [this, id](Callback<Device::DevDataArray> cb) { gimbalPresetName(id, std::move(cb)); });
+}
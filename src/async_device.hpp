@@ -0,0 +1,144 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <future>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <dev/dev.hpp>
+
+// Result of one asynchronous getter
+template <typename T>
+struct AsyncReply {
+    int32_t result = RM_RET_ERR; // RM_RET_OK, or a Device::ErrorType code
+    T value{};
+
+    bool ok() const { return result == RM_RET_OK; }
+};
+
+// Typed wrapper over the GetMethod::NonBlock + RxDataCallback getters.
+// Requests are issued without waiting for the previous reply, so many reads
+// can be in flight on one device. Each request completes exactly once:
+// with the decoded reply, with the synchronous error returned by the SDK
+// call, or with CommErrorTimeout once `timeout` expires.
+class AsyncDevice {
+public:
+    template <typename T>
+    using Callback = std::function<void(const AsyncReply<T>& reply)>;
+
+    using GimbalAttitude = std::array<float, 3>;
+
+    explicit AsyncDevice(std::shared_ptr<Device> device,
+                         std::chrono::milliseconds timeout = std::chrono::milliseconds(1000));
+    ~AsyncDevice();
+
+    AsyncDevice(const AsyncDevice&) = delete;
+    AsyncDevice& operator=(const AsyncDevice&) = delete;
+
+    const std::shared_ptr<Device>& device() const { return device_; }
+    size_t inFlight() const;
+
+    // Callbacks run on the SDK receive thread (or the timeout thread) and
+    // must not block
+    void aiStatus(Callback<Device::AiStatus> callback);
+    void gimbalState(Callback<Device::AiGimbalStateInfo> callback);
+    void gimbalAttitude(Callback<GimbalAttitude> callback);
+    void gimbalBootPos(Callback<Device::PresetPosInfo> callback);
+    void faceFocus(Callback<int32_t> callback);
+    void handTrackState(int32_t id, Callback<Device::AiHandTrackStateInfo> callback);
+    void gimbalPresetList(Callback<Device::DevDataArray> callback);
+    void gimbalPresetInfo(int32_t id, Callback<Device::PresetPosInfo> callback);
+    void gimbalPresetName(int32_t id, Callback<Device::DevDataArray> callback);
+
+    std::future<AsyncReply<Device::AiStatus>> aiStatus();
+    std::future<AsyncReply<Device::AiGimbalStateInfo>> gimbalState();
+    std::future<AsyncReply<GimbalAttitude>> gimbalAttitude();
+    std::future<AsyncReply<Device::PresetPosInfo>> gimbalBootPos();
+    std::future<AsyncReply<int32_t>> faceFocus();
+    std::future<AsyncReply<Device::AiHandTrackStateInfo>> handTrackState(int32_t id);
+    std::future<AsyncReply<Device::DevDataArray>> gimbalPresetList();
+    std::future<AsyncReply<Device::PresetPosInfo>> gimbalPresetInfo(int32_t id);
+    std::future<AsyncReply<Device::DevDataArray>> gimbalPresetName(int32_t id);
+
+    // Decode an RxDataCallback payload: the first byte is the payload
+    // length (>= 0) or an error code (< 0), followed by the raw reply.
+    template <typename T>
+    static AsyncReply<T> decode(const void* rcvd_data) {
+        AsyncReply<T> reply;
+        if (!rcvd_data) {
+            reply.result = Device::CommErrorOther;
+            return reply;
+        }
+        const auto* bytes = static_cast<const uint8_t*>(rcvd_data);
+        const auto length = static_cast<int8_t>(bytes[0]);
+        if (length < 0) {
+            reply.result = length;
+            return reply;
+        }
+        std::memcpy(&reply.value, bytes + 1, std::min(static_cast<size_t>(length), sizeof(T)));
+        reply.result = RM_RET_OK;
+        return reply;
+    }
+
+private:
+    using Issue = std::function<int32_t(Device::RxDataCallback callback)>;
+    using Complete = std::function<void(int32_t result, const void* rcvd_data)>;
+
+    struct Pending;
+    using Deadlines = std::multimap<std::chrono::steady_clock::time_point, std::shared_ptr<Pending>>;
+
+    struct Pending {
+        std::atomic<bool> done{false};
+        Complete complete;
+        Deadlines::iterator deadline;
+    };
+
+    // Shared with the in-flight RxDataCallbacks so a reply that arrives
+    // after the AsyncDevice is gone is simply dropped
+    struct State {
+        std::mutex mutex;
+        std::condition_variable cond;
+        Deadlines deadlines;
+        size_t in_flight = 0;
+        bool stopping = false;
+    };
+
+    template <typename T>
+    void request(Issue issue, Callback<T> callback) {
+        submit(std::move(issue), [callback = std::move(callback)](int32_t result, const void* rcvd_data) {
+            AsyncReply<T> reply;
+            if (result == RM_RET_OK) {
+                reply = decode<T>(rcvd_data);
+            } else {
+                reply.result = result;
+            }
+            callback(reply);
+        });
+    }
+
+    template <typename T, typename Start>
+    static std::future<AsyncReply<T>> promised(Start start) {
+        auto promise = std::make_shared<std::promise<AsyncReply<T>>>();
+        auto future = promise->get_future();
+        start([promise](const AsyncReply<T>& reply) { promise->set_value(reply); });
+        return future;
+    }
+
+    void submit(Issue issue, Complete complete);
+    static void finish(State& state, const std::shared_ptr<Pending>& pending, int32_t result,
+                       const void* rcvd_data);
+    void reap();
+
+    std::shared_ptr<Device> device_;
+    std::chrono::milliseconds timeout_;
+    std::shared_ptr<State> state_;
+    std::thread reaper_;
+};
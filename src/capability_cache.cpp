@@ -0,0 +1,315 @@
+#include "capability_cache.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+
+using RangeGetter = int32_t (Device::*)(Device::UvcParamRange&);
+
+struct RangeQuery {
+    const char* name;
+    RangeGetter getter;
+};
+
+// Indexed by DeviceCapabilities::Range
+const RangeQuery kRangeQueries[DeviceCapabilities::RangeCount] = {
+    {"zoom", &Device::cameraGetRangeZoomAbsoluteR},
+    {"brightness", &Device::cameraGetRangeImageBrightnessR},
+    {"contrast", &Device::cameraGetRangeImageContrastR},
+    {"hue", &Device::cameraGetRangeImageHueR},
+    {"saturation", &Device::cameraGetRangeImageSaturationR},
+    {"sharpness", &Device::cameraGetRangeImageSharpR},
+    {"white_balance", &Device::cameraGetRangeWhiteBalanceR},
+    {"ev_bias", &Device::cameraGetRangePAEEvBiasR},
+    {"iso", &Device::cameraGetRangeMAEIsoR},
+    {"anti_flicker", &Device::cameraGetRangeAntiFlickR},
+    {"exposure", &Device::cameraGetRangeExposureAbsolute},
+    {"focus", &Device::cameraGetRangeFocusAbsolute},
+};
+
+// Errors that say nothing about what the camera supports
+bool transient(int32_t ret) {
+    return ret == Device::CommErrorTimeout || ret == Device::CommErrorBusy || ret == Device::CommErrorInited ||
+           ret == Device::CommErrorLength;
+}
+
+bool writeAll(int fd, const void* data, size_t bytes) {
+    const auto* p = static_cast<const uint8_t*>(data);
+    while (bytes > 0) {
+        ssize_t n = ::write(fd, p, bytes);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+        p += n;
+        bytes -= static_cast<size_t>(n);
+    }
+    return true;
+}
+
+} // namespace
+
+const char* DeviceCapabilities::rangeName(Range which) {
+    return which < RangeCount ? kRangeQueries[which].name : "unknown";
+}
+
+bool DeviceCapabilities::query(Device& device, DeviceCapabilities& out) {
+    bool complete = true;
+    for (size_t i = 0; i < RangeCount; ++i) {
+        Device::UvcParamRange range;
+        int32_t ret = (device.*kRangeQueries[i].getter)(range);
+        if (ret != RM_RET_OK) {
+            complete = complete && !transient(ret);
+            range = Device::UvcParamRange();
+        }
+        out.ranges[i] = range;
+    }
+    out.formats = device.videoFormatInfo();
+    return complete && !out.formats.empty();
+}
+
+CapabilityCache::CapabilityCache() : base_(nullptr), bytes_(0), mapped_(nullptr), mapped_count_(0) {
+}
+
+CapabilityCache::~CapabilityCache() {
+    close();
+}
+
+bool CapabilityCache::open(const std::string& path) {
+    close();
+    path_ = path;
+
+    int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return errno == ENOENT;
+    }
+    struct stat st;
+    if (::fstat(fd, &st) != 0) {
+        ::close(fd);
+        return false;
+    }
+    size_t bytes = static_cast<size_t>(st.st_size);
+    if (bytes < sizeof(CapsFileHeader)) {
+        ::close(fd);
+        return true;
+    }
+    void* base = ::mmap(nullptr, bytes, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (base == MAP_FAILED) {
+        return false;
+    }
+
+    const auto* header = static_cast<const CapsFileHeader*>(base);
+    if (std::memcmp(header->magic, kCapsMagic, sizeof(kCapsMagic)) != 0 || header->version != kCapsVersion ||
+        header->entry_size != sizeof(CapsEntry) ||
+        header->entries > (bytes - sizeof(CapsFileHeader)) / sizeof(CapsEntry)) {
+        ::munmap(base, bytes);
+        return true;
+    }
+    base_ = static_cast<const uint8_t*>(base);
+    bytes_ = bytes;
+    mapped_ = reinterpret_cast<const CapsEntry*>(base_ + sizeof(CapsFileHeader));
+    mapped_count_ = static_cast<size_t>(header->entries);
+    return true;
+}
+
+void CapabilityCache::close() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (base_) {
+        ::munmap(const_cast<uint8_t*>(base_), bytes_);
+    }
+    base_ = nullptr;
+    bytes_ = 0;
+    mapped_ = nullptr;
+    mapped_count_ = 0;
+    saved_.clear();
+    added_.clear();
+}
+
+bool CapabilityCache::get(Device& device, DeviceCapabilities& out, bool* cached) {
+    std::string model_code = device.devModelCode();
+    std::string version = device.devVersion();
+    if (lookup(model_code, version, out)) {
+        if (cached) {
+            *cached = true;
+        }
+        return true;
+    }
+    if (cached) {
+        *cached = false;
+    }
+    if (!DeviceCapabilities::query(device, out)) {
+        return false;
+    }
+    store(model_code, version, out);
+    return true;
+}
+
+bool CapabilityCache::lookup(const std::string& model_code, const std::string& version,
+                             DeviceCapabilities& out) const {
+    Key key(model_code, version);
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = added_.find(key);
+    if (it != added_.end()) {
+        decode(it->second, out);
+        return true;
+    }
+    if (const CapsEntry* entry = findMapped(key)) {
+        decode(*entry, out);
+        return true;
+    }
+    return false;
+}
+
+void CapabilityCache::store(const std::string& model_code, const std::string& version,
+                            const DeviceCapabilities& caps) {
+    if (!keyFits(model_code, version)) {
+        return;
+    }
+    Key key(model_code, version);
+    CapsEntry entry;
+    encode(key, caps, entry);
+    std::lock_guard<std::mutex> lock(mutex_);
+    added_[key] = entry;
+}
+
+bool CapabilityCache::save() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (added_.empty() || path_.empty()) {
+        return true;
+    }
+
+    std::vector<CapsEntry> entries;
+    entries.reserve(mapped_count_ + added_.size());
+    for (size_t i = 0; i < mapped_count_; ++i) {
+        if (!added_.count(keyOf(mapped_[i]))) {
+            entries.push_back(mapped_[i]);
+        }
+    }
+    for (auto& entry : added_) {
+        entries.push_back(entry.second);
+    }
+
+    CapsFileHeader header;
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.magic, kCapsMagic, sizeof(kCapsMagic));
+    header.version = kCapsVersion;
+    header.entry_size = sizeof(CapsEntry);
+    header.entries = entries.size();
+
+    std::string temp = path_ + ".tmp";
+    int fd = ::open(temp.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        return false;
+    }
+    bool ok = writeAll(fd, &header, sizeof(header)) &&
+              writeAll(fd, entries.data(), entries.size() * sizeof(CapsEntry)) && ::fsync(fd) == 0;
+    ok = ::close(fd) == 0 && ok;
+    if (!ok || ::rename(temp.c_str(), path_.c_str()) != 0) {
+        ::unlink(temp.c_str());
+        return false;
+    }
+
+    // The mapping still shows the replaced file; serve the entries just
+    // written from memory instead
+    if (base_) {
+        ::munmap(const_cast<uint8_t*>(base_), bytes_);
+        base_ = nullptr;
+        bytes_ = 0;
+        mapped_ = nullptr;
+        mapped_count_ = 0;
+    }
+    saved_ = std::move(entries);
+    mapped_ = saved_.data();
+    mapped_count_ = saved_.size();
+    added_.clear();
+    return true;
+}
+
+size_t CapabilityCache::size() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    size_t count = added_.size();
+    for (size_t i = 0; i < mapped_count_; ++i) {
+        count += added_.count(keyOf(mapped_[i])) ? 0 : 1;
+    }
+    return count;
+}
+
+bool CapabilityCache::dirty() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return !added_.empty();
+}
+
+CapabilityCache::Key CapabilityCache::keyOf(const CapsEntry& entry) {
+    return Key(std::string(entry.model_code, strnlen(entry.model_code, kCapsKeyLength)),
+               std::string(entry.version, strnlen(entry.version, kCapsKeyLength)));
+}
+
+bool CapabilityCache::keyFits(const std::string& model_code, const std::string& version) {
+    return model_code.size() < kCapsKeyLength && version.size() < kCapsKeyLength;
+}
+
+void CapabilityCache::encode(const Key& key, const DeviceCapabilities& caps, CapsEntry& entry) {
+    std::memset(&entry, 0, sizeof(entry));
+    std::memcpy(entry.model_code, key.first.data(), key.first.size());
+    std::memcpy(entry.version, key.second.data(), key.second.size());
+    entry.range_count = DeviceCapabilities::RangeCount;
+    for (size_t i = 0; i < DeviceCapabilities::RangeCount; ++i) {
+        const auto& range = caps.ranges[i];
+        entry.ranges[i].min = range.min_;
+        entry.ranges[i].max = range.max_;
+        entry.ranges[i].step = range.step_;
+        entry.ranges[i].def = range.default_;
+        entry.ranges[i].caps_flags = range.caps_flags_;
+        entry.ranges[i].valid = range.valid_ ? 1 : 0;
+    }
+    entry.format_count = static_cast<uint32_t>(std::min(caps.formats.size(), kCapsMaxFormats));
+    for (size_t i = 0; i < entry.format_count; ++i) {
+        const auto& format = caps.formats[i];
+        entry.formats[i] = {format.width_, format.height_, format.fps_min_, format.fps_max_,
+                            static_cast<int32_t>(format.format_)};
+    }
+}
+
+void CapabilityCache::decode(const CapsEntry& entry, DeviceCapabilities& caps) {
+    size_t ranges = std::min<size_t>(entry.range_count, DeviceCapabilities::RangeCount);
+    for (size_t i = 0; i < DeviceCapabilities::RangeCount; ++i) {
+        Device::UvcParamRange range;
+        if (i < ranges) {
+            range.min_ = static_cast<long>(entry.ranges[i].min);
+            range.max_ = static_cast<long>(entry.ranges[i].max);
+            range.step_ = static_cast<long>(entry.ranges[i].step);
+            range.default_ = static_cast<long>(entry.ranges[i].def);
+            range.caps_flags_ = static_cast<long>(entry.ranges[i].caps_flags);
+            range.valid_ = entry.ranges[i].valid != 0;
+        }
+        caps.ranges[i] = range;
+    }
+    size_t formats = std::min<size_t>(entry.format_count, kCapsMaxFormats);
+    caps.formats.clear();
+    caps.formats.reserve(formats);
+    for (size_t i = 0; i < formats; ++i) {
+        const auto& format = entry.formats[i];
+        caps.formats.emplace_back(format.width, format.height, format.fps_min, format.fps_max,
+                                  static_cast<RmVideoFormat>(format.format));
+    }
+}
+
+const CapsEntry* CapabilityCache::findMapped(const Key& key) const {
+    // A handful of model/firmware pairs at most
+    for (size_t i = 0; i < mapped_count_; ++i) {
+        if (keyOf(mapped_[i]) == key) {
+            return &mapped_[i];
+        }
+    }
+    return nullptr;
+}
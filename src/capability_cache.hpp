@@ -0,0 +1,144 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <dev/dev.hpp>
+
+// Parameter ranges and video formats of a camera. They are fixed by the
+// model and firmware, so one query per model/firmware pair is enough.
+struct DeviceCapabilities {
+    enum Range : uint8_t {
+        Zoom,         // cameraGetRangeZoomAbsoluteR
+        Brightness,   // cameraGetRangeImageBrightnessR
+        Contrast,     // cameraGetRangeImageContrastR
+        Hue,          // cameraGetRangeImageHueR
+        Saturation,   // cameraGetRangeImageSaturationR
+        Sharpness,    // cameraGetRangeImageSharpR
+        WhiteBalance, // cameraGetRangeWhiteBalanceR
+        EvBias,       // cameraGetRangePAEEvBiasR
+        Iso,          // cameraGetRangeMAEIsoR
+        AntiFlicker,  // cameraGetRangeAntiFlickR
+        Exposure,     // cameraGetRangeExposureAbsolute
+        Focus,        // cameraGetRangeFocusAbsolute
+        RangeCount,
+    };
+
+    // valid_ is false for ranges the camera does not support
+    std::array<Device::UvcParamRange, RangeCount> ranges;
+    std::vector<Device::VideoFormatInfo> formats;
+
+    const Device::UvcParamRange& range(Range which) const { return ranges[which]; }
+    static const char* rangeName(Range which);
+
+    // Asks the camera for every range and the format list. Returns false when
+    // an answer was lost to a transient error (timeout, busy), in which case
+    // the result should not be cached.
+    static bool query(Device& device, DeviceCapabilities& out);
+};
+
+// On-disk format of the capability cache: a CapsFileHeader followed by
+// `entries` fixed-size CapsEntry records. The file is replaced as a whole on
+// save, never modified in place.
+
+constexpr char kCapsMagic[8] = {'O', 'B', 'S', 'C', 'A', 'P', 'S', '\0'};
+constexpr uint32_t kCapsVersion = 1;
+constexpr size_t kCapsMaxRanges = 16;
+constexpr size_t kCapsMaxFormats = 32;
+constexpr size_t kCapsKeyLength = 32; // model code / version, NUL padded
+
+struct CapsFileHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t entry_size;
+    uint64_t entries;
+    uint8_t reserved[40];
+};
+
+struct CapsRange {
+    int64_t min;
+    int64_t max;
+    int64_t step;
+    int64_t def;
+    int64_t caps_flags;
+    uint8_t valid;
+    uint8_t reserved[7];
+};
+
+struct CapsFormat {
+    int32_t width;
+    int32_t height;
+    int32_t fps_min;
+    int32_t fps_max;
+    int32_t format; // RmVideoFormat
+};
+
+struct CapsEntry {
+    char model_code[kCapsKeyLength];
+    char version[kCapsKeyLength];
+    uint32_t range_count;
+    uint32_t format_count;
+    CapsRange ranges[kCapsMaxRanges];
+    CapsFormat formats[kCapsMaxFormats];
+};
+
+static_assert(sizeof(CapsFileHeader) == 64, "capability cache header layout changed");
+static_assert(sizeof(CapsEntry) == 1480, "capability cache entry layout changed");
+static_assert(DeviceCapabilities::RangeCount <= kCapsMaxRanges, "too many ranges for the cache format");
+
+// Capabilities by devModelCode() + devVersion(), persisted in one file.
+//
+// open() maps the file once; lookups search the mapped entries and never
+// touch the disk again. Newly queried capabilities are kept in memory until
+// save() writes a new file next to the old one and renames it into place.
+class CapabilityCache {
+public:
+    CapabilityCache();
+    ~CapabilityCache();
+
+    CapabilityCache(const CapabilityCache&) = delete;
+    CapabilityCache& operator=(const CapabilityCache&) = delete;
+
+    // A missing, truncated or foreign file is treated as empty. Returns false
+    // only when `path` exists but cannot be read.
+    bool open(const std::string& path);
+    void close();
+
+    // Cached capabilities of the device's model and firmware, or a fresh
+    // query that is added to the cache. `cached` tells which one it was.
+    // Returns false when the camera could not be queried completely; `out`
+    // then holds what was read.
+    bool get(Device& device, DeviceCapabilities& out, bool* cached = nullptr);
+
+    bool lookup(const std::string& model_code, const std::string& version, DeviceCapabilities& out) const;
+    void store(const std::string& model_code, const std::string& version, const DeviceCapabilities& caps);
+
+    // Writes the cache if anything was stored since open()
+    bool save();
+
+    size_t size() const;
+    bool dirty() const;
+
+private:
+    using Key = std::pair<std::string, std::string>;
+
+    static Key keyOf(const CapsEntry& entry);
+    static bool keyFits(const std::string& model_code, const std::string& version);
+    static void encode(const Key& key, const DeviceCapabilities& caps, CapsEntry& entry);
+    static void decode(const CapsEntry& entry, DeviceCapabilities& caps);
+    const CapsEntry* findMapped(const Key& key) const;
+
+    std::string path_;
+    const uint8_t* base_;
+    size_t bytes_;
+    const CapsEntry* mapped_; // into base_, or saved_ after a save()
+    size_t mapped_count_;
+    std::vector<CapsEntry> saved_;
+
+    mutable std::mutex mutex_;
+    std::map<Key, CapsEntry> added_; // stored since open(), not saved yet
+};
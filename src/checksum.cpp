@@ -0,0 +1,272 @@
+#include "checksum.hpp"
+
+#include <cstdio>
+#include <cstring>
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#include <nmmintrin.h>
+#define OBSBOT_CRC32C_SSE42 1
+#elif defined(__aarch64__) && defined(__ARM_FEATURE_CRC32)
+#include <arm_acle.h>
+#define OBSBOT_CRC32C_ARM 1
+#endif
+
+namespace {
+
+constexpr uint32_t kCrc32cPoly = 0x82F63B78u; // reflected Castagnoli
+
+constexpr uint64_t kPrime1 = 11400714785074694791ull;
+constexpr uint64_t kPrime2 = 14029467366897019727ull;
+constexpr uint64_t kPrime3 = 1609587929392839161ull;
+constexpr uint64_t kPrime4 = 9650029242287828579ull;
+constexpr uint64_t kPrime5 = 2870177450012600261ull;
+
+uint64_t load64(const uint8_t* p) {
+    uint64_t v;
+    std::memcpy(&v, p, 8);
+    return v;
+}
+
+uint32_t load32(const uint8_t* p) {
+    uint32_t v;
+    std::memcpy(&v, p, 4);
+    return v;
+}
+
+// Slicing-by-8: table[k][b] is the CRC of byte b followed by k zero bytes
+struct Crc32cTables {
+    uint32_t table[8][256];
+
+    Crc32cTables() {
+        for (uint32_t b = 0; b < 256; ++b) {
+            uint32_t crc = b;
+            for (int bit = 0; bit < 8; ++bit) {
+                crc = crc & 1 ? (crc >> 1) ^ kCrc32cPoly : crc >> 1;
+            }
+            table[0][b] = crc;
+        }
+        for (uint32_t b = 0; b < 256; ++b) {
+            for (int k = 1; k < 8; ++k) {
+                table[k][b] = (table[k - 1][b] >> 8) ^ table[0][table[k - 1][b] & 0xFF];
+            }
+        }
+    }
+};
+
+const Crc32cTables& crcTables() {
+    static const Crc32cTables tables;
+    return tables;
+}
+
+uint32_t crc32cSoftware(uint32_t crc, const uint8_t* p, size_t size) {
+    const auto& t = crcTables().table;
+    while (size >= 8) {
+        uint64_t word = load64(p) ^ crc;
+        crc = t[7][word & 0xFF] ^ t[6][(word >> 8) & 0xFF] ^ t[5][(word >> 16) & 0xFF] ^
+              t[4][(word >> 24) & 0xFF] ^ t[3][(word >> 32) & 0xFF] ^ t[2][(word >> 40) & 0xFF] ^
+              t[1][(word >> 48) & 0xFF] ^ t[0][word >> 56];
+        p += 8;
+        size -= 8;
+    }
+    while (size-- > 0) {
+        crc = (crc >> 8) ^ t[0][(crc ^ *p++) & 0xFF];
+    }
+    return crc;
+}
+
+#if defined(OBSBOT_CRC32C_SSE42)
+__attribute__((target("sse4.2"))) uint32_t crc32cHardware(uint32_t crc, const uint8_t* p, size_t size) {
+    uint64_t crc64 = crc;
+    while (size >= 8) {
+        crc64 = _mm_crc32_u64(crc64, load64(p));
+        p += 8;
+        size -= 8;
+    }
+    crc = static_cast<uint32_t>(crc64);
+    while (size-- > 0) {
+        crc = _mm_crc32_u8(crc, *p++);
+    }
+    return crc;
+}
+
+bool detectHardware() {
+    return __builtin_cpu_supports("sse4.2");
+}
+#elif defined(OBSBOT_CRC32C_ARM)
+uint32_t crc32cHardware(uint32_t crc, const uint8_t* p, size_t size) {
+    while (size >= 8) {
+        crc = __crc32cd(crc, load64(p));
+        p += 8;
+        size -= 8;
+    }
+    while (size-- > 0) {
+        crc = __crc32cb(crc, *p++);
+    }
+    return crc;
+}
+
+bool detectHardware() {
+    return true;
+}
+#else
+uint32_t crc32cHardware(uint32_t crc, const uint8_t* p, size_t size) {
+    return crc32cSoftware(crc, p, size);
+}
+
+bool detectHardware() {
+    return false;
+}
+#endif
+
+const bool kHardwareCrc = detectHardware();
+
+uint64_t rotl(uint64_t x, int r) {
+    return (x << r) | (x >> (64 - r));
+}
+
+uint64_t xxhRound(uint64_t acc, uint64_t input) {
+    acc += input * kPrime2;
+    return rotl(acc, 31) * kPrime1;
+}
+
+uint64_t xxhMerge(uint64_t acc, uint64_t lane) {
+    acc ^= xxhRound(0, lane);
+    return acc * kPrime1 + kPrime4;
+}
+
+} // namespace
+
+Checksum::Checksum(Kind kind) : kind_(kind) {
+    reset();
+}
+
+void Checksum::reset() {
+    crc_ = 0xFFFFFFFFu;
+    total_ = 0;
+    acc_[0] = kPrime1 + kPrime2;
+    acc_[1] = kPrime2;
+    acc_[2] = 0;
+    acc_[3] = 0 - kPrime1;
+    pending_size_ = 0;
+}
+
+void Checksum::update(const void* data, size_t size) {
+    const auto* p = static_cast<const uint8_t*>(data);
+    total_ += size;
+    if (kind_ == Crc32c) {
+        crc_ = kHardwareCrc ? crc32cHardware(crc_, p, size) : crc32cSoftware(crc_, p, size);
+        return;
+    }
+    if (kind_ != Xxh64) {
+        return;
+    }
+    if (pending_size_ > 0) {
+        size_t take = std::min(size, sizeof(pending_) - pending_size_);
+        std::memcpy(pending_ + pending_size_, p, take);
+        pending_size_ += take;
+        p += take;
+        size -= take;
+        if (pending_size_ < sizeof(pending_)) {
+            return;
+        }
+        xxhStripes(pending_, 1);
+        pending_size_ = 0;
+    }
+    size_t stripes = size / 32;
+    xxhStripes(p, stripes);
+    p += stripes * 32;
+    size -= stripes * 32;
+    std::memcpy(pending_, p, size);
+    pending_size_ = size;
+}
+
+void Checksum::xxhStripes(const uint8_t* p, size_t stripes) {
+    uint64_t a0 = acc_[0], a1 = acc_[1], a2 = acc_[2], a3 = acc_[3];
+    for (size_t i = 0; i < stripes; ++i, p += 32) {
+        a0 = xxhRound(a0, load64(p));
+        a1 = xxhRound(a1, load64(p + 8));
+        a2 = xxhRound(a2, load64(p + 16));
+        a3 = xxhRound(a3, load64(p + 24));
+    }
+    acc_[0] = a0;
+    acc_[1] = a1;
+    acc_[2] = a2;
+    acc_[3] = a3;
+}
+
+uint64_t Checksum::value() const {
+    if (kind_ == Crc32c) {
+        return crc_ ^ 0xFFFFFFFFu;
+    }
+    if (kind_ != Xxh64) {
+        return 0;
+    }
+    uint64_t h;
+    if (total_ >= 32) {
+        h = rotl(acc_[0], 1) + rotl(acc_[1], 7) + rotl(acc_[2], 12) + rotl(acc_[3], 18);
+        for (uint64_t lane : acc_) {
+            h = xxhMerge(h, lane);
+        }
+    } else {
+        h = kPrime5;
+    }
+    h += total_;
+
+    const uint8_t* p = pending_;
+    size_t size = pending_size_;
+    for (; size >= 8; p += 8, size -= 8) {
+        h ^= xxhRound(0, load64(p));
+        h = rotl(h, 27) * kPrime1 + kPrime4;
+    }
+    if (size >= 4) {
+        h ^= load32(p) * kPrime1;
+        h = rotl(h, 23) * kPrime2 + kPrime3;
+        p += 4;
+        size -= 4;
+    }
+    for (; size > 0; ++p, --size) {
+        h ^= *p * kPrime5;
+        h = rotl(h, 11) * kPrime1;
+    }
+    h ^= h >> 33;
+    h *= kPrime2;
+    h ^= h >> 29;
+    h *= kPrime3;
+    h ^= h >> 32;
+    return h;
+}
+
+std::string Checksum::hex() const {
+    char buf[17];
+    if (kind_ == Crc32c) {
+        std::snprintf(buf, sizeof(buf), "%08x", static_cast<uint32_t>(value()));
+    } else {
+        std::snprintf(buf, sizeof(buf), "%016llx", static_cast<unsigned long long>(value()));
+    }
+    return buf;
+}
+
+const char* Checksum::name(Kind kind) {
+    switch (kind) {
+    case Crc32c:
+        return "crc32c";
+    case Xxh64:
+        return "xxh64";
+    default:
+        return "none";
+    }
+}
+
+bool Checksum::parse(const std::string& name, Kind& out) {
+    for (Kind kind : {None, Crc32c, Xxh64}) {
+        if (name == Checksum::name(kind)) {
+            out = kind;
+            return true;
+        }
+    }
+    return false;
+}
+
+bool Checksum::hardwareCrc32c() {
+    return kHardwareCrc;
+}
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// Streaming checksum of a byte sequence, fed in pieces of any size.
+//
+// Crc32c is the Castagnoli CRC, computed with the CPU's CRC32 instructions
+// (SSE4.2 on x86-64, the CRC extension on AArch64) when present and with
+// slicing-by-8 tables otherwise. Xxh64 is xxHash64 with seed 0. Both match
+// the usual command line tools, so a sidecar file can be checked with them.
+class Checksum {
+public:
+    enum Kind : uint32_t {
+        None = 0,
+        Crc32c = 1,
+        Xxh64 = 2,
+    };
+
+    explicit Checksum(Kind kind = Crc32c);
+
+    void reset();
+    void update(const void* data, size_t size);
+
+    Kind kind() const { return kind_; }
+    // CRC32C in the low 32 bits; 0 for None
+    uint64_t value() const;
+    // Lowercase hex, 8 digits for Crc32c and 16 for Xxh64
+    std::string hex() const;
+
+    // "crc32c", "xxh64" or "none"; also the sidecar file extension
+    static const char* name(Kind kind);
+    // Inverse of name(); false for an unknown name
+    static bool parse(const std::string& name, Kind& out);
+    static bool hardwareCrc32c();
+
+private:
+    void xxhStripes(const uint8_t* p, size_t stripes);
+
+    Kind kind_;
+    uint32_t crc_;
+    uint64_t total_;
+    uint64_t acc_[4]; // xxHash64 lanes
+    uint8_t pending_[32];
+    size_t pending_size_;
+};
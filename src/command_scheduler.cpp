@@ -0,0 +1,172 @@
+#include "command_scheduler.hpp"
+
+#include <algorithm>
+
+CommandScheduler::Pacing CommandScheduler::defaultPacing(Priority priority) {
+    switch (priority) {
+    case Settings:
+        return {100.0, 16.0};
+    case Bulk:
+        return {25.0, 4.0};
+    default:
+        return {0.0, 1.0};
+    }
+}
+
+CommandScheduler::CommandScheduler(ThreadPool& pool)
+    : pool_(pool), executed_(), scheduled_(false), waiting_(false), running_(0) {
+    auto now = Clock::now();
+    for (size_t i = 0; i < buckets_.size(); ++i) {
+        Pacing pacing = defaultPacing(static_cast<Priority>(i));
+        buckets_[i] = {pacing, pacing.burst, now};
+    }
+}
+
+void CommandScheduler::setPacing(Priority priority, Pacing pacing) {
+    if (priority <= Stop || priority >= PriorityCount) {
+        return;
+    }
+    std::lock_guard<std::mutex> lock(mutex_);
+    Bucket& bucket = buckets_[priority];
+    bucket.pacing = {std::max(pacing.rate, 0.0), std::max(pacing.burst, 1.0)};
+    bucket.tokens = std::min(bucket.tokens, bucket.pacing.burst);
+}
+
+CommandScheduler::Pacing CommandScheduler::pacing(Priority priority) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return buckets_[priority].pacing;
+}
+
+bool CommandScheduler::post(Task task, Priority priority) {
+    if (priority < Stop || priority >= PriorityCount) {
+        return false;
+    }
+    bool start = false;
+    bool wake = false;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        tasks_[priority].push_back(std::move(task));
+        if (priority == Stop) {
+            stops_waiting_.fetch_add(1, std::memory_order_release);
+        }
+        if (!scheduled_) {
+            scheduled_ = true;
+            start = true;
+        } else {
+            // The drain may be waiting for a token of another class
+            wake = waiting_;
+        }
+    }
+    if (wake) {
+        posted_.notify_one();
+    }
+    return !start || schedule();
+}
+
+size_t CommandScheduler::pending() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    size_t count = running_;
+    for (auto& tasks : tasks_) {
+        count += tasks.size();
+    }
+    return count;
+}
+
+size_t CommandScheduler::pending(Priority priority) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return tasks_[priority].size();
+}
+
+uint64_t CommandScheduler::executed(Priority priority) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return executed_[priority];
+}
+
+uint64_t CommandScheduler::posted(Priority priority) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return executed_[priority] + tasks_[priority].size();
+}
+
+bool CommandScheduler::schedule() {
+    auto self = shared_from_this();
+    if (pool_.post([self] { self->drain(); })) {
+        return true;
+    }
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (auto& tasks : tasks_) {
+        tasks.clear();
+    }
+    stops_waiting_.store(0, std::memory_order_release);
+    scheduled_ = false;
+    return false;
+}
+
+CommandScheduler::Priority CommandScheduler::next(Clock::time_point now, Clock::duration& wait) {
+    wait = Clock::duration::zero();
+    for (size_t i = 0; i < tasks_.size(); ++i) {
+        if (tasks_[i].empty()) {
+            continue;
+        }
+        Bucket& bucket = buckets_[i];
+        if (bucket.pacing.rate <= 0.0) {
+            return static_cast<Priority>(i);
+        }
+        double elapsed = std::chrono::duration<double>(now - bucket.refilled).count();
+        bucket.tokens = std::min(bucket.pacing.burst, bucket.tokens + elapsed * bucket.pacing.rate);
+        bucket.refilled = now;
+        if (bucket.tokens >= 1.0) {
+            bucket.tokens -= 1.0;
+            return static_cast<Priority>(i);
+        }
+        auto until = std::chrono::duration_cast<Clock::duration>(
+            std::chrono::duration<double>((1.0 - bucket.tokens) / bucket.pacing.rate));
+        until = std::max(until, Clock::duration(1));
+        if (wait == Clock::duration::zero() || until < wait) {
+            wait = until;
+        }
+    }
+    return PriorityCount;
+}
+
+void CommandScheduler::drain() {
+    for (size_t i = 0; i < kBatch; ++i) {
+        Task task;
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            Priority priority;
+            Clock::duration wait;
+            while ((priority = next(Clock::now(), wait)) == PriorityCount) {
+                if (wait == Clock::duration::zero()) {
+                    scheduled_ = false;
+                    return;
+                }
+                // Everything queued is paced; any new task ends the wait
+                throttled_.fetch_add(1, std::memory_order_relaxed);
+                waiting_ = true;
+                posted_.wait_for(lock, wait);
+                waiting_ = false;
+            }
+            task = std::move(tasks_[priority].front());
+            tasks_[priority].pop_front();
+            ++executed_[priority];
+            running_ = 1;
+            if (priority == Stop) {
+                stops_waiting_.fetch_sub(1, std::memory_order_release);
+            }
+        }
+        task();
+        std::lock_guard<std::mutex> lock(mutex_);
+        running_ = 0;
+    }
+
+    // Still busy: requeue behind other cameras instead of hogging the worker
+    auto self = shared_from_this();
+    if (!pool_.post([self] { self->drain(); })) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (auto& tasks : tasks_) {
+            tasks.clear();
+        }
+        stops_waiting_.store(0, std::memory_order_release);
+        scheduled_ = false;
+    }
+}
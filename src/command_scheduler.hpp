@@ -0,0 +1,104 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+
+#include "thread_pool.hpp"
+
+// Per-camera command queue with priority classes, on top of a ThreadPool.
+//
+// Tasks never run concurrently and tasks of one class run in posting order.
+// Between tasks the scheduler always picks the most urgent class that has
+// work and a token. Stop tasks go before anything else that is queued. A
+// task that is already running cannot be interrupted. Long tasks that run
+// many commands should check urgent() and yield.
+//
+// Each class except Stop may be paced by a token bucket: `rate` tasks per
+// second on average, and bursts of up to `burst` tasks. Pacing keeps a burst
+// of settings or bulk work from filling the camera's channel. While every
+// queued class is out of tokens, the drain waits on its pool worker, and a
+// newly posted task wakes it. Create through std::make_shared; queued tasks
+// keep it alive.
+class CommandScheduler : public std::enable_shared_from_this<CommandScheduler> {
+public:
+    using Task = ThreadPool::Task;
+    using Clock = std::chrono::steady_clock;
+
+    enum Priority {
+        Stop = 0, // aiSetGimbalStop, cameraSetZoomStopR, emergency stops
+        Motion,   // gimbal, zoom and preset moves, interactive commands
+        Settings, // image, exposure, audio and other settings writes
+        Bulk,     // MTP transfers, file listings, snapshot restores
+        PriorityCount
+    };
+
+    struct Pacing {
+        double rate;  // tasks per second; 0 disables pacing
+        double burst; // bucket size in tasks, at least 1
+    };
+
+    // Default pacing per class. With the usual 2 to 3 ms round trip a camera
+    // takes about 400 commands a second; settings may use a quarter of that
+    // and bulk work a sixteenth, leaving the rest to motion.
+    static Pacing defaultPacing(Priority priority);
+
+    explicit CommandScheduler(ThreadPool& pool);
+
+    CommandScheduler(const CommandScheduler&) = delete;
+    CommandScheduler& operator=(const CommandScheduler&) = delete;
+
+    // Stop is never paced, so its pacing cannot be changed
+    void setPacing(Priority priority, Pacing pacing);
+    Pacing pacing(Priority priority) const;
+
+    // Returns false once the pool is shutting down
+    bool post(Task task, Priority priority);
+
+    // Number of tasks waiting or running
+    size_t pending() const;
+    size_t pending(Priority priority) const;
+    // True while a Stop task is waiting
+    bool urgent() const { return stops_waiting_.load(std::memory_order_acquire) != 0; }
+
+    uint64_t executed(Priority priority) const;
+    // Tasks of `priority` posted so far: executed plus still queued
+    uint64_t posted(Priority priority) const;
+    uint64_t throttled() const { return throttled_.load(std::memory_order_relaxed); } // waits for a token
+
+private:
+    // Upper bound of tasks run per pool slot before yielding to other work
+    static constexpr size_t kBatch = 16;
+
+    struct Bucket {
+        Pacing pacing;
+        double tokens;
+        Clock::time_point refilled;
+    };
+
+    void drain();
+    bool schedule();
+    // Picks the next runnable class, or returns PriorityCount and the time
+    // until the next token when every queued class is out of tokens. Caller
+    // holds mutex_.
+    Priority next(Clock::time_point now, Clock::duration& wait);
+
+    ThreadPool& pool_;
+    mutable std::mutex mutex_;
+    std::condition_variable posted_;
+    std::array<std::deque<Task>, PriorityCount> tasks_;
+    std::array<Bucket, PriorityCount> buckets_;
+    std::array<uint64_t, PriorityCount> executed_;
+    bool scheduled_;
+    bool waiting_; // the drain sleeps for a token
+    size_t running_;
+
+    std::atomic<size_t> stops_waiting_{0};
+    std::atomic<uint64_t> throttled_{0};
+};
@@ -0,0 +1,155 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+// Wire format of the control socket served by ControlServer. Header-only so
+// that other processes can include it without linking obsbot_core.
+//
+// Every frame starts with a uint32 length counting the bytes after it. All
+// integers are little-endian; floats travel as their IEEE-754 bit pattern in
+// a 32-bit word.
+//
+//   request   u32 length | u32 id | u16 op | u16 camera | u32 args[]
+//   response  u32 length | u32 id | i32 result | payload
+//
+// A client may write any number of requests, in one write or many, without
+// waiting for responses. Each request gets exactly one response carrying its
+// id. Settings requests (SettingSet, SettingGet) for one camera run in
+// order, and so do its other requests, so their responses do too. The two
+// kinds may overtake each other, as may responses for different cameras and
+// for requests the server answers itself. GimbalStop is the exception: it runs
+// ahead of every request still queued for its camera, and the gimbal moves
+// among those (GimbalSpeed, GimbalAngle, GimbalReset, PresetRecall) are
+// answered with kResultPreempted without running. A GimbalSpeed whose turn
+// comes while a newer GimbalSpeed for the same camera is queued, with no
+// other gimbal move in between, is answered with kResultSuperseded without
+// running, so only the latest speed reaches the camera. `result` is otherwise
+// RM_RET_OK or the SDK error code of the command; unknown ops and cameras
+// and missing arguments get RM_RET_ERR. Closing the socket, even half-way,
+// drops unsent responses.
+
+namespace control {
+
+constexpr const char* kDefaultSocketPath = "/tmp/obsbot_control.sock";
+constexpr uint32_t kProtocolVersion = 4;
+
+// Result of a gimbal move cancelled by a later GimbalStop
+constexpr int32_t kResultPreempted = -2;
+// Result of a GimbalSpeed replaced by a newer one before it was sent
+constexpr int32_t kResultSuperseded = -3;
+
+constexpr size_t kRequestHeaderSize = 12;
+constexpr size_t kResponseHeaderSize = 12;
+constexpr size_t kMaxArgs = 4;
+constexpr size_t kMaxRequestSize = kRequestHeaderSize + kMaxArgs * 4;
+constexpr size_t kMaxResponseWords = 32;
+constexpr size_t kMaxResponseSize = kResponseHeaderSize + kMaxResponseWords * 4;
+
+enum Op : uint16_t {
+    // Answered by the server; `camera` is ignored
+    Ping = 0,        // -> u32 protocol version
+    ListCameras = 1, // -> per camera: u16 camera, u8 sn length, sn bytes
+
+    // Gimbal
+    GimbalSpeed = 16, // f32 pitch, f32 pan (deg/s)           aiSetGimbalSpeedCtrlR
+    GimbalAngle,      // f32 pitch, f32 yaw (deg)             aiSetGimbalMotorAngleR
+    GimbalStop,       //                                      aiSetGimbalStop
+    GimbalReset,      //                                      gimbalRstPosR
+    GimbalAttitude,   // -> f32 roll, f32 pitch, f32 yaw      gimbalGetAttitudeInfoR
+
+    // Zoom
+    ZoomSet = 32, // f32 zoom, 1.0 ..                         cameraSetZoomAbsoluteR
+    ZoomGet,      // -> f32 zoom                              cameraGetZoomAbsoluteR
+
+    // Presets
+    PresetRecall = 48, // i32 id                              aiTrgGimbalPresetR
+    PresetList,        // -> i32 id per preset, at most kMaxResponseWords
+
+    // Image, exposure, white balance, focus and audio settings
+    SettingSet = 64, // u32 SettingsSnapshot::Setting, i32 a, i32 b
+    SettingGet,      // u32 SettingsSnapshot::Setting -> i32 a, i32 b
+};
+
+inline uint32_t wordOf(float value) {
+    uint32_t word;
+    std::memcpy(&word, &value, sizeof(word));
+    return word;
+}
+
+inline float floatOf(uint32_t word) {
+    float value;
+    std::memcpy(&value, &word, sizeof(value));
+    return value;
+}
+
+inline uint32_t load32(const uint8_t* p) {
+    return static_cast<uint32_t>(p[0]) | static_cast<uint32_t>(p[1]) << 8 | static_cast<uint32_t>(p[2]) << 16 |
+           static_cast<uint32_t>(p[3]) << 24;
+}
+
+inline uint16_t load16(const uint8_t* p) {
+    return static_cast<uint16_t>(p[0] | p[1] << 8);
+}
+
+inline void store32(uint8_t* p, uint32_t value) {
+    p[0] = static_cast<uint8_t>(value);
+    p[1] = static_cast<uint8_t>(value >> 8);
+    p[2] = static_cast<uint8_t>(value >> 16);
+    p[3] = static_cast<uint8_t>(value >> 24);
+}
+
+inline void store16(uint8_t* p, uint16_t value) {
+    p[0] = static_cast<uint8_t>(value);
+    p[1] = static_cast<uint8_t>(value >> 8);
+}
+
+// Writes one request into `out`, which must hold kMaxRequestSize bytes.
+// Returns the frame size.
+inline size_t encodeRequest(uint8_t* out, uint32_t id, Op op, uint16_t camera, const uint32_t* args = nullptr,
+                            size_t count = 0) {
+    count = count < kMaxArgs ? count : kMaxArgs;
+    size_t size = kRequestHeaderSize + count * 4;
+    store32(out, static_cast<uint32_t>(size - 4));
+    store32(out + 4, id);
+    store16(out + 8, op);
+    store16(out + 10, camera);
+    for (size_t i = 0; i < count; ++i) {
+        store32(out + kRequestHeaderSize + i * 4, args[i]);
+    }
+    return size;
+}
+
+// A response frame inside a receive buffer
+struct Response {
+    uint32_t id = 0;
+    int32_t result = 0;
+    const uint8_t* payload = nullptr;
+    size_t payload_size = 0;
+
+    size_t words() const { return payload_size / 4; }
+    uint32_t word(size_t i) const { return load32(payload + i * 4); }
+};
+
+// Parses the response at the start of [data, data + size). Returns the
+// frame size, 0 when the frame is incomplete, or -1 for a malformed frame.
+inline long decodeResponse(const uint8_t* data, size_t size, Response& out) {
+    if (size < 4) {
+        return 0;
+    }
+    size_t length = load32(data);
+    if (length < kResponseHeaderSize - 4 || length > kMaxResponseSize - 4) {
+        return -1;
+    }
+    if (size < length + 4) {
+        return 0;
+    }
+    out.id = load32(data + 4);
+    out.result = static_cast<int32_t>(load32(data + 8));
+    out.payload = data + kResponseHeaderSize;
+    out.payload_size = length + 4 - kResponseHeaderSize;
+    return static_cast<long>(length + 4);
+}
+
+} // namespace control
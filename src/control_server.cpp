@@ -0,0 +1,758 @@
+#include "control_server.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <thread>
+#include <unistd.h>
+
+#include "settings_snapshot.hpp"
+
+namespace {
+
+constexpr size_t kInputBuffer = 16 * 1024;
+// Room for answers that are written at once (Ping, ListCameras, errors)
+constexpr size_t kInlineResponses = 16;
+
+// Arguments each op needs, or -1 for unknown ops
+int argCount(uint16_t op) {
+    switch (op) {
+    case control::Ping:
+    case control::ListCameras:
+    case control::GimbalStop:
+    case control::GimbalReset:
+    case control::GimbalAttitude:
+    case control::ZoomGet:
+    case control::PresetList:
+        return 0;
+    case control::ZoomSet:
+    case control::PresetRecall:
+    case control::SettingGet:
+        return 1;
+    case control::GimbalSpeed:
+    case control::GimbalAngle:
+        return 2;
+    case control::SettingSet:
+        return 3;
+    default:
+        return -1;
+    }
+}
+
+// Gimbal moves that a later GimbalStop cancels while they are still queued
+bool isGimbalMove(uint16_t op) {
+    switch (op) {
+    case control::GimbalSpeed:
+    case control::GimbalAngle:
+    case control::GimbalReset:
+    case control::PresetRecall:
+        return true;
+    default:
+        return false;
+    }
+}
+
+} // namespace
+
+struct ControlServer::Slot {
+    Connection* conn = nullptr;
+    Slot* next = nullptr;
+
+    uint32_t id = 0;
+    uint16_t op = 0;
+    uint16_t camera = 0;
+    uint32_t stops = 0; // Lane::stops when the request arrived
+    uint32_t args[control::kMaxArgs] = {};
+
+    int32_t result = RM_RET_ERR;
+    size_t words = 0;
+    uint32_t reply[control::kMaxResponseWords] = {};
+    std::vector<Device::PresetPosInfo> presets; // PresetList; keeps its capacity
+};
+
+struct ControlServer::Connection {
+    int fd = -1;
+    uint32_t events = 0; // registered with the reactor
+    bool closed = false;
+    bool woken = false; // queued in woken_
+
+    std::vector<Slot> slots;
+    Slot* free = nullptr;
+    size_t in_flight = 0;
+
+    std::vector<uint8_t> in;
+    size_t in_len = 0;
+    std::vector<uint8_t> out;
+    size_t out_len = 0;
+};
+
+ControlServer::ControlServer(Reactor& reactor, FleetManager& fleet, size_t max_in_flight)
+    : reactor_(reactor),
+      fleet_(fleet),
+      max_in_flight_(std::max<size_t>(max_in_flight, 1)),
+      speed_period_(0),
+      listen_fd_(-1),
+      outstanding_(0),
+      done_head_(nullptr),
+      done_tail_(nullptr) {
+    touched_.reserve(16);
+    woken_.reserve(16);
+}
+
+ControlServer::~ControlServer() {
+    close();
+}
+
+void ControlServer::setSpeedRate(double rate_hz) {
+    auto period = std::chrono::duration<double>(rate_hz > 0.0 ? 1.0 / rate_hz : 0.0);
+    speed_period_ = std::chrono::duration_cast<std::chrono::steady_clock::duration>(period);
+}
+
+bool ControlServer::listen(const std::string& path) {
+    sockaddr_un addr{};
+    if (listen_fd_ >= 0 || !done_event_.valid() || path.size() >= sizeof(addr.sun_path)) {
+        return false;
+    }
+    addr.sun_family = AF_UNIX;
+    std::memcpy(addr.sun_path, path.c_str(), path.size() + 1);
+
+    int fd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        return false;
+    }
+    // A socket file nobody answers on is left over from an earlier run; a
+    // live controller keeps its socket
+    int probe = ::socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (probe < 0) {
+        ::close(fd);
+        return false;
+    }
+    int probe_error = ::connect(probe, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) == 0 ? 0 : errno;
+    ::close(probe);
+    if (probe_error != ECONNREFUSED && probe_error != ENOENT) {
+        ::close(fd);
+        errno = EADDRINUSE;
+        return false;
+    }
+    ::unlink(path.c_str());
+    if (::bind(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0 || ::listen(fd, 64) != 0 ||
+        !reactor_.add(fd, EPOLLIN, [this](uint32_t) { onAccept(); })) {
+        ::close(fd);
+        return false;
+    }
+    if (!reactor_.add(done_event_.fd(), EPOLLIN, [this](uint32_t) { onDone(); })) {
+        reactor_.remove(fd);
+        ::close(fd);
+        return false;
+    }
+    listen_fd_ = fd;
+    path_ = path;
+    return true;
+}
+
+void ControlServer::close() {
+    if (listen_fd_ >= 0) {
+        reactor_.remove(listen_fd_);
+        reactor_.remove(done_event_.fd());
+        ::close(listen_fd_);
+        ::unlink(path_.c_str());
+        listen_fd_ = -1;
+    }
+    for (auto& conn : connections_) {
+        if (!conn->closed) {
+            closeConnection(conn.get());
+        }
+    }
+
+    // Commands still on the strands reference their slots and lanes
+    while (outstanding_ > 0) {
+        {
+            std::unique_lock<std::mutex> lock(done_mutex_);
+            done_cond_.wait(lock, [this] { return done_head_ != nullptr; });
+        }
+        onDone();
+    }
+    for (auto& lane : lanes_) {
+        for (;;) {
+            {
+                std::lock_guard<std::mutex> lock(lane.mutex);
+                if (!lane.scheduled) {
+                    break;
+                }
+            }
+            std::this_thread::yield();
+        }
+    }
+    connections_.clear();
+    connection_count_.store(0, std::memory_order_relaxed);
+}
+
+void ControlServer::onAccept() {
+    for (;;) {
+        int fd = ::accept4(listen_fd_, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd < 0) {
+            return;
+        }
+        auto conn = std::make_unique<Connection>();
+        conn->fd = fd;
+        conn->slots.resize(max_in_flight_);
+        for (auto& slot : conn->slots) {
+            slot.conn = conn.get();
+            slot.next = conn->free;
+            conn->free = &slot;
+        }
+        conn->in.resize(kInputBuffer);
+        conn->out.resize((max_in_flight_ + kInlineResponses) * control::kMaxResponseSize);
+
+        Connection* raw = conn.get();
+        conn->events = EPOLLIN;
+        if (!reactor_.add(fd, EPOLLIN, [this, raw](uint32_t events) { onConnection(raw, events); })) {
+            ::close(fd);
+            continue;
+        }
+        connections_.push_back(std::move(conn));
+        connection_count_.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+void ControlServer::onConnection(Connection* conn, uint32_t events) {
+    if (conn->closed) {
+        return;
+    }
+    if (events & EPOLLOUT) {
+        flush(conn);
+    }
+    if (events & (EPOLLHUP | EPOLLERR)) {
+        closeConnection(conn);
+    } else if ((events & EPOLLIN) && !conn->closed && conn->in_len < conn->in.size() && canAccept(conn)) {
+        // Only read what can be parsed; the rest waits in the socket
+        ssize_t n = ::recv(conn->fd, conn->in.data() + conn->in_len, conn->in.size() - conn->in_len, 0);
+        if (n > 0) {
+            conn->in_len += static_cast<size_t>(n);
+        } else if (n == 0 || (errno != EAGAIN && errno != EINTR)) {
+            closeConnection(conn);
+        }
+    }
+    if (!conn->closed) {
+        process(conn);
+    }
+    reap(conn);
+}
+
+bool ControlServer::canAccept(const Connection* conn) const {
+    // Every request taken, answered at once or later, has its response space
+    return conn->free &&
+           conn->out_len + (conn->in_flight + 1) * control::kMaxResponseSize <= conn->out.size();
+}
+
+void ControlServer::process(Connection* conn) {
+    size_t pos = 0;
+    while (!conn->closed && conn->in_len - pos >= 4) {
+        size_t length = control::load32(conn->in.data() + pos);
+        if (length < control::kRequestHeaderSize - 4 || length + 4 > control::kMaxRequestSize || length % 4 != 0) {
+            closeConnection(conn);
+            break;
+        }
+        if (conn->in_len - pos < length + 4 || !canAccept(conn)) {
+            break;
+        }
+        handleRequest(conn, conn->in.data() + pos, length + 4);
+        pos += length + 4;
+    }
+    if (pos > 0) {
+        std::memmove(conn->in.data(), conn->in.data() + pos, conn->in_len - pos);
+        conn->in_len -= pos;
+    }
+    dispatch();
+    if (!conn->closed && flush(conn)) {
+        updateEvents(conn);
+    }
+}
+
+void ControlServer::handleRequest(Connection* conn, const uint8_t* frame, size_t size) {
+    requests_.fetch_add(1, std::memory_order_relaxed);
+    uint32_t id = control::load32(frame + 4);
+    uint16_t op = control::load16(frame + 8);
+    uint16_t camera = control::load16(frame + 10);
+    size_t count = (size - control::kRequestHeaderSize) / 4;
+
+    int needed = argCount(op);
+    if (needed < 0 || count < static_cast<size_t>(needed)) {
+        respond(conn, id, RM_RET_ERR);
+        return;
+    }
+    if (op == control::Ping) {
+        uint32_t version = control::kProtocolVersion;
+        respond(conn, id, RM_RET_OK, &version, 1);
+        return;
+    }
+    if (op == control::ListCameras) {
+        listCameras(conn, id);
+        return;
+    }
+    if (camera == 0 || camera > lanes_.size() / 2) {
+        respond(conn, id, RM_RET_ERR);
+        return;
+    }
+
+    Slot* slot = conn->free;
+    conn->free = slot->next;
+    ++conn->in_flight;
+    ++outstanding_;
+    slot->next = nullptr;
+    slot->id = id;
+    slot->op = op;
+    slot->camera = camera;
+    std::fill(std::begin(slot->args), std::end(slot->args), 0u);
+    for (size_t i = 0; i < count; ++i) {
+        slot->args[i] = control::load32(frame + control::kRequestHeaderSize + i * 4);
+    }
+
+    // Settings take the camera's second lane, which runs at Settings priority
+    bool setting = op == control::SettingSet || op == control::SettingGet;
+    Lane& lane = lanes_[2 * (camera - 1) + (setting ? 1 : 0)];
+    if (op == control::GimbalStop) {
+        stop(lane, slot);
+        return;
+    }
+    slot->stops = lane.stops.load(std::memory_order_relaxed);
+    if (!lane.staged_head) {
+        lane.staged_head = slot;
+        touched_.push_back(&lane);
+    } else {
+        lane.staged_tail->next = slot;
+    }
+    lane.staged_tail = slot;
+}
+
+void ControlServer::listCameras(Connection* conn, uint32_t id) {
+    uint32_t words[control::kMaxResponseWords] = {};
+    auto* bytes = reinterpret_cast<uint8_t*>(words);
+    size_t used = 0;
+    for (auto& camera : fleet_.cameras()) {
+        const std::string& sn = camera->sn();
+        auto it = camera_ids_.find(sn);
+        if (it == camera_ids_.end()) {
+            if (lanes_.size() / 2 >= 0xffff) {
+                continue;
+            }
+            lanes_.emplace_back();
+            lanes_.back().sn = sn;
+            lanes_.emplace_back();
+            lanes_.back().sn = sn;
+            lanes_.back().priority = CommandScheduler::Settings;
+            it = camera_ids_.emplace(sn, static_cast<uint16_t>(lanes_.size() / 2)).first;
+        }
+        size_t entry = 3 + std::min<size_t>(sn.size(), 255);
+        if (used + entry > sizeof(words)) {
+            break;
+        }
+        control::store16(bytes + used, it->second);
+        bytes[used + 2] = static_cast<uint8_t>(entry - 3);
+        std::memcpy(bytes + used + 3, sn.data(), entry - 3);
+        used += entry;
+    }
+    // Padded to whole words; readers stop at the padding's zero length
+    for (size_t i = 0; i < (used + 3) / 4; ++i) {
+        words[i] = control::load32(bytes + i * 4);
+    }
+    respond(conn, id, RM_RET_OK, words, (used + 3) / 4);
+}
+
+void ControlServer::dispatch() {
+    for (Lane* lane : touched_) {
+        Slot* head = lane->staged_head;
+        Slot* tail = lane->staged_tail;
+        lane->staged_head = lane->staged_tail = nullptr;
+
+        auto handle = fleet_.camera(lane->sn);
+        if (!handle) {
+            fail(head, RM_RET_ERR);
+            continue;
+        }
+        bool post = false;
+        {
+            std::lock_guard<std::mutex> lock(lane->mutex);
+            if (lane->head) {
+                lane->tail->next = head;
+            } else {
+                lane->head = head;
+            }
+            lane->tail = tail;
+            if (!lane->scheduled) {
+                // A reconnected camera gets a new handle; a queued task
+                // still finishes on the old one
+                lane->scheduled = true;
+                lane->handle = handle;
+                post = true;
+            }
+        }
+        if (post) {
+            batches_.fetch_add(1, std::memory_order_relaxed);
+            if (!handle->post([this, lane](Device& device) { runLane(lane, device); }, lane->priority)) {
+                Slot* orphans;
+                {
+                    std::lock_guard<std::mutex> lock(lane->mutex);
+                    orphans = lane->head;
+                    lane->head = lane->tail = nullptr;
+                    lane->scheduled = false;
+                }
+                fail(orphans, RM_RET_ERR);
+            }
+        }
+    }
+    touched_.clear();
+}
+
+void ControlServer::stop(Lane& lane, Slot* slot) {
+    auto handle = fleet_.camera(lane.sn);
+    if (!handle) {
+        fail(slot, RM_RET_ERR);
+        return;
+    }
+    // Moves queued before the stop must not restart the gimbal after it
+    lane.stops.fetch_add(1, std::memory_order_relaxed);
+    {
+        // A speed waiting for its turn gives up at once
+        std::lock_guard<std::mutex> lock(lane.mutex);
+    }
+    lane.stopped.notify_all();
+    bool posted = handle->post(
+        [this, slot](Device& device) {
+            slot->result = device.aiSetGimbalStop();
+            slot->words = 0;
+            complete(slot);
+        },
+        CommandScheduler::Stop);
+    if (!posted) {
+        fail(slot, RM_RET_ERR);
+    }
+}
+
+void ControlServer::fail(Slot* slots, int32_t result) {
+    while (slots) {
+        Slot* next = slots->next;
+        slots->result = result;
+        slots->words = 0;
+        complete(slots);
+        slots = next;
+    }
+}
+
+void ControlServer::runLane(Lane* lane, Device& device) {
+    Slot* batch;
+    std::shared_ptr<CameraHandle> handle;
+    {
+        std::lock_guard<std::mutex> lock(lane->mutex);
+        batch = lane->head;
+        lane->head = lane->tail = nullptr;
+        handle = lane->handle;
+        if (!batch) {
+            lane->scheduled = false;
+            return;
+        }
+    }
+    while (batch) {
+        Slot* next = batch->next;
+        if (isGimbalMove(batch->op) && batch->stops != lane->stops.load(std::memory_order_relaxed)) {
+            batch->result = control::kResultPreempted;
+            batch->words = 0;
+        } else if (batch->op == control::GimbalSpeed && !holdSpeed(*lane, *batch)) {
+            batch->words = 0;
+        } else {
+            execute(*handle, device, *batch);
+        }
+        complete(batch);
+        batch = next;
+        if (batch && handle->urgent()) {
+            // Let a waiting stop run; the rest of the batch goes first
+            // when the lane is scheduled again
+            std::lock_guard<std::mutex> lock(lane->mutex);
+            Slot* last = batch;
+            while (last->next) {
+                last = last->next;
+            }
+            last->next = lane->head;
+            if (!lane->head) {
+                lane->tail = last;
+            }
+            lane->head = batch;
+            break;
+        }
+    }
+
+    // Requests that arrived meanwhile go behind other work on this strand
+    bool more;
+    {
+        std::lock_guard<std::mutex> lock(lane->mutex);
+        more = lane->head != nullptr;
+        lane->scheduled = more;
+    }
+    if (more) {
+        batches_.fetch_add(1, std::memory_order_relaxed);
+        if (!handle->post([this, lane](Device& next_device) { runLane(lane, next_device); }, lane->priority)) {
+            Slot* orphans;
+            {
+                std::lock_guard<std::mutex> lock(lane->mutex);
+                orphans = lane->head;
+                lane->head = lane->tail = nullptr;
+                lane->scheduled = false;
+            }
+            fail(orphans, RM_RET_ERR);
+        }
+    }
+}
+
+// The next gimbal move queued after `slot` is a GimbalSpeed, which would
+// replace the speed of `slot` as soon as it was sent
+bool ControlServer::superseded(Lane& lane, const Slot& slot) {
+    for (const Slot* later = slot.next; later; later = later->next) {
+        if (isGimbalMove(later->op)) {
+            return later->op == control::GimbalSpeed;
+        }
+    }
+    // Arrived after this batch was taken
+    std::lock_guard<std::mutex> lock(lane.mutex);
+    for (const Slot* later = lane.head; later; later = later->next) {
+        if (isGimbalMove(later->op)) {
+            return later->op == control::GimbalSpeed;
+        }
+    }
+    return false;
+}
+
+// Waits until the lane's speed rate allows sending the speed of `slot`.
+// False if it is not to be sent at all, with its result set.
+bool ControlServer::holdSpeed(Lane& lane, Slot& slot) {
+    if (superseded(lane, slot)) {
+        slot.result = control::kResultSuperseded;
+        superseded_.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+    if (speed_period_.count() > 0) {
+        auto now = std::chrono::steady_clock::now();
+        if (now < lane.next_speed) {
+            std::unique_lock<std::mutex> lock(lane.mutex);
+            lane.stopped.wait_until(lock, lane.next_speed, [&lane, &slot] {
+                return slot.stops != lane.stops.load(std::memory_order_relaxed);
+            });
+            if (slot.stops != lane.stops.load(std::memory_order_relaxed)) {
+                slot.result = control::kResultPreempted;
+                return false;
+            }
+            lock.unlock();
+            // A newer speed may have come in while this one waited
+            if (superseded(lane, slot)) {
+                slot.result = control::kResultSuperseded;
+                superseded_.fetch_add(1, std::memory_order_relaxed);
+                return false;
+            }
+            now = std::chrono::steady_clock::now();
+        }
+        lane.next_speed = now + speed_period_;
+    }
+    return true;
+}
+
+void ControlServer::execute(CameraHandle& handle, Device& device, Slot& slot) {
+    const uint32_t* args = slot.args;
+    slot.words = 0;
+    switch (slot.op) {
+    case control::GimbalSpeed:
+        slot.result = device.aiSetGimbalSpeedCtrlR(control::floatOf(args[0]), control::floatOf(args[1]));
+        break;
+    case control::GimbalAngle:
+        slot.result = device.aiSetGimbalMotorAngleR(control::floatOf(args[0]), control::floatOf(args[1]));
+        break;
+    case control::GimbalStop:
+        slot.result = device.aiSetGimbalStop();
+        break;
+    case control::GimbalReset:
+        slot.result = device.gimbalRstPosR();
+        break;
+    case control::GimbalAttitude: {
+        float xyz[3] = {};
+        slot.result = device.gimbalGetAttitudeInfoR(xyz);
+        for (float value : xyz) {
+            slot.reply[slot.words++] = control::wordOf(value);
+        }
+        break;
+    }
+    case control::ZoomSet:
+        slot.result = handle.settings().setZoom(control::floatOf(args[0]));
+        break;
+    case control::ZoomGet: {
+        float zoom = 0.f;
+        slot.result = device.cameraGetZoomAbsoluteR(zoom);
+        slot.reply[slot.words++] = control::wordOf(zoom);
+        break;
+    }
+    case control::PresetRecall:
+        slot.result = handle.presets().recall(static_cast<int32_t>(args[0]));
+        break;
+    case control::PresetList:
+        slot.result = handle.presets().presets(slot.presets) ? RM_RET_OK : RM_RET_ERR;
+        for (auto& preset : slot.presets) {
+            if (slot.words == control::kMaxResponseWords) {
+                break;
+            }
+            slot.reply[slot.words++] = static_cast<uint32_t>(preset.id);
+        }
+        break;
+    case control::SettingSet:
+    case control::SettingGet: {
+        if (args[0] >= SettingsSnapshot::SettingCount) {
+            slot.result = RM_RET_ERR;
+            break;
+        }
+        auto which = static_cast<SettingsSnapshot::Setting>(args[0]);
+        SettingsSnapshot::Value value;
+        if (slot.op == control::SettingSet) {
+            value = {static_cast<int32_t>(args[1]), static_cast<int32_t>(args[2])};
+            slot.result = handle.settings().set(which, value);
+            break;
+        }
+        slot.result = handle.settings().known(which, value) ? RM_RET_OK
+                                                            : SettingsSnapshotter::read(device, which, value);
+        slot.reply[slot.words++] = static_cast<uint32_t>(value.a);
+        slot.reply[slot.words++] = static_cast<uint32_t>(value.b);
+        break;
+    }
+    default:
+        slot.result = RM_RET_ERR;
+        break;
+    }
+}
+
+void ControlServer::complete(Slot* slot) {
+    bool wake;
+    {
+        std::lock_guard<std::mutex> lock(done_mutex_);
+        slot->next = nullptr;
+        wake = done_head_ == nullptr;
+        if (wake) {
+            done_head_ = slot;
+        } else {
+            done_tail_->next = slot;
+        }
+        done_tail_ = slot;
+    }
+    // One wakeup per burst of completions
+    if (wake) {
+        done_cond_.notify_all();
+        done_event_.signal();
+    }
+}
+
+void ControlServer::onDone() {
+    done_event_.drain();
+    Slot* slot;
+    {
+        std::lock_guard<std::mutex> lock(done_mutex_);
+        slot = done_head_;
+        done_head_ = done_tail_ = nullptr;
+    }
+    while (slot) {
+        Slot* next = slot->next;
+        Connection* conn = slot->conn;
+        if (!conn->closed) {
+            respond(conn, slot->id, slot->result, slot->reply, slot->words);
+        }
+        slot->next = conn->free;
+        conn->free = slot;
+        --conn->in_flight;
+        --outstanding_;
+        if (!conn->woken) {
+            conn->woken = true;
+            woken_.push_back(conn);
+        }
+        slot = next;
+    }
+
+    for (Connection* conn : woken_) {
+        conn->woken = false;
+        if (!conn->closed) {
+            // Freed slots may let buffered requests through
+            process(conn);
+        }
+        reap(conn);
+    }
+    woken_.clear();
+}
+
+void ControlServer::respond(Connection* conn, uint32_t id, int32_t result, const uint32_t* words, size_t count) {
+    count = std::min(count, control::kMaxResponseWords);
+    size_t size = control::kResponseHeaderSize + count * 4;
+    if (conn->out_len + size > conn->out.size()) {
+        return; // cannot happen: canAccept() reserved the space
+    }
+    uint8_t* p = conn->out.data() + conn->out_len;
+    control::store32(p, static_cast<uint32_t>(size - 4));
+    control::store32(p + 4, id);
+    control::store32(p + 8, static_cast<uint32_t>(result));
+    for (size_t i = 0; i < count; ++i) {
+        control::store32(p + control::kResponseHeaderSize + i * 4, words[i]);
+    }
+    conn->out_len += size;
+}
+
+bool ControlServer::flush(Connection* conn) {
+    size_t sent = 0;
+    while (sent < conn->out_len) {
+        ssize_t n = ::send(conn->fd, conn->out.data() + sent, conn->out_len - sent, MSG_NOSIGNAL | MSG_DONTWAIT);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                break;
+            }
+            closeConnection(conn);
+            return false;
+        }
+        sent += static_cast<size_t>(n);
+    }
+    if (sent > 0) {
+        std::memmove(conn->out.data(), conn->out.data() + sent, conn->out_len - sent);
+        conn->out_len -= sent;
+    }
+    return true;
+}
+
+void ControlServer::updateEvents(Connection* conn) {
+    uint32_t events = (canAccept(conn) ? EPOLLIN : 0u) | (conn->out_len > 0 ? EPOLLOUT : 0u);
+    if (events != conn->events) {
+        reactor_.modify(conn->fd, events);
+        conn->events = events;
+    }
+}
+
+void ControlServer::closeConnection(Connection* conn) {
+    if (conn->closed) {
+        return;
+    }
+    reactor_.remove(conn->fd);
+    ::close(conn->fd);
+    conn->fd = -1;
+    conn->closed = true;
+    conn->out_len = 0;
+    conn->in_len = 0;
+}
+
+void ControlServer::reap(Connection* conn) {
+    // Slots still on a strand point into the connection
+    if (!conn->closed || conn->in_flight > 0 || conn->woken) {
+        return;
+    }
+    for (auto it = connections_.begin(); it != connections_.end(); ++it) {
+        if (it->get() == conn) {
+            connections_.erase(it);
+            connection_count_.fetch_sub(1, std::memory_order_relaxed);
+            return;
+        }
+    }
+}
@@ -0,0 +1,143 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "control_protocol.hpp"
+#include "fleet_manager.hpp"
+#include "reactor.hpp"
+
+// Serves the control protocol (control_protocol.hpp) on an AF_UNIX stream
+// socket, so that other processes can drive the fleet.
+//
+// Sockets are handled on the reactor thread. Commands run on their camera's
+// strand, so a slow camera holds up neither the others nor the socket loop.
+// Each camera has two lanes: SettingSet and SettingGet go to one, which is
+// posted at Settings priority, everything else to the other, at Motion
+// priority. Requests parsed from one read go to each lane as one batch.
+// GimbalStop is posted on its own at Stop priority, so it overtakes the
+// queued work of its camera, and a running batch yields to it.
+// Gimbal speeds are coalesced per camera, latest wins: a GimbalSpeed with a
+// newer one queued behind it is not sent, so a joystick that outpaces the
+// camera does not build up a backlog of stale speeds. With a speed rate set,
+// each camera also gets at most that many speeds per second; a speed waits
+// for its turn on the camera's strand, and a newer one or a GimbalStop
+// arriving meanwhile replaces it.
+//
+// Each connection owns `max_in_flight` request slots and buffers sized for
+// them. Parsing, queueing, running a command and writing its response all
+// use those, so nothing is allocated per command. While every slot of a
+// connection is in flight, the server stops reading from it.
+class ControlServer {
+public:
+    ControlServer(Reactor& reactor, FleetManager& fleet, size_t max_in_flight = 256);
+    ~ControlServer();
+
+    ControlServer(const ControlServer&) = delete;
+    ControlServer& operator=(const ControlServer&) = delete;
+
+    // GimbalSpeed commands sent per camera and second at most; 0, the
+    // default, sends each speed as soon as the camera takes it. Set before
+    // listen().
+    void setSpeedRate(double rate_hz);
+
+    // Reactor thread. A stale socket file at `path` is replaced; one that a
+    // running server still accepts on is not, and listen() fails with
+    // errno EADDRINUSE.
+    bool listen(const std::string& path);
+
+    // Reactor thread. Drops every connection and waits for their commands
+    // to finish; the fleet must still be running.
+    void close();
+
+    size_t connections() const { return connection_count_.load(std::memory_order_relaxed); }
+    uint64_t requests() const { return requests_.load(std::memory_order_relaxed); }
+    uint64_t batches() const { return batches_.load(std::memory_order_relaxed); } // strand tasks posted
+    uint64_t superseded() const { return superseded_.load(std::memory_order_relaxed); } // GimbalSpeed not sent
+
+private:
+    struct Slot;
+    struct Connection;
+
+    // Commands of one priority for one camera, in arrival order
+    struct Lane {
+        std::string sn;
+        CommandScheduler::Priority priority = CommandScheduler::Motion;
+
+        std::mutex mutex;
+        Slot* head = nullptr;
+        Slot* tail = nullptr;
+        bool scheduled = false; // a task for this lane is queued on the strand
+        std::atomic<uint32_t> stops{0}; // GimbalStop requests so far
+        std::condition_variable stopped; // a GimbalStop came in
+        std::shared_ptr<CameraHandle> handle;
+        std::chrono::steady_clock::time_point next_speed; // strand side
+
+        // Reactor thread only: slots parsed from the current read
+        Slot* staged_head = nullptr;
+        Slot* staged_tail = nullptr;
+    };
+
+    void onAccept();
+    void onConnection(Connection* conn, uint32_t events);
+    void onDone();
+
+    // Parses buffered requests as far as slots and output space allow
+    void process(Connection* conn);
+    void handleRequest(Connection* conn, const uint8_t* frame, size_t size);
+    void listCameras(Connection* conn, uint32_t id);
+    void dispatch();
+    bool flush(Connection* conn);
+    void updateEvents(Connection* conn);
+    void closeConnection(Connection* conn);
+    void reap(Connection* conn);
+    bool canAccept(const Connection* conn) const;
+
+    void respond(Connection* conn, uint32_t id, int32_t result, const uint32_t* words = nullptr, size_t count = 0);
+    void stop(Lane& lane, Slot* slot);
+    void fail(Slot* slots, int32_t result);
+
+    // Strand side
+    void runLane(Lane* lane, Device& device);
+    bool superseded(Lane& lane, const Slot& slot);
+    bool holdSpeed(Lane& lane, Slot& slot);
+    void execute(CameraHandle& handle, Device& device, Slot& slot);
+    void complete(Slot* slot);
+
+    Reactor& reactor_;
+    FleetManager& fleet_;
+    size_t max_in_flight_;
+    std::chrono::steady_clock::duration speed_period_;
+    std::string path_;
+    int listen_fd_;
+
+    // Reactor thread only
+    std::vector<std::unique_ptr<Connection>> connections_;
+    // Motion lane of camera id at 2 * (id - 1), its Settings lane after it;
+    // never shrinks
+    std::deque<Lane> lanes_;
+    std::map<std::string, uint16_t> camera_ids_;
+    std::vector<Lane*> touched_;
+    std::vector<Connection*> woken_;
+    size_t outstanding_; // slots handed to lanes and not yet answered
+
+    EventFd done_event_;
+    std::mutex done_mutex_;
+    std::condition_variable done_cond_;
+    Slot* done_head_;
+    Slot* done_tail_;
+
+    std::atomic<size_t> connection_count_{0};
+    std::atomic<uint64_t> requests_{0};
+    std::atomic<uint64_t> batches_{0};
+    std::atomic<uint64_t> superseded_{0};
+};
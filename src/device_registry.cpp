@@ -0,0 +1,240 @@
+#include "device_registry.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+
+bool readAll(int fd, void* data, size_t bytes) {
+    auto* p = static_cast<uint8_t*>(data);
+    while (bytes > 0) {
+        ssize_t n = ::read(fd, p, bytes);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            return false;
+        }
+        p += n;
+        bytes -= static_cast<size_t>(n);
+    }
+    return true;
+}
+
+bool writeAll(int fd, const void* data, size_t bytes) {
+    const auto* p = static_cast<const uint8_t*>(data);
+    while (bytes > 0) {
+        ssize_t n = ::write(fd, p, bytes);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+        p += n;
+        bytes -= static_cast<size_t>(n);
+    }
+    return true;
+}
+
+void copyField(char (&field)[kCapsKeyLength], const std::string& value) {
+    std::memcpy(field, value.data(), std::min(value.size(), kCapsKeyLength - 1));
+}
+
+std::string fieldOf(const char (&field)[kCapsKeyLength]) {
+    return std::string(field, strnlen(field, kCapsKeyLength));
+}
+
+} // namespace
+
+DeviceRecord DeviceRecord::identify(Device& device) {
+    DeviceRecord record;
+    record.sn = device.devSn();
+    record.name = device.devName();
+    record.model_code = device.devModelCode();
+    record.version = device.devVersion();
+    record.uuid = device.uuid();
+    record.product = device.productType();
+    return record;
+}
+
+bool DeviceRecord::sameIdentity(const DeviceRecord& other) const {
+    return sn == other.sn && model_code == other.model_code && version == other.version && uuid == other.uuid &&
+           product == other.product;
+}
+
+bool DeviceRegistry::open(const std::string& path) {
+    close();
+    path_ = path;
+
+    int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return errno == ENOENT;
+    }
+    RegistryFileHeader header;
+    struct stat st;
+    if (::fstat(fd, &st) != 0) {
+        ::close(fd);
+        return false;
+    }
+    size_t bytes = static_cast<size_t>(st.st_size);
+    if (bytes < sizeof(header) || !readAll(fd, &header, sizeof(header)) ||
+        std::memcmp(header.magic, kRegistryMagic, sizeof(kRegistryMagic)) != 0 ||
+        header.version != kRegistryVersion || header.entry_size != sizeof(RegistryEntry) ||
+        header.entries > (bytes - sizeof(header)) / sizeof(RegistryEntry)) {
+        ::close(fd);
+        return true;
+    }
+
+    std::vector<RegistryEntry> entries(static_cast<size_t>(header.entries));
+    bool ok = readAll(fd, entries.data(), entries.size() * sizeof(RegistryEntry));
+    ::close(fd);
+    if (!ok) {
+        return false;
+    }
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (auto& entry : entries) {
+        entries_[fieldOf(entry.sn)] = entry;
+    }
+    return true;
+}
+
+void DeviceRegistry::close() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    entries_.clear();
+    dirty_ = false;
+}
+
+bool DeviceRegistry::lookup(const std::string& sn, DeviceRecord& out) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = entries_.find(sn);
+    if (it == entries_.end()) {
+        return false;
+    }
+    decode(it->second, out);
+    return true;
+}
+
+bool DeviceRegistry::recognize(Device& device, DeviceRecord& out) const {
+    DeviceRecord current = DeviceRecord::identify(device);
+    return lookup(current.sn, out) && out.sameIdentity(current);
+}
+
+void DeviceRegistry::remember(const DeviceRecord& record) {
+    if (!fits(record)) {
+        return;
+    }
+    RegistryEntry entry;
+    encode(record, entry);
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = entries_.find(record.sn);
+    if (it != entries_.end() && std::memcmp(&it->second, &entry, sizeof(entry)) == 0) {
+        return;
+    }
+    entries_[record.sn] = entry;
+    dirty_ = true;
+}
+
+bool DeviceRegistry::forget(const std::string& sn) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (entries_.erase(sn) == 0) {
+        return false;
+    }
+    dirty_ = true;
+    return true;
+}
+
+bool DeviceRegistry::save() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!dirty_ || path_.empty()) {
+        return true;
+    }
+
+    RegistryFileHeader header;
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.magic, kRegistryMagic, sizeof(kRegistryMagic));
+    header.version = kRegistryVersion;
+    header.entry_size = sizeof(RegistryEntry);
+    header.entries = entries_.size();
+
+    std::string temp = path_ + ".tmp";
+    int fd = ::open(temp.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        return false;
+    }
+    bool ok = writeAll(fd, &header, sizeof(header));
+    for (auto it = entries_.begin(); ok && it != entries_.end(); ++it) {
+        ok = writeAll(fd, &it->second, sizeof(RegistryEntry));
+    }
+    ok = ok && ::fsync(fd) == 0;
+    ok = ::close(fd) == 0 && ok;
+    if (!ok || ::rename(temp.c_str(), path_.c_str()) != 0) {
+        ::unlink(temp.c_str());
+        return false;
+    }
+    dirty_ = false;
+    return true;
+}
+
+size_t DeviceRegistry::size() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return entries_.size();
+}
+
+bool DeviceRegistry::dirty() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return dirty_;
+}
+
+std::vector<std::string> DeviceRegistry::serials() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::vector<std::string> result;
+    result.reserve(entries_.size());
+    for (auto& entry : entries_) {
+        result.push_back(entry.first);
+    }
+    return result;
+}
+
+bool DeviceRegistry::fits(const DeviceRecord& record) {
+    // Longer names are truncated; the key fields must round-trip
+    return !record.sn.empty() && record.sn.size() < kCapsKeyLength && record.model_code.size() < kCapsKeyLength &&
+           record.version.size() < kCapsKeyLength;
+}
+
+void DeviceRegistry::encode(const DeviceRecord& record, RegistryEntry& entry) {
+    std::memset(&entry, 0, sizeof(entry));
+    copyField(entry.sn, record.sn);
+    copyField(entry.name, record.name);
+    copyField(entry.model_code, record.model_code);
+    copyField(entry.version, record.version);
+    std::memcpy(entry.uuid, record.uuid.data(), DEV_UUID_SIZE);
+    entry.product = static_cast<int32_t>(record.product);
+    entry.format_count = static_cast<uint32_t>(std::min(record.formats.size(), kCapsMaxFormats));
+    for (size_t i = 0; i < entry.format_count; ++i) {
+        const auto& format = record.formats[i];
+        entry.formats[i] = {format.width_, format.height_, format.fps_min_, format.fps_max_,
+                            static_cast<int32_t>(format.format_)};
+    }
+}
+
+void DeviceRegistry::decode(const RegistryEntry& entry, DeviceRecord& record) {
+    record.sn = fieldOf(entry.sn);
+    record.name = fieldOf(entry.name);
+    record.model_code = fieldOf(entry.model_code);
+    record.version = fieldOf(entry.version);
+    std::memcpy(record.uuid.data(), entry.uuid, DEV_UUID_SIZE);
+    record.product = static_cast<ObsbotProductType>(entry.product);
+    size_t formats = std::min<size_t>(entry.format_count, kCapsMaxFormats);
+    record.formats.clear();
+    record.formats.reserve(formats);
+    for (size_t i = 0; i < formats; ++i) {
+        const auto& format = entry.formats[i];
+        record.formats.emplace_back(format.width, format.height, format.fps_min, format.fps_max,
+                                    static_cast<RmVideoFormat>(format.format));
+    }
+}
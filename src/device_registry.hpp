@@ -0,0 +1,106 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <dev/dev.hpp>
+
+#include "capability_cache.hpp"
+
+// Identity of one camera as of the last time it was connected
+struct DeviceRecord {
+    std::string sn;
+    std::string name;
+    std::string model_code;
+    std::string version;
+    Device::DevUuid uuid{};
+    ObsbotProductType product = ObsbotProdTailAir;
+    std::vector<Device::VideoFormatInfo> formats;
+
+    // Fills everything but the formats from accessors that answer without
+    // a round trip to the camera
+    static DeviceRecord identify(Device& device);
+
+    // Same camera, firmware and product; formats are not compared
+    bool sameIdentity(const DeviceRecord& other) const;
+};
+
+// On-disk format of the device registry: a RegistryFileHeader followed by
+// `entries` fixed-size RegistryEntry records, one per serial number. Like
+// the capability cache, the file is replaced as a whole on save.
+
+constexpr char kRegistryMagic[8] = {'O', 'B', 'S', 'D', 'E', 'V', 'S', '\0'};
+constexpr uint32_t kRegistryVersion = 1;
+
+struct RegistryFileHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t entry_size;
+    uint64_t entries;
+    uint8_t reserved[40];
+};
+
+struct RegistryEntry {
+    char sn[kCapsKeyLength];
+    char name[kCapsKeyLength];
+    char model_code[kCapsKeyLength];
+    char version[kCapsKeyLength];
+    uint8_t uuid[DEV_UUID_SIZE];
+    int32_t product; // ObsbotProductType
+    uint32_t format_count;
+    CapsFormat formats[kCapsMaxFormats];
+};
+
+static_assert(sizeof(RegistryFileHeader) == 64, "device registry header layout changed");
+static_assert(sizeof(RegistryEntry) == 800, "device registry entry layout changed");
+
+// Every camera seen before, by serial number, persisted in one file.
+//
+// A camera found here can be commanded the moment the SDK reports it: its
+// product, firmware and video formats are already known, and are refreshed
+// in the background rather than queried first. The registry is small, so
+// open() reads it into memory once.
+class DeviceRegistry {
+public:
+    DeviceRegistry() = default;
+
+    DeviceRegistry(const DeviceRegistry&) = delete;
+    DeviceRegistry& operator=(const DeviceRegistry&) = delete;
+
+    // A missing, truncated or foreign file is treated as empty. Returns false
+    // only when `path` exists but cannot be read.
+    bool open(const std::string& path);
+    void close();
+
+    bool lookup(const std::string& sn, DeviceRecord& out) const;
+
+    // Known camera with the same identity as `device` reports now, i.e. the
+    // stored formats still apply
+    bool recognize(Device& device, DeviceRecord& out) const;
+
+    // Adds or replaces the record of `record.sn`; an unchanged record does
+    // not make the registry dirty
+    void remember(const DeviceRecord& record);
+    bool forget(const std::string& sn);
+
+    // Writes the registry if anything changed since open()
+    bool save();
+
+    size_t size() const;
+    bool dirty() const;
+    std::vector<std::string> serials() const;
+
+private:
+    static bool fits(const DeviceRecord& record);
+    static void encode(const DeviceRecord& record, RegistryEntry& entry);
+    static void decode(const RegistryEntry& entry, DeviceRecord& record);
+
+    std::string path_;
+
+    mutable std::mutex mutex_;
+    std::map<std::string, RegistryEntry> entries_;
+    bool dirty_ = false;
+};
@@ -0,0 +1,185 @@
+#include "fleet_manager.hpp"
+
+#include <algorithm>
+
+CameraHandle::CameraHandle(std::shared_ptr<Device> device, std::string sn, ThreadPool& pool, StatusPump& pump)
+    : device_(std::move(device)),
+      sn_(std::move(sn)),
+      scheduler_(std::make_shared<CommandScheduler>(pool)),
+      pump_(pump),
+      status_source_(pump.addSource(sn_)),
+      presets_(device_),
+      settings_(device_) {
+}
+
+CameraHandle::~CameraHandle() {
+    // Last reference is dropped after detach and after any queued command,
+    // so the SDK no longer pushes into the source. That may happen in a pump
+    // sink, which is why the pump frees the source itself.
+    pump_.removeSource(status_source_);
+}
+
+bool CameraHandle::post(Command command, CommandScheduler::Priority priority) {
+    std::shared_ptr<Device> device = device_;
+    return scheduler_->post([device, command = std::move(command)] { command(*device); }, priority);
+}
+
+void CameraHandle::enableStatus(bool enabled) {
+    if (enabled) {
+        device_->setDevStatusCallbackFunc(StatusPump::onDeviceStatus, status_source_);
+        device_->enableDevStatusCallback(true);
+    } else {
+        device_->enableDevStatusCallback(false);
+    }
+}
+
+FleetManager::FleetManager(StatusPump& pump, size_t min_threads)
+    : pump_(pump), min_threads_(std::max<size_t>(min_threads, 1)), pool_(min_threads_), started_(false) {
+    pump_.addSink([this](const StatusSource& source, const StatusSample& sample) {
+        if (auto handle = camera(source.sn())) {
+            handle->presets().onStatus(sample.status);
+            handle->settings().onStatus(sample.status);
+        }
+    });
+}
+
+FleetManager::~FleetManager() {
+    stop();
+    pool_.shutdown();
+}
+
+void FleetManager::setListener(Listener listener) {
+    listener_ = std::move(listener);
+}
+
+void FleetManager::setEventListener(EventListener listener) {
+    event_listener_ = std::move(listener);
+}
+
+void FleetManager::start() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (started_) {
+            return;
+        }
+        started_ = true;
+    }
+
+    auto& devices = Devices::get();
+    devices.setDevChangedCallback(onDevChanged, this);
+
+    // Devices enumerated before the callback was installed
+    for (auto& device : devices.getDevList()) {
+        if (device) {
+            attach(device->devSn(), device);
+        }
+    }
+}
+
+void FleetManager::stop() {
+    std::map<std::string, std::shared_ptr<CameraHandle>> cameras;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!started_) {
+            return;
+        }
+        started_ = false;
+        cameras.swap(cameras_);
+    }
+    attached_.notify_all();
+    Devices::get().setDevChangedCallback(nullptr, nullptr);
+    for (auto& entry : cameras) {
+        entry.second->enableStatus(false);
+        entry.second->device()->setDevEventNotifyCallbackFunc(nullptr, nullptr);
+    }
+}
+
+std::shared_ptr<CameraHandle> FleetManager::camera(const std::string& sn) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = cameras_.find(sn);
+    return it == cameras_.end() ? nullptr : it->second;
+}
+
+std::vector<std::shared_ptr<CameraHandle>> FleetManager::cameras() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::vector<std::shared_ptr<CameraHandle>> result;
+    result.reserve(cameras_.size());
+    for (auto& entry : cameras_) {
+        result.push_back(entry.second);
+    }
+    return result;
+}
+
+size_t FleetManager::size() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return cameras_.size();
+}
+
+bool FleetManager::waitFor(size_t count, std::chrono::milliseconds timeout) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    attached_.wait_for(lock, timeout, [&] { return !started_ || cameras_.size() >= count; });
+    return started_ && cameras_.size() >= count;
+}
+
+bool FleetManager::post(const std::string& sn, CameraHandle::Command command, CommandScheduler::Priority priority) {
+    auto handle = camera(sn);
+    return handle && handle->post(std::move(command), priority);
+}
+
+void FleetManager::onDevChanged(std::string dev_sn, bool connected, void* param) {
+    auto* fleet = static_cast<FleetManager*>(param);
+    if (connected) {
+        fleet->attach(dev_sn, Devices::get().getDevBySn(dev_sn));
+    } else {
+        fleet->detach(dev_sn);
+    }
+}
+
+void FleetManager::attach(const std::string& sn, std::shared_ptr<Device> device) {
+    if (!device) {
+        return;
+    }
+
+    // Built outside mutex_: the constructor takes the pump's source lock,
+    // which the pump holds while its sinks look cameras up here
+    auto handle = std::make_shared<CameraHandle>(std::move(device), sn, pool_, pump_);
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!started_ || cameras_.count(sn)) {
+            return;
+        }
+        cameras_[sn] = handle;
+        // One worker per camera so a blocked strand never starves another
+        pool_.ensureThreads(std::max(min_threads_, cameras_.size() + 1));
+    }
+    handle->enableStatus(true);
+    if (event_listener_) {
+        handle->device()->setDevEventNotifyCallbackFunc(
+            [this, sn](void*, int32_t event_type, const void* result) { event_listener_(sn, event_type, result); },
+            nullptr);
+    }
+    attached_.notify_all();
+
+    if (listener_) {
+        listener_(handle, true);
+    }
+}
+
+void FleetManager::detach(const std::string& sn) {
+    std::shared_ptr<CameraHandle> handle;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = cameras_.find(sn);
+        if (it == cameras_.end()) {
+            return;
+        }
+        handle = std::move(it->second);
+        cameras_.erase(it);
+    }
+    handle->enableStatus(false);
+    handle->device()->setDevEventNotifyCallbackFunc(nullptr, nullptr);
+
+    if (listener_) {
+        listener_(handle, false);
+    }
+}
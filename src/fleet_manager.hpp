@@ -0,0 +1,120 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <dev/devs.hpp>
+
+#include "command_scheduler.hpp"
+#include "preset_cache.hpp"
+#include "settings_shadow.hpp"
+#include "status_pump.hpp"
+#include "thread_pool.hpp"
+
+// One connected camera: the SDK device plus its command scheduler. Commands
+// posted here run one at a time on the fleet's shared pool, the most urgent
+// class first and in order within a class.
+class CameraHandle {
+public:
+    using Command = std::function<void(Device& device)>;
+
+    CameraHandle(std::shared_ptr<Device> device, std::string sn, ThreadPool& pool, StatusPump& pump);
+    ~CameraHandle();
+
+    CameraHandle(const CameraHandle&) = delete;
+    CameraHandle& operator=(const CameraHandle&) = delete;
+
+    const std::string& sn() const { return sn_; }
+    const std::shared_ptr<Device>& device() const { return device_; }
+    const StatusSource* statusSource() const { return status_source_; }
+    // Kept current from this camera's status pushes
+    PresetCache& presets() { return presets_; }
+    SettingsShadow& settings() { return settings_; }
+
+    // Queue a command on this camera's scheduler
+    bool post(Command command, CommandScheduler::Priority priority = CommandScheduler::Settings);
+    size_t pending() const { return scheduler_->pending(); }
+    // A stop is waiting; commands that run many SDK calls should yield
+    bool urgent() const { return scheduler_->urgent(); }
+    CommandScheduler& scheduler() { return *scheduler_; }
+
+private:
+    friend class FleetManager;
+
+    void enableStatus(bool enabled);
+
+    std::shared_ptr<Device> device_;
+    std::string sn_;
+    std::shared_ptr<CommandScheduler> scheduler_;
+    StatusPump& pump_;
+    StatusSource* status_source_;
+    PresetCache presets_;
+    SettingsShadow settings_;
+};
+
+// Tracks every connected camera through Devices::getDevList() and the
+// hot-plug callback. A blocking SDK call on one camera's strand occupies a
+// single pool worker, and the pool always has at least one worker per
+// camera, so it cannot delay commands to the others.
+class FleetManager {
+public:
+    // Called on the SDK hot-plug thread after the fleet has been updated
+    using Listener = std::function<void(const std::shared_ptr<CameraHandle>& camera, bool connected)>;
+    // Called on an SDK thread for each DevEventNotifyCallback of an attached
+    // camera; `result` depends on `event_type` (Device::RmEventType) and is
+    // only valid during the call
+    using EventListener = std::function<void(const std::string& sn, int32_t event_type, const void* result)>;
+
+    // Registers a status sink on `pump`, so construct before pump.start()
+    explicit FleetManager(StatusPump& pump, size_t min_threads = 4);
+    ~FleetManager();
+
+    FleetManager(const FleetManager&) = delete;
+    FleetManager& operator=(const FleetManager&) = delete;
+
+    // Register before start()
+    void setListener(Listener listener);
+    void setEventListener(EventListener listener);
+
+    // Take ownership of the SDK hot-plug callback and adopt the devices that
+    // are already enumerated
+    void start();
+    void stop();
+
+    std::shared_ptr<CameraHandle> camera(const std::string& sn) const;
+    std::vector<std::shared_ptr<CameraHandle>> cameras() const;
+    size_t size() const;
+
+    // Blocks until at least `count` cameras are attached, woken by the
+    // hot-plug callback itself. Returns false on timeout, or when the fleet
+    // is not started.
+    bool waitFor(size_t count, std::chrono::milliseconds timeout);
+
+    bool post(const std::string& sn, CameraHandle::Command command,
+              CommandScheduler::Priority priority = CommandScheduler::Settings);
+
+    ThreadPool& pool() { return pool_; }
+
+private:
+    static void onDevChanged(std::string dev_sn, bool connected, void* param);
+
+    void attach(const std::string& sn, std::shared_ptr<Device> device);
+    void detach(const std::string& sn);
+
+    StatusPump& pump_;
+    size_t min_threads_;
+    ThreadPool pool_;
+    Listener listener_;
+    EventListener event_listener_;
+
+    mutable std::mutex mutex_;
+    std::condition_variable attached_;
+    std::map<std::string, std::shared_ptr<CameraHandle>> cameras_;
+    bool started_;
+};
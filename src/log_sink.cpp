@@ -0,0 +1,527 @@
+#include "log_sink.hpp"
+
+#include <algorithm>
+#include <cinttypes>
+#include <cstddef>
+#include <cstring>
+#include <ctime>
+#include <sys/epoll.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+namespace {
+
+// One printf conversion, split so it can be replayed with a different
+// length modifier
+struct Spec {
+    const char* begin;      // the '%'
+    const char* body_end;   // end of flags, width and precision
+    const char* end;        // one past the conversion character
+    char conversion;
+    enum Length { None, Char, Short, Long, LongLong, IntMax, Size, PtrDiff, LongDouble } length;
+    bool star_width;
+    bool star_precision;
+};
+
+// Finds the next conversion at or after `p`, skipping "%%". Returns false
+// when the format has no more.
+bool nextSpec(const char*& p, Spec& spec) {
+    for (;;) {
+        p = std::strchr(p, '%');
+        if (!p) {
+            return false;
+        }
+        if (p[1] == '%') {
+            p += 2;
+            continue;
+        }
+        spec.begin = p++;
+        spec.star_width = spec.star_precision = false;
+        while (*p && std::strchr("-+ #0'", *p)) {
+            ++p;
+        }
+        if (*p == '*') {
+            spec.star_width = true;
+            ++p;
+        }
+        while (*p >= '0' && *p <= '9') {
+            ++p;
+        }
+        if (*p == '.') {
+            ++p;
+            if (*p == '*') {
+                spec.star_precision = true;
+                ++p;
+            }
+            while (*p >= '0' && *p <= '9') {
+                ++p;
+            }
+        }
+        spec.body_end = p;
+        spec.length = Spec::None;
+        switch (*p) {
+        case 'h':
+            spec.length = p[1] == 'h' ? Spec::Char : Spec::Short;
+            p += p[1] == 'h' ? 2 : 1;
+            break;
+        case 'l':
+            spec.length = p[1] == 'l' ? Spec::LongLong : Spec::Long;
+            p += p[1] == 'l' ? 2 : 1;
+            break;
+        case 'j':
+            spec.length = Spec::IntMax;
+            ++p;
+            break;
+        case 'z':
+            spec.length = Spec::Size;
+            ++p;
+            break;
+        case 't':
+            spec.length = Spec::PtrDiff;
+            ++p;
+            break;
+        case 'L':
+            spec.length = Spec::LongDouble;
+            ++p;
+            break;
+        }
+        spec.conversion = *p;
+        if (*p) {
+            ++p;
+        }
+        spec.end = p;
+        return true;
+    }
+}
+
+int64_t readSigned(Spec::Length length, va_list& args) {
+    switch (length) {
+    case Spec::Char:
+        return static_cast<signed char>(va_arg(args, int));
+    case Spec::Short:
+        return static_cast<short>(va_arg(args, int));
+    case Spec::Long:
+        return va_arg(args, long);
+    case Spec::LongLong:
+        return va_arg(args, long long);
+    case Spec::IntMax:
+        return va_arg(args, intmax_t);
+    case Spec::Size:
+        return static_cast<int64_t>(va_arg(args, size_t));
+    case Spec::PtrDiff:
+        return va_arg(args, ptrdiff_t);
+    default:
+        return va_arg(args, int);
+    }
+}
+
+uint64_t readUnsigned(Spec::Length length, va_list& args) {
+    switch (length) {
+    case Spec::Char:
+        return static_cast<unsigned char>(va_arg(args, unsigned int));
+    case Spec::Short:
+        return static_cast<unsigned short>(va_arg(args, unsigned int));
+    case Spec::Long:
+        return va_arg(args, unsigned long);
+    case Spec::LongLong:
+        return va_arg(args, unsigned long long);
+    case Spec::IntMax:
+        return va_arg(args, uintmax_t);
+    case Spec::Size:
+        return va_arg(args, size_t);
+    case Spec::PtrDiff:
+        return static_cast<uint64_t>(va_arg(args, ptrdiff_t));
+    default:
+        return va_arg(args, unsigned int);
+    }
+}
+
+uint32_t currentThread() {
+    thread_local uint32_t tid = static_cast<uint32_t>(::syscall(SYS_gettid));
+    return tid;
+}
+
+uint64_t wallClockNs() {
+    timespec ts;
+    ::clock_gettime(CLOCK_REALTIME, &ts);
+    return static_cast<uint64_t>(ts.tv_sec) * 1000000000ull + static_cast<uint64_t>(ts.tv_nsec);
+}
+
+char levelLetter(int32_t level) {
+    return level <= DEV_ERROR ? 'E' : level <= DEV_WARN ? 'W' : level <= DEV_INFO ? 'I' : 'D';
+}
+
+} // namespace
+
+SdkLogSink::SdkLogSink()
+    : level_(DEV_INFO), queue_(new LogQueue<kQueueCapacity>()) {
+    // Errors always get through; the chattier levels are capped
+    setRateLimit(DEV_WARN, 200);
+    setRateLimit(DEV_INFO, 500);
+    setRateLimit(DEV_DEBUG, 5000);
+    line_.reserve(1024);
+}
+
+SdkLogSink::~SdkLogSink() {
+    stop();
+}
+
+size_t SdkLogSink::levelIndex(int32_t level) {
+    return static_cast<size_t>(std::min<int32_t>(std::max<int32_t>(level / 100, 1), kLevels) - 1);
+}
+
+void SdkLogSink::setRateLimit(int32_t level, uint32_t per_second) {
+    limits_[levelIndex(level)].per_second.store(per_second, std::memory_order_relaxed);
+}
+
+uint64_t SdkLogSink::droppedRate() const {
+    uint64_t total = 0;
+    for (auto& limit : limits_) {
+        total += limit.dropped.load(std::memory_order_relaxed);
+    }
+    return total;
+}
+
+bool SdkLogSink::start(const std::string& path) {
+    if (thread_.joinable()) {
+        return true;
+    }
+    if (!reactor_.valid() || !ready_.valid()) {
+        return false;
+    }
+    if (path.empty() || path == "-") {
+        out_ = stderr;
+        owns_out_ = false;
+    } else {
+        out_ = std::fopen(path.c_str(), "a");
+        if (!out_) {
+            return false;
+        }
+        owns_out_ = true;
+        std::setvbuf(out_, nullptr, _IOFBF, 64 * 1024);
+    }
+    reactor_.add(ready_.fd(), EPOLLIN, [this](uint32_t) { ready_.drain(); });
+    thread_ = std::thread(&SdkLogSink::run, this);
+
+    dev_get_log_handler(&previous_handler_, &previous_param_);
+    dev_set_log_handler(&SdkLogSink::handler, this);
+    return true;
+}
+
+void SdkLogSink::stop() {
+    if (!thread_.joinable()) {
+        return;
+    }
+    dev_set_log_handler(previous_handler_, previous_param_);
+    reactor_.stop();
+    thread_.join();
+    if (owns_out_) {
+        std::fclose(out_);
+    } else {
+        std::fflush(out_);
+    }
+    out_ = nullptr;
+}
+
+void SdkLogSink::handler(int32_t lvl, const char* msg, va_list args, void* p) {
+    auto* sink = static_cast<SdkLogSink*>(p);
+    if (!sink || !msg || lvl > sink->level_.load(std::memory_order_relaxed)) {
+        return;
+    }
+    uint64_t now_ns = wallClockNs();
+    if (!sink->admit(lvl, now_ns)) {
+        return;
+    }
+    va_list copy;
+    va_copy(copy, args);
+    sink->capture(lvl, msg, copy, now_ns);
+    va_end(copy);
+}
+
+bool SdkLogSink::admit(int32_t level, uint64_t now_ns) {
+    RateLimit& limit = limits_[levelIndex(level)];
+    uint32_t per_second = limit.per_second.load(std::memory_order_relaxed);
+    if (per_second == 0) {
+        return true;
+    }
+    uint64_t second = now_ns / 1000000000ull;
+    uint64_t window = limit.window.load(std::memory_order_relaxed);
+    if (window != second && limit.window.compare_exchange_strong(window, second, std::memory_order_relaxed)) {
+        limit.count.store(0, std::memory_order_relaxed);
+    }
+    uint32_t count = limit.count.fetch_add(1, std::memory_order_relaxed);
+    if (count >= per_second) {
+        limit.dropped.fetch_add(1, std::memory_order_relaxed);
+        if (count == per_second) {
+            // First drop of the window; the rest are reported with the next
+            // message or the next window's first drop
+            notify();
+        }
+        return false;
+    }
+    return true;
+}
+
+void SdkLogSink::capture(int32_t level, const char* format, va_list& args, uint64_t now_ns) {
+    size_t ticket;
+    LogRecord* record = queue_->claim(ticket);
+    if (!record) {
+        dropped_full_.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    record->timestamp_ns = now_ns;
+    record->format = format;
+    record->level = level;
+    record->thread = currentThread();
+    record->arg_count = 0;
+    record->truncated = false;
+    record->text_used = 0;
+
+    // Pull every argument off the va_list with the type the format names,
+    // so the list stays in step; nothing is formatted here
+    auto slot = [record]() -> LogRecord::Arg* {
+        if (record->arg_count == LogRecord::kMaxArgs) {
+            record->truncated = true;
+            return nullptr;
+        }
+        return &record->args[record->arg_count++];
+    };
+    const char* p = format;
+    Spec spec;
+    while (!record->truncated && nextSpec(p, spec)) {
+        LogRecord::Arg* arg;
+        if (spec.star_width && (arg = slot())) {
+            arg->i = va_arg(args, int);
+        }
+        if (spec.star_precision && (arg = slot())) {
+            arg->i = va_arg(args, int);
+        }
+        if (record->truncated) {
+            break;
+        }
+        switch (spec.conversion) {
+        case 'd':
+        case 'i':
+            if ((arg = slot())) {
+                arg->i = readSigned(spec.length, args);
+            }
+            break;
+        case 'u':
+        case 'o':
+        case 'x':
+        case 'X':
+            if ((arg = slot())) {
+                arg->u = readUnsigned(spec.length, args);
+            }
+            break;
+        case 'c':
+            if ((arg = slot())) {
+                arg->i = va_arg(args, int);
+            }
+            break;
+        case 'f':
+        case 'F':
+        case 'e':
+        case 'E':
+        case 'g':
+        case 'G':
+        case 'a':
+        case 'A':
+            if ((arg = slot())) {
+                arg->f = spec.length == Spec::LongDouble ? static_cast<double>(va_arg(args, long double))
+                                                         : va_arg(args, double);
+            }
+            break;
+        case 's':
+            if ((arg = slot())) {
+                const char* str = "";
+                if (spec.length == Spec::Long) {
+                    va_arg(args, const wchar_t*); // wide strings are not copied
+                } else {
+                    str = va_arg(args, const char*);
+                    str = str ? str : "(null)";
+                }
+                size_t room = LogRecord::kTextBytes - record->text_used;
+                size_t length = strnlen(str, room);
+                if (length == room) {
+                    // No room for the terminator; keep what fits and stop
+                    record->truncated = true;
+                    length = room > 0 ? room - 1 : 0;
+                }
+                if (room == 0) {
+                    arg->s.offset = LogRecord::kNoText;
+                    arg->s.length = 0;
+                    break;
+                }
+                arg->s.offset = record->text_used;
+                arg->s.length = static_cast<uint16_t>(length);
+                std::memcpy(record->text + record->text_used, str, length);
+                record->text[record->text_used + length] = '\0';
+                record->text_used = static_cast<uint16_t>(record->text_used + length + 1);
+            }
+            break;
+        case 'p':
+            if ((arg = slot())) {
+                arg->p = va_arg(args, const void*);
+            }
+            break;
+        case 'n':
+            va_arg(args, void*); // never written back
+            break;
+        default:
+            record->truncated = true; // unknown conversion, the rest cannot be decoded
+            break;
+        }
+    }
+    queue_->publish(ticket);
+    notify();
+}
+
+void SdkLogSink::notify() {
+    // Same handshake as StatusPump: only wake the writer when it is parked
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (sleeping_.load(std::memory_order_relaxed)) {
+        ready_.signal();
+    }
+}
+
+void SdkLogSink::write(const LogRecord& record) {
+    char buf[512];
+    time_t seconds = static_cast<time_t>(record.timestamp_ns / 1000000000ull);
+    if (seconds != stamp_second_) {
+        struct tm tm;
+        localtime_r(&seconds, &tm);
+        std::strftime(stamp_, sizeof(stamp_), "%Y-%m-%d %H:%M:%S", &tm);
+        stamp_second_ = seconds;
+    }
+    std::snprintf(buf, sizeof(buf), "%s.%06u %c %u ", stamp_,
+                  static_cast<unsigned>(record.timestamp_ns % 1000000000ull / 1000), levelLetter(record.level),
+                  record.thread);
+    line_.assign(buf);
+
+    // Replay the format one conversion at a time; integers are widened to
+    // long long and floats are doubles, matching how they were captured
+    const char* p = record.format;
+    const char* literal = p;
+    size_t next = 0;
+    Spec spec;
+    while (nextSpec(p, spec)) {
+        for (const char* c = literal; c < spec.begin; ++c) {
+            line_ += *c;
+            if (*c == '%' && c + 1 < spec.begin && c[1] == '%') {
+                ++c;
+            }
+        }
+        literal = spec.end;
+
+        size_t needed = (spec.star_width ? 1 : 0) + (spec.star_precision ? 1 : 0) +
+                        (spec.conversion == 'n' ? 0 : 1);
+        if (next + needed > record.arg_count) {
+            line_ += "...";
+            literal = nullptr;
+            break;
+        }
+        char format[48];
+        size_t f = 0;
+        for (const char* c = spec.begin; c < spec.body_end && f + 12 < sizeof(format); ++c) {
+            if (*c == '*') {
+                f += std::snprintf(format + f, sizeof(format) - f, "%d",
+                                   static_cast<int>(record.args[next++].i));
+            } else {
+                format[f++] = *c;
+            }
+        }
+        const LogRecord::Arg& arg = record.args[next];
+        switch (spec.conversion) {
+        case 'd':
+        case 'i':
+            std::snprintf(format + f, sizeof(format) - f, "ll%c", spec.conversion);
+            std::snprintf(buf, sizeof(buf), format, static_cast<long long>(arg.i));
+            break;
+        case 'u':
+        case 'o':
+        case 'x':
+        case 'X':
+            std::snprintf(format + f, sizeof(format) - f, "ll%c", spec.conversion);
+            std::snprintf(buf, sizeof(buf), format, static_cast<unsigned long long>(arg.u));
+            break;
+        case 'c':
+            std::snprintf(format + f, sizeof(format) - f, "c");
+            std::snprintf(buf, sizeof(buf), format, static_cast<int>(arg.i));
+            break;
+        case 's':
+            std::snprintf(format + f, sizeof(format) - f, "s");
+            std::snprintf(buf, sizeof(buf), format,
+                          arg.s.offset == LogRecord::kNoText ? "" : record.text + arg.s.offset);
+            break;
+        case 'p':
+            std::snprintf(format + f, sizeof(format) - f, "p");
+            std::snprintf(buf, sizeof(buf), format, arg.p);
+            break;
+        case 'n':
+            buf[0] = '\0';
+            break;
+        default: // floating point
+            std::snprintf(format + f, sizeof(format) - f, "%c", spec.conversion);
+            std::snprintf(buf, sizeof(buf), format, arg.f);
+            break;
+        }
+        if (spec.conversion != 'n') {
+            ++next;
+        }
+        line_ += buf;
+    }
+    if (literal) {
+        for (const char* c = literal; *c; ++c) {
+            line_ += *c;
+            if (c[0] == '%' && c[1] == '%') {
+                ++c;
+            }
+        }
+    }
+    if (record.truncated) {
+        line_ += " [truncated]";
+    }
+    line_ += '\n';
+    std::fwrite(line_.data(), 1, line_.size(), out_);
+}
+
+bool SdkLogSink::reportDrops() {
+    uint64_t full = droppedFull();
+    uint64_t rate = droppedRate();
+    if (full == reported_full_ && rate == reported_rate_) {
+        return false;
+    }
+    std::fprintf(out_, "libdev log: dropped %" PRIu64 " (queue full), %" PRIu64 " (rate limit)\n",
+                 full - reported_full_, rate - reported_rate_);
+    reported_full_ = full;
+    reported_rate_ = rate;
+    return true;
+}
+
+void SdkLogSink::drain() {
+    bool wrote = false;
+    while (const LogRecord* record = queue_->front()) {
+        write(*record);
+        queue_->pop();
+        written_.fetch_add(1, std::memory_order_relaxed);
+        wrote = true;
+    }
+    if (reportDrops() || wrote) {
+        std::fflush(out_);
+    }
+}
+
+void SdkLogSink::run() {
+    while (!reactor_.stopped()) {
+        drain();
+
+        sleeping_.store(true, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (queue_->empty()) {
+            reactor_.poll(-1);
+        }
+        sleeping_.store(false, std::memory_order_relaxed);
+    }
+    drain();
+}
@@ -0,0 +1,201 @@
+#pragma once
+
+#include <atomic>
+#include <cstdarg>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <thread>
+#include <util/comm.hpp>
+
+#include "reactor.hpp"
+
+#ifndef OBSBOT_CACHE_LINE
+#define OBSBOT_CACHE_LINE 64
+#endif
+
+// One captured dlog call: the format pointer plus the raw arguments, with
+// %s arguments copied inline since their storage belongs to the caller.
+// Formatting happens later, on the sink thread.
+struct LogRecord {
+    static constexpr size_t kMaxArgs = 12;
+    static constexpr size_t kTextBytes = 120;
+    static constexpr uint16_t kNoText = 0xffff; // string argument did not fit at all
+
+    union Arg {
+        int64_t i;
+        uint64_t u;
+        double f;
+        const void* p;
+        struct {
+            uint16_t offset; // into text
+            uint16_t length;
+        } s;
+    };
+
+    uint64_t timestamp_ns; // wall clock
+    const char* format;
+    int32_t level;
+    uint32_t thread; // kernel tid of the logging thread
+    uint8_t arg_count;
+    bool truncated; // more arguments or string bytes than fit
+    uint16_t text_used;
+    Arg args[kMaxArgs];
+    char text[kTextBytes];
+};
+
+// Bounded multi-producer/single-consumer queue of LogRecords (Vyukov's
+// sequence-numbered ring). Producers claim a slot with one CAS and fill it
+// in place; a full queue fails the push instead of waiting.
+template <size_t Capacity>
+class LogQueue {
+    static_assert(Capacity >= 2 && (Capacity & (Capacity - 1)) == 0, "Capacity must be a power of two");
+
+public:
+    LogQueue() {
+        for (size_t i = 0; i < Capacity; ++i) {
+            cells_[i].sequence.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    LogQueue(const LogQueue&) = delete;
+    LogQueue& operator=(const LogQueue&) = delete;
+
+    // Producer side: returns the slot to fill, or nullptr when full. Every
+    // claimed slot must be handed back through publish(ticket).
+    LogRecord* claim(size_t& ticket) {
+        size_t pos = tail_.load(std::memory_order_relaxed);
+        for (;;) {
+            Cell& cell = cells_[pos & (Capacity - 1)];
+            size_t seq = cell.sequence.load(std::memory_order_acquire);
+            intptr_t diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos);
+            if (diff == 0) {
+                if (tail_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    ticket = pos;
+                    return &cell.record;
+                }
+            } else if (diff < 0) {
+                return nullptr;
+            } else {
+                pos = tail_.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    void publish(size_t ticket) {
+        cells_[ticket & (Capacity - 1)].sequence.store(ticket + 1, std::memory_order_release);
+    }
+
+    // Consumer side: the oldest published record, or nullptr. Records are
+    // published out of order when producers race, so a claimed but not yet
+    // published slot holds back the ones behind it.
+    const LogRecord* front() {
+        Cell& cell = cells_[head_ & (Capacity - 1)];
+        size_t seq = cell.sequence.load(std::memory_order_acquire);
+        return seq == head_ + 1 ? &cell.record : nullptr;
+    }
+
+    void pop() {
+        Cell& cell = cells_[head_ & (Capacity - 1)];
+        cell.sequence.store(head_ + Capacity, std::memory_order_release);
+        ++head_;
+    }
+
+    bool empty() const {
+        const Cell& cell = cells_[head_ & (Capacity - 1)];
+        return cell.sequence.load(std::memory_order_acquire) != head_ + 1;
+    }
+
+private:
+    struct Cell {
+        std::atomic<size_t> sequence;
+        LogRecord record;
+    };
+
+    alignas(OBSBOT_CACHE_LINE) std::atomic<size_t> tail_{0};
+    alignas(OBSBOT_CACHE_LINE) size_t head_ = 0;
+    alignas(OBSBOT_CACHE_LINE) Cell cells_[Capacity];
+};
+
+// dlog_handler_t that keeps libdev logging off the SDK threads. The handler
+// only filters, rate-limits and copies the call into a LogQueue; a
+// background thread runs the printf formatting and the file writes. When
+// the queue is full or a level is over its rate the message is dropped and
+// counted, so logging never blocks the caller.
+//
+// The format pointer is stored as is: libdev formats are string literals.
+class SdkLogSink {
+public:
+    static constexpr size_t kQueueCapacity = 4096;
+
+    SdkLogSink();
+    ~SdkLogSink();
+
+    SdkLogSink(const SdkLogSink&) = delete;
+    SdkLogSink& operator=(const SdkLogSink&) = delete;
+
+    // Configure before start(). Messages above `level` (DEV_ERROR ..
+    // DEV_DEBUG) are discarded. A level's rate is messages per second,
+    // 0 for unlimited.
+    void setLevel(int32_t level) { level_.store(level, std::memory_order_relaxed); }
+    void setRateLimit(int32_t level, uint32_t per_second);
+
+    // Opens `path` for appending ("-" or empty for stderr), starts the
+    // writer thread and installs the handler through dev_set_log_handler
+    bool start(const std::string& path);
+
+    // Restores the previous handler, writes what is queued and closes
+    void stop();
+
+    uint64_t written() const { return written_.load(std::memory_order_relaxed); }
+    uint64_t droppedFull() const { return dropped_full_.load(std::memory_order_relaxed); }
+    uint64_t droppedRate() const;
+
+    // The dlog_handler_t itself, `p` is the SdkLogSink
+    static void handler(int32_t lvl, const char* msg, va_list args, void* p);
+
+private:
+    static constexpr size_t kLevels = 4; // error, warn, info, debug
+
+    // Fixed one-second window per level; the counter resets lazily on the
+    // first message of a new window
+    struct alignas(OBSBOT_CACHE_LINE) RateLimit {
+        std::atomic<uint32_t> per_second{0};
+        std::atomic<uint64_t> window{0}; // seconds
+        std::atomic<uint32_t> count{0};
+        std::atomic<uint64_t> dropped{0};
+    };
+
+    static size_t levelIndex(int32_t level);
+    bool admit(int32_t level, uint64_t now_ns);
+    void capture(int32_t level, const char* format, va_list& args, uint64_t now_ns);
+    void notify();
+    void write(const LogRecord& record);
+    // True when a line was written
+    bool reportDrops();
+    void drain();
+    void run();
+
+    std::atomic<int32_t> level_;
+    RateLimit limits_[kLevels];
+    std::atomic<uint64_t> dropped_full_{0};
+    std::atomic<uint64_t> written_{0};
+    uint64_t reported_full_ = 0;
+    uint64_t reported_rate_ = 0;
+
+    std::unique_ptr<LogQueue<kQueueCapacity>> queue_;
+    Reactor reactor_;
+    EventFd ready_;
+    std::atomic<bool> sleeping_{false};
+    std::thread thread_;
+
+    FILE* out_ = nullptr;
+    bool owns_out_ = false;
+    std::string line_;
+    int64_t stamp_second_ = -1;
+    char stamp_[32] = {};
+
+    dlog_handler_t previous_handler_ = nullptr;
+    void* previous_param_ = nullptr;
+};
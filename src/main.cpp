@@ -1,92 +1,356 @@
 #include <iostream>
-#include <thread>
 #include <chrono>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
 #include <dev/devs.hpp>
 #include <csignal>
+#include <cstdlib>
+#include <sys/epoll.h>
 
-// Global flag for program control
-volatile bool running = true;
+#include "capability_cache.hpp"
+#include "control_server.hpp"
+#include "device_registry.hpp"
+#include "fleet_manager.hpp"
+#include "log_sink.hpp"
+#include "media_ingest.hpp"
+#include "reactor.hpp"
+#include "reconnect_manager.hpp"
+#include "status_board.hpp"
+#include "status_delta.hpp"
+#include "status_journal.hpp"
+#include "status_pump.hpp"
 
-// Signal handler
-void signalHandler(int signum) {
-    running = false;
+// Hot-plug events queued by the SDK callback thread for the main loop
+struct DeviceEvents {
+    EventFd changed;
+
+    std::mutex mutex;
+    std::deque<std::pair<std::string, bool>> changes;
+};
+
+// Status sink, runs on the status pump thread. Prints only the fields that
+// changed since the previous push of the same camera.
+class StatusPrinter {
+public:
+    explicit StatusPrinter(const FleetManager& fleet) : fleet_(fleet) {}
+
+    void operator()(const StatusSource& source, const StatusSample& sample) {
+        auto it = trackers_.find(source.snHash());
+        if (it == trackers_.end()) {
+            auto camera = fleet_.camera(source.sn());
+            auto product = camera ? camera->device()->productType() : ObsbotProdTailAir;
+            it = trackers_.emplace(source.snHash(), StatusDeltaTracker(statusLayoutFor(product))).first;
+        }
+        if (it->second.update(sample.status, changes_)) {
+            std::cout << "[" << source.sn() << "] " << formatStatusChanges(changes_) << std::endl;
+        }
+    }
+
+private:
+    const FleetManager& fleet_;
+    std::unordered_map<uint64_t, StatusDeltaTracker> trackers_;
+    std::vector<StatusChange> changes_;
+};
+
+// Fleet listener, runs on the SDK hot-plug thread
+void onDeviceChange(DeviceEvents& events, const std::string& dev_sn, bool connected) {
+    {
+        std::lock_guard<std::mutex> lock(events.mutex);
+        events.changes.emplace_back(dev_sn, connected);
+    }
+    events.changed.signal();
 }
 
-// Status callback
-void onDeviceStatus(void* param, const void* data) {
-    auto* status = static_cast<const Device::CameraStatus*>(data);
-    std::cout << "\rBattery: " << (int)status->tail_air.battery.capacity 
-              << "% | AI Mode: " << (int)status->tail_air.ai_type 
-              << " | USB Status: " << (int)status->tail_air.usb_status 
-              << std::flush;
+// OBSBOT_SDK_LOG_LEVEL: error, warn, info (default) or debug
+int32_t sdkLogLevel() {
+    const char* level = std::getenv("OBSBOT_SDK_LOG_LEVEL");
+    if (!level) {
+        return DEV_INFO;
+    }
+    std::string name(level);
+    return name == "error" ? DEV_ERROR : name == "warn" ? DEV_WARN : name == "debug" ? DEV_DEBUG : DEV_INFO;
 }
 
-// Device change callback
-void onDeviceChange(std::string dev_sn, bool connected, void* param) {
-    std::cout << "Device " << dev_sn << (connected ? " connected" : " disconnected") << std::endl;
-    
-    if (connected) {
-        auto* device = static_cast<std::shared_ptr<Device>*>(param);
-        if (device) {
-            *device = Devices::get().getDevBySn(dev_sn);
-            if (*device) {
-                (*device)->setDevStatusCallbackFunc(onDeviceStatus, nullptr);
-                (*device)->enableDevStatusCallback(true);
-            }
+// OBSBOT_CAPS_CACHE, or ~/.obsbot_capabilities; empty disables the cache
+std::string capabilityCachePath() {
+    if (const char* path = std::getenv("OBSBOT_CAPS_CACHE")) {
+        return path;
+    }
+    const char* home = std::getenv("HOME");
+    return home ? std::string(home) + "/.obsbot_capabilities" : std::string();
+}
+
+// OBSBOT_DEVICE_REGISTRY, or ~/.obsbot_devices; empty disables the registry
+std::string deviceRegistryPath() {
+    if (const char* path = std::getenv("OBSBOT_DEVICE_REGISTRY")) {
+        return path;
+    }
+    const char* home = std::getenv("HOME");
+    return home ? std::string(home) + "/.obsbot_devices" : std::string();
+}
+
+// OBSBOT_CONTROL_SOCKET, or control::kDefaultSocketPath; empty disables the
+// control socket
+std::string controlSocketPath() {
+    const char* path = std::getenv("OBSBOT_CONTROL_SOCKET");
+    return path ? path : control::kDefaultSocketPath;
+}
+
+// OBSBOT_CONTROL_SPEED_HZ: gimbal speeds sent per camera and second at most;
+// unset or 0 sends each one as soon as the camera takes it
+double controlSpeedRate() {
+    const char* rate = std::getenv("OBSBOT_CONTROL_SPEED_HZ");
+    return rate ? std::atof(rate) : 0.0;
+}
+
+// OBSBOT_STATUS_SHM, or kDefaultStatusBoardName; empty disables the shared
+// status board
+std::string statusBoardName() {
+    const char* name = std::getenv("OBSBOT_STATUS_SHM");
+    return name ? name : kDefaultStatusBoardName;
+}
+
+// OBSBOT_INGEST_DIR: copy every camera's media there; unset disables ingest
+std::string ingestDirectory() {
+    const char* dir = std::getenv("OBSBOT_INGEST_DIR");
+    return dir ? dir : std::string();
+}
+
+// OBSBOT_INGEST_CHECKSUM: crc32c (default), xxh64 or none
+MediaIngest::Options ingestOptions() {
+    MediaIngest::Options options;
+    const char* name = std::getenv("OBSBOT_INGEST_CHECKSUM");
+    if (name && !Checksum::parse(name, options.checksum)) {
+        std::cerr << "Unknown OBSBOT_INGEST_CHECKSUM " << name << ", using " << Checksum::name(options.checksum)
+                  << std::endl;
+    }
+    return options;
+}
+
+// First commands for a newly attached camera, run on its strand
+void greetCamera(Device& camera, CapabilityCache& capabilities, DeviceRegistry& registry) {
+    // Try to wake up the camera; it needs nothing we would have to ask first
+    camera.cameraSetDevRunStatusR(Device::DevStatusRun);
+
+    DeviceRecord record = DeviceRecord::identify(camera);
+    DeviceRecord known;
+    bool recognized = registry.recognize(camera, known);
+    std::cout << "\nCamera Information:" << (recognized ? " (seen before)" : "") << std::endl;
+    std::cout << "Name: " << record.name << std::endl;
+    std::cout << "Serial: " << record.sn << std::endl;
+    std::cout << "Version: " << record.version << std::endl;
+
+    // Ranges and formats only change with the firmware
+    DeviceCapabilities caps;
+    bool cached = false;
+    if (capabilities.get(camera, caps, &cached)) {
+        std::cout << "Capabilities: " << caps.formats.size() << " video formats, zoom "
+                  << caps.range(DeviceCapabilities::Zoom).min_ << ".." << caps.range(DeviceCapabilities::Zoom).max_
+                  << (cached ? " (cached)" : "") << std::endl;
+        if (!cached && !capabilities.save()) {
+            std::cerr << "Failed to save capability cache" << std::endl;
         }
+        record.formats = caps.formats;
+    } else {
+        record.formats = known.formats;
+    }
+
+    registry.remember(record);
+    if (registry.dirty() && !registry.save()) {
+        std::cerr << "Failed to save device registry" << std::endl;
     }
 }
 
 int main() {
     std::cout << "OBSBOT Camera Test Program" << std::endl;
     std::cout << "==========================" << std::endl;
-    
-    // Set up signal handling
-    signal(SIGINT, signalHandler);
-    signal(SIGTERM, signalHandler);
-    
-    // Initialize device manager
-    auto& devices = Devices::get();
-    std::shared_ptr<Device> camera;
-    
-    // Register device callback with camera pointer
-    devices.setDevChangedCallback(onDeviceChange, &camera);
-    
-    std::cout << "Waiting for camera connection..." << std::endl;
-    
-    // Wait for device connection
-    int retries = 0;
-    while (!camera && retries < 10 && running) {
-        std::this_thread::sleep_for(std::chrono::seconds(1));
-        retries++;
-    }
-    
-    if (!camera) {
-        std::cout << "No camera found after " << retries << " seconds." << std::endl;
+
+    // Route SIGINT/SIGTERM through a signalfd; this must happen before the
+    // SDK starts its threads so they inherit the blocked mask
+    SignalFd signals({SIGINT, SIGTERM});
+    Reactor reactor;
+    DeviceEvents events;
+    SdkLogSink sdk_log;
+    CapabilityCache capabilities;
+    DeviceRegistry registry;
+    StatusJournal journal;
+    StatusBoard board;
+    StatusPump status_pump;
+    FleetManager fleet(status_pump);
+    StatusPrinter printer(fleet);
+    ReconnectManager reconnect(fleet);
+    ControlServer control_server(reactor, fleet);
+    control_server.setSpeedRate(controlSpeedRate());
+    std::string ingest_dir = ingestDirectory();
+    MediaIngest ingest(fleet, ingest_dir, ingestOptions());
+
+    // libdev logging is formatted and written off the SDK threads, to
+    // OBSBOT_SDK_LOG or stderr
+    const char* sdk_log_path = std::getenv("OBSBOT_SDK_LOG");
+    sdk_log.setLevel(sdkLogLevel());
+    if (!sdk_log.start(sdk_log_path ? sdk_log_path : "-")) {
+        std::cerr << "Failed to open SDK log " << (sdk_log_path ? sdk_log_path : "") << std::endl;
         return 1;
     }
-    
-    std::cout << "\nCamera Information:" << std::endl;
-    std::cout << "Name: " << camera->devName() << std::endl;
-    std::cout << "Serial: " << camera->devSn() << std::endl;
-    std::cout << "Version: " << camera->devVersion() << std::endl;
-    
-    // Try to wake up the camera
-    camera->cameraSetDevRunStatusR(Device::DevStatusRun);
-    
-    std::cout << "\nPress Ctrl+C to exit" << std::endl;
-    
-    // Main loop
-    while (running) {
-        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+    std::string caps_path = capabilityCachePath();
+    if (!caps_path.empty() && !capabilities.open(caps_path)) {
+        std::cerr << "Ignoring unreadable capability cache " << caps_path << std::endl;
+    }
+    std::string registry_path = deviceRegistryPath();
+    if (!registry_path.empty() && !registry.open(registry_path)) {
+        std::cerr << "Ignoring unreadable device registry " << registry_path << std::endl;
+    }
+
+    // Optional flight recorder of every status push
+    if (const char* journal_dir = std::getenv("OBSBOT_STATUS_JOURNAL")) {
+        if (!journal.open(journal_dir)) {
+            std::cerr << "Failed to open status journal in " << journal_dir << std::endl;
+            return 1;
+        }
+        status_pump.addSink([&journal](const StatusSource& source, const StatusSample& sample) {
+            journal.record(source, sample);
+        });
+        std::cout << "Recording status to " << journal_dir << std::endl;
+    }
+    // Latest status of every camera for other local processes
+    std::string board_name = statusBoardName();
+    if (!board_name.empty()) {
+        if (board.open(board_name)) {
+            status_pump.addSink([&board, &fleet](const StatusSource& source, const StatusSample& sample) {
+                if (auto camera = fleet.camera(source.sn())) {
+                    board.publish(source, sample, camera->device());
+                }
+            });
+            std::cout << "Status board: " << board_name << std::endl;
+        } else {
+            std::cerr << "Failed to open status board " << board_name << std::endl;
+        }
+    }
+    status_pump.addSink(std::ref(printer));
+    if (!signals.valid() || !reactor.valid() || !events.changed.valid() || !status_pump.start()) {
+        std::cerr << "Failed to set up event loop" << std::endl;
+        return 1;
+    }
+
+    std::string control_path = controlSocketPath();
+    if (!control_path.empty()) {
+        if (control_server.listen(control_path)) {
+            std::cout << "Control socket: " << control_path << std::endl;
+        } else {
+            std::cerr << "Failed to open control socket " << control_path << std::endl;
+        }
+    }
+
+    // A camera that comes back gets its settings, zoom and AI mode again
+    reconnect.setListener([](const std::string& sn, const ReconnectManager::Report& report) {
+        std::cout << "Restored " << sn << ": " << report.written << " writes, " << report.failed << " failed, in "
+                  << report.total.count() / 1000 << " ms" << std::endl;
+    });
+    // Media comes off the cameras in the background, next to their commands
+    ingest.setListener([](const std::string& sn, const std::string& path, bool ok) {
+        if (ok) {
+            std::cout << "Ingested " << sn << ":" << path << std::endl;
+        } else {
+            std::cerr << "Failed to ingest " << sn << ":" << path << std::endl;
+        }
+    });
+    fleet.setListener([&events, &reconnect, &ingest](const std::shared_ptr<CameraHandle>& camera, bool connected) {
+        reconnect.onDeviceChange(camera, connected);
+        ingest.onDeviceChange(camera, connected);
+        onDeviceChange(events, camera->sn(), connected);
+    });
+    if (!ingest_dir.empty()) {
+        // New photos and clips are fetched as soon as the camera announces them
+        fleet.setEventListener([&ingest](const std::string& sn, int32_t event_type, const void* result) {
+            ingest.onDeviceEvent(sn, event_type, result);
+        });
+    }
+
+    reactor.add(signals.fd(), EPOLLIN, [&](uint32_t) {
+        if (signals.read() != 0) {
+            reactor.stop();
+        }
+    });
+
+    reactor.add(events.changed.fd(), EPOLLIN, [&](uint32_t) {
+        events.changed.drain();
+        std::deque<std::pair<std::string, bool>> changes;
+        {
+            std::lock_guard<std::mutex> lock(events.mutex);
+            changes.swap(events.changes);
+        }
+        for (auto& change : changes) {
+            const std::string& dev_sn = change.first;
+            bool connected = change.second;
+            std::cout << "Device " << dev_sn << (connected ? " connected" : " disconnected") << std::endl;
+
+            if (connected) {
+                fleet.post(dev_sn, [&capabilities, &registry](Device& camera) {
+                    greetCamera(camera, capabilities, registry);
+                });
+                if (!ingest_dir.empty()) {
+                    ingest.ingest(dev_sn);
+                }
+            } else {
+                board.disconnect(dev_sn);
+            }
+        }
+    });
+
+    // Start tracking cameras; hot-plug events are queued for the main loop
+    fleet.start();
+
+    if (registry.size() > 0) {
+        std::cout << "Waiting for camera connection (" << registry.size() << " seen before)..." << std::endl;
+    } else {
+        std::cout << "Waiting for camera connection..." << std::endl;
+    }
+
+    // Wait for device connection, waking only on hot-plug or a signal
+    const auto wait_limit = std::chrono::seconds(10);
+    const auto wait_start = std::chrono::steady_clock::now();
+    while (fleet.size() == 0 && !reactor.stopped()) {
+        auto elapsed = std::chrono::steady_clock::now() - wait_start;
+        if (elapsed >= wait_limit) {
+            break;
+        }
+        auto remaining = std::chrono::duration_cast<std::chrono::milliseconds>(wait_limit - elapsed);
+        if (reactor.poll(static_cast<int>(remaining.count()) + 1) < 0) {
+            break;
+        }
     }
-    
+
+    if (fleet.size() == 0) {
+        if (!reactor.stopped()) {
+            std::cout << "No camera found after " << wait_limit.count() << " seconds." << std::endl;
+        }
+        control_server.close();
+        ingest.stop();
+        fleet.stop();
+        status_pump.stop();
+        board.close();
+        return 1;
+    }
+
+    std::cout << "\nPress Ctrl+C to exit" << std::endl;
+
+    // Main loop: sleeps in epoll_wait until a signal or hot-plug event
+    reactor.run();
+
     std::cout << "\nShutting down..." << std::endl;
-    
+
     // Clean shutdown
-    if (camera) {
-        camera->enableDevStatusCallback(false);
-    }
-    
+    control_server.close();
+    ingest.stop();
+    fleet.stop();
+    status_pump.stop();
+    board.close();
+
     return 0;
-}
\ No newline at end of file
+}
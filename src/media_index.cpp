@@ -0,0 +1,217 @@
+#include "media_index.hpp"
+
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <vector>
+
+namespace {
+
+// Replaced records tolerated before open() compacts the file
+constexpr size_t kSlackRecords = 1024;
+
+uint64_t fnv1a(const std::string& text) {
+    uint64_t hash = 1469598103934665603ull;
+    for (unsigned char c : text) {
+        hash ^= c;
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+bool readAll(int fd, void* data, size_t bytes) {
+    auto* p = static_cast<uint8_t*>(data);
+    while (bytes > 0) {
+        ssize_t n = ::read(fd, p, bytes);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            return false;
+        }
+        p += n;
+        bytes -= static_cast<size_t>(n);
+    }
+    return true;
+}
+
+bool writeAll(int fd, const void* data, size_t bytes) {
+    const auto* p = static_cast<const uint8_t*>(data);
+    while (bytes > 0) {
+        ssize_t n = ::write(fd, p, bytes);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+        p += n;
+        bytes -= static_cast<size_t>(n);
+    }
+    return true;
+}
+
+} // namespace
+
+MediaIndex::MediaIndex() : fd_(-1), records_(0) {
+}
+
+MediaIndex::~MediaIndex() {
+    close();
+}
+
+bool MediaIndex::open(const std::string& path) {
+    close();
+    std::lock_guard<std::mutex> lock(mutex_);
+    path_ = path;
+
+    int fd = ::open(path.c_str(), O_RDWR | O_APPEND | O_CLOEXEC);
+    if (fd < 0) {
+        if (errno != ENOENT) {
+            return false;
+        }
+        rewrite();
+        return true;
+    }
+    struct stat st;
+    if (::fstat(fd, &st) != 0) {
+        ::close(fd);
+        return false;
+    }
+    size_t bytes = static_cast<size_t>(st.st_size);
+    MediaIndexHeader header;
+    if (bytes < sizeof(header) || !readAll(fd, &header, sizeof(header)) ||
+        std::memcmp(header.magic, kMediaIndexMagic, sizeof(kMediaIndexMagic)) != 0 ||
+        header.version != kMediaIndexVersion || header.entry_size != sizeof(MediaIndexEntry)) {
+        ::close(fd);
+        rewrite();
+        return true;
+    }
+
+    size_t count = (bytes - sizeof(header)) / sizeof(MediaIndexEntry);
+    std::vector<MediaIndexEntry> records(count);
+    if (!readAll(fd, records.data(), count * sizeof(MediaIndexEntry))) {
+        ::close(fd);
+        return false;
+    }
+    entries_.reserve(count);
+    for (auto& record : records) {
+        entries_[record.path_hash] =
+            Value{record.size, record.modified_hash, record.checksum, static_cast<Checksum::Kind>(record.checksum_kind)};
+    }
+    records_ = count;
+
+    if (records_ > entries_.size() * 2 + kSlackRecords) {
+        ::close(fd);
+        rewrite();
+        return true;
+    }
+    // Cut a record torn by a crash, so appends stay aligned
+    size_t whole = sizeof(header) + count * sizeof(MediaIndexEntry);
+    if (whole != bytes && ::ftruncate(fd, static_cast<off_t>(whole)) != 0) {
+        ::close(fd);
+        return true;
+    }
+    fd_ = fd;
+    return true;
+}
+
+void MediaIndex::close() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (fd_ >= 0) {
+        ::close(fd_);
+    }
+    fd_ = -1;
+    records_ = 0;
+    entries_.clear();
+}
+
+bool MediaIndex::isOpen() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return fd_ >= 0;
+}
+
+MediaIndex::Match MediaIndex::check(const std::string& path, uint64_t size, const std::string& modified) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = entries_.find(fnv1a(path));
+    if (it == entries_.end()) {
+        return Unknown;
+    }
+    return it->second.size == size && it->second.modified_hash == fnv1a(modified) ? Current : Changed;
+}
+
+bool MediaIndex::record(const std::string& path, uint64_t size, const std::string& modified, Checksum::Kind kind,
+                        uint64_t checksum) {
+    MediaIndexEntry entry{fnv1a(path), size, fnv1a(modified), checksum, kind, 0};
+    Value value{size, entry.modified_hash, checksum, kind};
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = entries_.find(entry.path_hash);
+    if (it != entries_.end() && it->second == value) {
+        return fd_ >= 0;
+    }
+    entries_[entry.path_hash] = value;
+    if (fd_ < 0 || !writeAll(fd_, &entry, sizeof(entry))) {
+        return false;
+    }
+    ++records_;
+    return true;
+}
+
+bool MediaIndex::checksum(const std::string& path, Checksum::Kind& kind, uint64_t& value) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = entries_.find(fnv1a(path));
+    if (it == entries_.end() || it->second.kind == Checksum::None) {
+        return false;
+    }
+    kind = it->second.kind;
+    value = it->second.checksum;
+    return true;
+}
+
+size_t MediaIndex::size() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return entries_.size();
+}
+
+// Writes entries_ to a new file and renames it over path_; call with mutex_
+// held. On failure the index stays in memory only.
+bool MediaIndex::rewrite() {
+    if (fd_ >= 0) {
+        ::close(fd_);
+        fd_ = -1;
+    }
+    if (path_.empty()) {
+        return false;
+    }
+    MediaIndexHeader header;
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.magic, kMediaIndexMagic, sizeof(kMediaIndexMagic));
+    header.version = kMediaIndexVersion;
+    header.entry_size = sizeof(MediaIndexEntry);
+
+    std::vector<MediaIndexEntry> records;
+    records.reserve(entries_.size());
+    for (auto& entry : entries_) {
+        const Value& value = entry.second;
+        records.push_back(MediaIndexEntry{entry.first, value.size, value.modified_hash, value.checksum, value.kind, 0});
+    }
+
+    std::string temp = path_ + ".tmp";
+    int fd = ::open(temp.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        return false;
+    }
+    bool ok = writeAll(fd, &header, sizeof(header)) &&
+              writeAll(fd, records.data(), records.size() * sizeof(MediaIndexEntry)) && ::fsync(fd) == 0;
+    ok = ::close(fd) == 0 && ok;
+    if (!ok || ::rename(temp.c_str(), path_.c_str()) != 0) {
+        ::unlink(temp.c_str());
+        return false;
+    }
+    fd_ = ::open(path_.c_str(), O_WRONLY | O_APPEND | O_CLOEXEC);
+    records_ = records.size();
+    return fd_ >= 0;
+}
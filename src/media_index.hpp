@@ -0,0 +1,99 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+#include "checksum.hpp"
+
+// On-disk format of a media index: a MediaIndexHeader followed by
+// fixed-size MediaIndexEntry records, appended as files are ingested. A later
+// record for the same path replaces an earlier one, and a torn record at the
+// end is dropped on open. Paths and dates are stored as 64-bit FNV-1a
+// hashes, which keeps a record at 40 bytes whatever the path length.
+
+constexpr char kMediaIndexMagic[8] = {'O', 'B', 'S', 'M', 'I', 'D', 'X', '\0'};
+constexpr uint32_t kMediaIndexVersion = 2;
+
+struct MediaIndexHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t entry_size;
+    uint8_t reserved[48];
+};
+
+struct MediaIndexEntry {
+    uint64_t path_hash;
+    uint64_t size;          // MtpFileInfo::file_size_
+    uint64_t modified_hash; // of MtpFileInfo::date_modify_
+    uint64_t checksum;      // of the stored file, see Checksum::value()
+    uint32_t checksum_kind; // Checksum::Kind, None when not computed
+    uint32_t reserved;
+};
+
+static_assert(sizeof(MediaIndexHeader) == 64, "media index header layout changed");
+static_assert(sizeof(MediaIndexEntry) == 40, "media index entry layout changed");
+
+// Files already ingested from one camera, by path on the camera.
+//
+// open() reads the whole file into a hash map, so check() is one lookup and
+// never touches the disk. record() appends one entry and leaves the rest of
+// the file alone. When replaced entries outnumber the live ones, open()
+// rewrites the file without them.
+class MediaIndex {
+public:
+    enum Match {
+        Unknown, // never ingested
+        Changed, // ingested, but the camera's file has another size or date
+        Current, // ingested as it is now
+    };
+
+    MediaIndex();
+    ~MediaIndex();
+
+    MediaIndex(const MediaIndex&) = delete;
+    MediaIndex& operator=(const MediaIndex&) = delete;
+
+    // A missing, truncated or foreign file is treated as empty. Returns false
+    // only when `path` exists but cannot be read; the index then works in
+    // memory only.
+    bool open(const std::string& path);
+    void close();
+    bool isOpen() const;
+
+    Match check(const std::string& path, uint64_t size, const std::string& modified) const;
+
+    // Adds or replaces the entry of `path`; false when it could not be
+    // written to disk
+    bool record(const std::string& path, uint64_t size, const std::string& modified,
+                Checksum::Kind kind = Checksum::None, uint64_t checksum = 0);
+
+    // Checksum recorded for `path`; false when there is none
+    bool checksum(const std::string& path, Checksum::Kind& kind, uint64_t& value) const;
+
+    size_t size() const;
+
+private:
+    struct Value {
+        uint64_t size;
+        uint64_t modified_hash;
+        uint64_t checksum;
+        Checksum::Kind kind;
+
+        bool operator==(const Value& other) const {
+            return size == other.size && modified_hash == other.modified_hash && checksum == other.checksum &&
+                   kind == other.kind;
+        }
+    };
+
+    bool rewrite();
+
+    std::string path_;
+    int fd_;         // open for appending, or -1
+    size_t records_; // in the file, replaced ones included
+
+    mutable std::mutex mutex_;
+    std::unordered_map<uint64_t, Value> entries_; // by path hash
+};
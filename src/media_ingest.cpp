@@ -0,0 +1,524 @@
+#include "media_ingest.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <fcntl.h>
+#include <list>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <vector>
+
+namespace {
+
+std::string join(const std::string& dir, const std::string& name) {
+    return dir.empty() || dir.back() == '/' ? dir + name : dir + "/" + name;
+}
+
+// Creates every missing directory above `path`
+bool makeParents(const std::string& path) {
+    for (size_t pos = path.find('/', 1); pos != std::string::npos; pos = path.find('/', pos + 1)) {
+        std::string dir = path.substr(0, pos);
+        if (::mkdir(dir.c_str(), 0755) != 0 && errno != EEXIST) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// A serial number that can name a directory
+bool usableSn(const std::string& sn) {
+    return !sn.empty() && sn.find('/') == std::string::npos && sn != "." && sn != "..";
+}
+
+bool storedWithSize(const std::string& path, uint64_t size) {
+    struct stat st;
+    return ::stat(path.c_str(), &st) == 0 && S_ISREG(st.st_mode) && static_cast<uint64_t>(st.st_size) == size;
+}
+
+// Looks `path` up in a listing of its directory, for a file that was
+// announced rather than found by a walk
+bool statFile(Device& device, const std::string& path, MtpFileInfo& found) {
+    size_t slash = path.rfind('/');
+    if (slash == std::string::npos) {
+        return false;
+    }
+    std::string name = path.substr(slash + 1);
+    std::list<MtpFileInfo> infos;
+    if (device.mtpGetDirFileInfo(slash == 0 ? "/" : path.substr(0, slash), infos) != RM_RET_OK) {
+        return false;
+    }
+    for (auto& info : infos) {
+        if (info.file_type_ != MtpFileFolder && info.file_name_ == name) {
+            found = std::move(info);
+            return true;
+        }
+    }
+    return false;
+}
+
+// Hashes a file while another writer appends to it. Each poll() takes in
+// what was written since the previous one; those bytes were just written and
+// come from the page cache, not the disk.
+class FileFollower {
+public:
+    FileFollower(std::string path, Checksum::Kind kind)
+        : path_(std::move(path)), checksum_(kind), fd_(-1), offset_(0) {
+    }
+
+    ~FileFollower() {
+        if (fd_ >= 0) {
+            ::close(fd_);
+        }
+    }
+
+    FileFollower(const FileFollower&) = delete;
+    FileFollower& operator=(const FileFollower&) = delete;
+
+    void poll() {
+        if (checksum_.kind() == Checksum::None) {
+            return;
+        }
+        if (fd_ < 0) {
+            fd_ = ::open(path_.c_str(), O_RDONLY | O_CLOEXEC);
+            if (fd_ < 0) {
+                return;
+            }
+            buffer_.resize(kChunk);
+        }
+        for (;;) {
+            ssize_t n = ::pread(fd_, buffer_.data(), buffer_.size(), static_cast<off_t>(offset_));
+            if (n < 0 && errno == EINTR) {
+                continue;
+            }
+            if (n <= 0) {
+                return;
+            }
+            checksum_.update(buffer_.data(), static_cast<size_t>(n));
+            offset_ += static_cast<uint64_t>(n);
+        }
+    }
+
+    // Takes in the rest once the writer is done. False unless the checksum
+    // covers exactly `size` bytes.
+    bool finish(uint64_t size) {
+        poll();
+        return checksum_.kind() == Checksum::None || offset_ == size;
+    }
+
+    const Checksum& checksum() const { return checksum_; }
+
+private:
+    static constexpr size_t kChunk = 1 << 20;
+
+    std::string path_;
+    Checksum checksum_;
+    int fd_;
+    uint64_t offset_;
+    std::vector<uint8_t> buffer_;
+};
+
+// "<hex>  <name>", as written by crc32c and xxhsum
+bool writeChecksumFile(const std::string& path, const std::string& local, const Checksum& checksum) {
+    FILE* out = std::fopen(path.c_str(), "w");
+    if (!out) {
+        return false;
+    }
+    std::string name = local.substr(local.rfind('/') + 1);
+    bool ok = std::fprintf(out, "%s  %s\n", checksum.hex().c_str(), name.c_str()) > 0;
+    return std::fclose(out) == 0 && ok;
+}
+
+bool readChecksumFile(const std::string& path, uint64_t& value) {
+    FILE* in = std::fopen(path.c_str(), "r");
+    if (!in) {
+        return false;
+    }
+    unsigned long long parsed = 0;
+    bool ok = std::fscanf(in, "%llx", &parsed) == 1;
+    std::fclose(in);
+    value = parsed;
+    return ok;
+}
+
+} // namespace
+
+MediaIngest::MediaIngest(FleetManager& fleet, std::string destination)
+    : MediaIngest(fleet, std::move(destination), Options()) {
+}
+
+MediaIngest::MediaIngest(FleetManager& fleet, std::string destination, const Options& options)
+    : fleet_(fleet), destination_(std::move(destination)), options_(options), pool_(1) {
+    while (destination_.size() > 1 && destination_.back() == '/') {
+        destination_.pop_back();
+    }
+}
+
+MediaIngest::~MediaIngest() {
+    stop();
+    pool_.shutdown();
+}
+
+void MediaIngest::setProgress(Progress progress) {
+    progress_ = std::move(progress);
+}
+
+void MediaIngest::setListener(Listener listener) {
+    listener_ = std::move(listener);
+}
+
+std::string MediaIngest::localPath(const std::string& sn, const std::string& path) const {
+    if (destination_.empty() || !usableSn(sn)) {
+        return std::string();
+    }
+    // Camera paths must not climb out of the camera's directory
+    for (size_t pos = 0; pos <= path.size();) {
+        size_t next = path.find('/', pos);
+        if (next == std::string::npos) {
+            next = path.size();
+        }
+        std::string part = path.substr(pos, next - pos);
+        if (part == "." || part == "..") {
+            return std::string();
+        }
+        pos = next + 1;
+    }
+    if (path.empty() || path.back() == '/') {
+        return std::string();
+    }
+    return destination_ + "/" + sn + (path[0] == '/' ? path : "/" + path);
+}
+
+std::string MediaIngest::indexPath(const std::string& sn) const {
+    return !destination_.empty() && usableSn(sn) ? destination_ + "/" + sn + ".index" : std::string();
+}
+
+std::string MediaIngest::checksumPath(const std::string& sn, const std::string& path) const {
+    std::string local = localPath(sn, path);
+    if (local.empty() || options_.checksum == Checksum::None) {
+        return std::string();
+    }
+    return local + "." + Checksum::name(options_.checksum);
+}
+
+bool MediaIngest::verify(const std::string& sn, const std::string& path) const {
+    std::string sidecar = checksumPath(sn, path);
+    uint64_t expected;
+    if (sidecar.empty() || !readChecksumFile(sidecar, expected)) {
+        return false;
+    }
+    FileFollower file(localPath(sn, path), options_.checksum);
+    file.poll();
+    return file.checksum().value() == expected;
+}
+
+bool MediaIngest::ingest(const std::string& sn) {
+    auto camera = fleet_.camera(sn);
+    if (!camera) {
+        return false;
+    }
+    std::lock_guard<std::mutex> lock(mutex_);
+    Camera& entry = cameras_[sn];
+    entry.device = camera->device();
+    entry.walk = true;
+    schedule(sn, entry);
+    return true;
+}
+
+bool MediaIngest::announce(const std::string& sn, const std::string& path) {
+    auto camera = fleet_.camera(sn);
+    if (!camera || localPath(sn, path).empty()) {
+        return false;
+    }
+    std::lock_guard<std::mutex> lock(mutex_);
+    Camera& entry = cameras_[sn];
+    entry.device = camera->device();
+    if (!entry.queued.insert(path).second) {
+        // Already known from a walk; move it up unless it is in transfer
+        auto it = std::find_if(entry.queue.begin(), entry.queue.end(),
+                               [&path](const Item& item) { return item.path == path; });
+        if (it != entry.queue.end() && !it->announced) {
+            Item item = std::move(*it);
+            item.announced = true;
+            entry.queue.erase(it);
+            entry.queue.push_front(std::move(item));
+        }
+        return true;
+    }
+    Item item;
+    item.path = path;
+    item.announced = true;
+    entry.queue.push_front(std::move(item));
+    announced_.fetch_add(1, std::memory_order_relaxed);
+    schedule(sn, entry);
+    return true;
+}
+
+void MediaIngest::onDeviceEvent(const std::string& sn, int32_t event_type, const void* result) {
+    if (event_type != Device::kEvtInfoNewMediaFile || !result) {
+        return;
+    }
+    const auto& notify = *static_cast<const Device::CameraFileNotify*>(result);
+    if (notify.file_path.empty()) {
+        return;
+    }
+    announce(sn, notify.file_path[0] == '/' ? notify.file_path : join(options_.media_root, notify.file_path));
+}
+
+void MediaIngest::onDeviceChange(const std::shared_ptr<CameraHandle>& camera, bool connected) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = cameras_.find(camera->sn());
+    if (it == cameras_.end()) {
+        return;
+    }
+    if (connected) {
+        it->second.device = camera->device();
+        schedule(it->first, it->second);
+    } else {
+        // The running transfer fails on its own and is put back
+        it->second.device.reset();
+    }
+}
+
+void MediaIngest::schedule(const std::string& sn, Camera& camera) {
+    if (camera.active || !camera.device || stopping_ || (camera.queue.empty() && !camera.walk)) {
+        return;
+    }
+    camera.active = true;
+    ++active_;
+    // One worker per camera with work; a transfer blocks its worker
+    pool_.ensureThreads(active_);
+    std::shared_ptr<Device> device = camera.device;
+    if (!pool_.post([this, sn, device] { run(sn, device); })) {
+        camera.active = false;
+        --active_;
+    }
+}
+
+bool MediaIngest::current(const std::string& sn, const std::shared_ptr<Device>& device) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = cameras_.find(sn);
+    return !stopping_ && it != cameras_.end() && it->second.device == device;
+}
+
+void MediaIngest::run(const std::string& sn, std::shared_ptr<Device> device) {
+    MediaIndex* index;
+    bool first;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        Camera& camera = cameras_[sn];
+        index = &camera.index;
+        first = !camera.indexed;
+        camera.indexed = true;
+    }
+    if (first) {
+        // Without a readable index file every file is checked on disk, and
+        // the index only lasts until exit
+        std::string path = indexPath(sn);
+        if (!path.empty() && makeParents(path)) {
+            index->open(path);
+        }
+    }
+
+    for (;;) {
+        Item item;
+        bool walk_now = false;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            Camera& camera = cameras_[sn];
+            if (stopping_ || camera.device != device || (!camera.walk && camera.queue.empty())) {
+                camera.active = false;
+                --active_;
+                changed_.notify_all();
+                // Replugged while this worker was still winding down
+                if (camera.device && camera.device != device) {
+                    schedule(sn, camera);
+                }
+                return;
+            }
+            if (camera.walk && (camera.queue.empty() || !camera.queue.front().announced)) {
+                camera.walk = false;
+                walk_now = true;
+            } else {
+                item = std::move(camera.queue.front());
+                camera.queue.pop_front();
+            }
+        }
+        if (walk_now) {
+            walks_.fetch_add(1, std::memory_order_relaxed);
+            walk(sn, *device, *index);
+            continue;
+        }
+
+        bool ok = fetch(sn, *device, *index, item);
+        if (!ok && current(sn, device)) {
+            // Leave the device ready for the next transfer
+            device->mtpCancelTransaction();
+            ++item.attempts;
+        }
+        std::unique_lock<std::mutex> lock(mutex_);
+        Camera& camera = cameras_[sn];
+        if (ok || item.attempts >= options_.max_attempts) {
+            camera.queued.erase(item.path);
+            if (!ok) {
+                failures_.fetch_add(1, std::memory_order_relaxed);
+            }
+            lock.unlock();
+            if (listener_) {
+                listener_(sn, item.path, ok);
+            }
+            continue;
+        }
+        if (stopping_ || camera.device != device) {
+            // Lost with the camera, or cancelled by stop(): first in line
+            // next time
+            camera.queue.push_front(std::move(item));
+            continue;
+        }
+        retries_.fetch_add(1, std::memory_order_relaxed);
+        changed_.wait_for(lock, options_.retry_delay, [this] { return stopping_; });
+        if (item.announced) {
+            // Likely not visible over MTP yet; it keeps its place
+            camera.queue.push_front(std::move(item));
+        } else {
+            camera.queue.push_back(std::move(item));
+        }
+    }
+}
+
+void MediaIngest::walk(const std::string& sn, Device& device, MediaIndex& index) {
+    std::vector<Item> found;
+    std::deque<std::string> dirs{options_.root};
+    while (!dirs.empty()) {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (stopping_) {
+                return;
+            }
+        }
+        std::string dir = std::move(dirs.front());
+        dirs.pop_front();
+        std::list<MtpFileInfo> infos;
+        if (device.mtpGetDirFileInfo(dir, infos) != RM_RET_OK) {
+            continue;
+        }
+        for (auto& info : infos) {
+            std::string path = join(dir, info.file_name_);
+            if (info.file_type_ == MtpFileFolder) {
+                dirs.push_back(std::move(path));
+                continue;
+            }
+            std::string local = localPath(sn, path);
+            if (local.empty()) {
+                continue;
+            }
+            MediaIndex::Match match = index.check(path, info.file_size_, info.date_modify_);
+            if (match == MediaIndex::Current) {
+                skipped_.fetch_add(1, std::memory_order_relaxed);
+                continue;
+            }
+            if (match == MediaIndex::Unknown && storedWithSize(local, info.file_size_)) {
+                index.record(path, info.file_size_, info.date_modify_);
+                skipped_.fetch_add(1, std::memory_order_relaxed);
+                continue;
+            }
+            Item item;
+            item.path = std::move(path);
+            item.size = info.file_size_;
+            item.modified = info.date_modify_;
+            found.push_back(std::move(item));
+        }
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    Camera& camera = cameras_[sn];
+    for (auto& item : found) {
+        if (camera.queued.insert(item.path).second) {
+            camera.queue.push_back(std::move(item));
+        }
+    }
+}
+
+bool MediaIngest::fetch(const std::string& sn, Device& device, MediaIndex& index, const Item& item) {
+    std::string local = localPath(sn, item.path);
+    if (local.empty() || !makeParents(local)) {
+        return false;
+    }
+    std::string part = local + ".part";
+    std::string sidecar = checksumPath(sn, item.path);
+    // The follower must not pick up a leftover of an earlier attempt
+    ::unlink(part.c_str());
+    FileFollower follower(part, options_.checksum);
+    auto progress = [this, &sn, &item, &follower](const std::string&, int32_t percent) {
+        follower.poll();
+        if (progress_) {
+            progress_(sn, item.path, percent);
+        }
+    };
+    int32_t ret = device.mtpCopyFileFromDir(item.path, part, progress);
+    // An announced file's size is whatever arrived
+    bool unlisted = item.modified.empty();
+    uint64_t size = item.size;
+    struct stat st;
+    if (unlisted && ret == RM_RET_OK && ::stat(part.c_str(), &st) == 0) {
+        size = static_cast<uint64_t>(st.st_size);
+    }
+    bool ok = ret == RM_RET_OK && storedWithSize(part, size) && follower.finish(size);
+    ok = ok && (sidecar.empty() || writeChecksumFile(sidecar, local, follower.checksum()));
+    if (ok && ::rename(part.c_str(), local.c_str()) == 0) {
+        const Checksum& checksum = follower.checksum();
+        MtpFileInfo info;
+        if (!unlisted) {
+            index.record(item.path, size, item.modified, checksum.kind(), checksum.value());
+        } else if (statFile(device, item.path, info) && info.file_size_ == size) {
+            // Listed after the copy so the photo is not held up. Without a
+            // date the index is left alone, and the next walk finds the
+            // copy on disk.
+            index.record(item.path, size, info.date_modify_, checksum.kind(), checksum.value());
+        }
+        files_.fetch_add(1, std::memory_order_relaxed);
+        bytes_.fetch_add(size, std::memory_order_relaxed);
+        return true;
+    }
+    if (ok && !sidecar.empty()) {
+        ::unlink(sidecar.c_str());
+    }
+    ::unlink(part.c_str());
+    return false;
+}
+
+size_t MediaIngest::queued() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    size_t count = 0;
+    for (auto& entry : cameras_) {
+        count += entry.second.queued.size();
+    }
+    return count;
+}
+
+bool MediaIngest::waitIdle(std::chrono::milliseconds timeout) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    return changed_.wait_for(lock, timeout, [this] { return active_ == 0; });
+}
+
+void MediaIngest::stop() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    stopping_ = true;
+    changed_.notify_all();
+    while (active_ > 0) {
+        std::vector<std::shared_ptr<Device>> busy;
+        for (auto& entry : cameras_) {
+            if (entry.second.active && entry.second.device) {
+                busy.push_back(entry.second.device);
+            }
+        }
+        lock.unlock();
+        // Again on every round: a worker may have started a transfer after
+        // the previous cancel
+        for (auto& device : busy) {
+            device->mtpCancelTransaction();
+        }
+        lock.lock();
+        changed_.wait_for(lock, std::chrono::milliseconds(50), [this] { return active_ == 0; });
+    }
+}
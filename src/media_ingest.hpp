@@ -0,0 +1,168 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+#include <dev/dev.hpp>
+
+#include "checksum.hpp"
+#include "fleet_manager.hpp"
+#include "media_index.hpp"
+#include "thread_pool.hpp"
+
+// Copies the media on every camera's storage into `destination`/<sn>/<path>
+// in the background.
+//
+// ingest() queues a walk of the camera's storage (mtpGetDirFileInfo from
+// Options::root down), which adds every file not yet on disk to the
+// camera's download queue. Each camera with work gets one worker on the
+// ingest pool, which is separate from the fleet's pool: MTP transfers run
+// on all cameras at once and never occupy a camera's command scheduler, so
+// gimbal and settings commands keep flowing during ingest.
+//
+// Every stored file is recorded with its size and date_modify_ in the
+// camera's MediaIndex, `destination`/<sn>.index, and a walk skips the files
+// the index has in the same state without looking at the disk. A file that
+// changed on the camera is copied again. Files the index does not know count
+// as stored when they are on disk at their full size, which also covers
+// copies made before the index existed.
+//
+// Cameras that announce new media (DevEventNotifyCallback with
+// kEvtInfoNewMediaFile) need no walk for it: onDeviceEvent() queues the
+// announced file ahead of everything else on that camera, so a new photo
+// only waits for the transfer in progress. The event carries only a path,
+// so an announced file is always copied, and its date for the index comes
+// from a listing of its directory once the copy is stored.
+//
+// A checksum of each file is computed while it streams in: every progress
+// callback of the transfer hashes the bytes written since the previous one,
+// which are still in the page cache. It is written next to the file as
+// <file>.crc32c (or .xxh64), in the format of the usual checksum tools, and
+// into the index, so checking a copy later takes no extra pass at ingest.
+//
+// mtpCopyFileFromDir cannot resume inside a file, so ingest resumes per
+// file. A transfer writes <file>.part and renames it once the size matches,
+// so a file on disk is always complete. A failed
+// transfer is cancelled with mtpCancelTransaction and retried after
+// `retry_delay`, up to `max_attempts` times. A camera that goes away keeps
+// its queue, and the transfer it lost does not count as an attempt;
+// onDeviceChange() picks the queue up again when the camera returns.
+class MediaIngest {
+public:
+    struct Options {
+        std::string root = "/"; // camera directory to walk
+        int max_attempts = 3;
+        std::chrono::milliseconds retry_delay{200};
+        Checksum::Kind checksum = Checksum::Crc32c; // None: no sidecar files
+        std::string media_root = "/DCIM"; // what CameraFileNotify::file_path is relative to
+    };
+
+    // FileTransCallback of each transfer: percent of `path` done
+    using Progress = std::function<void(const std::string& sn, const std::string& path, int32_t progress)>;
+    // A file was stored, or gave up after its last attempt
+    using Listener = std::function<void(const std::string& sn, const std::string& path, bool ok)>;
+
+    MediaIngest(FleetManager& fleet, std::string destination);
+    MediaIngest(FleetManager& fleet, std::string destination, const Options& options);
+    ~MediaIngest();
+
+    MediaIngest(const MediaIngest&) = delete;
+    MediaIngest& operator=(const MediaIngest&) = delete;
+
+    // Register before the first ingest(); called on ingest workers
+    void setProgress(Progress progress);
+    void setListener(Listener listener);
+
+    // Queues a walk of the camera's storage; false when it is not attached
+    bool ingest(const std::string& sn);
+
+    // Queues one file of the camera ahead of its other work; false when
+    // the camera is not attached
+    bool announce(const std::string& sn, const std::string& path);
+
+    // Call from the FleetManager listener
+    void onDeviceChange(const std::shared_ptr<CameraHandle>& camera, bool connected);
+    // Call from the FleetManager event listener
+    void onDeviceEvent(const std::string& sn, int32_t event_type, const void* result);
+
+    // Waits until no camera has work, or the timeout
+    bool waitIdle(std::chrono::milliseconds timeout);
+    // Cancels running transfers and waits for the workers; queues are kept
+    void stop();
+
+    std::string localPath(const std::string& sn, const std::string& path) const;
+    std::string indexPath(const std::string& sn) const;
+    std::string checksumPath(const std::string& sn, const std::string& path) const;
+
+    // Reads a stored file again and compares it with its checksum file;
+    // false when they differ or there is no checksum
+    bool verify(const std::string& sn, const std::string& path) const;
+
+    size_t queued() const;
+    uint64_t files() const { return files_.load(std::memory_order_relaxed); }     // stored
+    uint64_t skipped() const { return skipped_.load(std::memory_order_relaxed); } // already ingested
+    uint64_t bytes() const { return bytes_.load(std::memory_order_relaxed); }
+    uint64_t retries() const { return retries_.load(std::memory_order_relaxed); }
+    uint64_t failures() const { return failures_.load(std::memory_order_relaxed); }
+    uint64_t announced() const { return announced_.load(std::memory_order_relaxed); }
+    uint64_t walks() const { return walks_.load(std::memory_order_relaxed); }
+
+private:
+    struct Item {
+        std::string path; // absolute, on the camera
+        uint64_t size = 0;
+        std::string modified; // MtpFileInfo::date_modify_
+        int attempts = 0;
+        bool announced = false; // goes first; without a walk, size and date are unknown
+    };
+
+    struct Camera {
+        std::shared_ptr<Device> device; // null while unplugged
+        std::deque<Item> queue;
+        std::set<std::string> queued; // paths in `queue` or in transfer
+        bool walk = false;            // a walk is requested
+        bool active = false;          // a worker runs for this camera
+        // Opened by the first walk; only the camera's worker uses it
+        MediaIndex index;
+        bool indexed = false;
+    };
+
+    // Call with mutex_ held
+    void schedule(const std::string& sn, Camera& camera);
+    void run(const std::string& sn, std::shared_ptr<Device> device);
+    void walk(const std::string& sn, Device& device, MediaIndex& index);
+    // True once the file is stored; false to retry or give up
+    bool fetch(const std::string& sn, Device& device, MediaIndex& index, const Item& item);
+    // Still the camera's device, and not stopping
+    bool current(const std::string& sn, const std::shared_ptr<Device>& device) const;
+
+    FleetManager& fleet_;
+    std::string destination_;
+    Options options_;
+    Progress progress_;
+    Listener listener_;
+    ThreadPool pool_;
+
+    mutable std::mutex mutex_;
+    std::condition_variable changed_; // a worker finished, or stop() began
+    std::map<std::string, Camera> cameras_;
+    size_t active_ = 0;
+    bool stopping_ = false;
+
+    std::atomic<uint64_t> files_{0};
+    std::atomic<uint64_t> skipped_{0};
+    std::atomic<uint64_t> bytes_{0};
+    std::atomic<uint64_t> retries_{0};
+    std::atomic<uint64_t> failures_{0};
+    std::atomic<uint64_t> announced_{0};
+    std::atomic<uint64_t> walks_{0};
+};
@@ -0,0 +1,154 @@
+#include "preset_cache.hpp"
+
+#include <algorithm>
+#include <future>
+#include <utility>
+
+PresetCache::PresetCache(std::shared_ptr<Device> device, std::chrono::milliseconds timeout)
+    : device_(std::move(device)), timeout_(timeout) {
+    auto product = device_->productType();
+    status_flag_ = product == ObsbotProdTailAir || product == ObsbotProdTail2;
+}
+
+bool PresetCache::presets(std::vector<Device::PresetPosInfo>& out) {
+    std::unique_lock<std::mutex> lock;
+    if (!acquire(lock)) {
+        return false;
+    }
+    out.clear();
+    out.reserve(presets_.size());
+    for (auto& entry : presets_) {
+        out.push_back(entry.second);
+    }
+    return true;
+}
+
+bool PresetCache::preset(int32_t id, Device::PresetPosInfo& out) {
+    std::unique_lock<std::mutex> lock;
+    if (!acquire(lock)) {
+        return false;
+    }
+    auto it = presets_.find(id);
+    if (it == presets_.end()) {
+        return false;
+    }
+    out = it->second;
+    return true;
+}
+
+// A failed edit may still have reached the camera, so every edit drops the
+// cached copy whatever the result
+int32_t PresetCache::add(Device::PresetPosInfo& info) {
+    int32_t ret = device_->aiAddGimbalPresetR(&info);
+    invalidate();
+    return ret;
+}
+
+int32_t PresetCache::update(Device::PresetPosInfo& info, bool presets_flag) {
+    int32_t ret = device_->aiUpdGimbalPresetR(&info, presets_flag);
+    invalidate();
+    return ret;
+}
+
+int32_t PresetCache::rename(int32_t id, const std::string& name) {
+    int32_t ret = device_->aiSetGimbalPresetNameWithIdR(name, id);
+    invalidate();
+    return ret;
+}
+
+int32_t PresetCache::remove(int32_t id) {
+    int32_t ret = device_->aiDelGimbalPresetR(id);
+    invalidate();
+    return ret;
+}
+
+int32_t PresetCache::recall(int32_t id) {
+    return device_->aiTrgGimbalPresetR(id);
+}
+
+void PresetCache::invalidate() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    valid_ = false;
+    ++generation_;
+    invalidations_.fetch_add(1, std::memory_order_relaxed);
+}
+
+void PresetCache::onStatus(const Device::CameraStatus& status) {
+    if (status_flag_ && status.tail_air.misc_status.preset_update) {
+        invalidate();
+    }
+}
+
+// libdev latches preset_update until it is cleared, which also covers
+// pushes the status pump had to drop
+bool PresetCache::changedOnCamera() {
+    if (!status_flag_ || !device_->getDevPosChangedFlag()) {
+        return false;
+    }
+    device_->setDevPosChangedFlag(false);
+    return true;
+}
+
+bool PresetCache::acquire(std::unique_lock<std::mutex>& lock) {
+    if (changedOnCamera()) {
+        invalidate();
+    }
+    lock = std::unique_lock<std::mutex>(mutex_);
+    if (valid_) {
+        hits_.fetch_add(1, std::memory_order_relaxed);
+        return true;
+    }
+    lock.unlock();
+
+    std::lock_guard<std::mutex> fetching(fetch_mutex_);
+    lock.lock();
+    if (valid_) { // fetched by another reader while we waited
+        hits_.fetch_add(1, std::memory_order_relaxed);
+        return true;
+    }
+    uint64_t generation = generation_;
+    lock.unlock();
+
+    misses_.fetch_add(1, std::memory_order_relaxed);
+    std::map<int32_t, Device::PresetPosInfo> fresh;
+    if (!fetch(fresh)) {
+        return false;
+    }
+
+    lock.lock();
+    presets_.swap(fresh);
+    // An invalidation that raced the fetch may describe a change the replies
+    // missed: hand them out this once, but read again next time
+    valid_ = generation == generation_;
+    return true;
+}
+
+bool PresetCache::fetch(std::map<int32_t, Device::PresetPosInfo>& presets) {
+    if (!async_) {
+        async_.reset(new AsyncDevice(device_, timeout_));
+    }
+    auto list = async_->gimbalPresetList().get();
+    if (!list.ok()) {
+        return false;
+    }
+    int32_t count = std::min<int32_t>(std::max<int32_t>(list.value.len, 0), 16);
+
+    // All info requests in flight at once: one round trip instead of one
+    // per preset
+    std::vector<std::future<AsyncReply<Device::PresetPosInfo>>> replies;
+    replies.reserve(count);
+    for (int32_t i = 0; i < count; ++i) {
+        replies.push_back(async_->gimbalPresetInfo(list.value.data_int32[i]));
+    }
+    for (int32_t i = 0; i < count; ++i) {
+        auto reply = replies[i].get();
+        if (!reply.ok()) {
+            return false;
+        }
+        if (reply.value.id < 0) { // deleted after the list was read
+            continue;
+        }
+        presets[list.value.data_int32[i]] = reply.value;
+    }
+    return true;
+}
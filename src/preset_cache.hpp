@@ -0,0 +1,80 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <dev/dev.hpp>
+
+#include "async_device.hpp"
+
+// Gimbal presets of one camera, read once and served from memory.
+//
+// The first read fetches aiGetGimbalPresetListR and then every
+// aiGetGimbalPresetInfoWithIdR at once, pipelined through AsyncDevice. The
+// copy stays valid until the camera reports a change (Tail Air / Tail 2 set
+// tail_air.misc_status.preset_update in a status push, and libdev latches
+// it in getDevPosChangedFlag) or a preset is added, updated, renamed or
+// deleted through this cache. Other models only see their own edits; call
+// invalidate() when something else may have changed them.
+class PresetCache {
+public:
+    explicit PresetCache(std::shared_ptr<Device> device,
+                         std::chrono::milliseconds timeout = std::chrono::milliseconds(1000));
+
+    PresetCache(const PresetCache&) = delete;
+    PresetCache& operator=(const PresetCache&) = delete;
+
+    // All presets in id order. False when they cannot be read; the previous
+    // copy, if any, is kept for the next attempt but not returned.
+    bool presets(std::vector<Device::PresetPosInfo>& out);
+    // False when the presets cannot be read or `id` does not exist
+    bool preset(int32_t id, Device::PresetPosInfo& out);
+
+    // Edits go straight to the camera and drop the cached copy. They return
+    // the SDK result.
+    int32_t add(Device::PresetPosInfo& info);
+    int32_t update(Device::PresetPosInfo& info, bool presets_flag = false);
+    int32_t rename(int32_t id, const std::string& name);
+    int32_t remove(int32_t id);
+
+    // Moves the gimbal to a preset; does not touch the cache
+    int32_t recall(int32_t id);
+
+    void invalidate();
+
+    // Feed every status push of this camera, e.g. from a StatusPump sink
+    void onStatus(const Device::CameraStatus& status);
+
+    // Reads answered from memory, and reads that had to go to the camera
+    uint64_t hits() const { return hits_.load(std::memory_order_relaxed); }
+    uint64_t misses() const { return misses_.load(std::memory_order_relaxed); }
+    uint64_t invalidations() const { return invalidations_.load(std::memory_order_relaxed); }
+
+private:
+    // Returns with mutex_ held and presets_ current, or false (unlocked)
+    bool acquire(std::unique_lock<std::mutex>& lock);
+    bool changedOnCamera();
+    bool fetch(std::map<int32_t, Device::PresetPosInfo>& presets);
+
+    std::shared_ptr<Device> device_;
+    std::chrono::milliseconds timeout_;
+    bool status_flag_; // the model reports preset_update
+
+    // Held across a fetch so concurrent readers wait for one round of
+    // requests instead of issuing their own
+    std::mutex fetch_mutex_;
+    std::unique_ptr<AsyncDevice> async_; // created by the first fetch
+
+    std::mutex mutex_;
+    std::map<int32_t, Device::PresetPosInfo> presets_;
+    bool valid_ = false;
+    uint64_t generation_ = 0; // bumped by every invalidation
+
+    std::atomic<uint64_t> hits_{0};
+    std::atomic<uint64_t> misses_{0};
+    std::atomic<uint64_t> invalidations_{0};
+};
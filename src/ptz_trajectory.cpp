@@ -0,0 +1,475 @@
+#include "ptz_trajectory.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+using Seconds = std::chrono::duration<double>;
+
+double clamp(double value, double limit) {
+    return std::max(-limit, std::min(limit, value));
+}
+
+// Shape constants of the unit profile (distance 1 over duration 1)
+struct UnitShape {
+    double velocity;
+    double acceleration;
+    double jerk;
+};
+
+UnitShape unitShape(double accel_fraction, double jerk_fraction) {
+    double ta = accel_fraction;
+    double tj = jerk_fraction * ta;
+    UnitShape shape;
+    shape.velocity = 1.0 / (1.0 - ta);
+    shape.acceleration = shape.velocity / (ta - tj);
+    shape.jerk = shape.acceleration / tj;
+    return shape;
+}
+
+} // namespace
+
+SCurve::SCurve(double distance, double duration, double accel_fraction, double jerk_fraction)
+    : distance_(distance), duration_(std::max(0.0, duration)), peak_velocity_(0.0), jerk_(0.0), phase_{} {
+    accel_fraction = std::max(1e-3, std::min(0.5, accel_fraction));
+    jerk_fraction = std::max(1e-3, std::min(0.5, jerk_fraction));
+    if (duration_ <= 0.0 || distance_ == 0.0) {
+        return;
+    }
+    double ta = accel_fraction * duration_;
+    double tj = jerk_fraction * ta;
+    double tc = ta - 2.0 * tj;
+    double tv = duration_ - 2.0 * ta;
+    peak_velocity_ = distance_ / (duration_ - ta);
+    jerk_ = peak_velocity_ / (ta - tj) / tj;
+    const double phases[7] = {tj, tc, tj, tv, tj, tc, tj};
+    std::copy(phases, phases + 7, phase_);
+}
+
+double SCurve::minDuration(double distance, double max_velocity, double max_acceleration, double max_jerk,
+                           double accel_fraction, double jerk_fraction) {
+    double d = std::fabs(distance);
+    if (d == 0.0) {
+        return 0.0;
+    }
+    UnitShape unit = unitShape(std::max(1e-3, std::min(0.5, accel_fraction)),
+                               std::max(1e-3, std::min(0.5, jerk_fraction)));
+    return std::max({d * unit.velocity / max_velocity, std::sqrt(d * unit.acceleration / max_acceleration),
+                     std::cbrt(d * unit.jerk / max_jerk)});
+}
+
+SCurve::State SCurve::at(double t) const {
+    State state{0.0, 0.0, 0.0};
+    if (jerk_ == 0.0) {
+        return state;
+    }
+    if (t >= duration_) {
+        state.position = distance_;
+        return state;
+    }
+    static const int kJerkSign[7] = {1, 0, -1, 0, -1, 0, 1};
+    double remaining = std::max(0.0, t);
+    for (int i = 0; i < 7; ++i) {
+        double dt = std::min(remaining, phase_[i]);
+        double j = kJerkSign[i] * jerk_;
+        state.position += state.velocity * dt + state.acceleration * dt * dt / 2.0 + j * dt * dt * dt / 6.0;
+        state.velocity += state.acceleration * dt + j * dt * dt / 2.0;
+        state.acceleration += j * dt;
+        remaining -= dt;
+        if (remaining <= 0.0) {
+            break;
+        }
+    }
+    return state;
+}
+
+PtzTrajectory::PtzTrajectory(const PtzPose& from, const PtzPose& to, double seconds, const PtzLimits& limits)
+    : from_(from), to_(to) {
+    double pan = to.pan - from.pan;
+    double pitch = to.pitch - from.pitch;
+    double zoom = to.zoom - from.zoom;
+    duration_ = std::max({seconds,
+                          SCurve::minDuration(pan, limits.pan_velocity, limits.pan_acceleration, limits.pan_jerk),
+                          SCurve::minDuration(pitch, limits.pitch_velocity, limits.pitch_acceleration,
+                                              limits.pitch_jerk),
+                          SCurve::minDuration(zoom, limits.zoom_velocity, limits.zoom_acceleration,
+                                              limits.zoom_jerk)});
+    pan_ = SCurve(pan, duration_);
+    pitch_ = SCurve(pitch, duration_);
+    zoom_ = SCurve(zoom, duration_);
+}
+
+PtzPose PtzTrajectory::pose(double t) const {
+    PtzPose pose;
+    pose.pan = static_cast<float>(from_.pan + pan_.at(t).position);
+    pose.pitch = static_cast<float>(from_.pitch + pitch_.at(t).position);
+    pose.zoom = static_cast<float>(from_.zoom + zoom_.at(t).position);
+    return pose;
+}
+
+PtzPose PtzTrajectory::velocity(double t) const {
+    PtzPose velocity;
+    velocity.pan = static_cast<float>(pan_.at(t).velocity);
+    velocity.pitch = static_cast<float>(pitch_.at(t).velocity);
+    velocity.zoom = static_cast<float>(zoom_.at(t).velocity);
+    return velocity;
+}
+
+PtzMover::PtzMover(std::shared_ptr<CameraHandle> camera)
+    : PtzMover(std::move(camera), Options()) {
+}
+
+PtzMover::PtzMover(std::shared_ptr<CameraHandle> camera, const Options& options)
+    : camera_(std::move(camera)),
+      device_(camera_->device()),
+      zoom_(zoomControl(device_->productType())),
+      options_(options),
+      async_(device_),
+      feedback_(std::make_shared<Feedback>()),
+      steps_(std::make_shared<Steps>()) {
+    thread_ = std::thread(&PtzMover::run, this);
+}
+
+PtzMover::~PtzMover() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    cond_.notify_all();
+    thread_.join();
+    // A move cut short here stops on its own once the last lease runs out
+}
+
+PtzMover::ZoomControl PtzMover::zoomControl(ObsbotProductType product) {
+    switch (product) {
+    case ObsbotProdTailAir:
+        return RatioZoom;
+    case ObsbotProdTiny:
+    case ObsbotProdTiny4k:
+    case ObsbotProdTiny2:
+    case ObsbotProdTiny2Lite:
+    case ObsbotProdMeet:
+    case ObsbotProdMeet4k:
+        return NormalizedZoom;
+    default:
+        return NoZoom;
+    }
+}
+
+int32_t PtzMover::setZoom(Device& device, ZoomControl zoom, float value) {
+    switch (zoom) {
+    case RatioZoom:
+        return device.cameraSetZoomWithSpeedAbsoluteR(static_cast<uint32_t>(std::lround(value * 100.f)), 255);
+    case NormalizedZoom:
+        return device.cameraSetZoomAbsoluteR(value);
+    default:
+        return RM_RET_ERR;
+    }
+}
+
+bool PtzMover::readPose(PtzPose& pose) {
+    Device::AiGimbalStateInfo state;
+    if (device_->aiGetGimbalStateR(&state) != RM_RET_OK) {
+        return false;
+    }
+    pose.pan = state.yaw_euler;
+    pose.pitch = state.pitch_euler;
+    if (zoom_ == RatioZoom) {
+        // Reported with every status push, no round trip needed
+        pose.zoom = device_->cameraStatus().tail_air.digi_zoom_ratio / 100.f;
+    } else if (zoom_ == NormalizedZoom) {
+        if (device_->cameraGetZoomAbsoluteR(pose.zoom) != RM_RET_OK) {
+            return false;
+        }
+    }
+    pose.zoom = std::max(1.f, pose.zoom);
+    return true;
+}
+
+bool PtzMover::moveTo(const PtzPose& target, double seconds) {
+    PtzPose from;
+    if (!readPose(from)) {
+        return false;
+    }
+    PtzPose to = target;
+    if (to.zoom <= 0.f || zoom_ == NoZoom) {
+        to.zoom = from.zoom;
+    }
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        plan_ = PtzTrajectory(from, to, seconds, options_.limits);
+        ++generation_;
+        pending_ = true;
+        halt_ = false;
+        active_ = true;
+    }
+    cond_.notify_all();
+    return true;
+}
+
+void PtzMover::cancel() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    ++generation_;
+    pending_ = false;
+    halt_ = true;
+    active_ = true;
+    cond_.notify_all();
+    // The streamer queues the stop, so it cannot race a last speed command
+    cond_.wait(lock, [this] { return !active_ || stopping_; });
+}
+
+bool PtzMover::wait(std::chrono::milliseconds timeout) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    return cond_.wait_for(lock, timeout, [this] { return !active_; });
+}
+
+bool PtzMover::moving() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return active_;
+}
+
+PtzTrajectory PtzMover::trajectory() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return plan_;
+}
+
+PtzMover::Stats PtzMover::stats() const {
+    Stats stats;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stats = stats_;
+    }
+    // Counted on the camera's strand, final commands included
+    std::lock_guard<std::mutex> lock(steps_->mutex);
+    stats.failed_commands = steps_->failed;
+    stats.command_latency_ms = steps_->latency * 1000.0;
+    return stats;
+}
+
+bool PtzMover::superseded(uint64_t generation) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return stopping_ || generation_ != generation;
+}
+
+void PtzMover::run() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    for (;;) {
+        cond_.wait(lock, [this] { return stopping_ || pending_ || halt_; });
+        if (stopping_) {
+            break;
+        }
+        uint64_t generation = generation_;
+        if (halt_) {
+            halt_ = false;
+            lock.unlock();
+            camera_->post([](Device& device) { device.aiSetGimbalStop(); }, CommandScheduler::Stop);
+            lock.lock();
+        } else {
+            pending_ = false;
+            PtzTrajectory plan = plan_;
+            lock.unlock();
+            stream(plan, generation);
+            lock.lock();
+        }
+        if (generation_ == generation) {
+            active_ = false;
+        }
+        cond_.notify_all();
+    }
+    active_ = false;
+    cond_.notify_all();
+}
+
+void PtzMover::requestState() {
+    if (feedback_->in_flight.exchange(true)) {
+        return;
+    }
+    auto feedback = feedback_;
+    auto issued = std::chrono::steady_clock::now();
+    async_.gimbalState([feedback, issued](const AsyncReply<Device::AiGimbalStateInfo>& reply) {
+        if (reply.ok()) {
+            // The device sampled somewhere inside the round trip
+            auto now = std::chrono::steady_clock::now();
+            std::lock_guard<std::mutex> lock(feedback->mutex);
+            feedback->at = issued + (now - issued) / 2;
+            feedback->pan = reply.value.yaw_euler;
+            feedback->pitch = reply.value.pitch_euler;
+            feedback->valid = true;
+        }
+        feedback->in_flight.store(false);
+    });
+}
+
+// A Stop task posted after the move started has run on the camera; called
+// with steps.mutex held
+bool PtzMover::preempted(Steps& steps, CommandScheduler& scheduler) {
+    if (!steps.preempted && scheduler.executed(CommandScheduler::Stop) > steps.stops) {
+        steps.preempted = true;
+    }
+    return steps.preempted;
+}
+
+// Sends the latest speed, and zoom if it changed; runs on the camera's strand
+void PtzMover::runStep(Device& device, CommandScheduler& scheduler, Steps& steps, ZoomControl zoom) {
+    std::unique_lock<std::mutex> lock(steps.mutex);
+    steps.queued = false;
+    if (preempted(steps, scheduler)) {
+        return;
+    }
+    float pitch_speed = steps.pitch_speed, pan_speed = steps.pan_speed, lease = steps.lease;
+    long zoom_step = steps.zoom > 0.f ? std::lround(steps.zoom * 100.f) : 0;
+    float zoom_value = steps.zoom;
+    auto at = steps.at;
+    lock.unlock();
+
+    uint64_t failed = 0;
+    if (device.aiSetGimbalSpeedTimeR(pitch_speed, pan_speed, lease, lease) != RM_RET_OK) {
+        ++failed;
+    }
+    double latency = Seconds(std::chrono::steady_clock::now() - at).count();
+    bool zoomed = false;
+    if (zoom_step != 0 && zoom_step != steps.sent_zoom) {
+        zoomed = setZoom(device, zoom, zoom_value) == RM_RET_OK;
+    }
+
+    lock.lock();
+    steps.latency = steps.latency == 0.0 ? latency : steps.latency * 0.8 + latency * 0.2;
+    steps.failed += failed;
+    if (zoomed) {
+        steps.sent_zoom = zoom_step;
+    }
+}
+
+void PtzMover::stream(const PtzTrajectory& plan, uint64_t generation) {
+    using Clock = std::chrono::steady_clock;
+    const double period = 1.0 / std::max(1.0, options_.rate_hz);
+    const auto tick = std::chrono::duration_cast<Clock::duration>(Seconds(period));
+    const bool zooming = plan.to().zoom != plan.from().zoom;
+    CommandScheduler* scheduler = &camera_->scheduler();
+    auto steps = steps_;
+    auto zoom = zoom_;
+    {
+        std::lock_guard<std::mutex> lock(feedback_->mutex);
+        feedback_->valid = false;
+    }
+    {
+        std::lock_guard<std::mutex> lock(steps->mutex);
+        steps->stops = scheduler->posted(CommandScheduler::Stop);
+        steps->preempted = false;
+        steps->sent_zoom = 0;
+    }
+
+    const auto start = Clock::now();
+    uint64_t k = 0;
+    Stats stats;
+    for (;;) {
+        if (superseded(generation)) {
+            return;
+        }
+        auto now = Clock::now();
+        double t = Seconds(now - start).count();
+        if (t >= plan.duration()) {
+            break;
+        }
+        double lateness = Seconds(now - (start + tick * k)).count();
+        stats.max_lateness_ms = std::max(stats.max_lateness_ms, lateness * 1000.0);
+        double latency; // seconds until a command queued now lands
+        {
+            std::lock_guard<std::mutex> lock(steps->mutex);
+            if (preempted(*steps, *scheduler)) {
+                return;
+            }
+            latency = steps->latency;
+        }
+
+        // Feedforward: where the plan will be heading when this command lands
+        PtzPose velocity = plan.velocity(t + latency);
+        double pan_speed = velocity.pan;
+        double pitch_speed = velocity.pitch;
+
+        // Feedback: compare the last reading with the plan at its sampling time
+        {
+            std::lock_guard<std::mutex> lock(feedback_->mutex);
+            if (feedback_->valid && feedback_->at >= start) {
+                PtzPose expected = plan.pose(Seconds(feedback_->at - start).count());
+                double pan_error = expected.pan - feedback_->pan;
+                double pitch_error = expected.pitch - feedback_->pitch;
+                stats.max_error_deg = std::max({stats.max_error_deg, std::fabs(pan_error), std::fabs(pitch_error)});
+                pan_speed += clamp(options_.gain * pan_error, options_.max_correction);
+                pitch_speed += clamp(options_.gain * pitch_error, options_.max_correction);
+            }
+        }
+
+        bool post;
+        {
+            std::lock_guard<std::mutex> lock(steps->mutex);
+            steps->pitch_speed = static_cast<float>(clamp(pitch_speed, 90.0));
+            steps->pan_speed = static_cast<float>(clamp(pan_speed, 180.0));
+            steps->lease = static_cast<float>(options_.lease_ticks * period + latency);
+            steps->zoom = zooming ? plan.pose(t + latency).zoom : 0.f;
+            steps->at = Clock::now();
+            post = !steps->queued;
+            steps->queued = true;
+        }
+        if (post && !camera_->post([scheduler, steps, zoom](Device& device) {
+                runStep(device, *scheduler, *steps, zoom);
+            }, CommandScheduler::Motion)) {
+            std::lock_guard<std::mutex> lock(steps->mutex);
+            steps->queued = false;
+            ++steps->failed;
+        }
+        requestState();
+        ++stats.ticks;
+
+        // Next tick on the absolute grid; skip the ones already missed
+        ++k;
+        auto elapsed = Clock::now() - start;
+        if (elapsed > tick * (k + 1)) {
+            ++stats.late_ticks;
+            k = static_cast<uint64_t>(elapsed / tick) + 1;
+        }
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stats_ = stats;
+        }
+        std::this_thread::sleep_until(start + tick * k);
+    }
+
+    // Land exactly on the target, at a speed that covers the remaining
+    // error in about a tick instead of jumping to settle_speed
+    const PtzPose& to = plan.to();
+    double pan_settle = options_.settle_speed, pitch_settle = options_.settle_speed;
+    {
+        std::lock_guard<std::mutex> lock(feedback_->mutex);
+        if (feedback_->valid) {
+            pan_settle = std::min(pan_settle, std::max(0.5, std::fabs(to.pan - feedback_->pan) / period));
+            pitch_settle = std::min(pitch_settle, std::max(0.5, std::fabs(to.pitch - feedback_->pitch) / period));
+        }
+    }
+    float target_zoom = zooming ? to.zoom : 0.f;
+    auto settle = [scheduler, steps, zoom, to, pan_settle, pitch_settle, target_zoom](Device& device) {
+        {
+            std::lock_guard<std::mutex> lock(steps->mutex);
+            if (preempted(*steps, *scheduler)) {
+                return;
+            }
+        }
+        uint64_t failed = 0;
+        if (device.aiSetGimbalSpeedEulerR(static_cast<float>(pitch_settle), static_cast<float>(pan_settle), to.pitch,
+                                          to.pan) != RM_RET_OK) {
+            ++failed;
+        }
+        if (target_zoom > 0.f && setZoom(device, zoom, target_zoom) != RM_RET_OK) {
+            ++failed;
+        }
+        std::lock_guard<std::mutex> lock(steps->mutex);
+        steps->failed += failed;
+    };
+    if (!camera_->post(settle, CommandScheduler::Motion)) {
+        std::lock_guard<std::mutex> lock(steps->mutex);
+        ++steps->failed;
+    }
+    std::lock_guard<std::mutex> lock(mutex_);
+    stats_ = stats;
+}
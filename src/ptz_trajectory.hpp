@@ -0,0 +1,227 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <dev/dev.hpp>
+
+#include "async_device.hpp"
+#include "fleet_manager.hpp"
+
+// Rest-to-rest jerk-limited ("double S") profile along one axis. Each
+// acceleration phase is a jerk ramp up, a constant-acceleration stretch and
+// a jerk ramp down; a cruise at peak velocity sits between the two phases.
+//
+// The shape is fixed by two ratios, so velocity, acceleration and jerk scale
+// as d/T, d/T^2 and d/T^3 and the shortest duration meeting a set of limits
+// has a closed form.
+class SCurve {
+public:
+    struct State {
+        double position; // offset from the start
+        double velocity;
+        double acceleration;
+    };
+
+    // accel_fraction: share of the duration spent in each acceleration
+    // phase, (0, 0.5]. jerk_fraction: share of an acceleration phase spent
+    // ramping the jerk, (0, 0.5]; 0.5 leaves no constant-acceleration part.
+    SCurve(double distance = 0.0, double duration = 0.0, double accel_fraction = 0.3, double jerk_fraction = 0.5);
+
+    // Shortest duration covering `distance` within the limits (all > 0)
+    static double minDuration(double distance, double max_velocity, double max_acceleration, double max_jerk,
+                              double accel_fraction = 0.3, double jerk_fraction = 0.5);
+
+    double distance() const { return distance_; }
+    double duration() const { return duration_; }
+    double peakVelocity() const { return peak_velocity_; }
+
+    // Clamped to [0, duration]
+    State at(double t) const;
+
+private:
+    double distance_;
+    double duration_;
+    double peak_velocity_;
+    double jerk_;
+    double phase_[7]; // segment durations
+};
+
+struct PtzPose {
+    float pan = 0.f;   // yaw, degrees
+    float pitch = 0.f; // degrees
+    // In the unit of the camera's zoom control: the zoom ratio, 1.0 ~ 4.0,
+    // on a Tail Air, the normalized zoom, 1.0 ~ 2.0, elsewhere
+    float zoom = 1.f;
+};
+
+// Axis limits for planning. Durations shorter than these allow are
+// stretched, never the other way round.
+struct PtzLimits {
+    double pan_velocity = 90.0; // deg/s
+    double pan_acceleration = 180.0;
+    double pan_jerk = 720.0;
+    double pitch_velocity = 60.0;
+    double pitch_acceleration = 120.0;
+    double pitch_jerk = 480.0;
+    double zoom_velocity = 1.5; // zoom units/s
+    double zoom_acceleration = 3.0;
+    double zoom_jerk = 12.0;
+};
+
+// Pan, pitch and zoom moving on one clock: every axis starts and stops
+// together, whatever its distance
+class PtzTrajectory {
+public:
+    PtzTrajectory() = default;
+    PtzTrajectory(const PtzPose& from, const PtzPose& to, double seconds, const PtzLimits& limits = PtzLimits());
+
+    double duration() const { return duration_; }
+    const PtzPose& from() const { return from_; }
+    const PtzPose& to() const { return to_; }
+
+    PtzPose pose(double t) const;
+    // Velocities in the same units as the pose, per second
+    PtzPose velocity(double t) const;
+
+private:
+    PtzPose from_;
+    PtzPose to_;
+    double duration_ = 0.0;
+    SCurve pan_;
+    SCurve pitch_;
+    SCurve zoom_;
+};
+
+// Streams a PtzTrajectory to one camera.
+//
+// Every tick sends aiSetGimbalSpeedTimeR with the planned velocity a
+// command latency ahead, plus a proportional correction from the latest
+// aiGetGimbalStateR reading, compared with where the plan was when that
+// reading was taken. Each speed command is a lease of several ticks, so a
+// late or lost command leaves the gimbal gliding at its last speed instead
+// of stopping, and a stalled host stops it within the lease. Ticks are
+// scheduled on absolute time and the plan is sampled at the actual clock,
+// so jitter never accumulates. The move ends with aiSetGimbalSpeedEulerR
+// onto the exact target. Zoom follows with cameraSetZoomWithSpeedAbsoluteR
+// on a Tail Air and cameraSetZoomAbsoluteR on the models that have it, and
+// stays where it is on the others.
+//
+// The commands run on the camera's strand at Motion priority, the latest
+// tick replacing one that has not run yet. A Stop task run on the camera
+// during the move, such as a GimbalStop from the control socket, ends it.
+class PtzMover {
+public:
+    struct Options {
+        double rate_hz = 50.0;
+        double lease_ticks = 4.0;   // speed command validity, in ticks
+        double gain = 2.0;          // 1/s, position error to corrective speed
+        double max_correction = 10.0; // deg/s
+        double settle_speed = 20.0; // deg/s, cap of the final Euler move
+        PtzLimits limits;
+    };
+
+    struct Stats {
+        uint64_t ticks = 0;
+        uint64_t late_ticks = 0;     // started more than a period late
+        uint64_t failed_commands = 0;
+        double max_lateness_ms = 0.0;
+        double max_error_deg = 0.0; // worst measured deviation from the plan
+        double command_latency_ms = 0.0; // current estimate
+    };
+
+    explicit PtzMover(std::shared_ptr<CameraHandle> camera);
+    PtzMover(std::shared_ptr<CameraHandle> camera, const Options& options);
+    ~PtzMover();
+
+    PtzMover(const PtzMover&) = delete;
+    PtzMover& operator=(const PtzMover&) = delete;
+
+    // Reads the current pose, plans a move of at least `seconds` and starts
+    // streaming it. A target zoom <= 0 keeps the current zoom. A move in
+    // progress is abandoned first. Returns false when the pose cannot be
+    // read.
+    bool moveTo(const PtzPose& target, double seconds);
+
+    // Abandons the current move and stops the gimbal where it is
+    void cancel();
+
+    // Waits until the current move has been streamed and its final commands
+    // queued on the camera; false on timeout
+    bool wait(std::chrono::milliseconds timeout);
+    bool moving() const;
+
+    PtzTrajectory trajectory() const;
+    Stats stats() const;
+
+private:
+    // How the camera's zoom is read and set, by product
+    enum ZoomControl {
+        NoZoom,
+        NormalizedZoom, // cameraGetZoomAbsoluteR, cameraSetZoomAbsoluteR
+        RatioZoom,      // status push, cameraSetZoomWithSpeedAbsoluteR
+    };
+
+    // Commands handed to the camera's strand. Shared with posted tasks,
+    // which may run after the mover is gone.
+    struct Steps {
+        std::mutex mutex;
+        float pitch_speed = 0.f;
+        float pan_speed = 0.f;
+        float lease = 0.f;
+        float zoom = 0.f; // <= 0 leaves the zoom alone
+        long sent_zoom = 0; // last zoom sent, in hundredths
+        std::chrono::steady_clock::time_point at; // when the values were set
+        bool queued = false; // a step is posted and has not run yet
+        uint64_t stops = 0;  // Stop tasks posted to the camera before the move
+        bool preempted = false;
+        double latency = 0.0; // seconds, EWMA from setting a step to its reply
+        uint64_t failed = 0;
+    };
+
+    static ZoomControl zoomControl(ObsbotProductType product);
+    static bool preempted(Steps& steps, CommandScheduler& scheduler);
+    static void runStep(Device& device, CommandScheduler& scheduler, Steps& steps, ZoomControl zoom);
+    static int32_t setZoom(Device& device, ZoomControl zoom, float value);
+
+    bool readPose(PtzPose& pose);
+    void run();
+    void stream(const PtzTrajectory& plan, uint64_t generation);
+    void requestState();
+    bool superseded(uint64_t generation) const;
+
+    std::shared_ptr<CameraHandle> camera_;
+    std::shared_ptr<Device> device_;
+    ZoomControl zoom_;
+    Options options_;
+    AsyncDevice async_;
+
+    mutable std::mutex mutex_;
+    std::condition_variable cond_;
+    PtzTrajectory plan_;
+    uint64_t generation_ = 0; // bumped by every moveTo/cancel
+    bool pending_ = false;    // plan_ not picked up yet
+    bool halt_ = false;       // cancel() asked for a stop
+    bool active_ = false;     // a move or stop is pending or streaming
+    bool stopping_ = false;
+    Stats stats_;
+
+    // Latest gimbal state reading. Shared with in-flight callbacks, which
+    // may complete after the mover is gone.
+    struct Feedback {
+        std::mutex mutex;
+        std::chrono::steady_clock::time_point at; // estimated sampling time
+        float pan = 0.f;
+        float pitch = 0.f;
+        bool valid = false;
+        std::atomic<bool> in_flight{false};
+    };
+    std::shared_ptr<Feedback> feedback_;
+    std::shared_ptr<Steps> steps_;
+
+    std::thread thread_;
+};
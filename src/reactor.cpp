@@ -0,0 +1,141 @@
+#include "reactor.hpp"
+
+#include <cerrno>
+#include <csignal>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/signalfd.h>
+#include <unistd.h>
+
+EventFd::EventFd()
+    : fd_(::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC)) {
+}
+
+EventFd::~EventFd() {
+    if (fd_ >= 0) {
+        ::close(fd_);
+    }
+}
+
+void EventFd::signal() {
+    uint64_t one = 1;
+    // EAGAIN only happens when the counter would overflow, the fd is readable anyway
+    while (::write(fd_, &one, sizeof(one)) < 0 && errno == EINTR) {
+    }
+}
+
+uint64_t EventFd::drain() {
+    uint64_t count = 0;
+    while (::read(fd_, &count, sizeof(count)) < 0) {
+        if (errno != EINTR) {
+            return 0;
+        }
+    }
+    return count;
+}
+
+SignalFd::SignalFd(std::initializer_list<int> signals)
+    : fd_(-1) {
+    sigset_t mask;
+    sigemptyset(&mask);
+    for (int signo : signals) {
+        sigaddset(&mask, signo);
+    }
+    if (pthread_sigmask(SIG_BLOCK, &mask, nullptr) != 0) {
+        return;
+    }
+    fd_ = ::signalfd(-1, &mask, SFD_NONBLOCK | SFD_CLOEXEC);
+}
+
+SignalFd::~SignalFd() {
+    if (fd_ >= 0) {
+        ::close(fd_);
+    }
+}
+
+int SignalFd::read() {
+    signalfd_siginfo info;
+    ssize_t n;
+    do {
+        n = ::read(fd_, &info, sizeof(info));
+    } while (n < 0 && errno == EINTR);
+    if (n != static_cast<ssize_t>(sizeof(info))) {
+        return 0;
+    }
+    return static_cast<int>(info.ssi_signo);
+}
+
+Reactor::Reactor()
+    : epfd_(::epoll_create1(EPOLL_CLOEXEC)), stop_(false) {
+    if (valid()) {
+        add(wake_.fd(), EPOLLIN, [this](uint32_t) { wake_.drain(); });
+    }
+}
+
+Reactor::~Reactor() {
+    if (epfd_ >= 0) {
+        ::close(epfd_);
+    }
+}
+
+bool Reactor::add(int fd, uint32_t events, Handler handler) {
+    epoll_event ev{};
+    ev.events = events;
+    ev.data.fd = fd;
+    if (::epoll_ctl(epfd_, EPOLL_CTL_ADD, fd, &ev) != 0) {
+        return false;
+    }
+    handlers_[fd] = std::move(handler);
+    return true;
+}
+
+bool Reactor::modify(int fd, uint32_t events) {
+    epoll_event ev{};
+    ev.events = events;
+    ev.data.fd = fd;
+    return ::epoll_ctl(epfd_, EPOLL_CTL_MOD, fd, &ev) == 0;
+}
+
+void Reactor::remove(int fd) {
+    ::epoll_ctl(epfd_, EPOLL_CTL_DEL, fd, nullptr);
+    handlers_.erase(fd);
+}
+
+int Reactor::poll(int timeout_ms) {
+    epoll_event events[16];
+    int n = ::epoll_wait(epfd_, events, 16, timeout_ms);
+    if (n < 0) {
+        return errno == EINTR ? 0 : -1;
+    }
+
+    int dispatched = 0;
+    for (int i = 0; i < n; ++i) {
+        // A previous handler in this batch may have removed the fd
+        auto it = handlers_.find(events[i].data.fd);
+        if (it == handlers_.end()) {
+            continue;
+        }
+        // Run a copy so a handler can safely remove itself
+        Handler handler = it->second;
+        handler(events[i].events);
+        ++dispatched;
+    }
+    return dispatched;
+}
+
+void Reactor::run() {
+    while (!stop_.load(std::memory_order_acquire)) {
+        if (poll(-1) < 0) {
+            break;
+        }
+    }
+}
+
+void Reactor::stop() {
+    stop_.store(true, std::memory_order_release);
+    wake_.signal();
+}
+
+bool Reactor::stopped() const {
+    return stop_.load(std::memory_order_acquire);
+}
@@ -0,0 +1,83 @@
+#pragma once
+
+#include <cstdint>
+#include <atomic>
+#include <functional>
+#include <initializer_list>
+#include <unordered_map>
+
+// Counter-style eventfd used to wake a Reactor from any thread
+class EventFd {
+public:
+    EventFd();
+    ~EventFd();
+
+    EventFd(const EventFd&) = delete;
+    EventFd& operator=(const EventFd&) = delete;
+
+    int fd() const { return fd_; }
+    bool valid() const { return fd_ >= 0; }
+
+    // Async-signal-safe; may be called from SDK callback threads
+    void signal();
+
+    // Reset the counter, returns the number of signals since the last drain
+    uint64_t drain();
+
+private:
+    int fd_;
+};
+
+// Blocks the given signals for the whole process and reports them through a fd.
+// Must be created before any other thread is started so the mask is inherited.
+class SignalFd {
+public:
+    SignalFd(std::initializer_list<int> signals);
+    ~SignalFd();
+
+    SignalFd(const SignalFd&) = delete;
+    SignalFd& operator=(const SignalFd&) = delete;
+
+    int fd() const { return fd_; }
+    bool valid() const { return fd_ >= 0; }
+
+    // Returns the pending signal number, or 0 if none is pending
+    int read();
+
+private:
+    int fd_;
+};
+
+// Single-threaded epoll loop. add()/remove()/poll()/run() belong to the loop
+// thread, stop() may be called from anywhere.
+class Reactor {
+public:
+    using Handler = std::function<void(uint32_t events)>;
+
+    Reactor();
+    ~Reactor();
+
+    Reactor(const Reactor&) = delete;
+    Reactor& operator=(const Reactor&) = delete;
+
+    bool valid() const { return epfd_ >= 0 && wake_.valid(); }
+
+    bool add(int fd, uint32_t events, Handler handler);
+    bool modify(int fd, uint32_t events);
+    void remove(int fd);
+
+    // Wait up to timeout_ms (-1 = forever) and dispatch ready handlers once.
+    // Returns the number of handlers run, or -1 on error.
+    int poll(int timeout_ms);
+
+    // Dispatch until stop() is called
+    void run();
+    void stop();
+    bool stopped() const;
+
+private:
+    int epfd_;
+    EventFd wake_;
+    std::atomic<bool> stop_;
+    std::unordered_map<int, Handler> handlers_;
+};
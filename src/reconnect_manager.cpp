@@ -0,0 +1,236 @@
+#include "reconnect_manager.hpp"
+
+#include <algorithm>
+#include <functional>
+#include <vector>
+
+ReconnectManager::ReconnectManager(FleetManager& fleet, size_t depth)
+    : fleet_(fleet), snapshotter_(depth) {
+}
+
+void ReconnectManager::setListener(Listener listener) {
+    listener_ = std::move(listener);
+}
+
+bool ReconnectManager::setAiMode(const std::string& sn, Device::AiWorkModeType mode, int32_t sub_mode) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        DesiredState& state = entries_[sn].state;
+        state.has_ai_mode = true;
+        state.ai_mode = mode;
+        state.ai_sub_mode = sub_mode;
+    }
+    return fleet_.post(
+        sn, [mode, sub_mode](Device& device) { device.cameraSetAiModeU(mode, sub_mode); },
+        CommandScheduler::Motion);
+}
+
+bool ReconnectManager::setZoom(const std::string& sn, float zoom) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        DesiredState& state = entries_[sn].state;
+        state.has_zoom = true;
+        state.zoom = zoom;
+    }
+    auto camera = fleet_.camera(sn);
+    return camera && camera->post([camera, zoom](Device&) { camera->settings().setZoom(zoom); },
+                                  CommandScheduler::Motion);
+}
+
+bool ReconnectManager::setPresetAction(const std::string& sn, int32_t id, const Device::PresetsAction& action) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        entries_[sn].state.preset_actions[id] = action;
+    }
+    return fleet_.post(
+        sn, [id, action](Device& device) { device.aiSetPresetsActionR(action, id); }, CommandScheduler::Motion);
+}
+
+bool ReconnectManager::setSetting(const std::string& sn, SettingsSnapshot::Setting which,
+                                  SettingsSnapshot::Value value) {
+    if (which >= SettingsSnapshot::SettingCount) {
+        return false;
+    }
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        entries_[sn].state.settings.set(which, value);
+    }
+    auto camera = fleet_.camera(sn);
+    return camera && camera->post([camera, which, value](Device&) { camera->settings().set(which, value); },
+                                  CommandScheduler::Settings);
+}
+
+bool ReconnectManager::desired(const std::string& sn, DesiredState& out) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = entries_.find(sn);
+    if (it == entries_.end()) {
+        return false;
+    }
+    out = it->second.state;
+    return true;
+}
+
+void ReconnectManager::forget(const std::string& sn) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    entries_.erase(sn);
+}
+
+void ReconnectManager::onDeviceChange(const std::shared_ptr<CameraHandle>& camera, bool connected) {
+    const std::string& sn = camera->sn();
+    if (!connected) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = entries_.find(sn);
+        // Before its restore finished, the shadow holds the defaults the
+        // camera came back with rather than its desired state
+        if (it == entries_.end() || it->second.settled != it->second.generation) {
+            return;
+        }
+        DesiredState& state = it->second.state;
+        for (size_t i = 0; i < SettingsSnapshot::SettingCount; ++i) {
+            auto which = static_cast<SettingsSnapshot::Setting>(i);
+            SettingsSnapshot::Value value;
+            if (camera->settings().known(which, value)) {
+                state.settings.set(which, value);
+            }
+        }
+        float zoom;
+        if (camera->settings().knownZoom(zoom)) {
+            state.has_zoom = true;
+            state.zoom = zoom;
+        }
+        return;
+    }
+
+    auto attached = Clock::now();
+    DesiredState state;
+    bool first;
+    uint64_t generation;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        Entry& entry = entries_[sn];
+        first = !entry.captured;
+        entry.captured = true;
+        generation = ++entry.generation;
+        state = entry.state;
+    }
+    if (!state.empty()) {
+        camera->post(
+            [this, camera, state, attached, generation](Device& device) {
+                restore(camera, device, state, attached, generation);
+            },
+            CommandScheduler::Motion);
+    } else if (!first) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        entries_[sn].settled = generation;
+    }
+    if (first) {
+        camera->post([this, camera, generation](Device& device) { capture(*camera, device, generation); },
+                     CommandScheduler::Bulk);
+    }
+}
+
+void ReconnectManager::settle(const std::string& sn, uint64_t generation) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = entries_.find(sn);
+    if (it != entries_.end() && it->second.generation == generation) {
+        it->second.settled = generation;
+    }
+}
+
+void ReconnectManager::capture(CameraHandle& camera, Device& device, uint64_t generation) {
+    SettingsSnapshot snapshot;
+    bool captured = snapshotter_.capture(device, snapshot);
+    float zoom = 1.f;
+    bool zoomed = device.cameraGetZoomAbsoluteR(zoom) == RM_RET_OK;
+    if (captured) {
+        camera.settings().seed(snapshot);
+    }
+    {
+        // Values recorded meanwhile win over the baseline
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = entries_.find(camera.sn());
+        if (it != entries_.end()) {
+            DesiredState& state = it->second.state;
+            for (size_t i = 0; i < SettingsSnapshot::SettingCount; ++i) {
+                auto which = static_cast<SettingsSnapshot::Setting>(i);
+                if (snapshot.has(which) && !state.settings.has(which)) {
+                    state.settings.set(which, snapshot.get(which));
+                }
+            }
+            if (zoomed && !state.has_zoom) {
+                state.has_zoom = true;
+                state.zoom = zoom;
+            }
+        }
+    }
+    settle(camera.sn(), generation);
+    captures_.fetch_add(1, std::memory_order_relaxed);
+}
+
+void ReconnectManager::restore(const std::shared_ptr<CameraHandle>& camera, Device& device,
+                               const DesiredState& state, Clock::time_point attached, uint64_t generation) {
+    Report report;
+    std::atomic<size_t> failed{0};
+    auto run = [&](std::vector<std::function<int32_t()>>& jobs) {
+        snapshotter_.parallel(jobs.size(), [&](size_t i) {
+            if (jobs[i]() != RM_RET_OK) {
+                failed.fetch_add(1, std::memory_order_relaxed);
+            }
+        });
+        report.written += jobs.size();
+    };
+
+    // What the gimbal does depends on these
+    std::vector<std::function<int32_t()>> jobs;
+    if (state.has_ai_mode) {
+        jobs.push_back([&] { return device.cameraSetAiModeU(state.ai_mode, state.ai_sub_mode); });
+    }
+    if (state.has_zoom) {
+        jobs.push_back([&] { return camera->settings().setZoom(state.zoom); });
+    }
+    run(jobs);
+    report.motion = std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - attached);
+
+    // An action for a preset that is gone would only fail
+    jobs.clear();
+    std::vector<Device::PresetPosInfo> presets;
+    bool listed = !state.preset_actions.empty() && camera->presets().presets(presets);
+    for (auto& entry : state.preset_actions) {
+        bool exists = !listed || std::any_of(presets.begin(), presets.end(),
+                                             [&](const Device::PresetPosInfo& p) { return p.id == entry.first; });
+        if (!exists) {
+            ++report.skipped;
+            continue;
+        }
+        jobs.push_back([&] { return device.aiSetPresetsActionR(entry.second, entry.first); });
+    }
+    run(jobs);
+    report.failed = failed.load();
+
+    // The rest waits behind other cameras' moves like any settings write
+    auto settings = state.settings;
+    if (!camera->post(
+            [this, camera, settings, report, attached, generation](Device& settings_device) {
+                restoreSettings(*camera, settings_device, settings, report, attached, generation);
+            },
+            CommandScheduler::Settings)) {
+        settle(camera->sn(), generation);
+    }
+}
+
+void ReconnectManager::restoreSettings(CameraHandle& camera, Device& device, const SettingsSnapshot& target,
+                                       Report report, Clock::time_point attached, uint64_t generation) {
+    SettingsSnapshotter::RestoreReport settings;
+    if (snapshotter_.apply(device, SettingsSnapshot(), target, &settings)) {
+        camera.settings().seed(target);
+    }
+    report.written += settings.written;
+    report.failed += settings.failed;
+    report.total = std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - attached);
+
+    settle(camera.sn(), generation);
+    restores_.fetch_add(1, std::memory_order_relaxed);
+    if (listener_) {
+        listener_(camera.sn(), report);
+    }
+}
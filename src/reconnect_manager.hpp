@@ -0,0 +1,105 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <dev/dev.hpp>
+
+#include "fleet_manager.hpp"
+#include "settings_snapshot.hpp"
+
+// State a camera should be in, kept across unplugs
+struct DesiredState {
+    bool has_ai_mode = false;
+    Device::AiWorkModeType ai_mode = Device::AiWorkModeNone;
+    int32_t ai_sub_mode = 0;
+    bool has_zoom = false;
+    float zoom = 1.f;
+    std::map<int32_t, Device::PresetsAction> preset_actions; // by preset id
+    SettingsSnapshot settings;
+
+    bool empty() const { return !has_ai_mode && !has_zoom && preset_actions.empty() && settings.present == 0; }
+};
+
+// Puts a camera back into its desired state when it comes back after an
+// unplug, a firmware reboot or a USB reset.
+//
+// The desired state of each SN comes from three places. The setters below
+// record it and apply it right away. When a camera is seen for the first
+// time, its image settings and zoom are captured as a baseline. On a
+// disconnect, whatever the camera's SettingsShadow learned, from writes and
+// from status pushes, is merged in.
+//
+// On reconnect the state goes out on the camera's scheduler with up to
+// `depth` calls in flight. AI mode and zoom go first, since they decide
+// where the gimbal points, then preset actions, all at Motion priority. The
+// other settings follow at Settings priority, modes before values.
+class ReconnectManager {
+public:
+    struct Report {
+        size_t written = 0;
+        size_t failed = 0;
+        size_t skipped = 0; // preset actions for presets the camera lacks
+        std::chrono::microseconds motion{0}; // from attach until AI mode and zoom were set
+        std::chrono::microseconds total{0};  // from attach until the last write
+    };
+    // Called on a pool worker after every restore
+    using Listener = std::function<void(const std::string& sn, const Report& report)>;
+
+    explicit ReconnectManager(FleetManager& fleet, size_t depth = 4);
+
+    ReconnectManager(const ReconnectManager&) = delete;
+    ReconnectManager& operator=(const ReconnectManager&) = delete;
+
+    // Register before the first camera attaches
+    void setListener(Listener listener);
+
+    // Record the desired value and, if the camera is attached, queue the
+    // write. Return whether a write was queued.
+    bool setAiMode(const std::string& sn, Device::AiWorkModeType mode, int32_t sub_mode = 0);
+    bool setZoom(const std::string& sn, float zoom);
+    bool setPresetAction(const std::string& sn, int32_t id, const Device::PresetsAction& action);
+    bool setSetting(const std::string& sn, SettingsSnapshot::Setting which, SettingsSnapshot::Value value);
+
+    bool desired(const std::string& sn, DesiredState& out) const;
+    void forget(const std::string& sn);
+
+    // Call from the FleetManager listener
+    void onDeviceChange(const std::shared_ptr<CameraHandle>& camera, bool connected);
+
+    uint64_t restores() const { return restores_.load(std::memory_order_relaxed); }
+    uint64_t captures() const { return captures_.load(std::memory_order_relaxed); }
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    struct Entry {
+        DesiredState state;
+        bool captured = false;   // baseline read, or being read
+        uint64_t generation = 0; // attaches so far
+        uint64_t settled = 0;    // last attach whose restore or capture finished
+    };
+
+    void capture(CameraHandle& camera, Device& device, uint64_t generation);
+    void restore(const std::shared_ptr<CameraHandle>& camera, Device& device, const DesiredState& state,
+                 Clock::time_point attached, uint64_t generation);
+    void restoreSettings(CameraHandle& camera, Device& device, const SettingsSnapshot& target, Report report,
+                         Clock::time_point attached, uint64_t generation);
+    void settle(const std::string& sn, uint64_t generation);
+
+    FleetManager& fleet_;
+    SettingsSnapshotter snapshotter_;
+    Listener listener_;
+
+    mutable std::mutex mutex_;
+    std::map<std::string, Entry> entries_;
+
+    std::atomic<uint64_t> restores_{0};
+    std::atomic<uint64_t> captures_{0};
+};
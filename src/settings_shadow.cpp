@@ -0,0 +1,149 @@
+#include "settings_shadow.hpp"
+
+#include <cmath>
+#include <utility>
+
+SettingsShadow::SettingsShadow(std::shared_ptr<Device> device, std::chrono::milliseconds hold_off)
+    : device_(std::move(device)), hold_off_(hold_off), product_(device_->productType()) {
+}
+
+int32_t SettingsShadow::set(Setting which, Value value) {
+    if (which >= SettingsSnapshot::SettingCount) {
+        return RM_RET_ERR;
+    }
+    // The camera reports no temperature outside manual white balance
+    if (which == SettingsSnapshot::WhiteBalance && value.a != Device::DevWhiteBalanceManual) {
+        value.b = 0;
+    }
+    Device& device = *device_;
+    return write(which, value, [&] { return SettingsSnapshotter::write(device, which, value); });
+}
+
+int32_t SettingsShadow::setZoom(float zoom) {
+    Device& device = *device_;
+    return write(kZoom, {static_cast<int32_t>(std::lround(zoom * 100.f)), 0},
+                 [&] { return device.cameraSetZoomAbsoluteR(zoom); });
+}
+
+template <typename Send>
+int32_t SettingsShadow::write(size_t index, Value value, Send send) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        Slot& slot = slots_[index];
+        if (slot.known && slot.in_flight == 0 && slot.value == value) {
+            hits_.fetch_add(1, std::memory_order_relaxed);
+            return RM_RET_OK;
+        }
+        slot.contended = slot.contended || slot.in_flight > 0;
+        ++slot.in_flight;
+    }
+    misses_.fetch_add(1, std::memory_order_relaxed);
+    int32_t ret = send();
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    Slot& slot = slots_[index];
+    --slot.in_flight;
+    // Overlapping writes may land in either order
+    slot.known = ret == RM_RET_OK && !slot.contended;
+    slot.value = value;
+    slot.written = std::chrono::steady_clock::now();
+    if (slot.in_flight == 0) {
+        slot.contended = false;
+    }
+    return ret;
+}
+
+void SettingsShadow::seed(const SettingsSnapshot& snapshot) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (size_t i = 0; i < SettingsSnapshot::SettingCount; ++i) {
+        auto which = static_cast<Setting>(i);
+        Slot& slot = slots_[i];
+        if (snapshot.has(which) && slot.in_flight == 0) {
+            slot.value = snapshot.get(which);
+            slot.known = true;
+        }
+    }
+}
+
+bool SettingsShadow::known(Setting which, Value& value) const {
+    if (which >= SettingsSnapshot::SettingCount) {
+        return false;
+    }
+    std::lock_guard<std::mutex> lock(mutex_);
+    const Slot& slot = slots_[which];
+    if (slot.known) {
+        value = slot.value;
+    }
+    return slot.known;
+}
+
+bool SettingsShadow::knownZoom(float& zoom) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    const Slot& slot = slots_[kZoom];
+    if (slot.known) {
+        zoom = static_cast<float>(slot.value.a) / 100.f;
+    }
+    return slot.known;
+}
+
+void SettingsShadow::invalidate() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (auto& slot : slots_) {
+        slot.known = false;
+    }
+}
+
+void SettingsShadow::onStatus(const Device::CameraStatus& status) {
+    auto now = std::chrono::steady_clock::now();
+    std::lock_guard<std::mutex> lock(mutex_);
+    switch (product_) {
+    case ObsbotProdTailAir:
+    case ObsbotProdTail2: {
+        const auto& tail = status.tail_air;
+        adopt(SettingsSnapshot::Brightness, {tail.brightness, 0}, now);
+        adopt(SettingsSnapshot::Contrast, {tail.contrast, 0}, now);
+        adopt(SettingsSnapshot::Hue, {tail.hue, 0}, now);
+        adopt(SettingsSnapshot::Saturation, {tail.saturation, 0}, now);
+        adopt(SettingsSnapshot::Sharpness, {tail.sharpness, 0}, now);
+        adopt(SettingsSnapshot::AntiFlicker, {tail.media_flags.anti_flick, 0}, now);
+        forgetOnChange(kZoom, tail.digi_zoom_ratio, now);
+        break;
+    }
+    case ObsbotProdMeet:
+    case ObsbotProdMeet4k:
+        adopt(SettingsSnapshot::AntiFlicker, {status.meet.anti_flicker, 0}, now);
+        forgetOnChange(kZoom, status.meet.zoom_ratio, now);
+        break;
+    default:
+        adopt(SettingsSnapshot::AntiFlicker, {status.tiny.anti_flicker, 0}, now);
+        forgetOnChange(kZoom, status.tiny.zoom_ratio, now);
+        break;
+    }
+}
+
+void SettingsShadow::adopt(size_t index, Value value, std::chrono::steady_clock::time_point now) {
+    Slot& slot = slots_[index];
+    if (slot.in_flight > 0 || (slot.known && slot.value == value)) {
+        return;
+    }
+    refreshes_.fetch_add(1, std::memory_order_relaxed);
+    if (now - slot.written < hold_off_) {
+        // May describe the camera before our last write
+        slot.known = false;
+        return;
+    }
+    slot.value = value;
+    slot.known = true;
+}
+
+void SettingsShadow::forgetOnChange(size_t index, int32_t reported, std::chrono::steady_clock::time_point now) {
+    Slot& slot = slots_[index];
+    if (reported != slot.reported) {
+        // Right after our own write the change is most likely that write
+        if (slot.reported >= 0 && slot.known && now - slot.written >= hold_off_) {
+            refreshes_.fetch_add(1, std::memory_order_relaxed);
+            slot.known = false;
+        }
+        slot.reported = reported;
+    }
+}
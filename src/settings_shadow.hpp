@@ -0,0 +1,88 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <dev/dev.hpp>
+
+#include "settings_snapshot.hpp"
+
+// Write-through shadow of one camera's settings that drops no-op writes.
+//
+// Every setter that the camera acknowledges records its value; a later
+// write of the same value returns RM_RET_OK without a round trip. Failed
+// writes, and writes that overlapped another write of the same setting,
+// leave the value unknown, so the next write always goes out.
+//
+// Status pushes keep the shadow honest: image controls and anti-flicker are
+// adopted from the push. The pushed zoom uses another scale than
+// cameraSetZoomAbsoluteR, so a change of it, other than right after our own
+// write, forgets the zoom value. For `hold_off` after a write a push may
+// still predate it, so a disagreeing value only makes the setting unknown
+// instead of replacing it.
+class SettingsShadow {
+public:
+    using Setting = SettingsSnapshot::Setting;
+    using Value = SettingsSnapshot::Value;
+
+    explicit SettingsShadow(std::shared_ptr<Device> device,
+                            std::chrono::milliseconds hold_off = std::chrono::milliseconds(500));
+
+    SettingsShadow(const SettingsShadow&) = delete;
+    SettingsShadow& operator=(const SettingsShadow&) = delete;
+
+    // Same result as the SDK setter, or RM_RET_OK for a skipped write
+    int32_t set(Setting which, Value value);
+    int32_t setZoom(float zoom); // cameraSetZoomAbsoluteR
+    int32_t setBrightness(int32_t brightness) { return set(SettingsSnapshot::Brightness, {brightness, 0}); }
+    int32_t setContrast(int32_t contrast) { return set(SettingsSnapshot::Contrast, {contrast, 0}); }
+    int32_t setHue(int32_t hue) { return set(SettingsSnapshot::Hue, {hue, 0}); }
+    int32_t setSaturation(int32_t saturation) { return set(SettingsSnapshot::Saturation, {saturation, 0}); }
+    int32_t setSharpness(int32_t sharpness) { return set(SettingsSnapshot::Sharpness, {sharpness, 0}); }
+
+    // Adopts values read elsewhere, e.g. by SettingsSnapshotter::capture()
+    void seed(const SettingsSnapshot& snapshot);
+    bool known(Setting which, Value& value) const;
+    bool knownZoom(float& zoom) const;
+    void invalidate();
+
+    // Feed every status push of this camera, e.g. from a StatusPump sink
+    void onStatus(const Device::CameraStatus& status);
+
+    uint64_t hits() const { return hits_.load(std::memory_order_relaxed); }     // writes skipped
+    uint64_t misses() const { return misses_.load(std::memory_order_relaxed); } // writes sent
+    uint64_t refreshes() const { return refreshes_.load(std::memory_order_relaxed); }
+
+private:
+    static constexpr size_t kZoom = SettingsSnapshot::SettingCount;
+    static constexpr size_t kSlots = kZoom + 1;
+
+    struct Slot {
+        Value value;
+        bool known = false;
+        int in_flight = 0;
+        bool contended = false; // another write started while one was in flight
+        std::chrono::steady_clock::time_point written;
+        int32_t reported = -1; // last raw status value, for forget-on-change
+    };
+
+    template <typename Send>
+    int32_t write(size_t slot, Value value, Send send);
+    // Call with mutex_ held
+    void adopt(size_t slot, Value value, std::chrono::steady_clock::time_point now);
+    void forgetOnChange(size_t slot, int32_t reported, std::chrono::steady_clock::time_point now);
+
+    std::shared_ptr<Device> device_;
+    std::chrono::milliseconds hold_off_;
+    ObsbotProductType product_;
+
+    mutable std::mutex mutex_;
+    std::array<Slot, kSlots> slots_;
+
+    std::atomic<uint64_t> hits_{0};
+    std::atomic<uint64_t> misses_{0};
+    std::atomic<uint64_t> refreshes_{0};
+};
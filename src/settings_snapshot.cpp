@@ -0,0 +1,276 @@
+#include "settings_snapshot.hpp"
+
+#include <algorithm>
+#include <atomic>
+
+namespace {
+
+constexpr uint8_t kSnapshotVersion = 1;
+
+const char* const kSettingNames[SettingsSnapshot::SettingCount] = {
+    "exposure_mode", "white_balance", "focus_mode", "audio_agc", "audio_noise_reduce", "brightness",
+    "contrast", "hue", "saturation", "sharpness", "ev_bias", "iso", "shutter", "anti_flicker", "ae_lock",
+    "focus_position", "audio_volume",
+};
+
+void putVarint(std::vector<uint8_t>& out, uint32_t value) {
+    while (value >= 0x80) {
+        out.push_back(static_cast<uint8_t>(value | 0x80));
+        value >>= 7;
+    }
+    out.push_back(static_cast<uint8_t>(value));
+}
+
+bool getVarint(const uint8_t*& p, const uint8_t* end, uint32_t& value) {
+    value = 0;
+    for (int shift = 0; shift < 35; shift += 7) {
+        if (p == end) {
+            return false;
+        }
+        uint8_t byte = *p++;
+        value |= static_cast<uint32_t>(byte & 0x7f) << shift;
+        if (!(byte & 0x80)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+uint32_t zigzag(int32_t value) {
+    return (static_cast<uint32_t>(value) << 1) ^ static_cast<uint32_t>(value >> 31);
+}
+
+int32_t unzigzag(uint32_t value) {
+    return static_cast<int32_t>((value >> 1) ^ (~(value & 1) + 1));
+}
+
+} // namespace
+
+size_t SettingsSnapshot::size() const {
+    return static_cast<size_t>(__builtin_popcount(present));
+}
+
+const char* SettingsSnapshot::name(Setting which) {
+    return which < SettingCount ? kSettingNames[which] : "unknown";
+}
+
+int SettingsSnapshot::stage(Setting which) {
+    return which < Brightness ? 0 : 1;
+}
+
+std::vector<uint8_t> SettingsSnapshot::encode() const {
+    std::vector<uint8_t> out;
+    out.reserve(2 + 5 + size() * 4);
+    out.push_back(kSnapshotVersion);
+    out.push_back(SettingCount);
+    putVarint(out, present);
+    for (size_t i = 0; i < SettingCount; ++i) {
+        if (present & (1u << i)) {
+            putVarint(out, zigzag(values[i].a));
+            putVarint(out, zigzag(values[i].b));
+        }
+    }
+    return out;
+}
+
+bool SettingsSnapshot::decode(const uint8_t* data, size_t size) {
+    const uint8_t* p = data;
+    const uint8_t* end = data + size;
+    if (size < 2 || p[0] != kSnapshotVersion) {
+        return false;
+    }
+    // Snapshots from a build with fewer settings decode; newer ones do not
+    size_t count = p[1];
+    p += 2;
+    uint32_t mask;
+    if (count > SettingCount || !getVarint(p, end, mask) || (count < 32 && (mask >> count) != 0)) {
+        return false;
+    }
+    SettingsSnapshot decoded;
+    for (size_t i = 0; i < count; ++i) {
+        if (mask & (1u << i)) {
+            uint32_t a, b;
+            if (!getVarint(p, end, a) || !getVarint(p, end, b)) {
+                return false;
+            }
+            decoded.set(static_cast<Setting>(i), {unzigzag(a), unzigzag(b)});
+        }
+    }
+    if (p != end) {
+        return false;
+    }
+    *this = decoded;
+    return true;
+}
+
+SettingsSnapshotter::SettingsSnapshotter(size_t depth)
+    : depth_(std::max<size_t>(depth, 1)), pool_(depth_ - 1) {
+}
+
+bool SettingsSnapshotter::capture(Device& device, SettingsSnapshot& out) {
+    std::array<SettingsSnapshot::Value, SettingsSnapshot::SettingCount> values;
+    std::array<int32_t, SettingsSnapshot::SettingCount> results;
+    parallel(SettingsSnapshot::SettingCount, [&](size_t i) {
+        results[i] = read(device, static_cast<SettingsSnapshot::Setting>(i), values[i]);
+    });
+
+    out = SettingsSnapshot();
+    for (size_t i = 0; i < SettingsSnapshot::SettingCount; ++i) {
+        if (results[i] == RM_RET_OK) {
+            out.set(static_cast<SettingsSnapshot::Setting>(i), values[i]);
+        }
+    }
+    return out.present != 0;
+}
+
+bool SettingsSnapshotter::restore(Device& device, const SettingsSnapshot& target, RestoreReport* report) {
+    SettingsSnapshot current;
+    capture(device, current);
+    return apply(device, current, target, report);
+}
+
+bool SettingsSnapshotter::apply(Device& device, const SettingsSnapshot& current, const SettingsSnapshot& target,
+                                RestoreReport* report) {
+    RestoreReport local;
+    std::atomic<size_t> failed{0};
+    for (int stage = 0; stage < 2; ++stage) {
+        std::vector<SettingsSnapshot::Setting> changes;
+        for (size_t i = 0; i < SettingsSnapshot::SettingCount; ++i) {
+            auto which = static_cast<SettingsSnapshot::Setting>(i);
+            if (!target.has(which) || SettingsSnapshot::stage(which) != stage) {
+                continue;
+            }
+            if (current.has(which) && current.get(which) == target.get(which)) {
+                ++local.unchanged;
+            } else {
+                changes.push_back(which);
+            }
+        }
+        parallel(changes.size(), [&](size_t i) {
+            if (write(device, changes[i], target.get(changes[i])) != RM_RET_OK) {
+                failed.fetch_add(1, std::memory_order_relaxed);
+            }
+        });
+        local.written += changes.size();
+    }
+    local.failed = failed.load();
+    if (report) {
+        *report = local;
+    }
+    return local.failed == 0;
+}
+
+int32_t SettingsSnapshotter::read(Device& device, SettingsSnapshot::Setting which, SettingsSnapshot::Value& value) {
+    value = SettingsSnapshot::Value();
+    int32_t ret = RM_RET_ERR;
+    switch (which) {
+    case SettingsSnapshot::ExposureMode:
+        return device.cameraGetExposureModeR(value.a);
+    case SettingsSnapshot::WhiteBalance: {
+        Device::DevWhiteBalanceType type;
+        ret = device.cameraGetWhiteBalanceR(type, value.b);
+        value.a = type;
+        // The temperature only means something in manual mode
+        if (type != Device::DevWhiteBalanceManual) {
+            value.b = 0;
+        }
+        return ret;
+    }
+    case SettingsSnapshot::FocusMode: {
+        Device::DevAutoFocusType type;
+        ret = device.cameraGetAutoFocusModeR(type);
+        value.a = type;
+        return ret;
+    }
+    case SettingsSnapshot::AudioAgc: {
+        bool enabled;
+        ret = device.cameraGetAudioAGCR(enabled);
+        value.a = enabled;
+        return ret;
+    }
+    case SettingsSnapshot::AudioNoiseReduce: {
+        bool enabled;
+        ret = device.cameraGetAudioNoiseReduceR(enabled, value.b);
+        value.a = enabled;
+        return ret;
+    }
+    case SettingsSnapshot::Brightness:
+        return device.cameraGetImageBrightnessR(value.a);
+    case SettingsSnapshot::Contrast:
+        return device.cameraGetImageContrastR(value.a);
+    case SettingsSnapshot::Hue:
+        return device.cameraGetImageHueR(value.a);
+    case SettingsSnapshot::Saturation:
+        return device.cameraGetImageSaturationR(value.a);
+    case SettingsSnapshot::Sharpness:
+        return device.cameraGetImageSharpR(value.a);
+    case SettingsSnapshot::EvBias:
+        return device.cameraGetPAEEvBiasR(value.a);
+    case SettingsSnapshot::Iso:
+        return device.cameraGetMAEIsoR(value.a);
+    case SettingsSnapshot::Shutter:
+        return device.cameraGetMAEShutterR(value.a);
+    case SettingsSnapshot::AntiFlicker:
+        return device.cameraGetAntiFlickR(value.a);
+    case SettingsSnapshot::AeLock: {
+        bool enabled;
+        ret = device.cameraGetAELockR(enabled);
+        value.a = enabled;
+        return ret;
+    }
+    case SettingsSnapshot::FocusPosition:
+        return device.cameraGetFocusPosR(value.a);
+    case SettingsSnapshot::AudioVolume: {
+        int16_t volume;
+        ret = device.cameraGetAudioVolumeR(volume);
+        value.a = volume;
+        return ret;
+    }
+    case SettingsSnapshot::SettingCount:
+        break;
+    }
+    return ret;
+}
+
+int32_t SettingsSnapshotter::write(Device& device, SettingsSnapshot::Setting which,
+                                   const SettingsSnapshot::Value& value) {
+    switch (which) {
+    case SettingsSnapshot::ExposureMode:
+        return device.cameraSetExposureModeR(value.a);
+    case SettingsSnapshot::WhiteBalance:
+        return device.cameraSetWhiteBalanceR(static_cast<Device::DevWhiteBalanceType>(value.a), value.b);
+    case SettingsSnapshot::FocusMode:
+        return device.cameraSetAutoFocusModeR(static_cast<Device::DevAutoFocusType>(value.a));
+    case SettingsSnapshot::AudioAgc:
+        return device.cameraSetAudioAGCR(value.a != 0);
+    case SettingsSnapshot::AudioNoiseReduce:
+        return device.cameraSetAudioNoiseReduceR(value.a != 0, value.b);
+    case SettingsSnapshot::Brightness:
+        return device.cameraSetImageBrightnessR(value.a);
+    case SettingsSnapshot::Contrast:
+        return device.cameraSetImageContrastR(value.a);
+    case SettingsSnapshot::Hue:
+        return device.cameraSetImageHueR(value.a);
+    case SettingsSnapshot::Saturation:
+        return device.cameraSetImageSaturationR(value.a);
+    case SettingsSnapshot::Sharpness:
+        return device.cameraSetImageSharpR(value.a);
+    case SettingsSnapshot::EvBias:
+        return device.cameraSetPAEEvBiasR(value.a);
+    case SettingsSnapshot::Iso:
+        return device.cameraSetMAEIsoR(value.a);
+    case SettingsSnapshot::Shutter:
+        return device.cameraSetMAEShutterR(value.a);
+    case SettingsSnapshot::AntiFlicker:
+        return device.cameraSetAntiFlickR(value.a);
+    case SettingsSnapshot::AeLock:
+        return device.cameraSetAELockR(value.a != 0);
+    case SettingsSnapshot::FocusPosition:
+        return device.cameraSetFocusPosR(value.a);
+    case SettingsSnapshot::AudioVolume:
+        return device.cameraSetAudioVolumeR(static_cast<int16_t>(value.a));
+    case SettingsSnapshot::SettingCount:
+        break;
+    }
+    return RM_RET_ERR;
+}
@@ -0,0 +1,159 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include <dev/dev.hpp>
+
+#include "thread_pool.hpp"
+
+// Image, exposure, white balance, focus and audio state of one camera.
+//
+// Each setting is one getter/setter pair of Device and holds up to two
+// integers (white balance: type and manual temperature; noise reduction:
+// enabled and level). Settings the camera refused to report are absent and
+// are never written back.
+struct SettingsSnapshot {
+    enum Setting : uint8_t {
+        // Modes first: restoring them may reset the values that follow
+        ExposureMode,     // cameraGetExposureModeR
+        WhiteBalance,     // cameraGetWhiteBalanceR
+        FocusMode,        // cameraGetAutoFocusModeR
+        AudioAgc,         // cameraGetAudioAGCR
+        AudioNoiseReduce, // cameraGetAudioNoiseReduceR
+        Brightness,       // cameraGetImageBrightnessR
+        Contrast,         // cameraGetImageContrastR
+        Hue,              // cameraGetImageHueR
+        Saturation,       // cameraGetImageSaturationR
+        Sharpness,        // cameraGetImageSharpR
+        EvBias,           // cameraGetPAEEvBiasR
+        Iso,              // cameraGetMAEIsoR
+        Shutter,          // cameraGetMAEShutterR
+        AntiFlicker,      // cameraGetAntiFlickR
+        AeLock,           // cameraGetAELockR
+        FocusPosition,    // cameraGetFocusPosR
+        AudioVolume,      // cameraGetAudioVolumeR
+        SettingCount,
+    };
+
+    struct Value {
+        int32_t a = 0;
+        int32_t b = 0;
+
+        bool operator==(const Value& other) const { return a == other.a && b == other.b; }
+        bool operator!=(const Value& other) const { return !(*this == other); }
+    };
+
+    uint32_t present = 0; // bit per setting
+    std::array<Value, SettingCount> values;
+
+    bool has(Setting which) const { return (present >> which) & 1u; }
+    const Value& get(Setting which) const { return values[which]; }
+    void set(Setting which, Value value) {
+        values[which] = value;
+        present |= 1u << which;
+    }
+    size_t size() const;
+
+    static const char* name(Setting which);
+    // Settings in the same stage can be written in any order
+    static int stage(Setting which);
+
+    // Compact binary form: a version byte, the presence mask and the
+    // present values as zigzag varints. Typically 20-40 bytes.
+    std::vector<uint8_t> encode() const;
+    bool decode(const uint8_t* data, size_t size);
+};
+
+static_assert(SettingsSnapshot::SettingCount <= 32, "presence mask is 32 bits");
+
+// Reads and writes SettingsSnapshots with several SDK calls in flight.
+//
+// The settings getters and setters only exist as blocking calls, so a
+// capture keeps up to `depth` of them running, on the calling thread and on
+// workers of the snapshotter's own pool. The pool grows so that every
+// capture in progress has depth - 1 helpers; they never occupy the fleet's
+// strand workers. Different cameras can be handled concurrently from their
+// own strands.
+class SettingsSnapshotter {
+public:
+    struct RestoreReport {
+        size_t written = 0;   // setters issued
+        size_t unchanged = 0; // already at the snapshot value
+        size_t failed = 0;    // setters that returned an error
+    };
+
+    explicit SettingsSnapshotter(size_t depth = 4);
+
+    // Returns false when no setting could be read
+    bool capture(Device& device, SettingsSnapshot& out);
+
+    // Reads the current state and writes back only the settings that differ
+    // from `target`, modes before values. Returns false when a setter failed.
+    bool restore(Device& device, const SettingsSnapshot& target, RestoreReport* report = nullptr);
+
+    // Writes the settings of `target` that differ from `current`, which
+    // must describe the camera as it is now
+    bool apply(Device& device, const SettingsSnapshot& current, const SettingsSnapshot& target,
+               RestoreReport* report = nullptr);
+
+    static int32_t read(Device& device, SettingsSnapshot::Setting which, SettingsSnapshot::Value& value);
+    static int32_t write(Device& device, SettingsSnapshot::Setting which, const SettingsSnapshot::Value& value);
+
+    // Runs job(0) .. job(count - 1) with up to `depth` of them at once and
+    // returns when all are done. The calling thread takes its share.
+    template <typename Job>
+    void parallel(size_t count, Job job);
+
+private:
+    size_t depth_;
+    std::atomic<size_t> active_{0}; // parallel() calls in progress
+    ThreadPool pool_;
+};
+
+// Runs job(0) .. job(count - 1) on up to depth_ threads, the caller being
+// one of them. Helpers that start after the work is gone return at once;
+// `job` is only touched for claimed indices, all of which finish before
+// this returns.
+template <typename Job>
+void SettingsSnapshotter::parallel(size_t count, Job job) {
+    struct Shared {
+        std::atomic<size_t> next{0};
+        std::mutex mutex;
+        std::condition_variable cond;
+        size_t finished = 0;
+    };
+    auto shared = std::make_shared<Shared>();
+    Job* target = &job;
+    auto work = [shared, target, count] {
+        size_t done = 0;
+        for (size_t i; (i = shared->next.fetch_add(1, std::memory_order_relaxed)) < count;) {
+            (*target)(i);
+            ++done;
+        }
+        if (done > 0) {
+            std::lock_guard<std::mutex> lock(shared->mutex);
+            shared->finished += done;
+            if (shared->finished == count) {
+                shared->cond.notify_all();
+            }
+        }
+    };
+
+    size_t helpers = std::min(depth_, count) - (count > 0 ? 1 : 0);
+    size_t active = active_.fetch_add(1, std::memory_order_relaxed) + 1;
+    pool_.ensureThreads(active * (depth_ - 1));
+    for (size_t i = 0; i < helpers; ++i) {
+        pool_.post(work);
+    }
+    work();
+    std::unique_lock<std::mutex> lock(shared->mutex);
+    shared->cond.wait(lock, [&] { return shared->finished == count; });
+    active_.fetch_sub(1, std::memory_order_relaxed);
+}
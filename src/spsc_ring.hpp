@@ -0,0 +1,73 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstring>
+#include <type_traits>
+
+#ifndef OBSBOT_CACHE_LINE
+#define OBSBOT_CACHE_LINE 64
+#endif
+
+// Fixed-capacity single-producer/single-consumer ring for trivially copyable
+// records. Push is a memcpy followed by one release store; the producer and
+// consumer indices live on separate cache lines so the two threads never
+// write to a shared line.
+template <typename T, size_t Capacity>
+class SpscRing {
+    static_assert(std::is_trivially_copyable<T>::value, "SpscRing stores raw copies");
+    static_assert(Capacity >= 2 && (Capacity & (Capacity - 1)) == 0, "Capacity must be a power of two");
+
+public:
+    SpscRing() = default;
+    SpscRing(const SpscRing&) = delete;
+    SpscRing& operator=(const SpscRing&) = delete;
+
+    // Producer side. Returns false and leaves the ring untouched when full.
+    bool tryPush(const T& value) {
+        const size_t tail = tail_.index.load(std::memory_order_relaxed);
+        if (tail - tail_.peer_cache == Capacity) {
+            tail_.peer_cache = head_.index.load(std::memory_order_acquire);
+            if (tail - tail_.peer_cache == Capacity) {
+                return false;
+            }
+        }
+        std::memcpy(&slots_[tail & (Capacity - 1)], &value, sizeof(T));
+        tail_.index.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Consumer side. Copies the oldest record out, returns false when empty.
+    bool tryPop(T& out) {
+        const size_t head = head_.index.load(std::memory_order_relaxed);
+        if (head == head_.peer_cache) {
+            head_.peer_cache = tail_.index.load(std::memory_order_acquire);
+            if (head == head_.peer_cache) {
+                return false;
+            }
+        }
+        std::memcpy(&out, &slots_[head & (Capacity - 1)], sizeof(T));
+        head_.index.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Approximate, safe to call from either side
+    bool empty() const {
+        return head_.index.load(std::memory_order_acquire) == tail_.index.load(std::memory_order_acquire);
+    }
+
+    static constexpr size_t capacity() { return Capacity; }
+
+private:
+    // Each side writes only its own line: its index plus a cached copy of
+    // the other side's index, refreshed only when the ring looks full/empty
+    struct alignas(OBSBOT_CACHE_LINE) Side {
+        std::atomic<size_t> index{0};
+        size_t peer_cache = 0;
+    };
+
+    Side head_;
+    Side tail_;
+
+    alignas(OBSBOT_CACHE_LINE) T slots_[Capacity];
+};
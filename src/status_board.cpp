@@ -0,0 +1,234 @@
+#include "status_board.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cerrno>
+
+namespace {
+
+bool hasGimbal(ObsbotProductType product) {
+    switch (product) {
+    case ObsbotProdTiny:
+    case ObsbotProdTiny4k:
+    case ObsbotProdTiny2:
+    case ObsbotProdTiny2Lite:
+    case ObsbotProdTailAir:
+    case ObsbotProdTail2:
+    case ObsbotProdTinySE:
+        return true;
+    default:
+        return false;
+    }
+}
+
+uint64_t wallClockNs() {
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count());
+}
+
+} // namespace
+
+StatusBoard::StatusBoard() : header_(nullptr), slots_(nullptr), bytes_(0) {
+}
+
+StatusBoard::~StatusBoard() {
+    close();
+}
+
+bool StatusBoard::open(const std::string& name, size_t slots) {
+    close();
+    slots = std::max<size_t>(slots, 1);
+    size_t bytes = sizeof(StatusBoardHeader) + slots * sizeof(StatusBoardSlot);
+
+    // Readers of a previous board keep their mapping until they reopen
+    ::shm_unlink(name.c_str());
+    int fd = ::shm_open(name.c_str(), O_RDWR | O_CREAT | O_EXCL | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        return false;
+    }
+    void* base = MAP_FAILED;
+    if (::ftruncate(fd, static_cast<off_t>(bytes)) == 0) {
+        base = ::mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    }
+    ::close(fd);
+    if (base == MAP_FAILED) {
+        ::shm_unlink(name.c_str());
+        return false;
+    }
+
+    // ftruncate zero-filled the segment: every slot is empty at sequence 0
+    auto* header = static_cast<StatusBoardHeader*>(base);
+    header->version = kStatusBoardVersion;
+    header->slot_size = sizeof(StatusBoardSlot);
+    header->slot_count = static_cast<uint32_t>(slots);
+    header->writer_pid = static_cast<uint64_t>(::getpid());
+    header->created_ns = wallClockNs();
+    header->live.store(1, std::memory_order_relaxed);
+    // Readers check the magic first, so it goes in last
+    std::atomic_thread_fence(std::memory_order_release);
+    std::memcpy(header->magic, kStatusBoardMagic, sizeof(kStatusBoardMagic));
+
+    name_ = name;
+    header_ = header;
+    slots_ = reinterpret_cast<StatusBoardSlot*>(static_cast<uint8_t*>(base) + sizeof(StatusBoardHeader));
+    bytes_ = bytes;
+    writers_.reset(new Writer[slots]);
+    return true;
+}
+
+void StatusBoard::close() {
+    if (!header_) {
+        return;
+    }
+    // Outstanding attitude reads complete (as failures) in these destructors
+    for (size_t i = 0; i < header_->slot_count; ++i) {
+        writers_[i].async.reset();
+    }
+    header_->live.store(0, std::memory_order_release);
+    ::munmap(header_, bytes_);
+    ::shm_unlink(name_.c_str());
+    header_ = nullptr;
+    slots_ = nullptr;
+    bytes_ = 0;
+    writers_.reset();
+    std::lock_guard<std::mutex> lock(mutex_);
+    index_.clear();
+}
+
+int StatusBoard::slotOf(const std::string& sn) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = index_.find(sn);
+    if (it != index_.end()) {
+        return it->second;
+    }
+    if (!header_ || index_.size() >= header_->slot_count || sn.size() >= kStatusBoardSnLength) {
+        dropped_.fetch_add(1, std::memory_order_relaxed);
+        return -1;
+    }
+    int index = static_cast<int>(index_.size());
+    index_.emplace(sn, index);
+    return index;
+}
+
+template <typename Fn>
+void StatusBoard::write(int index, Fn fn) {
+    StatusBoardSlot& slot = slots_[index];
+    std::lock_guard<std::mutex> lock(writers_[index].mutex);
+    uint32_t sequence = slot.sequence.load(std::memory_order_relaxed);
+    slot.sequence.store(sequence + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    fn(slot.record);
+    slot.sequence.store(sequence + 2, std::memory_order_release);
+    updates_.fetch_add(1, std::memory_order_relaxed);
+}
+
+void StatusBoard::publish(const StatusSource& source, const StatusSample& sample,
+                          const std::shared_ptr<Device>& device) {
+    int index = slotOf(source.sn());
+    if (index < 0 || !device) {
+        return;
+    }
+    // Read before entering the seqlock to keep the odd window short
+    ObsbotProductType product = device->productType();
+    auto live_stream = device->devLiveStreamStatus();
+    auto record = device->devRecordStatus();
+    write(index, [&](StatusBoardRecord& r) {
+        r.state = StatusBoardRecord::Connected;
+        r.product = product;
+        r.sn_hash = source.snHash();
+        std::memset(r.sn, 0, sizeof(r.sn));
+        std::memcpy(r.sn, source.sn().data(), source.sn().size());
+        r.status_ns = sample.timestamp_ns;
+        r.status = sample.status;
+        r.live_stream = live_stream;
+        r.record = record;
+    });
+    if (hasGimbal(product)) {
+        requestAttitude(index, device);
+    }
+}
+
+void StatusBoard::publishStatus(const std::string& sn, ObsbotProductType product, uint64_t timestamp_ns,
+                                const Device::CameraStatus& status) {
+    int index = slotOf(sn);
+    if (index < 0) {
+        return;
+    }
+    write(index, [&](StatusBoardRecord& r) {
+        r.state = StatusBoardRecord::Connected;
+        r.product = product;
+        r.sn_hash = snHash(sn);
+        std::memset(r.sn, 0, sizeof(r.sn));
+        std::memcpy(r.sn, sn.data(), sn.size());
+        r.status_ns = timestamp_ns;
+        r.status = status;
+    });
+}
+
+void StatusBoard::publishStreams(const std::string& sn, Device::DevLiveStreamStatus live_stream,
+                                 Device::DevRecordStatus record) {
+    int index = slotOf(sn);
+    if (index < 0) {
+        return;
+    }
+    write(index, [&](StatusBoardRecord& r) {
+        r.live_stream = live_stream;
+        r.record = record;
+    });
+}
+
+void StatusBoard::publishAttitude(const std::string& sn, const float attitude[3]) {
+    int index = slotOf(sn);
+    if (index < 0) {
+        return;
+    }
+    uint64_t now = wallClockNs();
+    write(index, [&](StatusBoardRecord& r) {
+        std::memcpy(r.attitude, attitude, sizeof(r.attitude));
+        r.attitude_ns = now;
+    });
+}
+
+void StatusBoard::disconnect(const std::string& sn) {
+    int index;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = index_.find(sn);
+        if (it == index_.end()) {
+            return;
+        }
+        index = it->second;
+    }
+    write(index, [](StatusBoardRecord& r) { r.state = StatusBoardRecord::Disconnected; });
+}
+
+void StatusBoard::requestAttitude(int index, const std::shared_ptr<Device>& device) {
+    Writer& writer = writers_[index];
+    // At most one read in flight; a slow gimbal just updates less often
+    if (writer.attitude_pending.exchange(true, std::memory_order_acq_rel)) {
+        return;
+    }
+    if (writer.device != device) {
+        // First push, or the camera reconnected. The old reader's callbacks
+        // take writer.mutex, so it is destroyed without holding it.
+        std::unique_ptr<AsyncDevice> old;
+        {
+            std::lock_guard<std::mutex> lock(writer.mutex);
+            old = std::move(writer.async);
+            writer.device = device;
+        }
+        old.reset();
+        writer.async.reset(new AsyncDevice(device));
+        writer.attitude_pending.store(true, std::memory_order_release);
+    }
+    writer.async->gimbalAttitude([this, index](const AsyncReply<AsyncDevice::GimbalAttitude>& reply) {
+        if (reply.ok()) {
+            uint64_t now = wallClockNs();
+            write(index, [&](StatusBoardRecord& r) {
+                std::memcpy(r.attitude, reply.value.data(), sizeof(r.attitude));
+                r.attitude_ns = now;
+            });
+        }
+        writers_[index].attitude_pending.store(false, std::memory_order_release);
+    });
+}
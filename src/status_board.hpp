@@ -0,0 +1,80 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <dev/dev.hpp>
+
+#include "async_device.hpp"
+#include "status_board_reader.hpp"
+#include "status_pump.hpp"
+
+// Publishes the latest status of every camera into a POSIX shared-memory
+// segment (layout in status_board_reader.hpp) for other local processes.
+//
+// Each camera gets a slot on its first publish and keeps it until close().
+// Every status push also refreshes the stream and record state and, for
+// models with a gimbal, starts one non-blocking attitude read whose reply
+// lands in the same slot. Writers of one slot are serialized in-process,
+// and readers are never waited for.
+class StatusBoard {
+public:
+    static constexpr size_t kDefaultSlots = 16;
+
+    StatusBoard();
+    ~StatusBoard();
+
+    StatusBoard(const StatusBoard&) = delete;
+    StatusBoard& operator=(const StatusBoard&) = delete;
+
+    // Creates the segment, replacing one left behind by an earlier writer
+    bool open(const std::string& name = kDefaultStatusBoardName, size_t slots = kDefaultSlots);
+    // Marks the board dead for readers and removes the segment name
+    void close();
+    bool valid() const { return header_ != nullptr; }
+
+    // StatusPump sink body; `device` is the camera the sample came from
+    void publish(const StatusSource& source, const StatusSample& sample, const std::shared_ptr<Device>& device);
+
+    void publishStatus(const std::string& sn, ObsbotProductType product, uint64_t timestamp_ns,
+                       const Device::CameraStatus& status);
+    void publishStreams(const std::string& sn, Device::DevLiveStreamStatus live_stream,
+                        Device::DevRecordStatus record);
+    void publishAttitude(const std::string& sn, const float attitude[3]);
+    void disconnect(const std::string& sn);
+
+    uint64_t updates() const { return updates_.load(std::memory_order_relaxed); }
+    uint64_t dropped() const { return dropped_.load(std::memory_order_relaxed); } // no free slot
+
+private:
+    // Process-local companion of a slot
+    struct Writer {
+        std::mutex mutex; // one seqlock writer at a time
+        std::shared_ptr<Device> device;
+        std::unique_ptr<AsyncDevice> async;
+        std::atomic<bool> attitude_pending{false};
+    };
+
+    // Slot of `sn`, assigned on first use; -1 when the board is full
+    int slotOf(const std::string& sn);
+    template <typename Fn>
+    void write(int index, Fn fn);
+    // Sink thread only, like `device` and `async` below
+    void requestAttitude(int index, const std::shared_ptr<Device>& device);
+
+    std::string name_;
+    StatusBoardHeader* header_;
+    StatusBoardSlot* slots_;
+    size_t bytes_;
+    std::unique_ptr<Writer[]> writers_;
+
+    std::mutex mutex_;
+    std::unordered_map<std::string, int> index_;
+
+    std::atomic<uint64_t> updates_{0};
+    std::atomic<uint64_t> dropped_{0};
+};
@@ -0,0 +1,184 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <dev/dev.hpp>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// Shared-memory layout of the live status board written by StatusBoard.
+// Header-only, so that other processes can read the board without linking
+// obsbot_core.
+//
+// The POSIX shared-memory object is a StatusBoardHeader followed by
+// `slot_count` StatusBoardSlots, one per camera. A slot is guarded by its
+// own seqlock: the writer makes `sequence` odd, updates the record and makes
+// it even again, so a reader that saw the same even sequence before and
+// after its read got a consistent record. Readers never write and never
+// block the writer.
+
+constexpr char kStatusBoardMagic[8] = {'O', 'B', 'S', 'B', 'O', 'R', 'D', '\0'};
+constexpr uint32_t kStatusBoardVersion = 1;
+constexpr const char* kDefaultStatusBoardName = "/obsbot_status";
+constexpr size_t kStatusBoardSnLength = 32;
+
+struct StatusBoardHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t slot_size;
+    uint32_t slot_count;
+    std::atomic<uint32_t> live; // 0 once the writer has closed the board
+    uint64_t writer_pid;
+    uint64_t created_ns; // wall clock, nanoseconds since the epoch
+    uint8_t reserved[24];
+};
+
+struct StatusBoardRecord {
+    enum State : uint32_t {
+        Empty = 0,
+        Connected,
+        Disconnected, // the rest of the record is the last known state
+    };
+
+    uint32_t state;
+    int32_t product; // ObsbotProductType
+    uint64_t sn_hash; // snHash() of the SN
+    char sn[kStatusBoardSnLength];
+    uint64_t status_ns;   // StatusSample::timestamp_ns of `status`
+    uint64_t attitude_ns; // 0 until the gimbal attitude was read
+    int32_t live_stream;  // Device::DevLiveStreamStatus
+    int32_t record;       // Device::DevRecordStatus
+    float attitude[3];    // roll, pitch, yaw in degrees, gimbalGetAttitudeInfoR
+    Device::CameraStatus status;
+};
+
+struct alignas(64) StatusBoardSlot {
+    std::atomic<uint32_t> sequence; // odd while the record is being written
+    uint32_t reserved0;
+    StatusBoardRecord record;
+    uint8_t reserved[40];
+};
+
+static_assert(std::atomic<uint32_t>::is_always_lock_free, "seqlock needs address-free atomics");
+static_assert(sizeof(StatusBoardHeader) == 64, "status board header layout changed");
+static_assert(sizeof(StatusBoardRecord) == 144, "status board record layout changed");
+static_assert(sizeof(StatusBoardSlot) == 192, "status board slot layout changed");
+
+// Read-only view of a status board in another process.
+//
+// read() copies a slot and is wait-free: it gives up after `attempts` tries
+// when the writer keeps the slot busy. peek() runs a callback on the record
+// in place, without copying, and tells afterwards whether what the callback
+// saw was consistent.
+class StatusBoardReader {
+public:
+    StatusBoardReader() = default;
+    ~StatusBoardReader() { close(); }
+
+    StatusBoardReader(const StatusBoardReader&) = delete;
+    StatusBoardReader& operator=(const StatusBoardReader&) = delete;
+
+    bool open(const std::string& name = kDefaultStatusBoardName) {
+        close();
+        int fd = ::shm_open(name.c_str(), O_RDONLY | O_CLOEXEC, 0);
+        if (fd < 0) {
+            return false;
+        }
+        struct stat st;
+        void* base = MAP_FAILED;
+        if (::fstat(fd, &st) == 0 && static_cast<size_t>(st.st_size) >= sizeof(StatusBoardHeader)) {
+            base = ::mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ, MAP_SHARED, fd, 0);
+        }
+        ::close(fd);
+        if (base == MAP_FAILED) {
+            return false;
+        }
+        const auto* header = static_cast<const StatusBoardHeader*>(base);
+        size_t bytes = static_cast<size_t>(st.st_size);
+        if (std::memcmp(header->magic, kStatusBoardMagic, sizeof(kStatusBoardMagic)) != 0 ||
+            header->version != kStatusBoardVersion || header->slot_size != sizeof(StatusBoardSlot) ||
+            header->slot_count > (bytes - sizeof(StatusBoardHeader)) / sizeof(StatusBoardSlot)) {
+            ::munmap(base, bytes);
+            return false;
+        }
+        header_ = header;
+        slots_ = reinterpret_cast<const StatusBoardSlot*>(static_cast<const uint8_t*>(base) + sizeof(StatusBoardHeader));
+        bytes_ = bytes;
+        return true;
+    }
+
+    void close() {
+        if (header_) {
+            ::munmap(const_cast<StatusBoardHeader*>(header_), bytes_);
+        }
+        header_ = nullptr;
+        slots_ = nullptr;
+        bytes_ = 0;
+    }
+
+    bool valid() const { return header_ != nullptr; }
+    // False once the writer closed the board; reopen to follow a new writer
+    bool live() const { return header_ && header_->live.load(std::memory_order_acquire) != 0; }
+    size_t capacity() const { return header_ ? header_->slot_count : 0; }
+
+    // Changes with every update of the slot; cheap change detection
+    uint32_t sequence(size_t index) const { return slots_[index].sequence.load(std::memory_order_acquire); }
+
+    bool read(size_t index, StatusBoardRecord& out, int attempts = 64) const {
+        if (index >= capacity()) {
+            return false;
+        }
+        const StatusBoardSlot& slot = slots_[index];
+        for (int i = 0; i < attempts; ++i) {
+            uint32_t before = slot.sequence.load(std::memory_order_acquire);
+            if (before & 1u) {
+                continue;
+            }
+            std::memcpy(&out, &slot.record, sizeof(out));
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (slot.sequence.load(std::memory_order_relaxed) == before) {
+                return out.state != StatusBoardRecord::Empty;
+            }
+        }
+        return false;
+    }
+
+    // Finds a camera by SN; false when it is not on the board
+    bool find(const std::string& sn, StatusBoardRecord& out, int attempts = 64) const {
+        for (size_t i = 0; i < capacity(); ++i) {
+            if (read(i, out, attempts) && sn.size() < kStatusBoardSnLength &&
+                std::strncmp(out.sn, sn.c_str(), kStatusBoardSnLength) == 0) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // Calls fn(const StatusBoardRecord&) on the shared record and returns
+    // true if the slot did not change meanwhile. Anything fn derived from
+    // the record must be discarded when this returns false.
+    template <typename Fn>
+    bool peek(size_t index, Fn fn) const {
+        if (index >= capacity()) {
+            return false;
+        }
+        const StatusBoardSlot& slot = slots_[index];
+        uint32_t before = slot.sequence.load(std::memory_order_acquire);
+        if (before & 1u) {
+            return false;
+        }
+        fn(slot.record);
+        std::atomic_thread_fence(std::memory_order_acquire);
+        return slot.sequence.load(std::memory_order_relaxed) == before;
+    }
+
+private:
+    const StatusBoardHeader* header_ = nullptr;
+    const StatusBoardSlot* slots_ = nullptr;
+    size_t bytes_ = 0;
+};
@@ -0,0 +1,347 @@
+#include "status_delta.hpp"
+
+#include <cstring>
+#include <type_traits>
+#include <utility>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace {
+
+constexpr size_t kStatusSize = sizeof(Device::CameraStatus);
+static_assert(kStatusSize <= 64, "byte masks are 64 bits wide");
+
+// Little-endian load of up to 8 bytes starting at offset
+uint64_t loadWord(const Device::CameraStatus& status, size_t offset) {
+    uint64_t word = 0;
+    size_t n = kStatusSize - offset < 8 ? kStatusSize - offset : 8;
+    std::memcpy(&word, reinterpret_cast<const uint8_t*>(&status) + offset, n);
+    return word;
+}
+
+// A field is described by a setter that fills it with ones; the table below
+// derives offset, width and shift from the bytes that setter touches, so
+// bitfield packing never has to be spelled out by hand.
+struct FieldProbe {
+    const char* name;
+    void (*fill)(Device::CameraStatus& status);
+    bool is_signed;
+};
+
+StatusField probeField(const FieldProbe& probe) {
+    Device::CameraStatus status;
+    std::memset(&status, 0, sizeof(status));
+    probe.fill(status);
+
+    const auto* bytes = reinterpret_cast<const uint8_t*>(&status);
+    StatusField field{probe.name, 0, 0, 0, probe.is_signed, 0};
+    bool found = false;
+    for (size_t i = 0; i < kStatusSize; ++i) {
+        if (bytes[i]) {
+            if (!found) {
+                field.offset = static_cast<uint8_t>(i);
+                found = true;
+            }
+            field.byte_mask |= 1ull << i;
+        }
+    }
+    uint64_t word = loadWord(status, field.offset);
+    field.shift = static_cast<uint8_t>(__builtin_ctzll(word));
+    field.width = static_cast<uint8_t>(__builtin_popcountll(word));
+    return field;
+}
+
+#define STATUS_FIELD(view, member)                                                                   \
+    FieldProbe {                                                                                     \
+        #view "." #member,                                                                           \
+            [](Device::CameraStatus& s) {                                                            \
+                --s.view.member; /* wraps from zero to all ones, bitfields included */             \
+            },                                                                                       \
+            std::is_signed<decltype(Device::CameraStatus::view.member)>::value                       \
+    }
+
+const FieldProbe kTinyFields[] = {
+    STATUS_FIELD(tiny, ai_target),
+    STATUS_FIELD(tiny, anti_flicker),
+    STATUS_FIELD(tiny, zoom_ratio),
+    STATUS_FIELD(tiny, hdr),
+    STATUS_FIELD(tiny, face_ae),
+    STATUS_FIELD(tiny, noise_cancellation),
+    STATUS_FIELD(tiny, dev_status),
+    STATUS_FIELD(tiny, auto_sleep_time),
+    STATUS_FIELD(tiny, vertical),
+    STATUS_FIELD(tiny, face_auto_focus),
+    STATUS_FIELD(tiny, auto_focus),
+    STATUS_FIELD(tiny, manual_focus_value),
+    STATUS_FIELD(tiny, sleep_micro),
+    STATUS_FIELD(tiny, fov),
+    STATUS_FIELD(tiny, image_flip_hor),
+    STATUS_FIELD(tiny, voice_ctrl_language),
+    STATUS_FIELD(tiny, voice_ctrl),
+    STATUS_FIELD(tiny, voice_ctrl_zoom),
+    STATUS_FIELD(tiny, ai_mode),
+    STATUS_FIELD(tiny, audio_auto_gain),
+    STATUS_FIELD(tiny, sleep_bg_type),
+    STATUS_FIELD(tiny, bg_img_idx),
+    STATUS_FIELD(tiny, ai_sub_mode),
+    STATUS_FIELD(tiny, bg_img_mirror),
+    STATUS_FIELD(tiny, hdr_support),
+    STATUS_FIELD(tiny, fps),
+    STATUS_FIELD(tiny, boot_mode),
+    STATUS_FIELD(tiny, led_brightness_level),
+    STATUS_FIELD(tiny, audio_opt.distance),
+    STATUS_FIELD(tiny, audio_opt.uac_enabled),
+    STATUS_FIELD(tiny, ble_status),
+    STATUS_FIELD(tiny, ai_tracker_speed),
+    STATUS_FIELD(tiny, live_stream_mode),
+    STATUS_FIELD(tiny, gesture_para.gesture_auto_frame),
+    STATUS_FIELD(tiny, gesture_para.auto_frame_mode),
+    STATUS_FIELD(tiny, gesture_para.gesture_zoom),
+    STATUS_FIELD(tiny, gesture_para.gesture_zoom_ratio),
+};
+
+const FieldProbe kMeetFields[] = {
+    STATUS_FIELD(meet, media_mode),
+    STATUS_FIELD(meet, hdr),
+    STATUS_FIELD(meet, dev_status),
+    STATUS_FIELD(meet, face_ae),
+    STATUS_FIELD(meet, fov),
+    STATUS_FIELD(meet, bg_mode),
+    STATUS_FIELD(meet, blur_level),
+    STATUS_FIELD(meet, anti_flicker),
+    STATUS_FIELD(meet, zoom_ratio),
+    STATUS_FIELD(meet, key_mode),
+    STATUS_FIELD(meet, noise_cancellation),
+    STATUS_FIELD(meet, vertical),
+    STATUS_FIELD(meet, group_single),
+    STATUS_FIELD(meet, close_upper),
+    STATUS_FIELD(meet, auto_sleep_time),
+    STATUS_FIELD(meet, img_idx),
+    STATUS_FIELD(meet, bg_color),
+    STATUS_FIELD(meet, face_auto_focus),
+    STATUS_FIELD(meet, auto_focus),
+    STATUS_FIELD(meet, manual_focus_value),
+    STATUS_FIELD(meet, mask_disable),
+    STATUS_FIELD(meet, sleep_micro),
+    STATUS_FIELD(meet, image_flip_hor),
+};
+
+const FieldProbe kTailAirFields[] = {
+    STATUS_FIELD(tail_air, length),
+    STATUS_FIELD(tail_air, work_mode),
+    STATUS_FIELD(tail_air, extern_flag.sd_size_extern),
+    STATUS_FIELD(tail_air, delay_setting),
+    STATUS_FIELD(tail_air, boot_media_setting.start_record),
+    STATUS_FIELD(tail_air, boot_media_setting.ndi_boot_enable),
+    STATUS_FIELD(tail_air, media_flags.hdr),
+    STATUS_FIELD(tail_air, media_flags.mirror),
+    STATUS_FIELD(tail_air, media_flags.flip),
+    STATUS_FIELD(tail_air, media_flags.portrait),
+    STATUS_FIELD(tail_air, media_flags.anti_flick),
+    STATUS_FIELD(tail_air, media_flags.face_ae),
+    STATUS_FIELD(tail_air, media_flags.face_af),
+    STATUS_FIELD(tail_air, media_flags.ae_lock),
+    STATUS_FIELD(tail_air, media_flags.exp_fix_rate),
+    STATUS_FIELD(tail_air, media_flags.af_mode),
+    STATUS_FIELD(tail_air, media_flags.af_status),
+    STATUS_FIELD(tail_air, media_running.media_switching),
+    STATUS_FIELD(tail_air, media_running.hdmi_plugin),
+    STATUS_FIELD(tail_air, media_running.hdmi_osd_enable),
+    STATUS_FIELD(tail_air, media_running.capture_status),
+    STATUS_FIELD(tail_air, media_running.record_status),
+    STATUS_FIELD(tail_air, media_running.has_exception),
+    STATUS_FIELD(tail_air, digi_zoom_ratio),
+    STATUS_FIELD(tail_air, digi_zoom_speed),
+    STATUS_FIELD(tail_air, hdmi_res_runtime),
+    STATUS_FIELD(tail_air, sd_card_speed),
+    STATUS_FIELD(tail_air, hdmi_size),
+    STATUS_FIELD(tail_air, recording_size),
+    STATUS_FIELD(tail_air, ndi_rtsp_size),
+    STATUS_FIELD(tail_air, rtmp_size),
+    STATUS_FIELD(tail_air, sensor_fps),
+    STATUS_FIELD(tail_air, mf_code),
+    STATUS_FIELD(tail_air, srt_enabled),
+    STATUS_FIELD(tail_air, sd_status),
+    STATUS_FIELD(tail_air, brightness),
+    STATUS_FIELD(tail_air, contrast),
+    STATUS_FIELD(tail_air, hue),
+    STATUS_FIELD(tail_air, saturation),
+    STATUS_FIELD(tail_air, sharpness),
+    STATUS_FIELD(tail_air, style),
+    STATUS_FIELD(tail_air, usb_status),
+    STATUS_FIELD(tail_air, battery.capacity),
+    STATUS_FIELD(tail_air, battery.charging),
+    STATUS_FIELD(tail_air, online_status.ai_online),
+    STATUS_FIELD(tail_air, online_status.gim_online),
+    STATUS_FIELD(tail_air, online_status.bat_online),
+    STATUS_FIELD(tail_air, online_status.lens_online),
+    STATUS_FIELD(tail_air, online_status.tof_online),
+    STATUS_FIELD(tail_air, online_status.bluetooth_online),
+    STATUS_FIELD(tail_air, online_status.usb_wifi),
+    STATUS_FIELD(tail_air, online_status.poe_attached),
+    STATUS_FIELD(tail_air, online_status.swivel_base),
+    STATUS_FIELD(tail_air, online_status.audio_attached),
+    STATUS_FIELD(tail_air, online_status.sd_insert),
+    STATUS_FIELD(tail_air, online_status.sensor_err),
+    STATUS_FIELD(tail_air, online_status.remote_attached),
+    STATUS_FIELD(tail_air, online_status.media_err),
+    STATUS_FIELD(tail_air, sd_size.ori_sd_size.sd_total_size),
+    STATUS_FIELD(tail_air, sd_size.ori_sd_size.sd_left_size),
+    STATUS_FIELD(tail_air, sd_size.sd_total_size),
+    STATUS_FIELD(tail_air, auto_sleep_time),
+    STATUS_FIELD(tail_air, color_temp),
+    STATUS_FIELD(tail_air, ai_type),
+    STATUS_FIELD(tail_air, battery_status),
+    STATUS_FIELD(tail_air, event_count),
+    STATUS_FIELD(tail_air, misc_status.preset_update),
+    STATUS_FIELD(tail_air, misc_status.fov_status),
+    STATUS_FIELD(tail_air, misc_status.lens_temp_status),
+    STATUS_FIELD(tail_air, misc_status.cpu_temp_status),
+    STATUS_FIELD(tail_air, misc_status.px30_attached),
+    STATUS_FIELD(tail_air, misc_status.adapter_plugin),
+    STATUS_FIELD(tail_air, sd_left_size),
+};
+
+#undef STATUS_FIELD
+
+template <size_t N>
+std::vector<StatusField> buildTable(const FieldProbe (&probes)[N]) {
+    std::vector<StatusField> fields;
+    fields.reserve(N);
+    for (const auto& probe : probes) {
+        fields.push_back(probeField(probe));
+    }
+    return fields;
+}
+
+} // namespace
+
+StatusLayout statusLayoutFor(ObsbotProductType product) {
+    switch (product) {
+    case ObsbotProdTailAir:
+    case ObsbotProdTail2:
+        return StatusLayout::TailAir;
+    case ObsbotProdMeet:
+    case ObsbotProdMeet4k:
+        return StatusLayout::Meet;
+    default:
+        return StatusLayout::Tiny;
+    }
+}
+
+int64_t StatusField::read(const Device::CameraStatus& status) const {
+    uint64_t raw = loadWord(status, offset) >> shift;
+    if (width < 64) {
+        raw &= (1ull << width) - 1;
+        if (is_signed && (raw >> (width - 1)) & 1) {
+            raw |= ~0ull << width;
+        }
+    }
+    return static_cast<int64_t>(raw);
+}
+
+uint64_t statusChangedBytes(const Device::CameraStatus& a, const Device::CameraStatus& b) {
+    // Zero padded to 64 bytes so both paths work on whole blocks
+    alignas(16) uint8_t pa[64] = {};
+    alignas(16) uint8_t pb[64] = {};
+    std::memcpy(pa, &a, kStatusSize);
+    std::memcpy(pb, &b, kStatusSize);
+
+    uint64_t changed = 0;
+#if defined(__SSE2__)
+    for (int block = 0; block < 4; ++block) {
+        __m128i va = _mm_load_si128(reinterpret_cast<const __m128i*>(pa + block * 16));
+        __m128i vb = _mm_load_si128(reinterpret_cast<const __m128i*>(pb + block * 16));
+        uint32_t equal = static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(va, vb)));
+        changed |= static_cast<uint64_t>(~equal & 0xFFFFu) << (block * 16);
+    }
+#else
+    for (int word = 0; word < 8; ++word) {
+        uint64_t wa, wb;
+        std::memcpy(&wa, pa + word * 8, 8);
+        std::memcpy(&wb, pb + word * 8, 8);
+        uint64_t diff = wa ^ wb;
+        if (!diff) {
+            continue;
+        }
+        for (int byte = 0; byte < 8; ++byte) {
+            if ((diff >> (byte * 8)) & 0xFF) {
+                changed |= 1ull << (word * 8 + byte);
+            }
+        }
+    }
+#endif
+    return changed;
+}
+
+const std::vector<StatusField>& statusFields(StatusLayout layout) {
+    static const std::vector<StatusField> tiny = buildTable(kTinyFields);
+    static const std::vector<StatusField> meet = buildTable(kMeetFields);
+    static const std::vector<StatusField> tail_air = buildTable(kTailAirFields);
+    switch (layout) {
+    case StatusLayout::Meet:
+        return meet;
+    case StatusLayout::TailAir:
+        return tail_air;
+    default:
+        return tiny;
+    }
+}
+
+void statusDiff(StatusLayout layout, const Device::CameraStatus& prev, const Device::CameraStatus& next,
+                std::vector<StatusChange>& changes) {
+    uint64_t changed = statusChangedBytes(prev, next);
+    if (!changed) {
+        return;
+    }
+    for (const auto& field : statusFields(layout)) {
+        if (!(field.byte_mask & changed)) {
+            continue;
+        }
+        // A shared byte may have changed because of a neighbouring bitfield
+        int64_t old_value = field.read(prev);
+        int64_t new_value = field.read(next);
+        if (old_value != new_value) {
+            changes.push_back(StatusChange{&field, old_value, new_value});
+        }
+    }
+}
+
+StatusDeltaTracker::StatusDeltaTracker(StatusLayout layout)
+    : layout_(layout), has_last_(false) {
+    std::memset(&last_, 0, sizeof(last_));
+}
+
+bool StatusDeltaTracker::update(const Device::CameraStatus& status, std::vector<StatusChange>& changes) {
+    changes.clear();
+    if (!has_last_) {
+        for (const auto& field : statusFields(layout_)) {
+            int64_t value = field.read(status);
+            changes.push_back(StatusChange{&field, value, value});
+        }
+        has_last_ = true;
+    } else {
+        statusDiff(layout_, last_, status, changes);
+    }
+    std::memcpy(&last_, &status, sizeof(last_));
+    return !changes.empty();
+}
+
+std::string formatStatusChanges(const std::vector<StatusChange>& changes) {
+    std::string out;
+    for (const auto& change : changes) {
+        if (!out.empty()) {
+            out += ", ";
+        }
+        out += change.field->name;
+        out += ' ';
+        if (change.old_value != change.new_value) {
+            out += std::to_string(change.old_value);
+            out += " -> ";
+        }
+        out += std::to_string(change.new_value);
+    }
+    return out;
+}
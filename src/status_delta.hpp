@@ -0,0 +1,69 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <dev/dev.hpp>
+
+// Which view of the Device::CameraStatus union a product reports
+enum class StatusLayout {
+    Tiny,    // tiny, tiny4k, tiny2 series, tinySE, meet2, meetSE
+    Meet,    // meet, meet4k
+    TailAir, // tail air, tail2
+};
+
+StatusLayout statusLayoutFor(ObsbotProductType product);
+
+// One decodable member of CameraStatus, including bitfields
+struct StatusField {
+    const char* name;  // e.g. "tail_air.battery.capacity"
+    uint8_t offset;    // first byte of the field
+    uint8_t width;     // width in bits
+    uint8_t shift;     // bit position inside the little-endian word at offset
+    bool is_signed;
+    uint64_t byte_mask; // bit i set when byte i of the status belongs to the field
+
+    int64_t read(const Device::CameraStatus& status) const;
+};
+
+struct StatusChange {
+    const StatusField* field;
+    int64_t old_value;
+    int64_t new_value;
+};
+
+// Bit i is set when byte i differs between a and b. Uses SSE2 when
+// available, 64-bit word compares otherwise.
+uint64_t statusChangedBytes(const Device::CameraStatus& a, const Device::CameraStatus& b);
+
+// Field table of one layout, in declaration order
+const std::vector<StatusField>& statusFields(StatusLayout layout);
+
+// Appends the fields that differ between prev and next to `changes`.
+// Only fields overlapping a changed byte are decoded.
+void statusDiff(StatusLayout layout, const Device::CameraStatus& prev, const Device::CameraStatus& next,
+                std::vector<StatusChange>& changes);
+
+// Keeps the last snapshot of one device and reports what changed since
+class StatusDeltaTracker {
+public:
+    explicit StatusDeltaTracker(StatusLayout layout);
+
+    StatusLayout layout() const { return layout_; }
+
+    // Fills `changes` (cleared first). The first update reports every field
+    // with old_value == new_value as the baseline. Returns false when
+    // nothing changed.
+    bool update(const Device::CameraStatus& status, std::vector<StatusChange>& changes);
+
+    void reset() { has_last_ = false; }
+
+private:
+    StatusLayout layout_;
+    Device::CameraStatus last_;
+    bool has_last_;
+};
+
+// "name old -> new" pairs joined with ", "
+std::string formatStatusChanges(const std::vector<StatusChange>& changes);
@@ -0,0 +1,332 @@
+#include "status_journal.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cinttypes>
+#include <cstdio>
+#include <cstring>
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+
+bool parseSegmentName(const char* name, uint64_t& index) {
+    char tail[16] = {};
+    return std::sscanf(name, "status-%" SCNu64 "%15s", &index, tail) == 2 && std::strcmp(tail, ".journal") == 0;
+}
+
+uint64_t nowNs() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+} // namespace
+
+std::string journalSegmentPath(const std::string& directory, uint64_t segment) {
+    char name[40];
+    std::snprintf(name, sizeof(name), "status-%08" PRIu64 ".journal", segment);
+    return directory + "/" + name;
+}
+
+StatusJournal::StatusJournal()
+    : capacity_(0), keep_segments_(0), oldest_(0), next_slot_(0), rotate_pending_(false), stopping_(false),
+      next_index_(0) {
+}
+
+StatusJournal::~StatusJournal() {
+    close();
+}
+
+bool StatusJournal::open(const std::string& directory, size_t segment_records, size_t keep_segments) {
+    if (isOpen() || segment_records == 0) {
+        return false;
+    }
+    DIR* dir = ::opendir(directory.c_str());
+    if (!dir) {
+        return false;
+    }
+    bool found = false;
+    uint64_t oldest = 0, newest = 0;
+    while (dirent* entry = ::readdir(dir)) {
+        uint64_t index;
+        if (parseSegmentName(entry->d_name, index)) {
+            oldest = found ? std::min(oldest, index) : index;
+            newest = found ? std::max(newest, index) : index;
+            found = true;
+        }
+    }
+    ::closedir(dir);
+
+    directory_ = directory;
+    capacity_ = segment_records;
+    keep_segments_ = keep_segments;
+    uint64_t first = found ? newest + 1 : 0;
+    oldest_ = found ? oldest : first;
+
+    if (!mapSegment(first, current_)) {
+        return false;
+    }
+    if (!mapSegment(first + 1, spare_)) {
+        unmapSegment(current_, true);
+        return false;
+    }
+    next_slot_ = 0;
+    next_index_ = first + 2;
+    spare_ready_.store(true, std::memory_order_release);
+    rotate_pending_ = false;
+    stopping_ = false;
+    rotator_ = std::thread(&StatusJournal::rotatorLoop, this);
+    return true;
+}
+
+void StatusJournal::close() {
+    if (!isOpen()) {
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    cond_.notify_one();
+    rotator_.join();
+
+    if (spare_ready_.exchange(false, std::memory_order_acquire)) {
+        unmapSegment(spare_, true);
+    }
+    if (retired_.records) {
+        retireSegment(retired_);
+    }
+    // An empty current segment means nothing was written since the last rotation
+    unmapSegment(current_, next_slot_ == 0);
+}
+
+bool StatusJournal::append(uint64_t sn_hash, uint64_t timestamp_ns, const Device::CameraStatus& status) {
+    if (next_slot_ == capacity_) {
+        if (!spare_ready_.load(std::memory_order_acquire)) {
+            dropped_.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            retired_ = current_;
+            current_ = spare_;
+            spare_ = Segment();
+            spare_ready_.store(false, std::memory_order_relaxed);
+            rotate_pending_ = true;
+        }
+        cond_.notify_one();
+        next_slot_ = 0;
+    }
+
+    JournalRecord& record = current_.records[next_slot_];
+    record.timestamp_ns = timestamp_ns;
+    record.sn_hash = sn_hash;
+    std::memcpy(&record.status, &status, sizeof(record.status));
+    // Publishes the record to readers mapping the same file
+    __atomic_store_n(&record.sequence, static_cast<uint32_t>(next_slot_ + 1), __ATOMIC_RELEASE);
+    ++next_slot_;
+    written_.fetch_add(1, std::memory_order_relaxed);
+    return true;
+}
+
+bool StatusJournal::mapSegment(uint64_t index, Segment& segment) {
+    std::string path = journalSegmentPath(directory_, index);
+    size_t bytes = sizeof(JournalHeader) + capacity_ * sizeof(JournalRecord);
+
+    int fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        return false;
+    }
+    // Allocate the blocks now so a full disk fails here and not as SIGBUS
+    // on a store into the mapping
+    if (::posix_fallocate(fd, 0, static_cast<off_t>(bytes)) != 0) {
+        ::close(fd);
+        ::unlink(path.c_str());
+        return false;
+    }
+    void* base = ::mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, 0);
+    if (base == MAP_FAILED) {
+        ::close(fd);
+        ::unlink(path.c_str());
+        return false;
+    }
+
+    JournalHeader header{};
+    std::memcpy(header.magic, kJournalMagic, sizeof(header.magic));
+    header.version = kJournalVersion;
+    header.record_size = sizeof(JournalRecord);
+    header.capacity = capacity_;
+    header.segment = index;
+    header.created_ns = nowNs();
+    std::memcpy(base, &header, sizeof(header));
+
+    segment.fd = fd;
+    segment.index = index;
+    segment.bytes = bytes;
+    segment.records = reinterpret_cast<JournalRecord*>(static_cast<uint8_t*>(base) + sizeof(JournalHeader));
+    return true;
+}
+
+void StatusJournal::unmapSegment(Segment& segment, bool discard) {
+    void* base = reinterpret_cast<uint8_t*>(segment.records) - sizeof(JournalHeader);
+    if (!discard) {
+        ::msync(base, segment.bytes, MS_ASYNC);
+    }
+    ::munmap(base, segment.bytes);
+    ::close(segment.fd);
+    if (discard) {
+        ::unlink(journalSegmentPath(directory_, segment.index).c_str());
+    }
+    segment = Segment();
+}
+
+void StatusJournal::retireSegment(Segment& segment) {
+    uint64_t index = segment.index;
+    unmapSegment(segment, false);
+    while (keep_segments_ > 0 && index >= oldest_ && index - oldest_ + 1 > keep_segments_) {
+        ::unlink(journalSegmentPath(directory_, oldest_++).c_str());
+    }
+}
+
+void StatusJournal::rotatorLoop() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (!stopping_) {
+        if (rotate_pending_) {
+            Segment retired = retired_;
+            retired_ = Segment();
+            rotate_pending_ = false;
+            lock.unlock();
+
+            retireSegment(retired);
+            lock.lock();
+            continue;
+        }
+
+        if (!spare_ready_.load(std::memory_order_relaxed)) {
+            uint64_t index = next_index_;
+            lock.unlock();
+            Segment next;
+            bool mapped = mapSegment(index, next);
+            lock.lock();
+            if (mapped) {
+                spare_ = next;
+                ++next_index_;
+                spare_ready_.store(true, std::memory_order_release);
+            } else {
+                // Out of space or descriptors; the writer drops records until a retry succeeds
+                cond_.wait_for(lock, std::chrono::seconds(1));
+            }
+            continue;
+        }
+
+        cond_.wait(lock, [this] { return rotate_pending_ || stopping_; });
+    }
+}
+
+JournalReader::JournalReader()
+    : position_(0), base_(nullptr), bytes_(0), records_(nullptr), capacity_(0), slot_(0) {
+}
+
+JournalReader::~JournalReader() {
+    close();
+}
+
+bool JournalReader::open(const std::string& directory) {
+    close();
+    DIR* dir = ::opendir(directory.c_str());
+    if (!dir) {
+        return false;
+    }
+    while (dirent* entry = ::readdir(dir)) {
+        uint64_t index;
+        if (parseSegmentName(entry->d_name, index)) {
+            segments_.push_back(index);
+        }
+    }
+    ::closedir(dir);
+    std::sort(segments_.begin(), segments_.end());
+
+    directory_ = directory;
+    rewind();
+    return records_ != nullptr;
+}
+
+void JournalReader::close() {
+    unmapSegment();
+    segments_.clear();
+    position_ = 0;
+}
+
+void JournalReader::rewind() {
+    unmapSegment();
+    position_ = 0;
+    while (position_ < segments_.size() && !mapSegment(position_)) {
+        ++position_;
+    }
+}
+
+bool JournalReader::next(JournalRecord& record) {
+    while (records_) {
+        if (slot_ < capacity_) {
+            const JournalRecord& slot = records_[slot_];
+            uint32_t sequence = __atomic_load_n(&slot.sequence, __ATOMIC_ACQUIRE);
+            if (sequence == slot_ + 1) {
+                std::memcpy(&record, &slot, sizeof(record));
+                ++slot_;
+                return true;
+            }
+        }
+        // Segment exhausted or ends in unwritten slots
+        unmapSegment();
+        while (++position_ < segments_.size() && !mapSegment(position_)) {
+        }
+    }
+    return false;
+}
+
+bool JournalReader::mapSegment(size_t position) {
+    std::string path = journalSegmentPath(directory_, segments_[position]);
+    int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return false;
+    }
+    struct stat st;
+    if (::fstat(fd, &st) != 0 || static_cast<size_t>(st.st_size) < sizeof(JournalHeader)) {
+        ::close(fd);
+        return false;
+    }
+    size_t bytes = static_cast<size_t>(st.st_size);
+    void* base = ::mmap(nullptr, bytes, PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (base == MAP_FAILED) {
+        return false;
+    }
+
+    const auto* header = static_cast<const JournalHeader*>(base);
+    if (std::memcmp(header->magic, kJournalMagic, sizeof(header->magic)) != 0 || header->version != kJournalVersion ||
+        header->record_size != sizeof(JournalRecord) ||
+        header->capacity > (bytes - sizeof(JournalHeader)) / sizeof(JournalRecord)) {
+        ::munmap(base, bytes);
+        return false;
+    }
+    base_ = static_cast<const uint8_t*>(base);
+    bytes_ = bytes;
+    records_ = reinterpret_cast<const JournalRecord*>(base_ + sizeof(JournalHeader));
+    capacity_ = header->capacity;
+    slot_ = 0;
+    return true;
+}
+
+void JournalReader::unmapSegment() {
+    if (base_) {
+        ::munmap(const_cast<uint8_t*>(base_), bytes_);
+    }
+    base_ = nullptr;
+    bytes_ = 0;
+    records_ = nullptr;
+    capacity_ = 0;
+    slot_ = 0;
+}
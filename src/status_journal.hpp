@@ -0,0 +1,153 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <dev/dev.hpp>
+
+#include "status_pump.hpp"
+
+// On-disk format of the status flight recorder.
+//
+// A journal is a directory of segment files named status-NNNNNNNN.journal.
+// Each segment is a JournalHeader followed by `capacity` fixed-size records,
+// preallocated at creation. A record is valid when its sequence is non-zero;
+// the sequence is stored last, so a reader never sees a half-written record.
+
+constexpr char kJournalMagic[8] = {'O', 'B', 'S', 'J', 'R', 'N', 'L', '\0'};
+constexpr uint32_t kJournalVersion = 1;
+
+struct JournalHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t record_size;
+    uint64_t capacity;   // records in this segment
+    uint64_t segment;    // segment index, also encoded in the file name
+    uint64_t created_ns; // wall clock, nanoseconds since the epoch
+    uint8_t reserved[24];
+};
+
+struct JournalRecord {
+    uint64_t timestamp_ns; // StatusSample::timestamp_ns
+    uint64_t sn_hash;      // snHash() of the device SN
+    uint32_t sequence;     // 1-based slot number, 0 while unwritten
+    Device::CameraStatus status;
+};
+
+static_assert(sizeof(JournalHeader) == 64, "journal header layout changed");
+static_assert(sizeof(JournalRecord) == 80, "journal record layout changed");
+
+std::string journalSegmentPath(const std::string& directory, uint64_t segment);
+
+// Append-only writer. Segments are created, preallocated and mapped ahead of
+// time by a rotation thread, so append() only copies into mapped memory; the
+// one exception is the wakeup of that thread when a segment fills up.
+//
+// append() and record() must be called from a single thread, for example as
+// a StatusPump sink.
+class StatusJournal {
+public:
+    static constexpr size_t kDefaultSegmentRecords = 1 << 16;
+
+    StatusJournal();
+    ~StatusJournal();
+
+    StatusJournal(const StatusJournal&) = delete;
+    StatusJournal& operator=(const StatusJournal&) = delete;
+
+    // Starts a new segment after the newest one already in `directory`.
+    // With keep_segments > 0, older full segments are deleted so that at
+    // most that many remain besides the one being written.
+    bool open(const std::string& directory, size_t segment_records = kDefaultSegmentRecords,
+              size_t keep_segments = 0);
+    void close();
+    bool isOpen() const { return current_.records != nullptr; }
+
+    // Returns false when the record was dropped because the next segment was
+    // not mapped in time
+    bool append(uint64_t sn_hash, uint64_t timestamp_ns, const Device::CameraStatus& status);
+
+    // StatusPump sink
+    void record(const StatusSource& source, const StatusSample& sample) {
+        append(source.snHash(), sample.timestamp_ns, sample.status);
+    }
+
+    uint64_t written() const { return written_.load(std::memory_order_relaxed); }
+    uint64_t dropped() const { return dropped_.load(std::memory_order_relaxed); }
+
+private:
+    struct Segment {
+        int fd = -1;
+        uint64_t index = 0;
+        size_t bytes = 0;
+        JournalRecord* records = nullptr;
+    };
+
+    bool mapSegment(uint64_t index, Segment& segment);
+    void unmapSegment(Segment& segment, bool discard);
+    void retireSegment(Segment& segment);
+    void rotatorLoop();
+
+    std::string directory_;
+    size_t capacity_;
+    size_t keep_segments_;
+    uint64_t oldest_;
+
+    // Writer state
+    Segment current_;
+    size_t next_slot_;
+    std::atomic<uint64_t> written_{0};
+    std::atomic<uint64_t> dropped_{0};
+
+    // Handoff with the rotation thread
+    Segment spare_;
+    std::atomic<bool> spare_ready_{false};
+    std::mutex mutex_;
+    std::condition_variable cond_;
+    Segment retired_;
+    bool rotate_pending_;
+    bool stopping_;
+    uint64_t next_index_;
+    std::thread rotator_;
+};
+
+// Sequential reader over every segment of a journal directory, oldest
+// first. Segments are mapped read-only one at a time; a segment that is
+// still being written is read up to its last committed record.
+class JournalReader {
+public:
+    JournalReader();
+    ~JournalReader();
+
+    JournalReader(const JournalReader&) = delete;
+    JournalReader& operator=(const JournalReader&) = delete;
+
+    // Returns false when the directory holds no readable segment
+    bool open(const std::string& directory);
+    void close();
+
+    // Copies the next committed record into `record`. Returns false at the end.
+    bool next(JournalRecord& record);
+    void rewind();
+
+    size_t segmentCount() const { return segments_.size(); }
+
+private:
+    bool mapSegment(size_t position);
+    void unmapSegment();
+
+    std::string directory_;
+    std::vector<uint64_t> segments_;
+    size_t position_;
+
+    const uint8_t* base_;
+    size_t bytes_;
+    const JournalRecord* records_;
+    size_t capacity_;
+    size_t slot_;
+};
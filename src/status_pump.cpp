@@ -0,0 +1,143 @@
+#include "status_pump.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <sys/epoll.h>
+
+uint64_t snHash(const std::string& sn) {
+    uint64_t hash = 1469598103934665603ull;
+    for (unsigned char c : sn) {
+        hash ^= c;
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+StatusSource::StatusSource(StatusPump* pump, std::string sn)
+    : pump_(pump), sn_(std::move(sn)), sn_hash_(::snHash(sn_)) {
+}
+
+StatusPump::StatusPump() = default;
+
+StatusPump::~StatusPump() {
+    stop();
+}
+
+void StatusPump::addSink(Sink sink) {
+    sinks_.push_back(std::move(sink));
+}
+
+StatusSource* StatusPump::addSource(const std::string& sn) {
+    std::unique_ptr<StatusSource> source(new StatusSource(this, sn));
+    StatusSource* raw = source.get();
+    std::lock_guard<std::mutex> lock(sources_mutex_);
+    sources_.push_back(std::move(source));
+    return raw;
+}
+
+void StatusPump::removeSource(StatusSource* source) {
+    {
+        std::lock_guard<std::mutex> lock(retired_mutex_);
+        retired_.push_back(source);
+    }
+    // Freed by the next drain()
+    notify();
+}
+
+bool StatusPump::start() {
+    if (thread_.joinable()) {
+        return true;
+    }
+    if (!reactor_.valid() || !ready_.valid()) {
+        return false;
+    }
+    reactor_.add(ready_.fd(), EPOLLIN, [this](uint32_t) { ready_.drain(); });
+    thread_ = std::thread(&StatusPump::run, this);
+    return true;
+}
+
+void StatusPump::stop() {
+    if (!thread_.joinable()) {
+        return;
+    }
+    reactor_.stop();
+    thread_.join();
+}
+
+void StatusPump::onDeviceStatus(void* param, const void* data) {
+    auto* source = static_cast<StatusSource*>(param);
+    StatusSample sample;
+    sample.timestamp_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+    std::memcpy(&sample.status, data, sizeof(sample.status));
+
+    if (!source->ring_.tryPush(sample)) {
+        source->dropped_.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    source->pump_->notify();
+}
+
+void StatusPump::notify() {
+    // Pairs with the fence in run(): either the consumer sees the new sample
+    // before parking, or we see it parked and wake it. No syscall while the
+    // consumer is busy.
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (sleeping_.load(std::memory_order_relaxed)) {
+        ready_.signal();
+    }
+}
+
+void StatusPump::drain() {
+    // Sinks run without sources_mutex_ so they may take other locks, such
+    // as the fleet's, that are held around addSource(). Only this thread
+    // frees sources, so the pointers stay valid.
+    {
+        std::lock_guard<std::mutex> lock(sources_mutex_);
+        draining_.clear();
+        for (auto& source : sources_) {
+            draining_.push_back(source.get());
+        }
+    }
+    StatusSample sample;
+    for (StatusSource* source : draining_) {
+        while (source->ring_.tryPop(sample)) {
+            for (auto& sink : sinks_) {
+                sink(*source, sample);
+            }
+        }
+    }
+
+    std::vector<StatusSource*> retired;
+    {
+        std::lock_guard<std::mutex> retired_lock(retired_mutex_);
+        retired.swap(retired_);
+    }
+    if (retired.empty()) {
+        return;
+    }
+    std::lock_guard<std::mutex> lock(sources_mutex_);
+    for (StatusSource* source : retired) {
+        sources_.remove_if([source](const std::unique_ptr<StatusSource>& s) { return s.get() == source; });
+    }
+}
+
+void StatusPump::run() {
+    while (!reactor_.stopped()) {
+        drain();
+
+        sleeping_.store(true, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        bool pending;
+        {
+            std::lock_guard<std::mutex> lock(sources_mutex_);
+            pending = std::any_of(sources_.begin(), sources_.end(),
+                                  [](const std::unique_ptr<StatusSource>& s) { return !s->ring_.empty(); });
+        }
+        if (!pending) {
+            reactor_.poll(-1);
+        }
+        sleeping_.store(false, std::memory_order_relaxed);
+    }
+    drain();
+}
@@ -0,0 +1,96 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <dev/dev.hpp>
+
+#include "reactor.hpp"
+#include "spsc_ring.hpp"
+
+// One status push from the SDK, stamped on arrival
+struct StatusSample {
+    uint64_t timestamp_ns; // wall clock, nanoseconds since the epoch
+    Device::CameraStatus status;
+};
+
+class StatusPump;
+
+// 64-bit FNV-1a of a device SN, used as a compact device key
+uint64_t snHash(const std::string& sn);
+
+// Per-device producer endpoint. Its address is the `param` handed to
+// Device::setDevStatusCallbackFunc together with StatusPump::onDeviceStatus.
+class StatusSource {
+public:
+    static constexpr size_t kRingCapacity = 64;
+
+    const std::string& sn() const { return sn_; }
+    uint64_t snHash() const { return sn_hash_; }
+    uint64_t dropped() const { return dropped_.load(std::memory_order_relaxed); }
+
+private:
+    friend class StatusPump;
+
+    StatusSource(StatusPump* pump, std::string sn);
+
+    StatusPump* pump_;
+    std::string sn_;
+    uint64_t sn_hash_;
+    std::atomic<uint64_t> dropped_{0};
+    SpscRing<StatusSample, kRingCapacity> ring_;
+};
+
+// Moves status handling off the SDK callback threads. Each device pushes
+// into its own SPSC ring; a single consumer thread drains all rings and fans
+// the samples out to the registered sinks.
+class StatusPump {
+public:
+    using Sink = std::function<void(const StatusSource& source, const StatusSample& sample)>;
+
+    StatusPump();
+    ~StatusPump();
+
+    StatusPump(const StatusPump&) = delete;
+    StatusPump& operator=(const StatusPump&) = delete;
+
+    // Sinks run on the consumer thread, without any pump lock held;
+    // register them before start()
+    void addSink(Sink sink);
+
+    // The returned source stays valid until removeSource(). Disable the
+    // device's status callback before removing its source. The source is
+    // freed by the consumer thread once it has drained it, so removeSource()
+    // may be called from a sink.
+    StatusSource* addSource(const std::string& sn);
+    void removeSource(StatusSource* source);
+
+    bool start();
+    void stop();
+
+    // Device::DevStatusCallback, param must be a StatusSource*
+    static void onDeviceStatus(void* param, const void* data);
+
+private:
+    void notify();
+    void drain();
+    void run();
+
+    Reactor reactor_;
+    EventFd ready_;
+    std::atomic<bool> sleeping_{false};
+    std::thread thread_;
+
+    std::vector<Sink> sinks_;
+    std::mutex sources_mutex_;
+    std::list<std::unique_ptr<StatusSource>> sources_;
+    std::mutex retired_mutex_; // never held while taking sources_mutex_
+    std::vector<StatusSource*> retired_;
+    std::vector<StatusSource*> draining_; // consumer thread only
+};
@@ -0,0 +1,94 @@
+#include "status_replay.hpp"
+
+#include <chrono>
+#include <cinttypes>
+#include <cstdio>
+#include <thread>
+
+namespace {
+
+std::string replaySn(uint64_t sn_hash) {
+    char sn[24];
+    std::snprintf(sn, sizeof(sn), "RPL%016" PRIx64, sn_hash);
+    return sn;
+}
+
+} // namespace
+
+StatusReplay::StatusReplay()
+    : record_count_(0), first_ns_(0), last_ns_(0), changed_param_(nullptr) {
+}
+
+bool StatusReplay::open(const std::string& directory) {
+    sns_.clear();
+    targets_.clear();
+    record_count_ = 0;
+    if (!reader_.open(directory)) {
+        return false;
+    }
+
+    JournalRecord record;
+    while (reader_.next(record)) {
+        if (record_count_++ == 0) {
+            first_ns_ = record.timestamp_ns;
+        }
+        last_ns_ = record.timestamp_ns;
+        if (targets_.find(record.sn_hash) == targets_.end()) {
+            std::string sn = replaySn(record.sn_hash);
+            sns_.push_back(sn);
+            targets_[record.sn_hash].sn = sn;
+        }
+    }
+    reader_.rewind();
+    return record_count_ > 0;
+}
+
+void StatusReplay::setDevChangedCallback(Devices::devChangedCallback callback, void* param) {
+    changed_ = std::move(callback);
+    changed_param_ = param;
+}
+
+void StatusReplay::setDevStatusCallbackFunc(const std::string& sn, Device::DevStatusCallback callback,
+                                            void* param) {
+    for (auto& entry : targets_) {
+        if (entry.second.sn == sn) {
+            entry.second.callback = std::move(callback);
+            entry.second.param = param;
+            return;
+        }
+    }
+}
+
+uint64_t StatusReplay::run(double speed) {
+    using Clock = std::chrono::steady_clock;
+    stop_.store(false, std::memory_order_relaxed);
+
+    if (changed_) {
+        for (auto& sn : sns_) {
+            changed_(sn, true, changed_param_);
+        }
+    }
+
+    uint64_t delivered = 0;
+    const auto start = Clock::now();
+    JournalRecord record;
+    reader_.rewind();
+    while (!stop_.load(std::memory_order_relaxed) && reader_.next(record)) {
+        if (speed > 0 && record.timestamp_ns > first_ns_) {
+            auto offset = std::chrono::duration<double, std::nano>((record.timestamp_ns - first_ns_) / speed);
+            std::this_thread::sleep_until(start + std::chrono::duration_cast<Clock::duration>(offset));
+        }
+        auto it = targets_.find(record.sn_hash);
+        if (it != targets_.end() && it->second.callback) {
+            it->second.callback(it->second.param, &record.status);
+            ++delivered;
+        }
+    }
+
+    if (changed_) {
+        for (auto& sn : sns_) {
+            changed_(sn, false, changed_param_);
+        }
+    }
+    return delivered;
+}
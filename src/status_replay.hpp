@@ -0,0 +1,67 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <dev/devs.hpp>
+
+#include "status_journal.hpp"
+
+// Plays a recorded status journal back through the same callback shapes the
+// SDK uses: a Devices::devChangedCallback for plug/unplug and one
+// Device::DevStatusCallback per device. Lets the status path run without
+// cameras attached.
+//
+// The journal only keeps SN hashes, so replayed devices get synthetic SNs
+// ("RPL" followed by the hash in hex).
+class StatusReplay {
+public:
+    // speed > 0 plays back at that multiple of the recorded pace (1 is real
+    // time); kAsFastAsPossible ignores the timestamps
+    static constexpr double kAsFastAsPossible = 0;
+
+    StatusReplay();
+
+    StatusReplay(const StatusReplay&) = delete;
+    StatusReplay& operator=(const StatusReplay&) = delete;
+
+    // Scans the journal and collects its devices. Returns false when it has
+    // no records.
+    bool open(const std::string& directory);
+
+    const std::vector<std::string>& devices() const { return sns_; }
+    uint64_t recordCount() const { return record_count_; }
+    uint64_t recordedSpanNs() const { return last_ns_ - first_ns_; }
+
+    // Set before run(). Like the SDK, the changed callback is the place to
+    // register per-device status callbacks.
+    void setDevChangedCallback(Devices::devChangedCallback callback, void* param);
+    void setDevStatusCallbackFunc(const std::string& sn, Device::DevStatusCallback callback, void* param);
+
+    // Announces every device, plays the journal on the calling thread, then
+    // unplugs them. Returns the number of status pushes delivered.
+    uint64_t run(double speed);
+
+    // May be called from any thread; run() returns after the current record
+    void stop() { stop_.store(true, std::memory_order_relaxed); }
+
+private:
+    struct Target {
+        std::string sn;
+        Device::DevStatusCallback callback;
+        void* param = nullptr;
+    };
+
+    JournalReader reader_;
+    std::vector<std::string> sns_;
+    std::unordered_map<uint64_t, Target> targets_;
+    uint64_t record_count_;
+    uint64_t first_ns_;
+    uint64_t last_ns_;
+
+    Devices::devChangedCallback changed_;
+    void* changed_param_;
+    std::atomic<bool> stop_{false};
+};
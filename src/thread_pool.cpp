@@ -0,0 +1,66 @@
+#include "thread_pool.hpp"
+
+ThreadPool::ThreadPool(size_t threads)
+    : stopping_(false) {
+    ensureThreads(threads == 0 ? 1 : threads);
+}
+
+ThreadPool::~ThreadPool() {
+    shutdown();
+}
+
+bool ThreadPool::post(Task task) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (stopping_) {
+            return false;
+        }
+        tasks_.push_back(std::move(task));
+    }
+    cond_.notify_one();
+    return true;
+}
+
+void ThreadPool::ensureThreads(size_t threads) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (stopping_) {
+        return;
+    }
+    while (threads_.size() < threads) {
+        threads_.emplace_back(&ThreadPool::worker, this);
+    }
+}
+
+size_t ThreadPool::size() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return threads_.size();
+}
+
+void ThreadPool::shutdown() {
+    std::vector<std::thread> threads;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+        threads.swap(threads_);
+    }
+    cond_.notify_all();
+    for (auto& thread : threads) {
+        thread.join();
+    }
+}
+
+void ThreadPool::worker() {
+    for (;;) {
+        Task task;
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            cond_.wait(lock, [this] { return stopping_ || !tasks_.empty(); });
+            if (tasks_.empty()) {
+                return;
+            }
+            task = std::move(tasks_.front());
+            tasks_.pop_front();
+        }
+        task();
+    }
+}
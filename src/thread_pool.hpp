@@ -0,0 +1,41 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Plain FIFO worker pool. Workers may block inside SDK calls, so the pool can
+// be grown at runtime to keep at least one thread per busy camera.
+class ThreadPool {
+public:
+    using Task = std::function<void()>;
+
+    explicit ThreadPool(size_t threads);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    // Returns false once the pool is shutting down
+    bool post(Task task);
+
+    // Grow the pool to at least `threads` workers
+    void ensureThreads(size_t threads);
+    size_t size() const;
+
+    // Finish queued tasks and join all workers
+    void shutdown();
+
+private:
+    void worker();
+
+    mutable std::mutex mutex_;
+    std::condition_variable cond_;
+    std::deque<Task> tasks_;
+    std::vector<std::thread> threads_;
+    bool stopping_;
+};